@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON outputs, a baseline and a candidate.
+
+Record each run with, for example:
+
+  bazel run -c opt //util/data_structs:red_black_tree_benchmark -- \
+      --benchmark_out=/tmp/base.json --benchmark_out_format=json \
+      --benchmark_repetitions=5
+
+then compare them with:
+
+  tools/compare_benchmarks.py /tmp/base.json /tmp/candidate.json
+
+With repetitions, the median of each benchmark is compared, and the runs
+otherwise. Exits with status 1 if `--fail_above` is given and any benchmark is
+slower by more than that percentage.
+"""
+
+import argparse
+import json
+import re
+import sys
+
+_NS_PER_UNIT = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load_times(path, metric):
+    """Returns {benchmark name: time in ns} from a benchmark JSON file."""
+    with open(path) as f:
+        benchmarks = json.load(f)["benchmarks"]
+
+    medians = {}
+    runs = {}
+    for b in benchmarks:
+        if "error_occurred" in b and b["error_occurred"]:
+            continue
+        aggregate = b.get("run_type") == "aggregate"
+        # Of the aggregates only medians are compared. Others, such as the
+        # _BigO and _RMS rows of complexity benchmarks, have no time.
+        if aggregate and b.get("aggregate_name") != "median":
+            continue
+        time = b[metric] * _NS_PER_UNIT[b.get("time_unit", "ns")]
+        if aggregate:
+            medians[b["run_name"]] = time
+        else:
+            name = b.get("run_name", b["name"])
+            # Without repetitions there is one run per benchmark; with them but
+            # no aggregates, keep the fastest.
+            runs[name] = min(time, runs.get(name, time))
+    runs.update(medians)
+    return runs
+
+
+def format_ns(ns):
+    for unit in ("s", "ms", "us"):
+        if ns >= _NS_PER_UNIT[unit]:
+            return "%.3g %s" % (ns / _NS_PER_UNIT[unit], unit)
+    return "%.3g ns" % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument(
+        "--metric",
+        choices=("real_time", "cpu_time"),
+        default="cpu_time",
+        help="the time to compare (default: %(default)s)",
+    )
+    parser.add_argument(
+        "--filter", default="", help="only compare benchmarks matching this regex"
+    )
+    parser.add_argument(
+        "--fail_above",
+        type=float,
+        default=None,
+        help="fail if any benchmark slows down by more than this percentage",
+    )
+    args = parser.parse_args()
+
+    baseline = load_times(args.baseline, args.metric)
+    candidate = load_times(args.candidate, args.metric)
+    pattern = re.compile(args.filter)
+    names = [n for n in baseline if n in candidate and pattern.search(n)]
+    if not names:
+        print("No benchmarks in common.", file=sys.stderr)
+        return 2
+
+    width = max(len(n) for n in names)
+    print("%-*s %12s %12s %9s" % (width, "Benchmark", "Baseline", "Candidate", "Change"))
+    regressions = []
+    for name in names:
+        change = 100.0 * (candidate[name] - baseline[name]) / baseline[name]
+        print(
+            "%-*s %12s %12s %+8.1f%%"
+            % (width, name, format_ns(baseline[name]), format_ns(candidate[name]), change)
+        )
+        if args.fail_above is not None and change > args.fail_above:
+            regressions.append(name)
+
+    for side, times, other in (
+        ("baseline", baseline, candidate),
+        ("candidate", candidate, baseline),
+    ):
+        only = [n for n in times if n not in other and pattern.search(n)]
+        if only:
+            print("%d benchmark(s) only in %s" % (len(only), side), file=sys.stderr)
+
+    if regressions:
+        print(
+            "%d benchmark(s) slower by more than %g%%: %s"
+            % (len(regressions), args.fail_above, ", ".join(regressions)),
+            file=sys.stderr,
+        )
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,65 @@
+#include "util/absl_util.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace util {
+
+namespace {
+
+thread_local StatusTrace status_trace;
+
+// Whether `status` is the same error instance as `traced`, rather than just an
+// equal one. Copies and moves of a status share its representation, which
+// holds the message, so their messages are at the same address. The trace
+// holds on to the traced status, so a new error cannot reuse its address.
+// Errors without a message have no representation, and are only compared.
+bool IsTracedError(const absl::Status& status, const absl::Status& traced) {
+  return status == traced && status.message().data() == traced.message().data();
+}
+
+}  // namespace
+
+std::string StatusTrace::ToString() const {
+  std::string result;
+  for (const StatusTraceEntry& entry : entries()) {
+    absl::StrAppend(&result, result.empty() ? "" : " <- ", entry.file, ":",
+                    entry.line);
+  }
+  if (dropped_ != 0) {
+    absl::StrAppend(&result, " <- (", dropped_, " more)");
+  }
+  return result;
+}
+
+const StatusTrace& GetStatusTrace(const absl::Status& status) {
+  static const StatusTrace kEmpty;
+  if (status.ok() || status_trace.empty() ||
+      !IsTracedError(status, status_trace.status_)) {
+    return kEmpty;
+  }
+  return status_trace;
+}
+
+namespace internal {
+
+void RecordStatusTrace(const absl::Status& status, const char* file,
+                       int line) {
+  StatusTrace& trace = status_trace;
+  if (trace.empty() || !IsTracedError(status, trace.status_)) {
+    trace.status_ = status;
+    trace.size_ = 0;
+    trace.dropped_ = 0;
+  }
+  if (trace.size_ == StatusTrace::kCapacity) {
+    trace.dropped_++;
+    return;
+  }
+  trace.entries_[trace.size_++] = { .file = file, .line = line };
+}
+
+}  // namespace internal
+
+}  // namespace util
@@ -1,32 +1,156 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "absl/base/attributes.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 
 #include "util/macro_util.h"
 
-#define RETURN_IF_ERROR(expr)      \
-  do {                             \
-    absl::Status _status = (expr); \
-    if (!_status.ok())             \
-      return _status;              \
-  } while (0)
+// Status traces are kept in debug builds, and can be turned on in optimized
+// builds with -DUTIL_STATUS_TRACE=1. Either way they cost nothing on the
+// success path of the macros below.
+#ifndef UTIL_STATUS_TRACE
+#ifdef UTIL_NDEBUG
+#define UTIL_STATUS_TRACE 0
+#else
+#define UTIL_STATUS_TRACE 1
+#endif
+#endif
 
-template <typename T>
-absl::Status DoAssignOrReturn(T &lhs, absl::StatusOr<T> result) {
-  if (result.ok()) {
-    lhs = result.value();
+namespace util {
+
+inline constexpr bool kStatusTraceEnabled = UTIL_STATUS_TRACE;
+
+namespace internal {
+
+// Appends a status macro location to the trace of `status`, starting a new
+// trace if it is not the error being traced (see `GetStatusTrace`).
+void RecordStatusTrace(const absl::Status& status, const char* file, int line);
+
+}  // namespace internal
+
+// A status macro which returned an error.
+struct StatusTraceEntry {
+  const char* file;
+  int line;
+};
+
+// The status macros an error was returned through, innermost first. The
+// entries point at static strings and are held inline, so recording one never
+// allocates. Past `kCapacity`, the outermost entries are only counted.
+class StatusTrace {
+ public:
+  static constexpr size_t kCapacity = 16;
+
+  absl::Span<const StatusTraceEntry> entries() const {
+    return absl::MakeConstSpan(entries_.data(), size_);
+  }
+
+  // The number of entries which did not fit.
+  size_t dropped() const {
+    return dropped_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
   }
-  return result.status();
+
+  // Formats the trace as "file:line <- file:line ...".
+  std::string ToString() const;
+
+ private:
+  friend const StatusTrace& GetStatusTrace(const absl::Status& status);
+  friend void internal::RecordStatusTrace(const absl::Status& status,
+                                          const char* file, int line);
+
+  // The traced error. It shares its representation with the error being
+  // propagated, so holding it does not allocate.
+  absl::Status status_;
+  std::array<StatusTraceEntry, kCapacity> entries_ = {};
+  size_t size_ = 0;
+  size_t dropped_ = 0;
+};
+
+// Returns the trace of `status` if it is the error last returned through a
+// status macro on this thread, and an empty trace otherwise. Each new error
+// starts a new trace, even if it equals the one being traced, while copies and
+// moves of an error continue its trace. Errors without a message are the
+// exception: they are only told apart by their code, so an equal one
+// continues the trace.
+//
+// Example:
+//   absl::Status status = Run();
+//   if (!status.ok()) {
+//     LOG(ERROR) << status << " via " << GetStatusTrace(status).ToString();
+//   }
+const StatusTrace& GetStatusTrace(const absl::Status& status);
+
+namespace internal {
+
+// The error paths of the macros below call these, which are out of line and
+// marked cold, so that the compiler moves the error handling away from the
+// success path of the caller.
+ABSL_ATTRIBUTE_COLD ABSL_ATTRIBUTE_NOINLINE inline absl::Status ReturnError(
+    absl::Status&& status) {
+  return std::move(status);
 }
 
-#define ASSIGN_OR_RETURN_IMPL(status, lhs, ...)               \
-  absl::Status status = DoAssignOrReturn(lhs, (__VA_ARGS__)); \
-  if (!(status).ok())                                         \
-    return status;
+template <typename T>
+ABSL_ATTRIBUTE_COLD ABSL_ATTRIBUTE_NOINLINE absl::Status ReturnError(
+    absl::StatusOr<T>&& status_or) {
+  return std::move(status_or).status();
+}
 
-// Executes an expression that returns a util::StatusOr, extracting its value
-// into the variable defined by lhs (or returning on error).
+// As above, also recording the location of the macro in the status trace.
+ABSL_ATTRIBUTE_COLD ABSL_ATTRIBUTE_NOINLINE inline absl::Status ReturnError(
+    absl::Status&& status, const char* file, int line) {
+  RecordStatusTrace(status, file, line);
+  return std::move(status);
+}
+
+template <typename T>
+ABSL_ATTRIBUTE_COLD ABSL_ATTRIBUTE_NOINLINE absl::Status ReturnError(
+    absl::StatusOr<T>&& status_or, const char* file, int line) {
+  absl::Status status = std::move(status_or).status();
+  RecordStatusTrace(status, file, line);
+  return status;
+}
+
+}  // namespace internal
+
+}  // namespace util
+
+#if UTIL_STATUS_TRACE
+#define RETURN_ERROR_IMPL(status) \
+  ::util::internal::ReturnError(std::move(status), __FILE__, __LINE__)
+#else
+#define RETURN_ERROR_IMPL(status) ::util::internal::ReturnError(std::move(status))
+#endif
+
+#define RETURN_IF_ERROR(expr)            \
+  do {                                   \
+    absl::Status _status = (expr);       \
+    if (!_status.ok()) [[unlikely]] {    \
+      return RETURN_ERROR_IMPL(_status); \
+    }                                    \
+  } while (0)
+
+#define ASSIGN_OR_RETURN_IMPL(tmp, lhs, ...) \
+  auto tmp = (__VA_ARGS__);                  \
+  if (!(tmp).ok()) [[unlikely]] {            \
+    return RETURN_ERROR_IMPL(tmp);           \
+  }                                          \
+  lhs = *std::move(tmp)  // NOLINT(bugprone-macro-parentheses)
+
+// Executes an expression that returns an absl::StatusOr, moving its value into
+// the variable defined by lhs (or returning on error). The value may be of a
+// move-only type.
 //
 // Example: Assigning to an existing value
 //   ValueType value;
@@ -36,18 +160,19 @@ absl::Status DoAssignOrReturn(T &lhs, absl::StatusOr<T> result) {
 //  in a single statement (e.g. as the body of an if statement without {})!
 #define ASSIGN_OR_RETURN(lhs, ...)                                             \
   ASSIGN_OR_RETURN_IMPL(UTILS_CONCAT_NAME(_status_or_value, __COUNTER__), lhs, \
-                        __VA_ARGS__);
+                        __VA_ARGS__)
 
 #define DEFINE_OR_RETURN_IMPL(type, lhs, tmp, ...) \
   absl::StatusOr<type> tmp = (__VA_ARGS__);        \
-  if (!(tmp).ok()) {                               \
-    return (tmp).status();                         \
+  if (!(tmp).ok()) [[unlikely]] {                  \
+    return RETURN_ERROR_IMPL(tmp);                 \
   }                                                \
-  type &lhs = (tmp).value()  // NOLINT(bugprone-macro-parentheses)
+  type &lhs = *(tmp)  // NOLINT(bugprone-macro-parentheses)
 
 // Executes an expression that returns an absl::StatusOr<T>, and defines a new
 // variable with given type and name to the result if the error code is OK. If
-// the Status is non-OK, returns the error.
+// the Status is non-OK, returns the error. The variable refers to the value in
+// place, so it is neither copied nor moved.
 #define DEFINE_OR_RETURN(type, lhs, ...)                                     \
   DEFINE_OR_RETURN_IMPL(type, lhs,                                           \
                         UTILS_CONCAT_NAME(__define_or_return_, __COUNTER__), \
@@ -0,0 +1,157 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/base/attributes.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+
+#include "util/absl_util.h"
+
+namespace util {
+
+namespace {
+
+// The number of calls per benchmark iteration.
+constexpr size_t kCallsPerIteration = 1024;
+
+// Fails only for an input the benchmarks never pass, so that the error paths
+// cannot be optimized out.
+ABSL_ATTRIBUTE_NOINLINE absl::Status Check(uint64_t i) {
+  if (i == UINT64_MAX) {
+    return absl::InternalError("Failed");
+  }
+  return absl::OkStatus();
+}
+
+ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<uint64_t> MakeInt(uint64_t i) {
+  if (i == UINT64_MAX) {
+    return absl::InternalError("Failed");
+  }
+  return i;
+}
+
+// Long enough to be heap-allocated, so that copying it would show.
+ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<std::string> MakeString(uint64_t i) {
+  if (i == UINT64_MAX) {
+    return absl::InternalError("Failed");
+  }
+  return std::string(64, static_cast<char>('a' + i % 26));
+}
+
+ABSL_ATTRIBUTE_NOINLINE absl::Status ReturnIfErrorMacro(uint64_t i) {
+  RETURN_IF_ERROR(Check(i));
+  RETURN_IF_ERROR(Check(i + 1));
+  return absl::OkStatus();
+}
+
+ABSL_ATTRIBUTE_NOINLINE absl::Status ReturnIfErrorByHand(uint64_t i) {
+  absl::Status status = Check(i);
+  if (!status.ok()) {
+    return status;
+  }
+  status = Check(i + 1);
+  if (!status.ok()) {
+    return status;
+  }
+  return absl::OkStatus();
+}
+
+// Always fails, with a shared error, so that only propagating it is measured.
+ABSL_ATTRIBUTE_NOINLINE absl::Status Fail(uint64_t i) {
+  static const absl::Status& kError = *new absl::Status(
+      absl::InternalError("Failed"));
+  benchmark::DoNotOptimize(i);
+  return kError;
+}
+
+ABSL_ATTRIBUTE_NOINLINE absl::Status ReturnIfErrorFailing(uint64_t i) {
+  RETURN_IF_ERROR(Fail(i));
+  return absl::OkStatus();
+}
+
+template <typename MakeFn>
+ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<size_t> AssignOrReturnMacro(
+    MakeFn make, uint64_t i) {
+  typename decltype(make(i))::value_type value;
+  ASSIGN_OR_RETURN(value, make(i));
+  return sizeof(value);
+}
+
+template <typename MakeFn>
+ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<size_t> AssignOrReturnByHand(
+    MakeFn make, uint64_t i) {
+  typename decltype(make(i))::value_type value;
+  auto status_or = make(i);
+  if (!status_or.ok()) {
+    return status_or.status();
+  }
+  value = *std::move(status_or);
+  return sizeof(value);
+}
+
+template <typename MakeFn>
+ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<size_t> DefineOrReturnMacro(MakeFn make,
+                                                                   uint64_t i) {
+  using T = typename decltype(make(i))::value_type;
+  DEFINE_OR_RETURN(T, value, make(i));
+  return sizeof(value);
+}
+
+void BM_ReturnIfErrorMacro(benchmark::State& state) {
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < kCallsPerIteration; i++) {
+      benchmark::DoNotOptimize(ReturnIfErrorMacro(i));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kCallsPerIteration);
+}
+
+void BM_ReturnIfErrorByHand(benchmark::State& state) {
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < kCallsPerIteration; i++) {
+      benchmark::DoNotOptimize(ReturnIfErrorByHand(i));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kCallsPerIteration);
+}
+
+// Measures the error path, which records the status trace if it is enabled.
+void BM_ReturnIfErrorFailing(benchmark::State& state) {
+  for (auto _ : state) {
+    for (uint64_t i = 0; i < kCallsPerIteration; i++) {
+      benchmark::DoNotOptimize(ReturnIfErrorFailing(i));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kCallsPerIteration);
+}
+
+#define STATUS_OR_BENCHMARK(name, make)                               \
+  void BM_##name##_##make(benchmark::State& state) {                  \
+    for (auto _ : state) {                                            \
+      for (uint64_t i = 0; i < kCallsPerIteration; i++) {             \
+        benchmark::DoNotOptimize(name(make, i));                      \
+      }                                                               \
+    }                                                                 \
+    state.SetItemsProcessed(state.iterations() * kCallsPerIteration); \
+  }                                                                   \
+  BENCHMARK(BM_##name##_##make)
+
+STATUS_OR_BENCHMARK(AssignOrReturnMacro, MakeInt);
+STATUS_OR_BENCHMARK(AssignOrReturnByHand, MakeInt);
+STATUS_OR_BENCHMARK(DefineOrReturnMacro, MakeInt);
+STATUS_OR_BENCHMARK(AssignOrReturnMacro, MakeString);
+STATUS_OR_BENCHMARK(AssignOrReturnByHand, MakeString);
+STATUS_OR_BENCHMARK(DefineOrReturnMacro, MakeString);
+
+#undef STATUS_OR_BENCHMARK
+
+BENCHMARK(BM_ReturnIfErrorMacro);
+BENCHMARK(BM_ReturnIfErrorByHand);
+BENCHMARK(BM_ReturnIfErrorFailing);
+
+}  // namespace
+
+}  // namespace util
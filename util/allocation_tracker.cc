@@ -0,0 +1,154 @@
+#include "util/allocation_tracker.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace util {
+
+namespace internal {
+
+namespace {
+
+// Trivially constructed and destroyed, so that `operator new` can count into it
+// from any thread at any time, including during thread exit.
+constinit thread_local AllocationCounts thread_allocation_counts;
+
+}  // namespace
+
+const AllocationCounts& ThreadAllocationCounts() {
+  return thread_allocation_counts;
+}
+
+namespace {
+
+// Allocates as the default `operator new` does: retries through the new
+// handler until it frees enough memory, and throws if there is none.
+void* Allocate(size_t size, size_t alignment) {
+  thread_allocation_counts.allocations++;
+  thread_allocation_counts.bytes += size;
+  if (size == 0) {
+    size = 1;
+  }
+  while (true) {
+    void* ptr = nullptr;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+      ptr = std::malloc(size);
+    } else if (posix_memalign(&ptr, alignment, size) != 0) {
+      ptr = nullptr;
+    }
+    if (ptr != nullptr) {
+      return ptr;
+    }
+    const std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void* AllocateNoThrow(size_t size, size_t alignment) noexcept {
+  try {
+    return Allocate(size, alignment);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+}  // namespace
+
+}  // namespace internal
+
+}  // namespace util
+
+// The replacement global allocation functions (see
+// `util::internal::ThreadAllocationCounts`). Every form is replaced, so that
+// memory is never allocated by one implementation and freed by another, such
+// as a sanitizer's.
+
+void* operator new(size_t size) {
+  return util::internal::Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t size) {
+  return util::internal::Allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return util::internal::Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return util::internal::Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return util::internal::AllocateNoThrow(size,
+                                         __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return util::internal::AllocateNoThrow(size,
+                                         __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return util::internal::AllocateNoThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return util::internal::AllocateNoThrow(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
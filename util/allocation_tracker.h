@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+// Counts heap allocations, for tests which check that code does not allocate.
+// Linking this library replaces the global `operator new` and `operator
+// delete` of the whole binary with ones which count each thread's
+// allocations, so only tests which use it should depend on it.
+
+namespace util {
+
+// Heap allocations through the global `operator new`.
+struct AllocationCounts {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+namespace internal {
+
+// Every allocation the calling thread has made. Counted by the replacement
+// global `operator new` and `operator delete` of allocation_tracker.cc, which
+// allocate with `malloc`.
+const AllocationCounts& ThreadAllocationCounts();
+
+}  // namespace internal
+
+// Counts the heap allocations the calling thread makes over its lifetime.
+// Allocations made by other threads, such as those of a thread pool the code
+// under test hands work to, are not counted.
+//
+// Example:
+//   ScopedAllocationTracker tracker;
+//   tree.Insert(&element);
+//   EXPECT_EQ(tracker.counts().allocations, 0);
+class ScopedAllocationTracker {
+ public:
+  ScopedAllocationTracker() : start_(internal::ThreadAllocationCounts()) {}
+
+  ScopedAllocationTracker(const ScopedAllocationTracker&) = delete;
+  ScopedAllocationTracker& operator=(const ScopedAllocationTracker&) = delete;
+
+  // The allocations since construction.
+  AllocationCounts counts() const {
+    const AllocationCounts& now = internal::ThreadAllocationCounts();
+    return {
+      .allocations = now.allocations - start_.allocations,
+      .bytes = now.bytes - start_.bytes,
+    };
+  }
+
+ private:
+  const AllocationCounts start_;
+};
+
+}  // namespace util
+
+#define ALLOCATIONS_LE_IMPL(check, n, ...)                                  \
+  do {                                                                      \
+    const ::util::ScopedAllocationTracker _allocation_tracker;              \
+    __VA_ARGS__;                                                            \
+    const ::util::AllocationCounts _allocations =                           \
+        _allocation_tracker.counts();                                       \
+    check(_allocations.allocations, static_cast<uint64_t>(n))             \
+        << #__VA_ARGS__ << " made " << _allocations.allocations            \
+        << " allocations of " << _allocations.bytes << " bytes in total";  \
+  } while (false)
+
+// Executes a statement, and generates a test failure if the calling thread made
+// more than `n` heap allocations in it. The `ASSERT_` variant also returns from
+// the current function, which must have a void return type.
+//
+// Example:
+//   EXPECT_ALLOCATIONS_LE(1, vec.push_back(value));
+//   EXPECT_NO_ALLOCATIONS(tree.Insert(&element));
+#define EXPECT_ALLOCATIONS_LE(n, ...) \
+  ALLOCATIONS_LE_IMPL(EXPECT_LE, n, __VA_ARGS__)
+#define ASSERT_ALLOCATIONS_LE(n, ...) \
+  ALLOCATIONS_LE_IMPL(ASSERT_LE, n, __VA_ARGS__)
+#define EXPECT_NO_ALLOCATIONS(...) EXPECT_ALLOCATIONS_LE(0, __VA_ARGS__)
+#define ASSERT_NO_ALLOCATIONS(...) ASSERT_ALLOCATIONS_LE(0, __VA_ARGS__)
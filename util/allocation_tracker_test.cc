@@ -0,0 +1,51 @@
+#include "util/allocation_tracker.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest-spi.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+TEST(AllocationTrackerTest, TestAllocationTracker) {
+  struct alignas(64) Aligned {
+    char data[64];
+  };
+
+  ScopedAllocationTracker tracker;
+  EXPECT_EQ(tracker.counts().allocations, 0);
+  {
+    auto value = std::make_unique<int64_t>(1);
+    auto aligned = std::make_unique<Aligned>();
+    auto array = std::make_unique<int32_t[]>(10);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned.get()) % 64, 0);
+  }
+  EXPECT_EQ(tracker.counts().allocations, 3);
+  EXPECT_EQ(tracker.counts().bytes, 8 + 64 + 40);
+
+  // Other threads count their own allocations. Starting one allocates its
+  // state in this thread, so this starts counting after.
+  std::thread thread([] {
+    ScopedAllocationTracker tracker;
+    std::vector<int> vec;
+    vec.reserve(100);
+    EXPECT_EQ(tracker.counts().allocations, 1);
+  });
+  ScopedAllocationTracker thread_tracker;
+  thread.join();
+  EXPECT_EQ(thread_tracker.counts().allocations, 0);
+}
+
+TEST(AllocationTrackerTest, TestAllocationMacros) {
+  EXPECT_NO_ALLOCATIONS(int value = 1; EXPECT_EQ(value, 1));
+  EXPECT_ALLOCATIONS_LE(1, auto value = std::make_unique<int32_t>(1));
+  ASSERT_ALLOCATIONS_LE(2, std::vector<int> vec = { 1, 2, 3 });
+  EXPECT_NONFATAL_FAILURE(
+      EXPECT_NO_ALLOCATIONS(auto value = std::make_unique<int32_t>(1)),
+      "made 1 allocations of 4 bytes in total");
+}
+
+}  // namespace util
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+
+#include "util/perf_counters.h"
+
+namespace util {
+
+// Reports the hardware counters of the calling thread over its scope as
+// per-iteration counters of a benchmark: "cycles", "instructions",
+// "LLC-misses" and "branch-misses", and their "IPC". Reports nothing where
+// perf events are unavailable (see `PerfCounters::Create`). Construct it just
+// before the benchmark loop, so that the setup is not counted. Sections of the
+// loop in `PauseTiming` are counted.
+//
+// Example:
+//   void BM_Insert(benchmark::State& state) {
+//     RbTree tree = MakeTree(state.range(0));
+//     BenchmarkPerfCounters perf(state);
+//     for (auto _ : state) {
+//       ...
+//     }
+//   }
+class BenchmarkPerfCounters {
+ public:
+  explicit BenchmarkPerfCounters(benchmark::State& state)
+      : state_(state), counters_(Counters()) {
+    if (counters_ != nullptr) {
+      start_ = counters_->Read();
+    }
+  }
+
+  BenchmarkPerfCounters(const BenchmarkPerfCounters&) = delete;
+  BenchmarkPerfCounters& operator=(const BenchmarkPerfCounters&) = delete;
+
+  ~BenchmarkPerfCounters() {
+    if (counters_ == nullptr) {
+      return;
+    }
+    const PerfCounts counts = PerfCounters::Between(start_, counters_->Read());
+    const auto per_iteration = [](uint64_t count) {
+      return benchmark::Counter(static_cast<double>(count),
+                                benchmark::Counter::kAvgIterations);
+    };
+    state_.counters["cycles"] = per_iteration(counts.cycles);
+    state_.counters["instructions"] = per_iteration(counts.instructions);
+    state_.counters["LLC-misses"] = per_iteration(counts.cache_misses);
+    state_.counters["branch-misses"] = per_iteration(counts.branch_misses);
+    state_.counters["IPC"] = counts.ipc();
+  }
+
+ private:
+  static const PerfCounters* Counters() {
+    const absl::StatusOr<PerfCounters>& counters =
+        PerfCounters::ForThisThread();
+    return counters.ok() ? &*counters : nullptr;
+  }
+
+  benchmark::State& state_;
+  const PerfCounters* counters_;
+  PerfCounters::Sample start_;
+};
+
+}  // namespace util
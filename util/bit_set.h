@@ -74,8 +74,11 @@ class BitSet {
   static constexpr size_t kArraySize = (N + kBitsPerEntry - 1) / kBitsPerEntry;
 
   // A mask over the bits that are part of the BitSet in the last entry of
-  // `data_`.
-  static constexpr I kRemainderMask = (I(0x1) << (N % kBitsPerEntry)) - 1;
+  // `data_`, which are all of them if `N` fills it.
+  static constexpr I kRemainderMask =
+      N % kBitsPerEntry == 0
+          ? static_cast<I>(~I(0))
+          : static_cast<I>((I(0x1) << (N % kBitsPerEntry)) - 1);
 
  public:
   using value_type = size_t;
@@ -220,6 +223,7 @@ BitSet<N, I>& BitSet<N, I>::operator&=(const BitSet<N, I>& b) {
   for (size_t idx = 0; idx < kArraySize; idx++) {
     data_[idx] &= b.data_[idx];
   }
+  return *this;
 }
 
 template <size_t N, typename I>
@@ -227,6 +231,7 @@ BitSet<N, I>& BitSet<N, I>::operator|=(const BitSet<N, I>& b) {
   for (size_t idx = 0; idx < kArraySize; idx++) {
     data_[idx] |= b.data_[idx];
   }
+  return *this;
 }
 
 template <size_t N, typename I>
@@ -234,6 +239,7 @@ BitSet<N, I>& BitSet<N, I>::operator^=(const BitSet<N, I>& b) {
   for (size_t idx = 0; idx < kArraySize; idx++) {
     data_[idx] ^= b.data_[idx];
   }
+  return *this;
 }
 
 template <size_t N, typename I>
@@ -302,7 +308,8 @@ constexpr size_t BitSet<N, I>::LeadingOnes() const {
   for (size_t idx = kArraySize - 1; idx < kArraySize; idx--) {
     size_t leading_ones;
     if (idx == kArraySize - 1) {
-      leading_ones = absl::countl_one(~kRemainderMask | data_[idx]);
+      leading_ones =
+          absl::countl_one(static_cast<I>(~kRemainderMask | data_[idx]));
     } else {
       leading_ones = absl::countl_one(data_[idx]);
     }
@@ -317,7 +324,7 @@ template <size_t N, typename I>
 constexpr size_t BitSet<N, I>::TrailingZeros(size_t from) const {
   auto [idx, bidx] = Idx(from);
   size_t trailing_zeros =
-      absl::countr_zero(data_[idx] & ~((I(0x1) << bidx) - 1));
+      absl::countr_zero(static_cast<I>(data_[idx] & ~((I(0x1) << bidx) - 1)));
   if (trailing_zeros < kBitsPerEntry) {
     return trailing_zeros + idx * kBitsPerEntry;
   }
@@ -333,7 +340,8 @@ constexpr size_t BitSet<N, I>::TrailingZeros(size_t from) const {
 template <size_t N, typename I>
 constexpr size_t BitSet<N, I>::TrailingOnes(size_t from) const {
   auto [idx, bidx] = Idx(from);
-  size_t trailing_ones = absl::countr_one(data_[idx] | ((I(0x1) << bidx) - 1));
+  size_t trailing_ones =
+      absl::countr_one(static_cast<I>(data_[idx] | ((I(0x1) << bidx) - 1)));
   if (trailing_ones < kBitsPerEntry) {
     return trailing_ones + idx * kBitsPerEntry;
   }
@@ -0,0 +1,223 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include "benchmark/benchmark.h"
+
+#include "util/benchmark_util.h"
+#include "util/bit_set.h"
+
+namespace util {
+
+namespace {
+
+// Returns a bit set with each bit set with probability `percent`/100.
+template <size_t N>
+std::unique_ptr<BitSet<N>> RandomBitSet(int64_t percent, uint64_t seed) {
+  auto b = std::make_unique<BitSet<N>>();
+  std::mt19937_64 gen(seed);
+  std::uniform_int_distribution<int64_t> dist(0, 99);
+  for (size_t pos = 0; pos < N; pos++) {
+    b->Set(pos, dist(gen) < percent);
+  }
+  return b;
+}
+
+template <size_t N>
+void SetBulkCounters(benchmark::State& state) {
+  state.SetItemsProcessed(state.iterations() * N);
+  state.SetBytesProcessed(state.iterations() * sizeof(BitSet<N>));
+}
+
+template <size_t N>
+void BM_And(benchmark::State& state) {
+  auto a = RandomBitSet<N>(50, 1);
+  auto b = RandomBitSet<N>(50, 2);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    *a &= *b;
+    benchmark::DoNotOptimize(*a);
+  }
+  SetBulkCounters<N>(state);
+}
+
+template <size_t N>
+void BM_Or(benchmark::State& state) {
+  auto a = RandomBitSet<N>(50, 1);
+  auto b = RandomBitSet<N>(50, 2);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    *a |= *b;
+    benchmark::DoNotOptimize(*a);
+  }
+  SetBulkCounters<N>(state);
+}
+
+template <size_t N>
+void BM_Xor(benchmark::State& state) {
+  auto a = RandomBitSet<N>(50, 1);
+  auto b = RandomBitSet<N>(50, 2);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    *a ^= *b;
+    benchmark::DoNotOptimize(*a);
+  }
+  SetBulkCounters<N>(state);
+}
+
+template <size_t N>
+void BM_Not(benchmark::State& state) {
+  auto a = RandomBitSet<N>(50, 1);
+  auto b = std::make_unique<BitSet<N>>();
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    *b = ~*a;
+    benchmark::DoNotOptimize(*b);
+  }
+  SetBulkCounters<N>(state);
+}
+
+template <size_t N>
+void BM_Popcount(benchmark::State& state) {
+  auto a = RandomBitSet<N>(50, 1);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(*a);
+    benchmark::DoNotOptimize(a->Popcount());
+  }
+  SetBulkCounters<N>(state);
+}
+
+// Args: percent of bits set.
+template <size_t N>
+void BM_Iterate(benchmark::State& state) {
+  auto a = RandomBitSet<N>(state.range(0), 1);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    size_t sum = 0;
+    for (size_t pos : *a) {
+      sum += pos;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  SetBulkCounters<N>(state);
+}
+
+// Args: percent of bits set.
+//
+// Visits the set bits with `TrailingZeros`, the way callers search for the
+// next used slot from a position.
+template <size_t N>
+void BM_ScanSet(benchmark::State& state) {
+  auto a = RandomBitSet<N>(state.range(0), 1);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    size_t sum = 0;
+    for (size_t pos = a->TrailingZeros(); pos < N;
+         pos = pos + 1 < N ? a->TrailingZeros(pos + 1) : N) {
+      sum += pos;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  SetBulkCounters<N>(state);
+}
+
+// Args: percent of bits set.
+//
+// Visits the clear bits with `TrailingOnes`, the way callers search for the
+// next free slot from a position.
+template <size_t N>
+void BM_ScanClear(benchmark::State& state) {
+  auto a = RandomBitSet<N>(state.range(0), 1);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    size_t sum = 0;
+    for (size_t pos = a->TrailingOnes(); pos < N;
+         pos = pos + 1 < N ? a->TrailingOnes(pos + 1) : N) {
+      sum += pos;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  SetBulkCounters<N>(state);
+}
+
+// The size of the bit set the costs of single operations are measured in, up
+// to which `ComplexityArgs` grow. Small enough to stay in cache, so that the
+// reported complexity is of the operation rather than of cache misses.
+constexpr size_t kComplexitySize = 1 << 16;
+
+// Args: the number of bits n the tested positions range over.
+//
+// Testing a bit costs the same wherever it is, so this reports O(1).
+void BM_TestComplexity(benchmark::State& state) {
+  const size_t n = state.range(0);
+  auto a = RandomBitSet<kComplexitySize>(50, 1);
+  BenchmarkPerfCounters perf(state);
+  size_t pos = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a->Test(pos));
+    pos = (pos + 7919) % n;
+  }
+  state.SetComplexityN(static_cast<int64_t>(n));
+}
+
+// Args: the position n - 1 of the only set bit.
+//
+// Finding the first set bit scans every word before it, so this reports O(N).
+void BM_TrailingZerosComplexity(benchmark::State& state) {
+  const size_t n = state.range(0);
+  auto a = std::make_unique<BitSet<kComplexitySize>>();
+  a->Set(n - 1);
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(*a);
+    benchmark::DoNotOptimize(a->TrailingZeros());
+  }
+  state.SetComplexityN(static_cast<int64_t>(n));
+}
+
+void ComplexityArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n" })
+      ->RangeMultiplier(4)
+      ->Range(64, kComplexitySize)
+      ->Complexity();
+}
+
+void DensityArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "percent" });
+  for (int64_t percent : { 1, 10, 50, 90, 99 }) {
+    b->Arg(percent);
+  }
+}
+
+// From one word to well beyond the L1 cache.
+#define BIT_SET_BENCHMARK(name) \
+  BENCHMARK(name<64>);          \
+  BENCHMARK(name<1024>);        \
+  BENCHMARK(name<1 << 16>);     \
+  BENCHMARK(name<1 << 20>)
+
+#define BIT_SET_DENSITY_BENCHMARK(name)        \
+  BENCHMARK(name<64>)->Apply(DensityArgs);     \
+  BENCHMARK(name<1024>)->Apply(DensityArgs);   \
+  BENCHMARK(name<1 << 16>)->Apply(DensityArgs); \
+  BENCHMARK(name<1 << 20>)->Apply(DensityArgs)
+
+BIT_SET_BENCHMARK(BM_And);
+BIT_SET_BENCHMARK(BM_Or);
+BIT_SET_BENCHMARK(BM_Xor);
+BIT_SET_BENCHMARK(BM_Not);
+BIT_SET_BENCHMARK(BM_Popcount);
+BIT_SET_DENSITY_BENCHMARK(BM_Iterate);
+BIT_SET_DENSITY_BENCHMARK(BM_ScanSet);
+BIT_SET_DENSITY_BENCHMARK(BM_ScanClear);
+BENCHMARK(BM_TestComplexity)->Apply(ComplexityArgs);
+BENCHMARK(BM_TrailingZerosComplexity)->Apply(ComplexityArgs);
+
+#undef BIT_SET_BENCHMARK
+#undef BIT_SET_DENSITY_BENCHMARK
+
+}  // namespace
+
+}  // namespace util
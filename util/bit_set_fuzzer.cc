@@ -0,0 +1,313 @@
+// Checks `BitSet` against `std::bitset` over traces of operations decoded from
+// the input. The first byte picks the size and representation of the sets, and
+// every observer is compared after each operation.
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+#include "util/absl_util.h"
+#include "util/bit_set.h"
+#include "util/fuzz_util.h"
+
+namespace util {
+
+namespace {
+
+// An operation on two sets, `a` and `b`. Binary operations assign to `a`.
+struct Op {
+  enum Kind : uint8_t {
+    kSet,
+    kFlip,
+    kAnd,
+    kOr,
+    kXor,
+    kNot,
+    kCopy,
+    kSwap,
+    kTrailingZeros,
+    kTrailingOnes,
+    kIterateFrom,
+    kClearAt,
+    kNumKinds,
+  };
+
+  Kind kind;
+  // The bit, or where to start from.
+  size_t pos = 0;
+  // The value to set, or for `kClearAt`, whether to clear every other bit
+  // rather than each one.
+  bool value = false;
+};
+
+std::ostream& operator<<(std::ostream& os, const Op& op) {
+  switch (op.kind) {
+    case Op::kSet:
+      return os << "a.Set(" << op.pos << ", " << (op.value ? "true" : "false")
+                << ")";
+    case Op::kFlip:
+      return os << "a.Flip(" << op.pos << ")";
+    case Op::kAnd:
+      return os << "a &= b";
+    case Op::kOr:
+      return os << "a |= b";
+    case Op::kXor:
+      return os << "a ^= b";
+    case Op::kNot:
+      return os << "a = ~a";
+    case Op::kCopy:
+      return os << "b = a";
+    case Op::kSwap:
+      return os << "swap(a, b)";
+    case Op::kTrailingZeros:
+      return os << "a.TrailingZeros(" << op.pos << ")";
+    case Op::kTrailingOnes:
+      return os << "a.TrailingOnes(" << op.pos << ")";
+    case Op::kIterateFrom:
+      return os << "a.begin(" << op.pos << ")";
+    case Op::kClearAt:
+      return os << "a.begin(" << op.pos << ").ClearAt()"
+                << (op.value ? " every other bit" : " every bit");
+    case Op::kNumKinds:
+      break;
+  }
+  return os << "?";
+}
+
+template <size_t N>
+Op DecodeOp(FuzzInput& input) {
+  Op op = { .kind = static_cast<Op::Kind>(input.Below(Op::kNumKinds)) };
+  switch (op.kind) {
+    case Op::kSet:
+      op.pos = input.Below(N);
+      op.value = input.Bool();
+      break;
+    case Op::kFlip:
+      op.pos = input.Below(N);
+      break;
+    case Op::kTrailingZeros:
+    case Op::kTrailingOnes:
+      op.pos = input.Below(N);
+      break;
+    case Op::kIterateFrom:
+      op.pos = input.Below(N + 1);
+      break;
+    case Op::kClearAt:
+      op.pos = input.Below(N + 1);
+      op.value = input.Bool();
+      break;
+    default:
+      break;
+  }
+  return op;
+}
+
+// The reference implementations of the observers, one bit at a time.
+
+template <size_t N>
+std::vector<size_t> ExpectedBits(const std::bitset<N>& set, size_t from = 0) {
+  std::vector<size_t> bits;
+  for (size_t pos = from; pos < N; pos++) {
+    if (set.test(pos)) {
+      bits.push_back(pos);
+    }
+  }
+  return bits;
+}
+
+template <size_t N>
+size_t ExpectedFind(const std::bitset<N>& set, size_t from, bool value) {
+  size_t pos = from;
+  while (pos < N && set.test(pos) != value) {
+    pos++;
+  }
+  return pos;
+}
+
+template <size_t N>
+size_t ExpectedLeading(const std::bitset<N>& set, bool value) {
+  size_t count = 0;
+  while (count < N && set.test(N - 1 - count) == value) {
+    count++;
+  }
+  return count;
+}
+
+template <typename T>
+absl::Status CheckEq(const char* what, const T& actual, const T& expected) {
+  if (actual == expected) {
+    return absl::OkStatus();
+  }
+  return absl::InternalError(absl::StrCat(what, " mismatch"));
+}
+
+template <size_t N, typename I>
+std::vector<size_t> Bits(const BitSet<N, I>& set, size_t from = 0) {
+  return std::vector<size_t>(set.begin(from), set.end());
+}
+
+template <size_t N, typename I>
+absl::Status Validate(const BitSet<N, I>& set, const std::bitset<N>& expected) {
+  for (size_t pos = 0; pos < N; pos++) {
+    if (set.Test(pos) != expected.test(pos)) {
+      return absl::InternalError(absl::StrCat("Test(", pos, ") mismatch"));
+    }
+  }
+  RETURN_IF_ERROR(CheckEq("Popcount()", set.Popcount(), expected.count()));
+  RETURN_IF_ERROR(CheckEq("LeadingZeros()", set.LeadingZeros(),
+                          ExpectedLeading(expected, false)));
+  RETURN_IF_ERROR(CheckEq("LeadingOnes()", set.LeadingOnes(),
+                          ExpectedLeading(expected, true)));
+  RETURN_IF_ERROR(CheckEq("TrailingZeros()", set.TrailingZeros(),
+                          ExpectedFind(expected, 0, true)));
+  RETURN_IF_ERROR(CheckEq("TrailingOnes()", set.TrailingOnes(),
+                          ExpectedFind(expected, 0, false)));
+  return CheckEq("iteration", Bits(set), ExpectedBits(expected));
+}
+
+template <size_t N, typename I>
+absl::Status RunOp(const Op& op, BitSet<N, I>& a, BitSet<N, I>& b,
+                   std::bitset<N>& expected_a, std::bitset<N>& expected_b) {
+  switch (op.kind) {
+    case Op::kSet:
+      a.Set(op.pos, op.value);
+      expected_a.set(op.pos, op.value);
+      break;
+    case Op::kFlip:
+      a.Flip(op.pos);
+      expected_a.flip(op.pos);
+      break;
+    case Op::kAnd:
+      a &= b;
+      expected_a &= expected_b;
+      break;
+    case Op::kOr:
+      a |= b;
+      expected_a |= expected_b;
+      break;
+    case Op::kXor:
+      a ^= b;
+      expected_a ^= expected_b;
+      break;
+    case Op::kNot:
+      a = ~a;
+      expected_a = ~expected_a;
+      break;
+    case Op::kCopy:
+      b = a;
+      expected_b = expected_a;
+      break;
+    case Op::kSwap:
+      std::swap(a, b);
+      std::swap(expected_a, expected_b);
+      break;
+    case Op::kTrailingZeros:
+      return CheckEq("TrailingZeros(from)", a.TrailingZeros(op.pos),
+                     ExpectedFind(expected_a, op.pos, true));
+    case Op::kTrailingOnes:
+      return CheckEq("TrailingOnes(from)", a.TrailingOnes(op.pos),
+                     ExpectedFind(expected_a, op.pos, false));
+    case Op::kIterateFrom:
+      return CheckEq("iteration from", Bits(a, op.pos),
+                     ExpectedBits(expected_a, op.pos));
+    case Op::kClearAt: {
+      const std::vector<size_t> expected = ExpectedBits(expected_a, op.pos);
+      std::vector<size_t> visited;
+      bool clear = true;
+      for (auto it = a.begin(op.pos); it != a.end(); ++it) {
+        visited.push_back(*it);
+        if (clear) {
+          it.ClearAt();
+          expected_a.reset(*it);
+        }
+        if (op.value) {
+          clear = !clear;
+        }
+      }
+      return CheckEq("iteration while clearing", visited, expected);
+    }
+    case Op::kNumKinds:
+      break;
+  }
+  return absl::OkStatus();
+}
+
+template <size_t N, typename I>
+absl::Status RunTrace(std::span<const Op> ops) {
+  BitSet<N, I> a;
+  BitSet<N, I> b;
+  std::bitset<N> expected_a;
+  std::bitset<N> expected_b;
+  for (size_t i = 0; i < ops.size(); i++) {
+    absl::Status status = RunOp(ops[i], a, b, expected_a, expected_b);
+    if (status.ok()) {
+      status = Validate(a, expected_a);
+    }
+    if (status.ok()) {
+      status = Validate(b, expected_b);
+    }
+    if (!status.ok()) {
+      return absl::InternalError(
+          absl::StrCat("BitSet<", N, "> op ", i, ": ", status.message()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <size_t N, typename I = BitSetRepr<N>::value>
+void FuzzBitSet(FuzzInput& input) {
+  std::vector<Op> ops;
+  while (!input.empty()) {
+    ops.push_back(DecodeOp<N>(input));
+  }
+  CheckTrace<Op>(ops, RunTrace<N, I>);
+}
+
+}  // namespace
+
+}  // namespace util
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  util::FuzzInput input(data, size);
+  // Sizes around the boundaries of entries, of each representation.
+  switch (input.Below(10)) {
+    case 0:
+      util::FuzzBitSet<1>(input);
+      break;
+    case 1:
+      util::FuzzBitSet<8>(input);
+      break;
+    case 2:
+      util::FuzzBitSet<13>(input);
+      break;
+    case 3:
+      util::FuzzBitSet<32>(input);
+      break;
+    case 4:
+      util::FuzzBitSet<63>(input);
+      break;
+    case 5:
+      util::FuzzBitSet<64>(input);
+      break;
+    case 6:
+      util::FuzzBitSet<65>(input);
+      break;
+    case 7:
+      util::FuzzBitSet<200>(input);
+      break;
+    case 8:
+      util::FuzzBitSet<100, uint8_t>(input);
+      break;
+    case 9:
+      util::FuzzBitSet<96, uint32_t>(input);
+      break;
+  }
+  return 0;
+}
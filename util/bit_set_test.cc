@@ -1,10 +1,14 @@
 #include "util/bit_set.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+#include "util/allocation_tracker.h"
+
 namespace util {
 
 TEST(BitSetTest, TestSizes) {
@@ -50,6 +54,16 @@ TEST(BitSetTest, TestFull) {
   EXPECT_EQ(b.TrailingOnes(), kSize);
 }
 
+// The last entry is full, so none of it is masked off.
+TEST(BitSetTest, TestFullEntries) {
+  EXPECT_EQ((~BitSet<8>()).Popcount(), 8);
+  EXPECT_EQ((~BitSet<64>()).Popcount(), 64);
+  EXPECT_EQ((~BitSet<128>()).Popcount(), 128);
+  EXPECT_EQ((~BitSet<96, uint32_t>()).Popcount(), 96);
+  EXPECT_EQ((~BitSet<64>()).LeadingOnes(), 64);
+  EXPECT_EQ((~BitSet<64>()).TrailingOnes(), 64);
+}
+
 TEST(BitSetTest, TestSingleBit) {
   static constexpr size_t kSize = 189;
   BitSet<kSize> b;
@@ -147,4 +161,43 @@ TEST(BitSetTest, TestClearIterator) {
   EXPECT_THAT(b, testing::ElementsAre(12, 14, 88));
 }
 
+TEST(BitSetTest, TestBitwiseAssign) {
+  static constexpr size_t kSize = 130;
+  BitSet<kSize> a;
+  BitSet<kSize> b;
+  for (size_t pos = 0; pos < kSize; pos++) {
+    a.Set(pos, pos % 2 == 0);
+    b.Set(pos, pos % 3 == 0);
+  }
+
+  BitSet<kSize> and_ab = a;
+  EXPECT_EQ(&(and_ab &= b), &and_ab);
+  BitSet<kSize> or_ab = a;
+  EXPECT_EQ(&(or_ab |= b), &or_ab);
+  BitSet<kSize> xor_ab = a;
+  EXPECT_EQ(&(xor_ab ^= b), &xor_ab);
+  for (size_t pos = 0; pos < kSize; pos++) {
+    EXPECT_EQ(and_ab.Test(pos), pos % 6 == 0) << pos;
+    EXPECT_EQ(or_ab.Test(pos), pos % 2 == 0 || pos % 3 == 0) << pos;
+    EXPECT_EQ(xor_ab.Test(pos), (pos % 2 == 0) != (pos % 3 == 0)) << pos;
+  }
+
+  // Assignments chain.
+  BitSet<kSize> c = a;
+  (c |= b) &= b;
+  EXPECT_EQ(c.Popcount(), b.Popcount());
+}
+
+TEST(BitSetTest, TestNoAllocations) {
+  static constexpr size_t kSize = 1000;
+  BitSet<kSize> a;
+  BitSet<kSize> b;
+  EXPECT_NO_ALLOCATIONS(a.Set(10).Set(500).Flip(999));
+  EXPECT_NO_ALLOCATIONS(b = ~a; b &= a; b |= a; b ^= a);
+  EXPECT_NO_ALLOCATIONS(EXPECT_EQ(a.Popcount(), 3));
+  size_t sum = 0;
+  EXPECT_NO_ALLOCATIONS(for (size_t pos : a) { sum += pos; });
+  EXPECT_EQ(sum, 10 + 500 + 999);
+}
+
 }  // namespace util
@@ -0,0 +1,109 @@
+#include "util/complexity.h"
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+namespace {
+
+constexpr size_t kNumComplexities =
+    static_cast<size_t>(Complexity::kQuadratic) + 1;
+
+double GrowthOf(Complexity complexity, size_t size) {
+  const double n = static_cast<double>(size);
+  switch (complexity) {
+    case Complexity::kConstant:
+      return 1;
+    case Complexity::kLogarithmic:
+      return std::log2(n);
+    case Complexity::kLinear:
+      return n;
+    case Complexity::kQuadratic:
+      return n * n;
+  }
+  return 0;
+}
+
+// The root-mean-square error of the least-squares fit of `costs` to
+// `c * f(sizes)`, for the growth `f` of `complexity`.
+double FitError(Complexity complexity, const std::vector<size_t>& sizes,
+                const std::vector<double>& costs) {
+  double sum_cost_growth = 0;
+  double sum_growth_squared = 0;
+  for (size_t i = 0; i < sizes.size(); i++) {
+    const double growth = GrowthOf(complexity, sizes[i]);
+    sum_cost_growth += costs[i] * growth;
+    sum_growth_squared += growth * growth;
+  }
+  const double coefficient =
+      sum_growth_squared == 0 ? 0 : sum_cost_growth / sum_growth_squared;
+
+  double sum_error_squared = 0;
+  for (size_t i = 0; i < sizes.size(); i++) {
+    const double error =
+        costs[i] - coefficient * GrowthOf(complexity, sizes[i]);
+    sum_error_squared += error * error;
+  }
+  return std::sqrt(sum_error_squared / static_cast<double>(sizes.size()));
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, Complexity complexity) {
+  switch (complexity) {
+    case Complexity::kConstant:
+      return os << "O(1)";
+    case Complexity::kLogarithmic:
+      return os << "O(log n)";
+    case Complexity::kLinear:
+      return os << "O(n)";
+    case Complexity::kQuadratic:
+      return os << "O(n^2)";
+  }
+  return os << "O(?)";
+}
+
+Complexity FitComplexity(const std::vector<size_t>& sizes,
+                         const std::vector<double>& costs) {
+  Complexity best = Complexity::kConstant;
+  double best_error = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < kNumComplexities; i++) {
+    const Complexity complexity = static_cast<Complexity>(i);
+    const double error = FitError(complexity, sizes, costs);
+    // Ties, as when every cost is 0, go to the slower-growing class.
+    if (error < best_error) {
+      best = complexity;
+      best_error = error;
+    }
+  }
+  return best;
+}
+
+::testing::AssertionResult HasComplexity(
+    Complexity expected, const std::vector<size_t>& sizes,
+    absl::FunctionRef<double(size_t)> cost) {
+  std::vector<double> costs;
+  costs.reserve(sizes.size());
+  for (size_t size : sizes) {
+    costs.push_back(cost(size));
+  }
+
+  const Complexity fit = FitComplexity(sizes, costs);
+  ::testing::AssertionResult result = fit == expected
+                                          ? ::testing::AssertionSuccess()
+                                          : ::testing::AssertionFailure();
+  result << "costs grow as " << fit << ", expected " << expected << ":";
+  for (size_t i = 0; i < sizes.size(); i++) {
+    result << "\n  n = " << sizes[i] << ": " << costs[i];
+  }
+  return result;
+}
+
+}  // namespace util
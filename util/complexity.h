@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+// Growth classes of the cost of an operation in the size `n` of its input.
+// O(n log n) is left out: over the sizes a test can afford, it grows only a
+// little faster than O(n).
+enum class Complexity {
+  kConstant,     // O(1)
+  kLogarithmic,  // O(log n)
+  kLinear,       // O(n)
+  kQuadratic,    // O(n^2)
+};
+
+std::ostream& operator<<(std::ostream& os, Complexity complexity);
+
+// Returns the growth class which best fits costs measured at each of `sizes`.
+// Each class `f` is fit as `cost ~ c * f(n)` by least squares, and the class
+// with the smallest root-mean-square error wins, as with Google Benchmark's
+// `Complexity()`. There is no constant term, but a constant overhead barely
+// moves the fit as long as the costs at the largest sizes dominate it.
+Complexity FitComplexity(const std::vector<size_t>& sizes,
+                         const std::vector<double>& costs);
+
+// Checks that the cost of an operation grows as `expected`, by calling
+// `cost(n)` for each of `sizes` and fitting the results (see `FitComplexity`).
+// The cost should be a count of steps, such as comparisons, which is exact;
+// timings are too noisy for a test to fit reliably, and belong in a benchmark
+// with `benchmark::Benchmark::Complexity()`. The sizes should span a few
+// orders of magnitude for the classes to be told apart.
+//
+// Example:
+//   EXPECT_TRUE(HasComplexity(Complexity::kLogarithmic,
+//                             { 1 << 8, 1 << 12, 1 << 16 }, [](size_t n) {
+//     ...
+//     return static_cast<double>(comparisons) / n;
+//   }));
+::testing::AssertionResult HasComplexity(
+    Complexity expected, const std::vector<size_t>& sizes,
+    absl::FunctionRef<double(size_t)> cost);
+
+}  // namespace util
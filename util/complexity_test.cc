@@ -0,0 +1,58 @@
+#include "util/complexity.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+using ::testing::HasSubstr;
+
+TEST(ComplexityTest, TestFitComplexity) {
+  const std::vector<size_t> sizes = { 16, 64, 256, 1024, 4096, 16384 };
+  auto costs = [&](auto growth) {
+    std::vector<double> costs;
+    for (size_t size : sizes) {
+      // With a constant overhead.
+      costs.push_back(3 * growth(static_cast<double>(size)) + 5);
+    }
+    return costs;
+  };
+
+  EXPECT_EQ(FitComplexity(sizes, costs([](double) { return 1; })),
+            Complexity::kConstant);
+  EXPECT_EQ(FitComplexity(sizes, costs([](double n) { return std::log2(n); })),
+            Complexity::kLogarithmic);
+  EXPECT_EQ(FitComplexity(sizes, costs([](double n) { return n; })),
+            Complexity::kLinear);
+  EXPECT_EQ(FitComplexity(sizes, costs([](double n) { return n * n; })),
+            Complexity::kQuadratic);
+  EXPECT_EQ(FitComplexity(sizes, costs([](double) { return 0; })),
+            Complexity::kConstant);
+}
+
+TEST(ComplexityTest, TestHasComplexity) {
+  const std::vector<size_t> sizes = { 1 << 4, 1 << 8, 1 << 12 };
+  // Binary search steps.
+  EXPECT_TRUE(HasComplexity(Complexity::kLogarithmic, sizes, [](size_t n) {
+    double steps = 0;
+    for (; n > 1; n /= 2) {
+      steps++;
+    }
+    return steps;
+  }));
+
+  const ::testing::AssertionResult result =
+      HasComplexity(Complexity::kConstant, sizes, [](size_t n) {
+        return static_cast<double>(n);
+      });
+  EXPECT_FALSE(result);
+  EXPECT_THAT(result.message(),
+              HasSubstr("costs grow as O(n), expected O(1):\n"
+                        "  n = 16: 16\n"));
+}
+
+}  // namespace util
@@ -18,6 +18,11 @@
 // Cursor position (row n, column m)
 #define CSI_CHP(n, m) __CSI #n ";" #m "H"
 
+// printf formats of the above, for positions known only at runtime
+#define CSI_VAR_CUR __CSI "%uC"
+#define CSI_VAR_CHA __CSI "%uG"
+#define CSI_VAR_CHP __CSI "%u;%uH"
+
 // Cursor-relative actions, pass to following control sequences
 #define CSI_CURSOR_BEFORE 0
 #define CSI_CURSOR_AFTER  1
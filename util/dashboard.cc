@@ -0,0 +1,363 @@
+#include "util/dashboard.h"
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+#include "util/frame_buffer.h"
+#include "util/metrics.h"
+
+namespace util {
+
+namespace {
+
+constexpr double kNoSample = std::numeric_limits<double>::quiet_NaN();
+
+// The title and the column headings.
+constexpr size_t kHeaderRows = 2;
+// The width of the frame when the output is not a terminal.
+constexpr size_t kDefaultCols = 120;
+
+constexpr size_t kMaxNameWidth = 24;
+constexpr size_t kValueWidth = 14;
+constexpr size_t kDetailWidth = 40;
+constexpr size_t kBarWidth = 20;
+
+constexpr FrameStyle kTitleStyle = { .fg = 15, .bg = 4, .bold = true };
+constexpr FrameStyle kDimStyle = { .fg = 8 };
+// By severity: within the thresholds, past `warn`, and past `critical`.
+constexpr uint16_t kValueColors[] = { FrameStyle::kDefaultColor, 11, 9 };
+constexpr uint16_t kSparklineColors[] = { 6, 11, 9 };
+
+// Formats `value` with 3 significant digits and an SI suffix, e.g. "1.23k".
+std::string FormatValue(double value, const std::string& unit) {
+  if (std::isnan(value)) {
+    return "-";
+  }
+  constexpr std::string_view kSuffixes = " kMGTPE";
+  size_t suffix = 0;
+  while (std::abs(value) >= 999.5 && suffix + 1 < kSuffixes.size()) {
+    value /= 1000;
+    suffix++;
+  }
+  std::string out;
+  if (suffix == 0 && value == std::trunc(value)) {
+    out = absl::StrFormat("%.0f", value);
+  } else {
+    const double magnitude = std::abs(value);
+    out = absl::StrFormat(magnitude < 9.995   ? "%.2f"
+                          : magnitude < 99.95 ? "%.1f"
+                                              : "%.0f",
+                          value);
+  }
+  if (suffix != 0) {
+    out.push_back(kSuffixes[suffix]);
+  }
+  if (!unit.empty()) {
+    absl::StrAppend(&out, " ", unit);
+  }
+  return out;
+}
+
+// 0 if `value` is within the thresholds of `display`, 1 if past `warn`, and 2
+// if past `critical`.
+size_t Severity(double value, const MetricDisplay& display) {
+  if (std::isnan(value)) {
+    return 0;
+  }
+  const bool lower_is_worse = display.critical < display.warn;
+  const auto past = [&](double threshold) {
+    return lower_is_worse ? value <= threshold : value >= threshold;
+  };
+  return past(display.critical) ? 2 : past(display.warn) ? 1 : 0;
+}
+
+absl::Status WriteAll(int fd, std::string_view out) {
+  while (!out.empty()) {
+    const ssize_t written = write(fd, out.data(), out.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return absl::ErrnoToStatus(errno, "Failed to write the dashboard");
+    }
+    out.remove_prefix(written);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+Dashboard::Dashboard(Options options)
+    : options_(std::move(options)), frame_(kHeaderRows, kDefaultCols) {}
+
+Dashboard::~Dashboard() {
+  Stop().IgnoreError();
+}
+
+void Dashboard::AddCounter(std::string name, const Counter& counter,
+                           MetricDisplay display) {
+  AddRow({ .kind = Kind::kCounter,
+           .name = std::move(name),
+           .display = std::move(display),
+           .counter = &counter,
+           .last_count = counter.Value() });
+}
+
+void Dashboard::AddGauge(std::string name, const Gauge& gauge,
+                         MetricDisplay display) {
+  AddRow({ .kind = Kind::kGauge,
+           .name = std::move(name),
+           .display = std::move(display),
+           .gauge = &gauge });
+}
+
+void Dashboard::AddHistogram(std::string name, const Histogram& histogram,
+                             MetricDisplay display) {
+  AddRow({ .kind = Kind::kHistogram,
+           .name = std::move(name),
+           .display = std::move(display),
+           .histogram = &histogram,
+           .last_snapshot = histogram.Snapshot() });
+}
+
+void Dashboard::AddProgress(std::string name, const Counter& done,
+                            uint64_t total) {
+  AddRow({ .kind = Kind::kProgress,
+           .name = std::move(name),
+           .counter = &done,
+           .total = total });
+}
+
+void Dashboard::AddRow(Row row) {
+  absl::MutexLock lock(&mu_);
+  rows_.push_back(std::move(row));
+}
+
+void Dashboard::Start() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = false;
+    frame_.EnterAlternateDisplay();
+  }
+  thread_ = std::thread([this] { Run(); });
+}
+
+absl::Status Dashboard::Stop() {
+  if (!thread_.joinable()) {
+    return absl::OkStatus();
+  }
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  thread_.join();
+
+  // Restore the display even after an error, which may have been transient,
+  // so as not to leave the terminal on the alternate display.
+  absl::MutexLock lock(&mu_);
+  std::string out(frame_.LeaveAlternateDisplay());
+  out.append(frame_.ToString());
+  status_.Update(WriteAll(options_.fd, out));
+  return status_;
+}
+
+void Dashboard::Run() {
+  absl::MutexLock lock(&mu_);
+  while (status_.ok()) {
+    UpdateLocked(absl::Now());
+    status_ = frame_.RenderTo(options_.fd);
+    if (mu_.AwaitWithTimeout(absl::Condition(&stopping_), options_.period)) {
+      break;
+    }
+  }
+}
+
+void Dashboard::Update(absl::Time now) {
+  absl::MutexLock lock(&mu_);
+  UpdateLocked(now);
+}
+
+std::string Dashboard::ToString() const {
+  absl::MutexLock lock(&mu_);
+  return frame_.ToString();
+}
+
+void Dashboard::UpdateLocked(absl::Time now) {
+  if (start_ == absl::InfinitePast()) {
+    start_ = now;
+  }
+  const double seconds = last_update_ == absl::InfinitePast()
+                             ? 0
+                             : absl::ToDoubleSeconds(now - last_update_);
+  last_update_ = now;
+  for (Row& row : rows_) {
+    Sample(row, seconds, now - start_);
+  }
+  Draw(now - start_);
+}
+
+void Dashboard::Sample(Row& row, double seconds, absl::Duration elapsed) {
+  const std::string& unit = row.display.unit;
+  double sample = kNoSample;
+  switch (row.kind) {
+    case Kind::kCounter: {
+      const uint64_t count = row.counter->Value();
+      if (seconds > 0) {
+        sample = static_cast<double>(count - row.last_count) / seconds;
+      }
+      row.last_count = count;
+      row.value = absl::StrCat(FormatValue(sample, unit), "/s");
+      row.detail = absl::StrCat("total ", FormatValue(count, unit));
+      break;
+    }
+    case Kind::kGauge:
+      sample = static_cast<double>(row.gauge->Value());
+      row.value = FormatValue(sample, unit);
+      break;
+    case Kind::kHistogram: {
+      const HistogramSnapshot snapshot = row.histogram->Snapshot();
+      HistogramSnapshot interval = snapshot;
+      interval -= row.last_snapshot;
+      row.last_snapshot = snapshot;
+      if (interval.count() == 0) {
+        row.value = "-";
+        row.detail = "no values";
+        break;
+      }
+      sample = static_cast<double>(interval.Percentile(99));
+      row.value = absl::StrCat("p99 ", FormatValue(sample, unit));
+      row.detail = absl::StrCat(
+          "p50 ", FormatValue(interval.Percentile(50), unit), "  p90 ",
+          FormatValue(interval.Percentile(90), unit), "  max ",
+          FormatValue(interval.Max(), unit));
+      break;
+    }
+    case Kind::kProgress: {
+      const uint64_t done = std::min(row.counter->Value(), row.total);
+      sample = row.total == 0 ? 100 : 100.0 * done / row.total;
+      row.value = absl::StrFormat("%.1f%%", sample);
+      if (done == row.total) {
+        row.detail = "done";
+      } else if (done == 0) {
+        row.detail = "ETA -";
+      } else {
+        // At the average rate so far.
+        const absl::Duration eta =
+            elapsed * (static_cast<double>(row.total - done) / done);
+        row.detail = absl::StrCat(
+            "ETA ", absl::FormatDuration(absl::Trunc(eta, absl::Seconds(1))));
+      }
+      break;
+    }
+  }
+  row.history.push_back(sample);
+  while (row.history.size() > options_.history) {
+    row.history.pop_front();
+  }
+}
+
+void Dashboard::Draw(absl::Duration elapsed) {
+  size_t rows = kHeaderRows + rows_.size();
+  size_t cols = kDefaultCols;
+  winsize size;
+  if (ioctl(options_.fd, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 &&
+      size.ws_col > 0) {
+    rows = size.ws_row;
+    cols = size.ws_col;
+  }
+  if (rows != frame_.rows() || cols != frame_.cols()) {
+    frame_.Resize(rows, cols);
+  }
+  frame_.Clear();
+
+  for (size_t col = 0; col < cols; col++) {
+    frame_.at(0, col) = FrameCell{ .style = kTitleStyle };
+  }
+  frame_.Print(0, 1, options_.title, kTitleStyle);
+  const std::string clock =
+      absl::FormatDuration(absl::Trunc(elapsed, absl::Seconds(1)));
+  if (clock.size() + 1 < cols) {
+    frame_.Print(0, cols - clock.size() - 1, clock, kTitleStyle);
+  }
+
+  size_t name_width = 6;
+  for (const Row& row : rows_) {
+    name_width = std::max(name_width, std::min(row.name.size(), kMaxNameWidth));
+  }
+  const size_t value_col = 1 + name_width + 2;
+  const size_t detail_col = value_col + kValueWidth + 2;
+  const size_t history_col = detail_col + kDetailWidth + 2;
+  frame_.Print(1, 1, "metric", kDimStyle);
+  frame_.Print(1, value_col + kValueWidth - 3, "now", kDimStyle);
+  frame_.Print(1, history_col, "history", kDimStyle);
+
+  for (size_t i = 0; i < rows_.size() && kHeaderRows + i < rows; i++) {
+    const Row& row = rows_[i];
+    const size_t r = kHeaderRows + i;
+    const double latest = row.history.empty() ? kNoSample : row.history.back();
+    frame_.Print(r, 1, std::string_view(row.name).substr(0, name_width));
+    const size_t value_width = std::min(row.value.size(), kValueWidth);
+    frame_.Print(
+        r, value_col + kValueWidth - value_width,
+        std::string_view(row.value).substr(0, value_width),
+        { .fg = kValueColors[Severity(latest, row.display)], .bold = true });
+
+    if (row.kind == Kind::kProgress) {
+      const size_t filled = static_cast<size_t>(latest / 100 * kBarWidth);
+      for (size_t j = 0; j < kBarWidth && detail_col + j < cols; j++) {
+        frame_.at(r, detail_col + j) =
+            j < filled ? FrameCell{ .glyph = U'█', .style = { .fg = 2 } }
+                       : FrameCell{ .glyph = U'░', .style = kDimStyle };
+      }
+      frame_.Print(r, detail_col + kBarWidth + 1, row.detail);
+      continue;
+    }
+    frame_.Print(r, detail_col,
+                 std::string_view(row.detail).substr(0, kDetailWidth),
+                 kDimStyle);
+
+    // Scaled from the lowest of 0 and the samples, to the highest sample.
+    double low = 0;
+    double high = 0;
+    for (double sample : row.history) {
+      if (!std::isnan(sample)) {
+        low = std::min(low, sample);
+        high = std::max(high, sample);
+      }
+    }
+    size_t col = history_col + options_.history - row.history.size();
+    for (double sample : row.history) {
+      if (col >= cols) {
+        break;
+      }
+      if (!std::isnan(sample)) {
+        const size_t level =
+            high > low ? std::lround((sample - low) / (high - low) * 7) : 0;
+        frame_.at(r, col) = {
+          .glyph = static_cast<char32_t>(U'▁' + level),
+          .style = { .fg = kSparklineColors[Severity(sample, row.display)] },
+        };
+      }
+      col++;
+    }
+  }
+}
+
+}  // namespace util
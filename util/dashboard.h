@@ -0,0 +1,155 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+#include "util/frame_buffer.h"
+#include "util/metrics.h"
+
+namespace util {
+
+// How a metric is shown on a `Dashboard`.
+struct MetricDisplay {
+  // Appended to values, e.g. "ns".
+  std::string unit;
+  // Values at or past `warn` are shown in yellow, and at or past `critical` in
+  // red. If `critical` is below `warn`, lower values are worse, e.g. for
+  // throughput.
+  double warn = std::numeric_limits<double>::infinity();
+  double critical = std::numeric_limits<double>::infinity();
+};
+
+struct DashboardOptions {
+  std::string title;
+  // Where frames are written, which should be a terminal.
+  int fd = STDOUT_FILENO;
+  // How often the metrics are sampled and the screen redrawn.
+  absl::Duration period = absl::Milliseconds(500);
+  // The number of samples in each sparkline.
+  size_t history = 40;
+};
+
+// A live table of metrics, redrawn in place on the terminal's alternate
+// display. Each row shows a metric's latest sample, colored by its thresholds,
+// and a sparkline of its recent samples:
+//   - counters, as a rate per second, and their total;
+//   - gauges, as their value;
+//   - histograms, as the percentiles of the values recorded since the last
+//     sample;
+//   - progress, as the fraction of a counter's total, and an ETA.
+//
+// Metrics are only read when sampled, so hot threads update them at the cost
+// of a relaxed atomic add, and never wait on the dashboard. They must outlive
+// the dashboard.
+//
+// Example:
+//   Counter requests;
+//   Histogram latency;
+//   Dashboard dashboard({ .title = "loadtest" });
+//   dashboard.AddCounter("requests", requests, { .unit = "req" });
+//   dashboard.AddHistogram("latency", latency, { .unit = "us", .warn = 500 });
+//   dashboard.Start();
+//   ... // Worker threads call requests.Add() and latency.Record().
+//   RETURN_IF_ERROR(dashboard.Stop());
+class Dashboard {
+ public:
+  using Options = DashboardOptions;
+
+  explicit Dashboard(Options options = {});
+
+  Dashboard(const Dashboard&) = delete;
+  Dashboard& operator=(const Dashboard&) = delete;
+
+  // Stops the dashboard, if running.
+  ~Dashboard();
+
+  // Adds a row for a metric. Rows may be added while running.
+  void AddCounter(std::string name, const Counter& counter,
+                  MetricDisplay display = {});
+  void AddGauge(std::string name, const Gauge& gauge,
+                MetricDisplay display = {});
+  void AddHistogram(std::string name, const Histogram& histogram,
+                    MetricDisplay display = {});
+  void AddProgress(std::string name, const Counter& done, uint64_t total);
+
+  // Switches to the alternate display, and starts redrawing it every period
+  // on a background thread.
+  void Start();
+
+  // Stops redrawing, and restores the main display with the last frame
+  // printed on it, even after an error. Returns the first error writing to the
+  // terminal, after which the dashboard stops redrawing.
+  absl::Status Stop();
+
+  // Samples the metrics at `now`, and draws them. Called by the background
+  // thread every period, or by jobs which drive their own loop.
+  void Update(absl::Time now);
+
+  // Returns the last frame drawn, as text.
+  std::string ToString() const;
+
+ private:
+  enum class Kind {
+    kCounter,
+    kGauge,
+    kHistogram,
+    kProgress,
+  };
+
+  struct Row {
+    Kind kind;
+    std::string name;
+    MetricDisplay display;
+    const Counter* counter = nullptr;
+    const Gauge* gauge = nullptr;
+    const Histogram* histogram = nullptr;
+    uint64_t total = 0;
+
+    // The previous sample of a counter or histogram, to get the rate or the
+    // values recorded since.
+    uint64_t last_count = 0;
+    HistogramSnapshot last_snapshot;
+    // The latest samples, oldest first. NaN where there was nothing to sample.
+    std::deque<double> history;
+    std::string value;
+    std::string detail;
+  };
+
+  void AddRow(Row row) ABSL_LOCKS_EXCLUDED(mu_);
+
+  void Run() ABSL_LOCKS_EXCLUDED(mu_);
+
+  void UpdateLocked(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Takes the next sample of `row`, `seconds` after the last one.
+  void Sample(Row& row, double seconds, absl::Duration elapsed)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  void Draw(absl::Duration elapsed) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  std::vector<Row> rows_ ABSL_GUARDED_BY(mu_);
+  FrameBuffer frame_ ABSL_GUARDED_BY(mu_);
+  absl::Time start_ ABSL_GUARDED_BY(mu_) = absl::InfinitePast();
+  absl::Time last_update_ ABSL_GUARDED_BY(mu_) = absl::InfinitePast();
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  absl::Status status_ ABSL_GUARDED_BY(mu_);
+
+  std::thread thread_;
+};
+
+}  // namespace util
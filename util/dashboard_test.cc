@@ -0,0 +1,156 @@
+#include "util/dashboard.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/csi.h"
+#include "util/metrics.h"
+
+namespace util {
+
+using ::testing::AllOf;
+using ::testing::ContainsRegex;
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::StartsWith;
+
+// The output of a dashboard, written to a pipe. The output is not a terminal,
+// so the frame is sized to fit.
+class DashboardTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(pipe2(fds_, O_NONBLOCK), 0);
+  }
+
+  void TearDown() override {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  std::string ReadOutput() {
+    std::string out;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds_[0], buffer, sizeof(buffer))) > 0) {
+      out.append(buffer, n);
+    }
+    return out;
+  }
+
+  int fds_[2];
+};
+
+TEST_F(DashboardTest, TestMetrics) {
+  Counter requests;
+  Gauge queue;
+  Histogram latency;
+  Dashboard dashboard({ .title = "loadtest", .fd = fds_[1] });
+  dashboard.AddCounter("requests", requests, { .unit = "req" });
+  dashboard.AddGauge("queue", queue);
+  dashboard.AddHistogram("latency", latency, { .unit = "us" });
+
+  const absl::Time start = absl::FromUnixSeconds(1000);
+  dashboard.Update(start);
+  // Nothing to take a rate or percentiles over yet.
+  EXPECT_THAT(dashboard.ToString(),
+              AllOf(StartsWith(" loadtest"), HasSubstr(" 0\n"),
+                    ContainsRegex("requests +-/s +total 0 req"),
+                    ContainsRegex("queue +0"),
+                    ContainsRegex("latency +- +no values")));
+
+  requests.Add(2500);
+  queue.Set(7);
+  for (int i = 0; i < 100; i++) {
+    latency.Record(i < 99 ? 10 : 1000);
+  }
+  dashboard.Update(start + absl::Seconds(2));
+  EXPECT_THAT(
+      dashboard.ToString(),
+      AllOf(HasSubstr(" 2s\n"),
+            ContainsRegex("requests +1.25k req/s +total 2.50k req +█\n"),
+            // Scaled from 0 to 7.
+            ContainsRegex("queue +7 +▁█\n"),
+            ContainsRegex("latency +p99 1.02k us +p50 10 us  p90 10 us  "
+                          "max 1.02k us")));
+
+  // Percentiles are of the values recorded since the last update.
+  latency.Record(100);
+  dashboard.Update(start + absl::Seconds(4));
+  EXPECT_THAT(dashboard.ToString(),
+              AllOf(ContainsRegex("requests +0 req/s"),
+                    ContainsRegex("latency +p99 103 us +p50 103 us")));
+}
+
+TEST_F(DashboardTest, TestProgress) {
+  Counter done;
+  Dashboard dashboard({ .fd = fds_[1] });
+  dashboard.AddProgress("shards", done, 200);
+  const absl::Time start = absl::FromUnixSeconds(1000);
+  dashboard.Update(start);
+  EXPECT_THAT(dashboard.ToString(),
+              ContainsRegex("shards +0.0% +░░░░░░░░░░░░░░░░░░░░ ETA -"));
+
+  done.Add(50);
+  dashboard.Update(start + absl::Seconds(10));
+  EXPECT_THAT(dashboard.ToString(),
+              ContainsRegex("shards +25.0% +█████░░░░░░░░░░░░░░░ ETA 30s"));
+
+  done.Add(500);
+  dashboard.Update(start + absl::Seconds(20));
+  EXPECT_THAT(dashboard.ToString(),
+              ContainsRegex("shards +100.0% +████████████████████ done"));
+}
+
+TEST_F(DashboardTest, TestStartStop) {
+  Counter requests;
+  Dashboard dashboard({ .title = "job",
+                        .fd = fds_[1],
+                        .period = absl::Milliseconds(1) });
+  dashboard.AddCounter("requests", requests);
+  dashboard.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_TRUE(dashboard.Stop().ok());
+
+  const std::string out = ReadOutput();
+  EXPECT_THAT(out, StartsWith(CSI_ALTERNATE_DISPLAY CSI_HIDE));
+  // The last frame is left on the main display.
+  const size_t main = out.find(CSI_MAIN_DISPLAY);
+  ASSERT_NE(main, std::string::npos);
+  EXPECT_THAT(out.substr(main + sizeof(CSI_MAIN_DISPLAY) - 1),
+              AllOf(StartsWith(" job"), ContainsRegex("requests +0/s"),
+                    Not(HasSubstr("\033"))));
+  // Stopping again does nothing.
+  EXPECT_TRUE(dashboard.Stop().ok());
+}
+
+TEST_F(DashboardTest, TestWriteError) {
+  Dashboard dashboard({ .fd = -1, .period = absl::Milliseconds(1) });
+  dashboard.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(dashboard.Stop().code(), absl::StatusCode::kFailedPrecondition);
+}
+
+// After a failed write, stopping still restores the main display and cursor.
+TEST_F(DashboardTest, TestRestoresDisplayAfterWriteError) {
+  // Fill the pipe, so that drawing fails.
+  const std::string fill(4096, ' ');
+  while (write(fds_[1], fill.data(), fill.size()) > 0) {
+  }
+  Dashboard dashboard({ .fd = fds_[1], .period = absl::Milliseconds(1) });
+  dashboard.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ReadOutput();
+
+  EXPECT_EQ(dashboard.Stop().code(), absl::StatusCode::kUnavailable);
+  EXPECT_THAT(ReadOutput(), AllOf(HasSubstr(CSI_SHOW CSI_MAIN_DISPLAY),
+                                  Not(HasSubstr(CSI_ALTERNATE_DISPLAY))));
+}
+
+}  // namespace util
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+
+#include "util/internal/util.h"
+
+namespace util {
+
+// An ordered container of `T*` with the same interface as `RbTree`, laid out
+// as a B+-tree whose nodes are `kNodeBytes` large and cache-line aligned.
+//
+// Like `RbTree`, the tree never owns the items in it. Unlike `RbTree`, items
+// do not need to embed a hook, so any `T` may be stored. Equal items are kept
+// in insertion order, and all items are kept in a doubly-linked list of leaves
+// for scanning.
+//
+// Each inner node holds separator keys, which are pointers to the smallest item
+// in the subtree to their right. A separator always points to an item in the
+// tree, so removing an item never leaves a dangling separator behind.
+template <typename T, typename Cmp = std::less<T>, size_t kNodeBytes = 256>
+class BTree {
+  struct Node {
+    uint16_t size;
+    bool is_leaf;
+  };
+
+  static constexpr size_t kCacheLineBytes = 64;
+
+  static_assert(kNodeBytes % kCacheLineBytes == 0,
+                "kNodeBytes must be a multiple of the cache line size");
+
+  // `Node` is padded to pointer alignment in both node types.
+  static constexpr size_t kHeaderBytes = sizeof(void*);
+
+  static constexpr size_t kLeafCapacity =
+      (kNodeBytes - kHeaderBytes - 2 * sizeof(void*)) / sizeof(T*);
+  static constexpr size_t kInnerCapacity =
+      (kNodeBytes - kHeaderBytes - sizeof(Node*)) /
+      (sizeof(T*) + sizeof(Node*));
+
+  static_assert(kInnerCapacity >= 3, "kNodeBytes is too small");
+
+  static constexpr size_t kMinLeafSize = kLeafCapacity / 2;
+  static constexpr size_t kMinInnerSize = kInnerCapacity / 2;
+
+  // Enough for 2^64 items, since every inner node but the root has at least
+  // kMinInnerSize + 1 >= 2 children.
+  static constexpr size_t kMaxDepth = 64;
+
+  struct alignas(kCacheLineBytes) Leaf : Node {
+    Leaf* prev;
+    Leaf* next;
+    T* items[kLeafCapacity];
+  };
+
+  // An inner node with `size` keys has `size + 1` children. `keys[i]` is the
+  // smallest item in `children[i + 1]`.
+  struct alignas(kCacheLineBytes) Inner : Node {
+    T* keys[kInnerCapacity];
+    Node* children[kInnerCapacity + 1];
+  };
+
+  static_assert(sizeof(Leaf) == kNodeBytes);
+  static_assert(sizeof(Inner) == kNodeBytes);
+
+  struct PathEntry {
+    Inner* node;
+    size_t idx;
+  };
+
+  // The path from the root to a leaf, with the index of the child taken at each
+  // inner node.
+  struct Path {
+    PathEntry entries[kMaxDepth];
+    size_t depth = 0;
+    Leaf* leaf;
+  };
+
+ public:
+  class Iterator {
+    friend BTree;
+
+   public:
+    using value_type = T*;
+    using reference = T*;
+    using pointer = T* const*;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    Iterator() = default;
+
+    T* operator*() const {
+      return leaf_->items[pos_];
+    }
+
+    bool operator==(const Iterator& it) const {
+      return leaf_ == it.leaf_ && pos_ == it.pos_;
+    }
+
+    Iterator& operator++() {
+      if (++pos_ == leaf_->size && leaf_->next != nullptr) {
+        leaf_ = leaf_->next;
+        pos_ = 0;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++(*this);
+      return it;
+    }
+
+    Iterator& operator--() {
+      if (pos_ == 0) {
+        leaf_ = leaf_->prev;
+        pos_ = leaf_->size;
+      }
+      pos_--;
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      Iterator it = *this;
+      --(*this);
+      return it;
+    }
+
+   private:
+    Iterator(Leaf* leaf, size_t pos) : leaf_(leaf), pos_(pos) {}
+
+    Leaf* leaf_ = nullptr;
+    size_t pos_ = 0;
+  };
+
+  BTree() = default;
+
+  BTree(const BTree&) = delete;
+  BTree& operator=(const BTree&) = delete;
+
+  ~BTree() {
+    if (root_ != nullptr) {
+      FreeSubtree(root_);
+    }
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  // Iterates over the items in order. `end()` is one past the last item of the
+  // last leaf, and is only valid to decrement if the tree is non-empty.
+  Iterator begin() const {
+    return Iterator(head_, 0);
+  }
+
+  Iterator end() const {
+    return tail_ != nullptr ? Iterator(tail_, tail_->size) : Iterator();
+  }
+
+  void Insert(T* item);
+
+  // Removes `item`, which must be in the tree.
+  void Remove(T* item);
+
+  // Returns the lowest-valued element in the tree that `AtLeast`() is true
+  // for.
+  template <typename AtLeast>
+  T* LowerBound(AtLeast at_least) const;
+
+ private:
+  // Returns the number of items in `items[0..size)` which `at_least` is false
+  // for. `at_least` must be monotonic over `items`.
+  template <typename AtLeast>
+  static size_t CountFalse(T* const* items, size_t size, AtLeast& at_least) {
+    size_t lo = 0;
+    while (size > 0) {
+      const size_t half = size / 2;
+      const bool go_right = !at_least(*items[lo + half]);
+      lo = go_right ? lo + half + 1 : lo;
+      size = go_right ? size - half - 1 : half;
+    }
+    return lo;
+  }
+
+  // Prefetches every cache line of `node` at once, since a search within the
+  // node touches them in a data-dependent order.
+  static void Prefetch(const Node* node) {
+    for (size_t offset = 0; offset < kNodeBytes; offset += kCacheLineBytes) {
+      __builtin_prefetch(reinterpret_cast<const char*>(node) + offset);
+    }
+  }
+
+  // Moves `path` to the first item of the next leaf, returning false if
+  // `path.leaf` is the last leaf.
+  static bool NextLeaf(Path& path);
+
+  // Finds the path to `item` in the tree, which must be in it, and returns the
+  // position of `item` in `path.leaf`.
+  size_t Find(T* item, Path& path) const;
+
+  // Inserts `key` and its right sibling `right` into the parent of the node at
+  // `level` in `path`.
+  void InsertIntoParent(Path& path, size_t level, T* key, Node* right);
+
+  // Restores the minimum size of the leaf in `path`, which has just dropped
+  // below `kMinLeafSize`.
+  void RebalanceLeaf(Path& path);
+
+  // Restores the minimum size of the inner node at `level` in `path`.
+  void RebalanceInner(Path& path, size_t level);
+
+  static void FreeSubtree(Node* node);
+
+  Node* root_ = nullptr;
+  Leaf* head_ = nullptr;
+  Leaf* tail_ = nullptr;
+  size_t size_ = 0;
+};
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+void BTree<T, Cmp, kNodeBytes>::Insert(T* item) {
+  size_++;
+  if (root_ == nullptr) {
+    Leaf* leaf = new Leaf();
+    leaf->is_leaf = true;
+    leaf->size = 1;
+    leaf->prev = nullptr;
+    leaf->next = nullptr;
+    leaf->items[0] = item;
+    root_ = head_ = tail_ = leaf;
+    return;
+  }
+
+  // Equal items are placed after existing ones.
+  auto at_least = [item](const T& other) {
+    return Cmp{}(*item, other);
+  };
+
+  Path path;
+  Node* node = root_;
+  while (!node->is_leaf) {
+    Inner* inner = static_cast<Inner*>(node);
+    const size_t idx = CountFalse(inner->keys, inner->size, at_least);
+    path.entries[path.depth++] = { inner, idx };
+    node = inner->children[idx];
+  }
+  Leaf* leaf = path.leaf = static_cast<Leaf*>(node);
+  const size_t pos = CountFalse(leaf->items, leaf->size, at_least);
+
+  if (leaf->size < kLeafCapacity) {
+    std::copy_backward(&leaf->items[pos], &leaf->items[leaf->size],
+                       &leaf->items[leaf->size + 1]);
+    leaf->items[pos] = item;
+    leaf->size++;
+    return;
+  }
+
+  T* items[kLeafCapacity + 1];
+  std::copy(&leaf->items[0], &leaf->items[pos], &items[0]);
+  items[pos] = item;
+  std::copy(&leaf->items[pos], &leaf->items[kLeafCapacity], &items[pos + 1]);
+
+  constexpr size_t kLeftSize = (kLeafCapacity + 1) / 2;
+  constexpr size_t kRightSize = kLeafCapacity + 1 - kLeftSize;
+
+  Leaf* right = new Leaf();
+  right->is_leaf = true;
+  right->size = kRightSize;
+  std::copy(&items[kLeftSize], &items[kLeafCapacity + 1], &right->items[0]);
+  leaf->size = kLeftSize;
+  std::copy(&items[0], &items[kLeftSize], &leaf->items[0]);
+
+  right->prev = leaf;
+  right->next = leaf->next;
+  if (leaf->next != nullptr) {
+    leaf->next->prev = right;
+  } else {
+    tail_ = right;
+  }
+  leaf->next = right;
+
+  InsertIntoParent(path, path.depth, right->items[0], right);
+}
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+void BTree<T, Cmp, kNodeBytes>::InsertIntoParent(Path& path, size_t level,
+                                                 T* key, Node* right) {
+  if (level == 0) {
+    Inner* root = new Inner();
+    root->is_leaf = false;
+    root->size = 1;
+    root->keys[0] = key;
+    root->children[0] = root_;
+    root->children[1] = right;
+    root_ = root;
+    return;
+  }
+
+  auto [parent, idx] = path.entries[level - 1];
+  if (parent->size < kInnerCapacity) {
+    std::copy_backward(&parent->keys[idx], &parent->keys[parent->size],
+                       &parent->keys[parent->size + 1]);
+    std::copy_backward(&parent->children[idx + 1],
+                       &parent->children[parent->size + 1],
+                       &parent->children[parent->size + 2]);
+    parent->keys[idx] = key;
+    parent->children[idx + 1] = right;
+    parent->size++;
+    return;
+  }
+
+  T* keys[kInnerCapacity + 1];
+  Node* children[kInnerCapacity + 2];
+  std::copy(&parent->keys[0], &parent->keys[idx], &keys[0]);
+  keys[idx] = key;
+  std::copy(&parent->keys[idx], &parent->keys[kInnerCapacity], &keys[idx + 1]);
+  std::copy(&parent->children[0], &parent->children[idx + 1], &children[0]);
+  children[idx + 1] = right;
+  std::copy(&parent->children[idx + 1], &parent->children[kInnerCapacity + 1],
+            &children[idx + 2]);
+
+  // The middle key moves up into the grandparent, since it is the smallest
+  // item in the new right node.
+  constexpr size_t kLeftSize = kInnerCapacity / 2;
+  constexpr size_t kRightSize = kInnerCapacity - kLeftSize;
+
+  Inner* new_inner = new Inner();
+  new_inner->is_leaf = false;
+  new_inner->size = kRightSize;
+  std::copy(&keys[kLeftSize + 1], &keys[kInnerCapacity + 1],
+            &new_inner->keys[0]);
+  std::copy(&children[kLeftSize + 1], &children[kInnerCapacity + 2],
+            &new_inner->children[0]);
+  parent->size = kLeftSize;
+  std::copy(&keys[0], &keys[kLeftSize], &parent->keys[0]);
+  std::copy(&children[0], &children[kLeftSize + 1], &parent->children[0]);
+
+  InsertIntoParent(path, level - 1, keys[kLeftSize], new_inner);
+}
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+void BTree<T, Cmp, kNodeBytes>::Remove(T* item) {
+  Path path;
+  const size_t pos = Find(item, path);
+  Leaf* leaf = path.leaf;
+  std::copy(&leaf->items[pos + 1], &leaf->items[leaf->size],
+            &leaf->items[pos]);
+  leaf->size--;
+  size_--;
+
+  if (path.depth == 0) {
+    if (leaf->size == 0) {
+      delete leaf;
+      root_ = head_ = tail_ = nullptr;
+    }
+    return;
+  }
+
+  // If `item` was the smallest in its leaf, it is the separator to the left of
+  // the deepest subtree on the path which is not a leftmost child. Non-root
+  // leaves are never empty after a removal, so replace it with the new first
+  // item of the leaf.
+  if (pos == 0) {
+    for (size_t level = path.depth; level > 0; level--) {
+      auto [parent, idx] = path.entries[level - 1];
+      if (idx != 0) {
+        UTIL_DCHECK(parent->keys[idx - 1] == item);
+        parent->keys[idx - 1] = leaf->items[0];
+        break;
+      }
+    }
+  }
+
+  if (leaf->size < kMinLeafSize) {
+    RebalanceLeaf(path);
+  }
+}
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+void BTree<T, Cmp, kNodeBytes>::RebalanceLeaf(Path& path) {
+  Leaf* leaf = path.leaf;
+  auto [parent, idx] = path.entries[path.depth - 1];
+
+  if (idx > 0) {
+    Leaf* left = static_cast<Leaf*>(parent->children[idx - 1]);
+    if (left->size > kMinLeafSize) {
+      std::copy_backward(&leaf->items[0], &leaf->items[leaf->size],
+                         &leaf->items[leaf->size + 1]);
+      leaf->items[0] = left->items[--left->size];
+      leaf->size++;
+      parent->keys[idx - 1] = leaf->items[0];
+      return;
+    }
+
+    // Merge `leaf` into `left`.
+    std::copy(&leaf->items[0], &leaf->items[leaf->size],
+              &left->items[left->size]);
+    left->size += leaf->size;
+    left->next = leaf->next;
+    if (leaf->next != nullptr) {
+      leaf->next->prev = left;
+    } else {
+      tail_ = left;
+    }
+    delete leaf;
+  } else {
+    Leaf* right = static_cast<Leaf*>(parent->children[1]);
+    if (right->size > kMinLeafSize) {
+      leaf->items[leaf->size++] = right->items[0];
+      std::copy(&right->items[1], &right->items[right->size],
+                &right->items[0]);
+      right->size--;
+      parent->keys[0] = right->items[0];
+      return;
+    }
+
+    // Merge `right` into `leaf`.
+    std::copy(&right->items[0], &right->items[right->size],
+              &leaf->items[leaf->size]);
+    leaf->size += right->size;
+    leaf->next = right->next;
+    if (right->next != nullptr) {
+      right->next->prev = leaf;
+    } else {
+      tail_ = leaf;
+    }
+    delete right;
+    idx = 1;
+  }
+
+  // Remove the separator and child pointer of the node which was merged away,
+  // at `idx`.
+  std::copy(&parent->keys[idx], &parent->keys[parent->size],
+            &parent->keys[idx - 1]);
+  std::copy(&parent->children[idx + 1], &parent->children[parent->size + 1],
+            &parent->children[idx]);
+  parent->size--;
+  RebalanceInner(path, path.depth - 1);
+}
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+void BTree<T, Cmp, kNodeBytes>::RebalanceInner(Path& path, size_t level) {
+  Inner* node = path.entries[level].node;
+  if (level == 0) {
+    if (node->size == 0) {
+      root_ = node->children[0];
+      delete node;
+    }
+    return;
+  }
+  if (node->size >= kMinInnerSize) {
+    return;
+  }
+
+  auto [parent, idx] = path.entries[level - 1];
+  if (idx > 0) {
+    Inner* left = static_cast<Inner*>(parent->children[idx - 1]);
+    if (left->size > kMinInnerSize) {
+      // Rotate the last child of `left` through the parent.
+      std::copy_backward(&node->keys[0], &node->keys[node->size],
+                         &node->keys[node->size + 1]);
+      std::copy_backward(&node->children[0], &node->children[node->size + 1],
+                         &node->children[node->size + 2]);
+      node->keys[0] = parent->keys[idx - 1];
+      node->children[0] = left->children[left->size];
+      node->size++;
+      parent->keys[idx - 1] = left->keys[--left->size];
+      return;
+    }
+
+    // Merge `node` into `left`, pulling down the separator between them.
+    left->keys[left->size] = parent->keys[idx - 1];
+    std::copy(&node->keys[0], &node->keys[node->size],
+              &left->keys[left->size + 1]);
+    std::copy(&node->children[0], &node->children[node->size + 1],
+              &left->children[left->size + 1]);
+    left->size += node->size + 1;
+    delete node;
+  } else {
+    Inner* right = static_cast<Inner*>(parent->children[1]);
+    if (right->size > kMinInnerSize) {
+      // Rotate the first child of `right` through the parent.
+      node->keys[node->size] = parent->keys[0];
+      node->children[node->size + 1] = right->children[0];
+      node->size++;
+      parent->keys[0] = right->keys[0];
+      std::copy(&right->keys[1], &right->keys[right->size], &right->keys[0]);
+      std::copy(&right->children[1], &right->children[right->size + 1],
+                &right->children[0]);
+      right->size--;
+      return;
+    }
+
+    // Merge `right` into `node`, pulling down the separator between them.
+    node->keys[node->size] = parent->keys[0];
+    std::copy(&right->keys[0], &right->keys[right->size],
+              &node->keys[node->size + 1]);
+    std::copy(&right->children[0], &right->children[right->size + 1],
+              &node->children[node->size + 1]);
+    node->size += right->size + 1;
+    delete right;
+    idx = 1;
+  }
+
+  std::copy(&parent->keys[idx], &parent->keys[parent->size],
+            &parent->keys[idx - 1]);
+  std::copy(&parent->children[idx + 1], &parent->children[parent->size + 1],
+            &parent->children[idx]);
+  parent->size--;
+  RebalanceInner(path, level - 1);
+}
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+size_t BTree<T, Cmp, kNodeBytes>::Find(T* item, Path& path) const {
+  UTIL_DCHECK(root_ != nullptr);
+
+  // Find the first item equal to `item`, then scan forward for `item` itself.
+  auto at_least = [item](const T& other) {
+    return !Cmp{}(other, *item);
+  };
+
+  Node* node = root_;
+  while (!node->is_leaf) {
+    Inner* inner = static_cast<Inner*>(node);
+    const size_t idx = CountFalse(inner->keys, inner->size, at_least);
+    path.entries[path.depth++] = { inner, idx };
+    node = inner->children[idx];
+  }
+  path.leaf = static_cast<Leaf*>(node);
+  size_t pos = CountFalse(path.leaf->items, path.leaf->size, at_least);
+
+  while (true) {
+    if (pos == path.leaf->size) {
+      [[maybe_unused]] const bool has_next = NextLeaf(path);
+      UTIL_DCHECK(has_next);
+      pos = 0;
+    }
+    T* candidate = path.leaf->items[pos];
+    if (candidate == item) {
+      return pos;
+    }
+    UTIL_DCHECK(!Cmp{}(*item, *candidate));
+    pos++;
+  }
+}
+
+/* static */
+template <typename T, typename Cmp, size_t kNodeBytes>
+bool BTree<T, Cmp, kNodeBytes>::NextLeaf(Path& path) {
+  size_t level = path.depth;
+  while (level > 0 &&
+         path.entries[level - 1].idx == path.entries[level - 1].node->size) {
+    level--;
+  }
+  if (level == 0) {
+    return false;
+  }
+
+  PathEntry& entry = path.entries[level - 1];
+  entry.idx++;
+  Node* node = entry.node->children[entry.idx];
+  for (; level < path.depth; level++) {
+    Inner* inner = static_cast<Inner*>(node);
+    path.entries[level] = { inner, 0 };
+    node = inner->children[0];
+  }
+  path.leaf = static_cast<Leaf*>(node);
+  return true;
+}
+
+template <typename T, typename Cmp, size_t kNodeBytes>
+template <typename AtLeast>
+T* BTree<T, Cmp, kNodeBytes>::LowerBound(AtLeast at_least) const {
+  const Node* node = root_;
+  if (node == nullptr) {
+    return nullptr;
+  }
+
+  while (!node->is_leaf) {
+    const Inner* inner = static_cast<const Inner*>(node);
+    node = inner->children[CountFalse(inner->keys, inner->size, at_least)];
+    Prefetch(node);
+  }
+
+  // If no item in this leaf satisfies `at_least`, the first item of the next
+  // leaf does, since it is bounded below by a separator which satisfied it.
+  const Leaf* leaf = static_cast<const Leaf*>(node);
+  const size_t pos = CountFalse(leaf->items, leaf->size, at_least);
+  if (pos < leaf->size) {
+    return leaf->items[pos];
+  }
+  return leaf->next != nullptr ? leaf->next->items[0] : nullptr;
+}
+
+/* static */
+template <typename T, typename Cmp, size_t kNodeBytes>
+void BTree<T, Cmp, kNodeBytes>::FreeSubtree(Node* node) {
+  if (node->is_leaf) {
+    delete static_cast<Leaf*>(node);
+    return;
+  }
+  Inner* inner = static_cast<Inner*>(node);
+  for (size_t i = 0; i <= inner->size; i++) {
+    FreeSubtree(inner->children[i]);
+  }
+  delete inner;
+}
+
+}  // namespace util
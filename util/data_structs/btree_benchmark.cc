@@ -0,0 +1,105 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/btree.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+using Element = BenchmarkElement;
+
+// The number of operations per benchmark iteration.
+constexpr size_t kOpsPerIteration = 1024;
+
+template <typename Tree>
+void BM_LowerBound(benchmark::State& state) {
+  const size_t n = state.range(0);
+  BenchmarkTree<Tree> test_tree(n);
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(
+          test_tree.tree().LowerBound([key](const Element& element) {
+            return element.key >= key;
+          }));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+void BM_LowerBoundAbslBtree(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::vector<uint64_t> shuffled = ShuffledKeys(n);
+  absl::btree_set<uint64_t> set(shuffled.begin(), shuffled.end());
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(set.lower_bound(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+// Removes and re-inserts random elements, keeping the tree size constant.
+template <typename Tree>
+void BM_RemoveInsert(benchmark::State& state) {
+  const size_t n = state.range(0);
+  BenchmarkTree<Tree> test_tree(n);
+  const std::vector<uint64_t> indices = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t idx : indices) {
+      test_tree.tree().Remove(&test_tree.element(idx));
+      test_tree.tree().Insert(&test_tree.element(idx));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+void BM_RemoveInsertAbslBtree(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::vector<uint64_t> shuffled = ShuffledKeys(n);
+  absl::btree_set<uint64_t> set(shuffled.begin(), shuffled.end());
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      set.erase(key);
+      set.insert(key);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+using ElementRbTree = BenchmarkRbTree;
+using ElementBTree = BTree<Element, BenchmarkElementLess>;
+
+BENCHMARK(BM_LowerBound<ElementRbTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_LowerBound<ElementBTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_LowerBoundAbslBtree)->RangeMultiplier(16)->Range(1 << 8, 1 << 24);
+
+BENCHMARK(BM_RemoveInsert<ElementRbTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_RemoveInsert<ElementBTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_RemoveInsertAbslBtree)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+
+}  // namespace
+
+}  // namespace util
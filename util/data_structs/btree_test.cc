@@ -0,0 +1,240 @@
+#include "util/data_structs/btree.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::Field;
+using ::testing::Pointee;
+
+struct Element : public RbNode {
+  int val;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.val < e2.val;
+  }
+};
+
+struct ElementPtrLess {
+  bool operator()(const Element* e1, const Element* e2) const {
+    return e1->val < e2->val;
+  }
+};
+
+// Use small nodes so that splits and merges happen often.
+using ElementBTree = BTree<Element, ElementLess, /*kNodeBytes=*/128>;
+
+template <typename Tree>
+std::vector<int> Values(const Tree& tree) {
+  std::vector<int> values;
+  for (const Element* element : tree) {
+    values.push_back(element->val);
+  }
+  return values;
+}
+
+template <typename Tree>
+Element* LowerBound(Tree& tree, int val) {
+  return tree.LowerBound([val](const Element& element) {
+    return element.val >= val;
+  });
+}
+
+TEST(BTreeTest, TestEmpty) {
+  ElementBTree tree;
+  EXPECT_EQ(tree.Size(), 0);
+  EXPECT_EQ(tree.LowerBound([](const Element&) {
+    return true;
+  }),
+            nullptr);
+  EXPECT_EQ(tree.begin(), tree.end());
+}
+
+TEST(BTreeTest, TestSingle) {
+  ElementBTree tree;
+  Element element = { .val = 1 };
+  tree.Insert(&element);
+
+  EXPECT_EQ(tree.Size(), 1);
+  EXPECT_EQ(LowerBound(tree, 0), &element);
+  EXPECT_EQ(LowerBound(tree, 1), &element);
+  EXPECT_EQ(LowerBound(tree, 2), nullptr);
+  EXPECT_THAT(Values(tree), ElementsAre(1));
+
+  tree.Remove(&element);
+  EXPECT_EQ(tree.Size(), 0);
+  EXPECT_EQ(LowerBound(tree, 0), nullptr);
+}
+
+TEST(BTreeTest, TestInsertMany) {
+  constexpr size_t kNumElements = 1000;
+
+  ElementBTree tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = static_cast<int>(2 * ((i * 13) % kNumElements));
+    tree.Insert(&elements[i]);
+    ASSERT_EQ(tree.Size(), i + 1);
+  }
+
+  std::vector<int> values = Values(tree);
+  ASSERT_EQ(values.size(), kNumElements);
+  EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+
+  for (int i = -1; i <= static_cast<int>(2 * kNumElements); i++) {
+    Element* element = LowerBound(tree, i);
+    if (i > static_cast<int>(2 * (kNumElements - 1))) {
+      EXPECT_EQ(element, nullptr);
+    } else {
+      EXPECT_THAT(element, Pointee(Field(&Element::val, (std::max(i, 0) + 1) /
+                                                            2 * 2)));
+    }
+  }
+}
+
+TEST(BTreeTest, TestReverseIterate) {
+  constexpr size_t kNumElements = 100;
+
+  ElementBTree tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = static_cast<int>(i);
+    tree.Insert(&elements[i]);
+  }
+
+  int expected = kNumElements;
+  for (auto it = tree.end(); it != tree.begin();) {
+    --it;
+    EXPECT_EQ((*it)->val, --expected);
+  }
+  EXPECT_EQ(expected, 0);
+}
+
+TEST(BTreeTest, TestDuplicates) {
+  constexpr size_t kNumElements = 200;
+
+  ElementBTree tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = static_cast<int>(i % 3);
+    tree.Insert(&elements[i]);
+  }
+
+  // Equal elements are kept in insertion order.
+  std::vector<const Element*> in_order(tree.begin(), tree.end());
+  for (size_t i = 1; i < in_order.size(); i++) {
+    if (in_order[i - 1]->val == in_order[i]->val) {
+      EXPECT_LT(in_order[i - 1], in_order[i]);
+    }
+  }
+
+  // Remove all but the first and last element of each value.
+  for (size_t i = 3; i < kNumElements - 3; i++) {
+    tree.Remove(&elements[i]);
+  }
+  EXPECT_THAT(Values(tree), ElementsAre(0, 0, 1, 1, 2, 2));
+  EXPECT_EQ(LowerBound(tree, 1), &elements[1]);
+  EXPECT_EQ(LowerBound(tree, 2), &elements[2]);
+}
+
+TEST(BTreeTest, TestRandomOperations) {
+  constexpr size_t kNumElements = 2000;
+  constexpr size_t kNumOperations = 20000;
+
+  ElementBTree tree;
+  std::multiset<Element*, ElementPtrLess> expected;
+  Element elements[kNumElements];
+  std::vector<bool> in_tree(kNumElements);
+
+  uint64_t state = 1;
+  auto next_random = [&state]() {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    return state >> 33;
+  };
+
+  for (size_t op = 0; op < kNumOperations; op++) {
+    const size_t idx = next_random() % kNumElements;
+    if (in_tree[idx]) {
+      tree.Remove(&elements[idx]);
+      auto [begin, end] = expected.equal_range(&elements[idx]);
+      expected.erase(std::find(begin, end, &elements[idx]));
+    } else {
+      elements[idx].val = static_cast<int>(next_random() % 500);
+      tree.Insert(&elements[idx]);
+      expected.insert(&elements[idx]);
+    }
+    in_tree[idx] = !in_tree[idx];
+    ASSERT_EQ(tree.Size(), expected.size());
+
+    if (op % 1000 == 0) {
+      std::vector<int> expected_values;
+      for (const Element* element : expected) {
+        expected_values.push_back(element->val);
+      }
+      ASSERT_THAT(Values(tree), ElementsAreArray(expected_values));
+      for (int val = 0; val <= 500; val++) {
+        Element key = { .val = val };
+        auto it = expected.lower_bound(&key);
+        Element* element = LowerBound(tree, val);
+        if (it == expected.end()) {
+          ASSERT_EQ(element, nullptr);
+        } else {
+          ASSERT_NE(element, nullptr);
+          ASSERT_EQ(element->val, (*it)->val);
+        }
+      }
+    }
+  }
+}
+
+// `BTree` and `RbTree` can be used interchangeably through their common
+// interface.
+template <typename Tree>
+class OrderedTreeTest : public ::testing::Test {};
+
+using OrderedTreeTypes =
+    ::testing::Types<RbTree<Element, ElementLess>, ElementBTree>;
+TYPED_TEST_SUITE(OrderedTreeTest, OrderedTreeTypes);
+
+TYPED_TEST(OrderedTreeTest, TestInsertRemoveLowerBound) {
+  constexpr size_t kNumElements = 500;
+
+  TypeParam tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = static_cast<int>((i * 7) % kNumElements);
+    tree.Insert(&elements[i]);
+  }
+  EXPECT_EQ(tree.Size(), kNumElements);
+
+  for (size_t i = 0; i < kNumElements; i += 2) {
+    tree.Remove(&elements[i]);
+  }
+  EXPECT_EQ(tree.Size(), kNumElements / 2);
+
+  for (size_t i = 0; i < kNumElements; i++) {
+    const int val = static_cast<int>((i * 7) % kNumElements);
+    Element* element = LowerBound(tree, val);
+    if (i % 2 == 1) {
+      EXPECT_EQ(element, &elements[i]);
+    } else {
+      ASSERT_NE(element, nullptr);
+      EXPECT_GT(element->val, val);
+    }
+  }
+}
+
+}  // namespace util
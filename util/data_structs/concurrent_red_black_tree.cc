@@ -0,0 +1,120 @@
+#include "util/data_structs/concurrent_red_black_tree.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "absl/synchronization/mutex.h"
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/red_black_tree_ops.h"
+
+namespace util {
+
+namespace internal {
+
+namespace {
+
+using AtomicRbNodeOps = RbOps<AtomicRbNodeLinks>;
+
+// Assigns threads to reader shards round-robin, so that up to
+// `kNumReaderShards` threads never share one.
+size_t ThisThreadReaderShard() {
+  static std::atomic<size_t> next_shard = 0;
+  thread_local const size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed);
+  return shard;
+}
+
+}  // namespace
+
+ConcurrentRbTreeBase::ReadToken ConcurrentRbTreeBase::BeginRead() const {
+  ReadToken token = { .shard = ThisThreadReaderShard() % kNumReaderShards };
+  while (true) {
+    token.parity = parity_.load(std::memory_order_relaxed);
+    if (begin_read_hook_for_testing_ != nullptr) {
+      begin_read_hook_for_testing_();
+    }
+    reader_shards_[token.shard].readers[token.parity].fetch_add(
+        1, std::memory_order_relaxed);
+    // Pairs with the fence in `Synchronize`: either it sees this reader, or
+    // this reader sees its parity flip and every node removal that came before
+    // it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // A `Synchronize` may have flipped the parity and found no readers under
+    // the old one between the load above and registering. Registering under
+    // the old parity then would go unnoticed by the next `Synchronize`, which
+    // only waits for the new one, so register again under the new parity.
+    if (parity_.load(std::memory_order_relaxed) == token.parity) {
+      return token;
+    }
+    reader_shards_[token.shard].readers[token.parity].fetch_sub(
+        1, std::memory_order_relaxed);
+  }
+}
+
+void ConcurrentRbTreeBase::EndRead(ReadToken token) const {
+  reader_shards_[token.shard].readers[token.parity].fetch_sub(
+      1, std::memory_order_release);
+}
+
+void ConcurrentRbTreeBase::Synchronize() {
+  absl::MutexLock lock(&sync_mu_);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // Readers which register from here on use the new parity, so the count of
+  // the old parity can only drain.
+  const uint32_t parity = parity_.load(std::memory_order_relaxed);
+  parity_.store(parity ^ 1, std::memory_order_relaxed);
+  // Pairs with the fence in `BeginRead`: either this sees a reader registered
+  // under the old parity, or the reader sees the flip and registers again.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (const ReaderShard& shard : reader_shards_) {
+    while (shard.readers[parity].load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void ConcurrentRbTreeBase::BeginWrite() {
+  const uint64_t seq = seq_.load(std::memory_order_relaxed);
+  seq_.store(seq + 1, std::memory_order_relaxed);
+  // Keeps the tree modifications from being reordered before the sequence
+  // number is made odd.
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ConcurrentRbTreeBase::EndWrite() {
+  seq_.store(seq_.load(std::memory_order_relaxed) + 1,
+             std::memory_order_release);
+}
+
+void ConcurrentRbTreeBase::InsertNode(RbNode* node, RbNode* parent,
+                                      bool right) {
+  BeginWrite();
+  if (parent == nullptr) {
+    AtomicRbNodeLinks::SetLeft(node, nullptr);
+    AtomicRbNodeLinks::SetRight(node, nullptr);
+    AtomicRbNodeLinks::SetParent(node, &root_);
+    AtomicRbNodeLinks::SetRed(node, false);
+    AtomicRbNodeLinks::SetLeft(&root_, node);
+  } else if (right) {
+    AtomicRbNodeOps({}).InsertRight(node, parent, &root_);
+  } else {
+    AtomicRbNodeOps({}).InsertLeft(node, parent, &root_);
+  }
+  EndWrite();
+  size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConcurrentRbTreeBase::RemoveNode(RbNode* node) {
+  BeginWrite();
+  AtomicRbNodeOps({}).Remove(node, &root_);
+  EndWrite();
+  size_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+
+}  // namespace util
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+namespace internal {
+
+// Accesses the child links of `RbNode`s through `std::atomic_ref`, so that
+// readers may follow them while a writer is relinking the tree. Stores are
+// release, so a reader which loads (with acquire) a pointer to a newly inserted
+// node also sees the node's contents. Parent links and colors are only touched
+// by writers, and are accessed normally.
+struct AtomicRbNodeLinks {
+  using Ref = RbNode*;
+
+  static RbNode* Null() {
+    return nullptr;
+  }
+
+  static RbNode* Left(const RbNode* node) {
+    return std::atomic_ref<RbNode*>(const_cast<RbNode*&>(node->left_))
+        .load(std::memory_order_acquire);
+  }
+
+  static RbNode* Right(const RbNode* node) {
+    return std::atomic_ref<RbNode*>(const_cast<RbNode*&>(node->right_))
+        .load(std::memory_order_acquire);
+  }
+
+  static RbNode* Parent(RbNode* node) {
+    return node->parent_;
+  }
+
+  static bool IsRed(RbNode* node) {
+    return node->red_;
+  }
+
+  static void SetLeft(RbNode* node, RbNode* left) {
+    std::atomic_ref<RbNode*>(node->left_).store(left,
+                                                std::memory_order_release);
+  }
+
+  static void SetRight(RbNode* node, RbNode* right) {
+    std::atomic_ref<RbNode*>(node->right_).store(right,
+                                                 std::memory_order_release);
+  }
+
+  static void SetParent(RbNode* node, RbNode* parent) {
+    node->parent_ = parent;
+  }
+
+  static void SetRed(RbNode* node, bool red) {
+    node->red_ = red;
+  }
+};
+
+// The type-independent part of `ConcurrentRbTree`: the seqlock, the writer
+// mutex, rebalancing, and the reader registry used by `Synchronize`.
+class ConcurrentRbTreeBase {
+ public:
+  ConcurrentRbTreeBase() = default;
+
+  ConcurrentRbTreeBase(const ConcurrentRbTreeBase&) = delete;
+  ConcurrentRbTreeBase& operator=(const ConcurrentRbTreeBase&) = delete;
+
+  size_t Size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  // Waits until every read which might still reach a node removed before this
+  // call has finished. Nodes may only be destroyed, freed, or modified after
+  // removal once this returns.
+  void Synchronize() ABSL_LOCKS_EXCLUDED(sync_mu_);
+
+  // Sets a function for readers to call between loading the parity and
+  // registering under it, so that tests can stall them there. Must not be
+  // called while any tree is being read.
+  static void SetBeginReadHookForTesting(void (*hook)()) {
+    begin_read_hook_for_testing_ = hook;
+  }
+
+ protected:
+  // Optimistic traversals are abandoned after this many steps, which is more
+  // than the height of any red-black tree that fits in memory. A traversal can
+  // only take longer if it raced with a writer, and will fail validation.
+  static constexpr size_t kMaxReadSteps = 128;
+  // The number of times a reader retries an optimistic traversal before it
+  // takes the writer mutex in shared mode.
+  static constexpr int kOptimisticReadAttempts = 8;
+
+  // A registered reader, from `BeginRead`.
+  struct ReadToken {
+    size_t shard;
+    uint32_t parity;
+  };
+
+  ReadToken BeginRead() const;
+  void EndRead(ReadToken token) const;
+
+  // Returns the sequence number to validate an optimistic read against, or
+  // an odd number if a write is in progress.
+  uint64_t ReadBegin() const {
+    return seq_.load(std::memory_order_acquire);
+  }
+
+  // Returns whether nothing was written since `ReadBegin` returned `seq`.
+  bool ReadValidate(uint64_t seq) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq_.load(std::memory_order_relaxed) == seq;
+  }
+
+  const RbNode* Root() const {
+    return AtomicRbNodeLinks::Left(&root_);
+  }
+
+  // Links `node` in as a child of `parent` (or as the root if `parent` is
+  // null), within a write section.
+  void InsertNode(RbNode* node, RbNode* parent, bool right)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Unlinks `node`, within a write section.
+  void RemoveNode(RbNode* node) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Serializes writers. Readers take it in shared mode only after repeatedly
+  // failing to validate an optimistic traversal.
+  mutable absl::Mutex mu_;
+
+ private:
+  static constexpr size_t kNumReaderShards = 64;
+
+  // Counts of in-flight readers, per parity. Readers spread over the shards so
+  // that they rarely share a cache line.
+  struct alignas(64) ReaderShard {
+    std::atomic<int64_t> readers[2] = { 0, 0 };
+  };
+
+  void BeginWrite() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void EndWrite() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  RbNode root_;
+  // Odd while a writer is modifying the tree.
+  std::atomic<uint64_t> seq_ = 0;
+  std::atomic<size_t> size_ = 0;
+
+  // The parity new readers register under. `Synchronize` flips it, so that it
+  // only has to wait for the readers that came before.
+  std::atomic<uint32_t> parity_ = 0;
+  mutable ReaderShard reader_shards_[kNumReaderShards];
+  absl::Mutex sync_mu_;
+
+  static inline void (*begin_read_hook_for_testing_)() = nullptr;
+};
+
+}  // namespace internal
+
+// An `RbTree` which may be read from any number of threads without locking
+// while writers modify it.
+//
+// Writers are serialized by a mutex, and publish each modification under a
+// seqlock. Readers traverse the tree optimistically and retry if a write
+// overlapped their traversal, so lookups scale with the number of reader
+// threads as long as writes are rare. A reader that keeps losing to writers
+// falls back to taking the writer mutex in shared mode.
+//
+// Since a reader may be partway through a node when it is removed, removed
+// nodes must stay intact until `Synchronize()` returns; only then may they be
+// freed, modified, or re-inserted. Items may not be modified while in the tree.
+//
+// `T` must derive from `RbNode`, as for `RbTree`. The tree cannot be copied or
+// moved.
+template <typename T, typename Cmp = std::less<T>>
+class ConcurrentRbTree : public internal::ConcurrentRbTreeBase {
+ public:
+  // Keeps the items returned by `LowerBound` from being reclaimed by
+  // `Synchronize()` for as long as it is alive. Lookups outside of a
+  // `ReadSection` are still safe, but their results may be removed and
+  // reclaimed as soon as they return.
+  class ReadSection {
+   public:
+    explicit ReadSection(const ConcurrentRbTree& tree)
+        : tree_(tree), token_(tree.BeginRead()) {}
+
+    ReadSection(const ReadSection&) = delete;
+    ReadSection& operator=(const ReadSection&) = delete;
+
+    ~ReadSection() {
+      tree_.EndRead(token_);
+    }
+
+   private:
+    const ConcurrentRbTree& tree_;
+    const ReadToken token_;
+  };
+
+  ConcurrentRbTree() = default;
+
+  void Insert(T* item) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Removes `item`, which must stay intact until `Synchronize()` is called.
+  void Remove(T* item) ABSL_LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    RemoveNode(item);
+  }
+
+  // Returns the lowest-valued element in the tree that `AtLeast`() is true
+  // for. `at_least` may be called on items which are concurrently being
+  // removed.
+  template <typename AtLeast>
+  const T* LowerBound(AtLeast at_least) const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Walks the tree from the root, returning false if the walk did not finish
+  // within `kMaxReadSteps`.
+  template <typename AtLeast>
+  bool TryLowerBound(AtLeast& at_least, const RbNode** result) const;
+};
+
+template <typename T, typename Cmp>
+void ConcurrentRbTree<T, Cmp>::Insert(T* item) {
+  absl::MutexLock lock(&mu_);
+  RbNode* parent = const_cast<RbNode*>(Root());
+  bool right = false;
+  for (RbNode* node = parent; node != nullptr;) {
+    parent = node;
+    right = !Cmp{}(*item, *static_cast<T*>(parent));
+    node = right ? internal::AtomicRbNodeLinks::Right(parent)
+                 : internal::AtomicRbNodeLinks::Left(parent);
+  }
+  InsertNode(item, parent, right);
+}
+
+template <typename T, typename Cmp>
+template <typename AtLeast>
+const T* ConcurrentRbTree<T, Cmp>::LowerBound(AtLeast at_least) const {
+  const ReadToken token = BeginRead();
+  const RbNode* result;
+  bool valid = false;
+  for (int attempt = 0; attempt < kOptimisticReadAttempts && !valid;
+       attempt++) {
+    const uint64_t seq = ReadBegin();
+    if ((seq & 1) != 0) {
+      continue;
+    }
+    valid = TryLowerBound(at_least, &result) && ReadValidate(seq);
+  }
+  if (!valid) {
+    absl::ReaderMutexLock lock(&mu_);
+    TryLowerBound(at_least, &result);
+  }
+  EndRead(token);
+  return static_cast<const T*>(result);
+}
+
+template <typename T, typename Cmp>
+template <typename AtLeast>
+bool ConcurrentRbTree<T, Cmp>::TryLowerBound(AtLeast& at_least,
+                                             const RbNode** result) const {
+  const RbNode* node = Root();
+  const RbNode* smallest = nullptr;
+  for (size_t steps = 0; node != nullptr; steps++) {
+    if (steps == kMaxReadSteps) {
+      return false;
+    }
+    if (at_least(*static_cast<const T*>(node))) {
+      smallest = node;
+      node = internal::AtomicRbNodeLinks::Left(node);
+    } else {
+      node = internal::AtomicRbNodeLinks::Right(node);
+    }
+  }
+  *result = smallest;
+  return true;
+}
+
+}  // namespace util
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/concurrent_red_black_tree.h"
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+using Element = BenchmarkElement;
+using ElementLess = BenchmarkElementLess;
+
+// The number of elements a writer removes before it synchronizes and inserts
+// them back.
+constexpr size_t kRetireBatch = 32;
+
+// An `RbTree` behind a reader/writer mutex, as the baseline.
+class MutexRbTree {
+ public:
+  bool Find(uint64_t key) const {
+    absl::ReaderMutexLock lock(&mu_);
+    return tree_.LowerBound([key](const Element& element) {
+      return element.key >= key;
+    }) != nullptr;
+  }
+
+  void Insert(Element* element) {
+    absl::MutexLock lock(&mu_);
+    tree_.Insert(element);
+  }
+
+  void Remove(Element* element) {
+    absl::MutexLock lock(&mu_);
+    tree_.Remove(element);
+  }
+
+  void Synchronize() {}
+
+ private:
+  mutable absl::Mutex mu_;
+  mutable RbTree<Element, ElementLess> tree_ ABSL_GUARDED_BY(mu_);
+};
+
+class LockFreeReadRbTree {
+ public:
+  bool Find(uint64_t key) const {
+    return tree_.LowerBound([key](const Element& element) {
+      return element.key >= key;
+    }) != nullptr;
+  }
+
+  void Insert(Element* element) {
+    tree_.Insert(element);
+  }
+
+  void Remove(Element* element) {
+    tree_.Remove(element);
+  }
+
+  void Synchronize() {
+    tree_.Synchronize();
+  }
+
+ private:
+  ConcurrentRbTree<Element, ElementLess> tree_;
+};
+
+// Each thread looks up random keys, and with probability `state.range(1)`%
+// instead removes one of the elements it owns. Every `kRetireBatch` removals,
+// the writer synchronizes and inserts its removed elements back.
+template <typename Tree>
+void BM_ReadMostly(benchmark::State& state) {
+  static BenchmarkTree<Tree>* shared = nullptr;
+  if (state.thread_index() == 0) {
+    shared = new BenchmarkTree<Tree>(state.range(0));
+  }
+  const size_t n = state.range(0);
+  const uint64_t write_percent = state.range(1);
+
+  // Elements are owned by threads round-robin, so writers never touch the
+  // same element.
+  std::vector<size_t> owned;
+  for (size_t i = state.thread_index(); i < n; i += state.threads()) {
+    owned.push_back(i);
+  }
+  std::mt19937_64 gen(state.thread_index());
+  std::shuffle(owned.begin(), owned.end(), gen);
+  size_t next_owned = 0;
+  std::vector<Element*> retired;
+
+  for (auto _ : state) {
+    const uint64_t random = gen();
+    if (random % 100 >= write_percent) {
+      benchmark::DoNotOptimize(shared->tree().Find((random >> 8) % n));
+      continue;
+    }
+
+    Element& element = shared->element(owned[next_owned]);
+    next_owned = (next_owned + 1) % owned.size();
+    shared->tree().Remove(&element);
+    retired.push_back(&element);
+    if (retired.size() == kRetireBatch) {
+      shared->tree().Synchronize();
+      for (Element* retired_element : retired) {
+        shared->tree().Insert(retired_element);
+      }
+      retired.clear();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) {
+    delete shared;
+    shared = nullptr;
+  }
+}
+
+void ReadMostlyArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n", "write%" });
+  for (int64_t write_percent : { 1, 10 }) {
+    b->Args({ 1 << 20, write_percent });
+  }
+  b->ThreadRange(1, 64)->UseRealTime();
+}
+
+BENCHMARK(BM_ReadMostly<MutexRbTree>)->Apply(ReadMostlyArgs);
+BENCHMARK(BM_ReadMostly<LockFreeReadRbTree>)->Apply(ReadMostlyArgs);
+
+}  // namespace
+
+}  // namespace util
@@ -0,0 +1,233 @@
+#include "util/data_structs/concurrent_red_black_tree.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+using ::testing::Eq;
+using ::testing::Field;
+using ::testing::IsNull;
+using ::testing::Pointee;
+
+struct Element : public RbNode {
+  uint64_t val;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.val < e2.val;
+  }
+};
+
+using ElementTree = ConcurrentRbTree<Element, ElementLess>;
+
+const Element* LowerBound(const ElementTree& tree, uint64_t val) {
+  return tree.LowerBound(
+      [val](const Element& element) { return element.val >= val; });
+}
+
+TEST(ConcurrentRedBlackTreeTest, TestEmpty) {
+  ElementTree tree;
+  EXPECT_EQ(tree.Size(), 0);
+  EXPECT_THAT(LowerBound(tree, 0), IsNull());
+}
+
+TEST(ConcurrentRedBlackTreeTest, TestInsertRemove) {
+  constexpr size_t kNumElements = 1000;
+
+  ElementTree tree;
+  std::vector<Element> elements(kNumElements);
+  for (size_t i = 0; i < kNumElements; i++) {
+    const size_t idx = (i * 17) % kNumElements;
+    elements[idx].val = 2 * idx;
+    tree.Insert(&elements[idx]);
+  }
+  ASSERT_EQ(tree.Size(), kNumElements);
+
+  for (uint64_t val = 0; val < 2 * kNumElements - 1; val++) {
+    EXPECT_THAT(LowerBound(tree, val),
+                Pointee(Field(&Element::val, (val + 1) / 2 * 2)));
+  }
+  EXPECT_THAT(LowerBound(tree, 2 * kNumElements), IsNull());
+
+  for (size_t i = 0; i < kNumElements; i += 2) {
+    tree.Remove(&elements[i]);
+  }
+  tree.Synchronize();
+  ASSERT_EQ(tree.Size(), kNumElements / 2);
+  for (size_t i = 0; i < kNumElements; i += 2) {
+    EXPECT_THAT(LowerBound(tree, 2 * i),
+                Pointee(Field(&Element::val, 2 * i + 2)));
+  }
+
+  // Removed elements may be re-inserted after `Synchronize`.
+  for (size_t i = 0; i < kNumElements; i += 2) {
+    tree.Insert(&elements[i]);
+  }
+  for (size_t i = 0; i < kNumElements; i++) {
+    EXPECT_EQ(LowerBound(tree, 2 * i), &elements[i]);
+  }
+}
+
+// Readers look up keys while a writer churns the tree. Elements with even
+// values stay in the tree throughout, so every lookup must find one.
+TEST(ConcurrentRedBlackTreeTest, TestConcurrentReaders) {
+  constexpr size_t kNumElements = 2000;
+  constexpr size_t kNumReaders = 4;
+  constexpr size_t kNumWrites = 5000;
+
+  ElementTree tree;
+  std::vector<Element> elements(kNumElements);
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(&elements[i]);
+  }
+
+  std::atomic<bool> done = false;
+  std::atomic<size_t> failures = 0;
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < kNumReaders; r++) {
+    readers.emplace_back([&, r] {
+      std::mt19937_64 gen(r);
+      while (!done.load(std::memory_order_relaxed)) {
+        const uint64_t val = gen() % (kNumElements - 1);
+        const Element* found = LowerBound(tree, val);
+        const uint64_t expected = val % 2 == 0 ? val : val + 1;
+        if (found == nullptr ||
+            (found->val != val && found->val != expected)) {
+          failures.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+
+  std::mt19937_64 gen(kNumReaders);
+  for (size_t i = 0; i < kNumWrites; i++) {
+    Element& element = elements[2 * (gen() % (kNumElements / 2)) + 1];
+    tree.Remove(&element);
+    tree.Synchronize();
+    tree.Insert(&element);
+  }
+  done.store(true, std::memory_order_relaxed);
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(failures.load(), 0);
+  EXPECT_EQ(tree.Size(), kNumElements);
+  for (size_t i = 0; i < kNumElements; i++) {
+    EXPECT_EQ(LowerBound(tree, i), &elements[i]);
+  }
+}
+
+// Whether the next `BeginRead` on this thread stalls in the hook.
+thread_local bool stall_begin_read = false;
+
+// Stalls readers between loading the parity and registering under it for
+// their read section, which lets `Synchronize` run in between. Removed
+// elements are poisoned once `Synchronize` returns, which readers must never
+// see.
+TEST(ConcurrentRedBlackTreeTest, TestSynchronizeWithStalledReaders) {
+  constexpr size_t kNumElements = 4;
+  constexpr size_t kNumReaders = 4;
+  constexpr size_t kNumWrites = 20000;
+  constexpr uint64_t kPoisoned = ~uint64_t{ 0 };
+
+  ElementTree tree;
+  std::vector<Element> elements(kNumElements);
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(&elements[i]);
+  }
+
+  ElementTree::SetBeginReadHookForTesting([] {
+    if (stall_begin_read) {
+      stall_begin_read = false;
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  });
+  std::atomic<bool> done = false;
+  std::atomic<size_t> poisoned_reads = 0;
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < kNumReaders; r++) {
+    readers.emplace_back([&, r] {
+      std::mt19937_64 gen(r);
+      while (!done.load(std::memory_order_relaxed)) {
+        stall_begin_read = true;
+        ElementTree::ReadSection section(tree);
+        const Element* found = LowerBound(tree, gen() % kNumElements);
+        std::this_thread::yield();
+        if (found != nullptr && found->val == kPoisoned) {
+          poisoned_reads.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+
+  std::mt19937_64 gen(kNumReaders);
+  for (size_t i = 0; i < kNumWrites; i++) {
+    const uint64_t val = gen() % kNumElements;
+    tree.Remove(&elements[val]);
+    tree.Synchronize();
+    elements[val].val = kPoisoned;
+    std::this_thread::yield();
+    elements[val].val = val;
+    tree.Insert(&elements[val]);
+    std::this_thread::yield();
+  }
+  done.store(true, std::memory_order_relaxed);
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  ElementTree::SetBeginReadHookForTesting(nullptr);
+
+  EXPECT_EQ(poisoned_reads.load(), 0);
+  EXPECT_EQ(tree.Size(), kNumElements);
+}
+
+TEST(ConcurrentRedBlackTreeTest, TestSynchronizeWaitsForReadSection) {
+  ElementTree tree;
+  Element element;
+  element.val = 1;
+  tree.Insert(&element);
+
+  absl::Notification entered;
+  absl::Notification release;
+  std::thread reader([&] {
+    ElementTree::ReadSection section(tree);
+    EXPECT_THAT(LowerBound(tree, 0), Eq(&element));
+    entered.Notify();
+    release.WaitForNotification();
+  });
+  entered.WaitForNotification();
+
+  tree.Remove(&element);
+  std::atomic<bool> synchronized = false;
+  std::thread writer([&] {
+    tree.Synchronize();
+    synchronized.store(true);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(synchronized.load());
+  release.Notify();
+  reader.join();
+  writer.join();
+  EXPECT_TRUE(synchronized.load());
+
+  EXPECT_THAT(LowerBound(tree, 0), IsNull());
+}
+
+}  // namespace util
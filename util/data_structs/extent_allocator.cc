@@ -0,0 +1,295 @@
+#include "util/data_structs/extent_allocator.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+
+#include "util/data_structs/red_black_tree_ops.h"
+#include "util/internal/util.h"
+
+namespace util {
+
+using internal::Extent;
+using internal::ExtentHook;
+
+namespace {
+
+// Links extents through one of their hooks, for `RbOps`.
+template <ExtentHook Extent::*kHook>
+struct ExtentLinks {
+  using Ref = Extent*;
+
+  static Extent* Null() {
+    return nullptr;
+  }
+
+  static Extent* Left(Extent* extent) {
+    return (extent->*kHook).left;
+  }
+
+  static Extent* Right(Extent* extent) {
+    return (extent->*kHook).right;
+  }
+
+  static Extent* Parent(Extent* extent) {
+    return (extent->*kHook).parent;
+  }
+
+  static bool IsRed(Extent* extent) {
+    return (extent->*kHook).red;
+  }
+
+  static void SetLeft(Extent* extent, Extent* left) {
+    (extent->*kHook).left = left;
+  }
+
+  static void SetRight(Extent* extent, Extent* right) {
+    (extent->*kHook).right = right;
+  }
+
+  static void SetParent(Extent* extent, Extent* parent) {
+    (extent->*kHook).parent = parent;
+  }
+
+  static void SetRed(Extent* extent, bool red) {
+    (extent->*kHook).red = red;
+  }
+};
+
+struct OffsetLinks : ExtentLinks<&Extent::by_offset> {
+  static void Update(Extent* extent) {
+    uint64_t max_size = extent->size;
+    if (extent->by_offset.left != nullptr) {
+      max_size = std::max(max_size, extent->by_offset.left->max_size);
+    }
+    if (extent->by_offset.right != nullptr) {
+      max_size = std::max(max_size, extent->by_offset.right->max_size);
+    }
+    extent->max_size = max_size;
+  }
+};
+
+using SizeLinks = ExtentLinks<&Extent::by_size>;
+
+using OffsetOps = internal::RbOps<OffsetLinks>;
+using SizeOps = internal::RbOps<SizeLinks>;
+
+// Returns the extent after `extent` in the tree of `kHook`, or null.
+template <ExtentHook Extent::*kHook>
+Extent* Next(Extent* extent) {
+  if (Extent* node = (extent->*kHook).right; node != nullptr) {
+    for (Extent* left; (left = (node->*kHook).left) != nullptr; node = left)
+      ;
+    return node;
+  }
+
+  Extent* node = extent;
+  Extent* parent = (node->*kHook).parent;
+  while ((parent->*kHook).right == node) {
+    node = parent;
+    parent = (node->*kHook).parent;
+  }
+  // Past the last extent, this reaches the root sentinel, which has no parent.
+  return (parent->*kHook).parent != nullptr ? parent : nullptr;
+}
+
+uint64_t AlignUp(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+bool Fits(const Extent* extent, uint64_t size, uint64_t alignment) {
+  const uint64_t padding = AlignUp(extent->offset, alignment) - extent->offset;
+  return extent->size >= padding && extent->size - padding >= size;
+}
+
+// Returns the first extent under `node` in offset order which fits, skipping
+// subtrees whose largest extent is too small.
+Extent* FirstFit(Extent* node, uint64_t size, uint64_t alignment) {
+  if (node == nullptr || node->max_size < size) {
+    return nullptr;
+  }
+  if (Extent* extent = FirstFit(node->by_offset.left, size, alignment);
+      extent != nullptr) {
+    return extent;
+  }
+  if (Fits(node, size, alignment)) {
+    return node;
+  }
+  return FirstFit(node->by_offset.right, size, alignment);
+}
+
+}  // namespace
+
+ExtentAllocator::ExtentAllocator(uint64_t offset, uint64_t size) {
+  if (size != 0) {
+    Free(offset, size);
+  }
+}
+
+std::optional<uint64_t> ExtentAllocator::Allocate(uint64_t size,
+                                                  uint64_t alignment, Fit fit) {
+  UTIL_DCHECK(size != 0);
+  UTIL_DCHECK(alignment != 0 && (alignment & (alignment - 1)) == 0);
+  Extent* extent = fit == Fit::kFirst ? FindFirstFit(size, alignment)
+                                      : FindBestFit(size, alignment);
+  if (extent == nullptr) {
+    return std::nullopt;
+  }
+
+  // Leave the free space before and after the allocated range in place.
+  const uint64_t start = AlignUp(extent->offset, alignment);
+  const uint64_t before = start - extent->offset;
+  const uint64_t after = extent->size - before - size;
+  if (before == 0 && after == 0) {
+    RemoveExtent(extent);
+  } else if (before == 0) {
+    ResizeExtent(extent, start + size, after);
+  } else {
+    ResizeExtent(extent, extent->offset, before);
+    if (after != 0) {
+      InsertExtent(start + size, after);
+    }
+  }
+  free_size_ -= size;
+  return start;
+}
+
+void ExtentAllocator::Free(uint64_t offset, uint64_t size) {
+  UTIL_DCHECK(size != 0);
+  // Find the extents just before and after the range.
+  Extent* pred = nullptr;
+  Extent* succ = nullptr;
+  for (Extent* node = offset_root_.by_offset.left; node != nullptr;) {
+    if (node->offset < offset) {
+      pred = node;
+      node = node->by_offset.right;
+    } else {
+      succ = node;
+      node = node->by_offset.left;
+    }
+  }
+  UTIL_DCHECK(pred == nullptr || pred->offset + pred->size <= offset);
+  UTIL_DCHECK(succ == nullptr || offset + size <= succ->offset);
+
+  const bool merge_pred =
+      pred != nullptr && pred->offset + pred->size == offset;
+  const bool merge_succ = succ != nullptr && offset + size == succ->offset;
+  if (merge_pred && merge_succ) {
+    const uint64_t merged_size = pred->size + size + succ->size;
+    RemoveExtent(succ);
+    ResizeExtent(pred, pred->offset, merged_size);
+  } else if (merge_pred) {
+    ResizeExtent(pred, pred->offset, pred->size + size);
+  } else if (merge_succ) {
+    ResizeExtent(succ, offset, size + succ->size);
+  } else {
+    InsertExtent(offset, size);
+  }
+  free_size_ += size;
+}
+
+ExtentAllocator::Stats ExtentAllocator::GetStats() const {
+  const Extent* root = offset_root_.by_offset.left;
+  return {
+    .free_size = free_size_,
+    .free_extents = free_extents_,
+    .largest_extent = root != nullptr ? root->max_size : 0,
+  };
+}
+
+const Extent* ExtentAllocator::FirstByOffset() const {
+  const Extent* extent = offset_root_.by_offset.left;
+  if (extent == nullptr) {
+    return nullptr;
+  }
+  for (const Extent* left; (left = extent->by_offset.left) != nullptr;
+       extent = left)
+    ;
+  return extent;
+}
+
+const Extent* ExtentAllocator::NextByOffset(const Extent* extent) {
+  return Next<&Extent::by_offset>(const_cast<Extent*>(extent));
+}
+
+Extent* ExtentAllocator::FindFirstFit(uint64_t size, uint64_t alignment) {
+  return FirstFit(offset_root_.by_offset.left, size, alignment);
+}
+
+Extent* ExtentAllocator::FindBestFit(uint64_t size, uint64_t alignment) {
+  // Find the smallest extent of at least `size`, then skip extents which
+  // cannot hold an aligned range. Any extent of at least
+  // `size + alignment - 1` can, so this ends there at the latest.
+  Extent* extent = nullptr;
+  for (Extent* node = size_root_.by_size.left; node != nullptr;) {
+    if (node->size >= size) {
+      extent = node;
+      node = node->by_size.left;
+    } else {
+      node = node->by_size.right;
+    }
+  }
+  while (extent != nullptr && !Fits(extent, size, alignment)) {
+    extent = Next<&Extent::by_size>(extent);
+  }
+  return extent;
+}
+
+void ExtentAllocator::InsertExtent(uint64_t offset, uint64_t size) {
+  Extent* extent = new (arena_.Allocate()) Extent{
+    .offset = offset,
+    .size = size,
+  };
+
+  Extent* parent = &offset_root_;
+  bool left = true;
+  for (Extent* node = offset_root_.by_offset.left; node != nullptr;) {
+    parent = node;
+    left = offset < node->offset;
+    node = left ? node->by_offset.left : node->by_offset.right;
+  }
+  if (left) {
+    OffsetOps({}).InsertLeft(extent, parent, &offset_root_);
+  } else {
+    OffsetOps({}).InsertRight(extent, parent, &offset_root_);
+  }
+
+  InsertBySize(extent);
+  free_extents_++;
+}
+
+void ExtentAllocator::RemoveExtent(Extent* extent) {
+  OffsetOps({}).Remove(extent, &offset_root_);
+  SizeOps({}).Remove(extent, &size_root_);
+  arena_.Free(extent);
+  free_extents_--;
+}
+
+void ExtentAllocator::ResizeExtent(Extent* extent, uint64_t offset,
+                                   uint64_t size) {
+  SizeOps({}).Remove(extent, &size_root_);
+  extent->offset = offset;
+  extent->size = size;
+  InsertBySize(extent);
+  OffsetOps({}).Propagate(extent, &offset_root_);
+}
+
+void ExtentAllocator::InsertBySize(Extent* extent) {
+  Extent* parent = &size_root_;
+  bool left = true;
+  for (Extent* node = size_root_.by_size.left; node != nullptr;) {
+    parent = node;
+    left = extent->size < node->size ||
+           (extent->size == node->size && extent->offset < node->offset);
+    node = left ? node->by_size.left : node->by_size.right;
+  }
+  if (left) {
+    SizeOps({}).InsertLeft(extent, parent, &size_root_);
+  } else {
+    SizeOps({}).InsertRight(extent, parent, &size_root_);
+  }
+}
+
+}  // namespace util
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "util/data_structs/slab_arena.h"
+
+namespace util {
+
+namespace internal {
+
+struct Extent;
+
+// The links of an `Extent` in one of the trees of an `ExtentAllocator`.
+struct ExtentHook {
+  Extent* left = nullptr;
+  Extent* right = nullptr;
+  Extent* parent = nullptr;
+  bool red = false;
+};
+
+// A free range of an `ExtentAllocator`, linked into two red-black trees: one
+// ordered by offset, and one by size and then offset.
+struct Extent {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  // The largest `size` in this extent's subtree of the offset tree.
+  uint64_t max_size = 0;
+  ExtentHook by_offset;
+  ExtentHook by_size;
+};
+
+}  // namespace internal
+
+// Allocates ranges of an abstract space, such as a device or a file, by
+// keeping track of its free extents.
+//
+// Free extents are kept in a red-black tree ordered by offset, where each node
+// also holds the largest extent in its subtree, and in a second tree ordered by
+// size. First-fit allocation descends the offset tree into the leftmost subtree
+// with a large enough extent, and best-fit allocation looks up the smallest
+// large enough extent in the size tree, so both are O(log n) in the number of
+// free extents. Freed ranges are coalesced with adjacent free extents.
+//
+// Offsets and sizes are in arbitrary units. This is not thread-safe.
+class ExtentAllocator {
+ public:
+  enum class Fit {
+    // The extent with the lowest offset.
+    kFirst,
+    // The smallest extent, and the one with the lowest offset among those.
+    kBest,
+  };
+
+  struct Stats {
+    // The total size of all free extents.
+    uint64_t free_size = 0;
+    size_t free_extents = 0;
+    uint64_t largest_extent = 0;
+
+    // The fraction of free space outside the largest extent, from 0 (all free
+    // space is in one extent) towards 1.
+    double Fragmentation() const {
+      return free_size == 0 ? 0.
+                            : 1. - static_cast<double>(largest_extent) /
+                                       static_cast<double>(free_size);
+    }
+  };
+
+  // Constructs an allocator with no free space.
+  ExtentAllocator() = default;
+
+  // Constructs an allocator with `[offset, offset + size)` free.
+  ExtentAllocator(uint64_t offset, uint64_t size);
+
+  // The trees point into the allocator.
+  ExtentAllocator(const ExtentAllocator&) = delete;
+  ExtentAllocator(ExtentAllocator&&) = delete;
+  ExtentAllocator& operator=(const ExtentAllocator&) = delete;
+  ExtentAllocator& operator=(ExtentAllocator&&) = delete;
+
+  // Allocates `size` units at an offset which is a multiple of `alignment`, a
+  // power of two, and returns the offset, or `std::nullopt` if no free extent
+  // can hold it. `size` must not be 0.
+  //
+  // With `alignment` above 1, extents which are large enough but cannot hold
+  // an aligned range are skipped, which may visit more than O(log n) of them.
+  std::optional<uint64_t> Allocate(uint64_t size, uint64_t alignment = 1,
+                                   Fit fit = Fit::kFirst);
+
+  // Marks `[offset, offset + size)` as free. The range must not overlap any
+  // free extent.
+  void Free(uint64_t offset, uint64_t size);
+
+  Stats GetStats() const;
+
+  // Calls `fn(offset, size)` on every free extent, in order of offset.
+  template <typename Fn>
+  void ForEachFreeExtent(Fn fn) const {
+    for (const internal::Extent* extent = FirstByOffset(); extent != nullptr;
+         extent = NextByOffset(extent)) {
+      fn(extent->offset, extent->size);
+    }
+  }
+
+ private:
+  const internal::Extent* FirstByOffset() const;
+
+  static const internal::Extent* NextByOffset(const internal::Extent* extent);
+
+  // Returns the first extent in offset order which can hold `size` units at
+  // `alignment`, or null.
+  internal::Extent* FindFirstFit(uint64_t size, uint64_t alignment);
+
+  // Returns the smallest extent which can hold `size` units at `alignment`, or
+  // null.
+  internal::Extent* FindBestFit(uint64_t size, uint64_t alignment);
+
+  // Adds a new free extent, which is not adjacent to any other.
+  void InsertExtent(uint64_t offset, uint64_t size);
+
+  void RemoveExtent(internal::Extent* extent);
+
+  // Changes the range of `extent`, which must keep its position in offset
+  // order.
+  void ResizeExtent(internal::Extent* extent, uint64_t offset, uint64_t size);
+
+  void InsertBySize(internal::Extent* extent);
+
+  // The root sentinels of the two trees: the root of each tree is the left
+  // child of its sentinel.
+  internal::Extent offset_root_;
+  internal::Extent size_root_;
+
+  uint64_t free_size_ = 0;
+  size_t free_extents_ = 0;
+
+  SlabArena<sizeof(internal::Extent), alignof(internal::Extent)> arena_;
+};
+
+}  // namespace util
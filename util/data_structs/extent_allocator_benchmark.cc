@@ -0,0 +1,206 @@
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/extent_allocator.h"
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/slab_arena.h"
+
+namespace util {
+
+namespace {
+
+// Allocation sizes are uniform in [1, 2 * kMeanSize).
+constexpr uint64_t kMeanSize = 64;
+
+// The baseline: free extents in an `RbTree` ordered by offset, scanned in
+// order with `Next()` for the first one that fits.
+class LinearScanAllocator {
+ public:
+  explicit LinearScanAllocator(uint64_t size) {
+    tree_.Insert(NewExtent(0, size));
+  }
+
+  ~LinearScanAllocator() {
+    while (tree_.Size() != 0) {
+      Extent* extent = First();
+      tree_.Remove(extent);
+      arena_.Free(extent);
+    }
+  }
+
+  std::optional<uint64_t> Allocate(uint64_t size) {
+    for (Extent* extent = First(); extent != nullptr; extent = Next(extent)) {
+      if (extent->size < size) {
+        continue;
+      }
+
+      const uint64_t offset = extent->offset;
+      if (extent->size == size) {
+        tree_.Remove(extent);
+        arena_.Free(extent);
+      } else {
+        // The extent keeps its position in the tree.
+        extent->offset += size;
+        extent->size -= size;
+      }
+      return offset;
+    }
+    return std::nullopt;
+  }
+
+  void Free(uint64_t offset, uint64_t size) {
+    // The first extent ending at or after `offset` is either just before the
+    // range, or after it.
+    Extent* pred = tree_.LowerBound([offset](const Extent& extent) {
+      return extent.offset + extent.size >= offset;
+    });
+    Extent* succ = pred;
+    if (pred != nullptr && pred->offset + pred->size == offset) {
+      succ = Next(pred);
+    } else {
+      pred = nullptr;
+    }
+
+    const bool merge_succ = succ != nullptr && succ->offset == offset + size;
+    if (pred != nullptr) {
+      pred->size += size;
+      if (merge_succ) {
+        pred->size += succ->size;
+        tree_.Remove(succ);
+        arena_.Free(succ);
+      }
+    } else if (merge_succ) {
+      succ->offset = offset;
+      succ->size += size;
+    } else {
+      tree_.Insert(NewExtent(offset, size));
+    }
+  }
+
+  size_t FreeExtents() const {
+    return tree_.Size();
+  }
+
+ private:
+  struct Extent : public RbNode {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  struct OffsetLess {
+    bool operator()(const Extent& e1, const Extent& e2) const {
+      return e1.offset < e2.offset;
+    }
+  };
+
+  Extent* NewExtent(uint64_t offset, uint64_t size) {
+    Extent* extent = new (arena_.Allocate()) Extent();
+    extent->offset = offset;
+    extent->size = size;
+    return extent;
+  }
+
+  Extent* First() {
+    return tree_.LowerBound([](const Extent&) { return true; });
+  }
+
+  Extent* Next(Extent* extent) const {
+    const RbNode* next = extent->Next();
+    return next != tree_.RootSentinel()
+               ? const_cast<Extent*>(static_cast<const Extent*>(next))
+               : nullptr;
+  }
+
+  RbTree<Extent, OffsetLess> tree_;
+  SlabArena<sizeof(Extent), alignof(Extent)> arena_;
+};
+
+template <ExtentAllocator::Fit kFit>
+class TreeAllocator {
+ public:
+  explicit TreeAllocator(uint64_t size) : allocator_(0, size) {}
+
+  std::optional<uint64_t> Allocate(uint64_t size) {
+    return allocator_.Allocate(size, 1, kFit);
+  }
+
+  void Free(uint64_t offset, uint64_t size) {
+    allocator_.Free(offset, size);
+  }
+
+  size_t FreeExtents() const {
+    return allocator_.GetStats().free_extents;
+  }
+
+ private:
+  ExtentAllocator allocator_;
+};
+
+using FirstFitAllocator = TreeAllocator<ExtentAllocator::Fit::kFirst>;
+using BestFitAllocator = TreeAllocator<ExtentAllocator::Fit::kBest>;
+
+// Args: n.
+//
+// Keeps about `n` random-sized allocations live in a space with 25% headroom.
+// Every iteration frees a random allocation and allocates a new one, which
+// breaks the free space up into many small extents. When an allocation fails,
+// more allocations are freed until it fits.
+template <typename Allocator>
+void BM_Churn(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const uint64_t space = n * kMeanSize * 5 / 4;
+
+  std::mt19937_64 gen(0);
+  auto random_size = [&gen]() { return 1 + gen() % (2 * kMeanSize - 1); };
+
+  Allocator allocator(space);
+  std::vector<std::pair<uint64_t, uint64_t>> live;
+  auto free_random = [&]() {
+    const size_t i = gen() % live.size();
+    allocator.Free(live[i].first, live[i].second);
+    live[i] = live.back();
+    live.pop_back();
+  };
+  auto allocate = [&]() {
+    const uint64_t size = random_size();
+    std::optional<uint64_t> offset;
+    while (!(offset = allocator.Allocate(size)).has_value()) {
+      free_random();
+    }
+    live.emplace_back(*offset, size);
+  };
+
+  while (live.size() < n) {
+    allocate();
+  }
+  for (auto _ : state) {
+    free_random();
+    while (live.size() < n) {
+      allocate();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["free_extents"] = allocator.FreeExtents();
+}
+
+void ChurnArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n" });
+  for (int64_t n : { 1 << 10, 1 << 14, 1 << 18 }) {
+    b->Arg(n);
+  }
+}
+
+BENCHMARK(BM_Churn<LinearScanAllocator>)->Apply(ChurnArgs);
+BENCHMARK(BM_Churn<FirstFitAllocator>)->Apply(ChurnArgs);
+BENCHMARK(BM_Churn<BestFitAllocator>)->Apply(ChurnArgs);
+
+}  // namespace
+
+}  // namespace util
@@ -0,0 +1,230 @@
+#include "util/data_structs/extent_allocator.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::Optional;
+using ::testing::Pair;
+
+using Fit = ExtentAllocator::Fit;
+
+std::vector<std::pair<uint64_t, uint64_t>> FreeExtents(
+    const ExtentAllocator& allocator) {
+  std::vector<std::pair<uint64_t, uint64_t>> extents;
+  allocator.ForEachFreeExtent([&extents](uint64_t offset, uint64_t size) {
+    extents.emplace_back(offset, size);
+  });
+  return extents;
+}
+
+// A free list which finds extents by scanning all of them.
+class ReferenceAllocator {
+ public:
+  std::optional<uint64_t> Allocate(uint64_t size, uint64_t alignment,
+                                   Fit fit) {
+    auto best = free_.end();
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+      const uint64_t start = AlignUp(it->first, alignment);
+      if (start + size > it->first + it->second) {
+        continue;
+      }
+      if (best == free_.end() || it->second < best->second) {
+        best = it;
+      }
+      if (fit == Fit::kFirst) {
+        break;
+      }
+    }
+    if (best == free_.end()) {
+      return std::nullopt;
+    }
+
+    const auto [offset, extent_size] = *best;
+    const uint64_t start = AlignUp(offset, alignment);
+    free_.erase(best);
+    if (start != offset) {
+      free_.emplace(offset, start - offset);
+    }
+    if (start + size != offset + extent_size) {
+      free_.emplace(start + size, offset + extent_size - start - size);
+    }
+    return start;
+  }
+
+  void Free(uint64_t offset, uint64_t size) {
+    auto it = free_.emplace(offset, size).first;
+    if (auto next = std::next(it);
+        next != free_.end() && offset + size == next->first) {
+      it->second += next->second;
+      free_.erase(next);
+    }
+    if (it != free_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + prev->second == offset) {
+        prev->second += it->second;
+        free_.erase(it);
+      }
+    }
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> FreeExtents() const {
+    return { free_.begin(), free_.end() };
+  }
+
+ private:
+  static uint64_t AlignUp(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+  }
+
+  std::map<uint64_t, uint64_t> free_;
+};
+
+TEST(ExtentAllocatorTest, TestEmpty) {
+  ExtentAllocator allocator;
+  EXPECT_EQ(allocator.Allocate(1), std::nullopt);
+  EXPECT_THAT(FreeExtents(allocator), IsEmpty());
+
+  const ExtentAllocator::Stats stats = allocator.GetStats();
+  EXPECT_EQ(stats.free_size, 0);
+  EXPECT_EQ(stats.free_extents, 0);
+  EXPECT_EQ(stats.largest_extent, 0);
+  EXPECT_EQ(stats.Fragmentation(), 0.);
+}
+
+TEST(ExtentAllocatorTest, TestAllocateAndCoalesce) {
+  ExtentAllocator allocator(100, 1000);
+  EXPECT_THAT(allocator.Allocate(100), Optional(100));
+  EXPECT_THAT(allocator.Allocate(200), Optional(200));
+  EXPECT_THAT(allocator.Allocate(300), Optional(400));
+  EXPECT_THAT(FreeExtents(allocator), ElementsAre(Pair(700, 400)));
+
+  allocator.Free(200, 200);
+  EXPECT_THAT(FreeExtents(allocator),
+              ElementsAre(Pair(200, 200), Pair(700, 400)));
+  // Coalesces with the extent after.
+  allocator.Free(400, 100);
+  EXPECT_THAT(FreeExtents(allocator),
+              ElementsAre(Pair(200, 300), Pair(700, 400)));
+  // Coalesces with the extent before.
+  allocator.Free(100, 100);
+  EXPECT_THAT(FreeExtents(allocator),
+              ElementsAre(Pair(100, 400), Pair(700, 400)));
+  // Coalesces with both.
+  allocator.Free(500, 200);
+  EXPECT_THAT(FreeExtents(allocator), ElementsAre(Pair(100, 1000)));
+
+  EXPECT_THAT(allocator.Allocate(1000), Optional(100));
+  EXPECT_EQ(allocator.Allocate(1), std::nullopt);
+}
+
+TEST(ExtentAllocatorTest, TestFirstAndBestFit) {
+  ExtentAllocator allocator;
+  allocator.Free(0, 100);
+  allocator.Free(200, 50);
+  allocator.Free(300, 10);
+  allocator.Free(400, 10);
+
+  EXPECT_THAT(allocator.Allocate(10, 1, Fit::kFirst), Optional(0));
+  EXPECT_THAT(allocator.Allocate(10, 1, Fit::kBest), Optional(300));
+  EXPECT_THAT(allocator.Allocate(10, 1, Fit::kBest), Optional(400));
+  EXPECT_THAT(allocator.Allocate(60, 1, Fit::kBest), Optional(10));
+  EXPECT_THAT(allocator.Allocate(40, 1, Fit::kBest), Optional(200));
+  EXPECT_THAT(FreeExtents(allocator),
+              ElementsAre(Pair(70, 30), Pair(240, 10)));
+  EXPECT_EQ(allocator.Allocate(31, 1, Fit::kBest), std::nullopt);
+}
+
+TEST(ExtentAllocatorTest, TestAligned) {
+  ExtentAllocator allocator(3, 100);
+  EXPECT_THAT(allocator.Allocate(10, 16), Optional(16));
+  EXPECT_THAT(FreeExtents(allocator),
+              ElementsAre(Pair(3, 13), Pair(26, 77)));
+
+  // [3, 16) is large enough, but cannot hold a range aligned to 16.
+  EXPECT_THAT(allocator.Allocate(8, 16, Fit::kFirst), Optional(32));
+  EXPECT_THAT(allocator.Allocate(8, 8, Fit::kBest), Optional(8));
+  EXPECT_THAT(FreeExtents(allocator),
+              ElementsAre(Pair(3, 5), Pair(26, 6), Pair(40, 63)));
+  EXPECT_EQ(allocator.Allocate(64, 1), std::nullopt);
+}
+
+TEST(ExtentAllocatorTest, TestStats) {
+  ExtentAllocator allocator;
+  allocator.Free(0, 300);
+  allocator.Free(1000, 100);
+
+  const ExtentAllocator::Stats stats = allocator.GetStats();
+  EXPECT_EQ(stats.free_size, 400);
+  EXPECT_EQ(stats.free_extents, 2);
+  EXPECT_EQ(stats.largest_extent, 300);
+  EXPECT_DOUBLE_EQ(stats.Fragmentation(), 0.25);
+}
+
+// Applies random allocations and frees to an allocator and to a reference free
+// list, and checks that they return the same offsets and keep the same free
+// extents.
+TEST(ExtentAllocatorTest, TestRandomAgainstReference) {
+  constexpr uint64_t kSpace = 1 << 16;
+  constexpr size_t kNumOps = 20000;
+
+  std::mt19937_64 gen(0);
+  ExtentAllocator allocator(0, kSpace);
+  ReferenceAllocator expected;
+  expected.Free(0, kSpace);
+  std::vector<std::pair<uint64_t, uint64_t>> allocated;
+
+  for (size_t op = 0; op < kNumOps; op++) {
+    if (gen() % 2 == 0 || allocated.empty()) {
+      const uint64_t size = 1 + gen() % (gen() % 8 == 0 ? 4096 : 64);
+      const uint64_t alignment = uint64_t{ 1 } << (gen() % 4 == 0 ? gen() % 8
+                                                                  : 0);
+      const Fit fit = gen() % 2 == 0 ? Fit::kFirst : Fit::kBest;
+      const std::optional<uint64_t> offset =
+          allocator.Allocate(size, alignment, fit);
+      ASSERT_EQ(offset, expected.Allocate(size, alignment, fit)) << "op " << op;
+      if (offset.has_value()) {
+        allocated.emplace_back(*offset, size);
+      }
+    } else {
+      const size_t i = gen() % allocated.size();
+      const auto [offset, size] = allocated[i];
+      allocated[i] = allocated.back();
+      allocated.pop_back();
+      allocator.Free(offset, size);
+      expected.Free(offset, size);
+    }
+
+    const std::vector<std::pair<uint64_t, uint64_t>> extents =
+        expected.FreeExtents();
+    ASSERT_THAT(FreeExtents(allocator), ElementsAreArray(extents))
+        << "op " << op;
+
+    uint64_t free_size = 0;
+    uint64_t largest = 0;
+    for (const auto& [offset, size] : extents) {
+      free_size += size;
+      largest = std::max(largest, size);
+    }
+    const ExtentAllocator::Stats stats = allocator.GetStats();
+    ASSERT_EQ(stats.free_size, free_size);
+    ASSERT_EQ(stats.free_extents, extents.size());
+    ASSERT_EQ(stats.largest_extent, largest);
+  }
+}
+
+}  // namespace util
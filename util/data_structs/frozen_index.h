@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+// A read-only snapshot of the in-order contents of an `RbTree`, laid out in
+// Eytzinger (BFS) order in a contiguous array.
+//
+// Lookups walk the implicit tree without branching on the comparison result,
+// and prefetch the block of descendants three levels down as well as the items
+// of both children, so the next levels are already in flight while the current
+// item is compared.
+//
+// The index points back to the items of the tree it was built from, which must
+// outlive it. It is not updated if the tree is modified.
+template <typename T, typename Cmp = std::less<T>>
+class FrozenIndex {
+  static constexpr size_t kCacheLineBytes = 64;
+  static constexpr size_t kItemsPerCacheLine =
+      kCacheLineBytes / sizeof(const T*);
+
+ public:
+  FrozenIndex() = default;
+
+  explicit FrozenIndex(const RbTree<T, Cmp>& tree);
+
+  // `items_` points into `storage_`, so copies align and point into their own
+  // storage, and moves leave the source empty.
+  FrozenIndex(const FrozenIndex& other);
+  FrozenIndex& operator=(const FrozenIndex& other);
+  FrozenIndex(FrozenIndex&& other) noexcept
+      : size_(std::exchange(other.size_, 0)),
+        items_(std::exchange(other.items_, nullptr)),
+        storage_(std::move(other.storage_)) {}
+  FrozenIndex& operator=(FrozenIndex&& other) noexcept;
+
+  size_t Size() const {
+    return size_;
+  }
+
+  // Returns the lowest-valued element in the index that `AtLeast`() is true
+  // for.
+  template <typename AtLeast>
+  const T* LowerBound(AtLeast at_least) const;
+
+ private:
+  // Allocates null entries for `size` items, and points `items_` at them.
+  void Allocate(size_t size);
+
+  size_t size_ = 0;
+
+  // `items_[1..size_]` hold the items in Eytzinger order, where the children
+  // of `items_[k]` are `items_[2k]` and `items_[2k + 1]`. Entries past
+  // `size_`, up to `2 * size_ + 1`, are null so children can be prefetched
+  // without bounds checks.
+  const T** items_ = nullptr;
+  std::vector<const T*> storage_;
+};
+
+template <typename T, typename Cmp>
+FrozenIndex<T, Cmp> Freeze(const RbTree<T, Cmp>& tree) {
+  return FrozenIndex<T, Cmp>(tree);
+}
+
+template <typename T, typename Cmp>
+FrozenIndex<T, Cmp>::FrozenIndex(const RbTree<T, Cmp>& tree) {
+  Allocate(tree.Size());
+  if (size_ == 0) {
+    return;
+  }
+
+  // Walk the tree and the implicit Eytzinger tree in order in lockstep,
+  // starting from the leftmost position of each.
+  size_t k = std::bit_floor(size_);
+  for (const RbNode* node = tree.Root()->LeftmostChild();
+       node != tree.RootSentinel(); node = node->Next()) {
+    items_[k] = static_cast<const T*>(node);
+    if (2 * k + 1 <= size_) {
+      k = 2 * k + 1;
+      k <<= std::countl_zero(k) - std::countl_zero(size_);
+      if (k > size_) {
+        k >>= 1;
+      }
+    } else {
+      k >>= std::countr_one(k) + 1;
+    }
+  }
+}
+
+template <typename T, typename Cmp>
+FrozenIndex<T, Cmp>::FrozenIndex(const FrozenIndex& other) {
+  if (other.size_ == 0) {
+    return;
+  }
+  Allocate(other.size_);
+  std::copy(other.items_ + 1, other.items_ + size_ + 1, items_ + 1);
+}
+
+template <typename T, typename Cmp>
+FrozenIndex<T, Cmp>& FrozenIndex<T, Cmp>::operator=(const FrozenIndex& other) {
+  if (this != &other) {
+    *this = FrozenIndex(other);
+  }
+  return *this;
+}
+
+template <typename T, typename Cmp>
+FrozenIndex<T, Cmp>& FrozenIndex<T, Cmp>::operator=(
+    FrozenIndex&& other) noexcept {
+  size_ = std::exchange(other.size_, 0);
+  items_ = std::exchange(other.items_, nullptr);
+  storage_ = std::move(other.storage_);
+  return *this;
+}
+
+template <typename T, typename Cmp>
+void FrozenIndex<T, Cmp>::Allocate(size_t size) {
+  size_ = size;
+  storage_.assign(2 * size + 2 + kItemsPerCacheLine, nullptr);
+  // Align the array so that the descendants three levels below `k`, at
+  // `[8k, 8k + 8)`, share a cache line.
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(storage_.data());
+  items_ = storage_.data() + (-addr % kCacheLineBytes) / sizeof(const T*);
+}
+
+template <typename T, typename Cmp>
+template <typename AtLeast>
+const T* FrozenIndex<T, Cmp>::LowerBound(AtLeast at_least) const {
+  // The descendants three levels below `k` can be past the end of `items_`, so
+  // their address is computed as an integer rather than by pointer arithmetic.
+  // Prefetching an address past the end is harmless.
+  const uintptr_t items_addr = reinterpret_cast<uintptr_t>(items_);
+  size_t k = 1;
+  while (k <= size_) {
+    __builtin_prefetch(reinterpret_cast<const void*>(
+        items_addr + kItemsPerCacheLine * k * sizeof(const T*)));
+    __builtin_prefetch(items_[2 * k]);
+    __builtin_prefetch(items_[2 * k + 1]);
+    k = 2 * k + !at_least(*items_[k]);
+  }
+
+  // After the last item `at_least` was true for, `k` turned left once and then
+  // only right until falling off the tree. Undo those turns to find that item,
+  // or 0 if `at_least` was never true.
+  k >>= std::countr_one(k) + 1;
+  return k != 0 ? items_[k] : nullptr;
+}
+
+}  // namespace util
@@ -0,0 +1,70 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/frozen_index.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+// The number of lookups issued per benchmark iteration.
+constexpr size_t kLookupsPerIteration = 1024;
+
+void BM_RbTreeLowerBound(benchmark::State& state) {
+  const size_t n = state.range(0);
+  BenchmarkTree<> test_tree(n, /*key_step=*/2);
+  const std::vector<uint64_t> keys = RandomKeys(kLookupsPerIteration, 2 * n);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(
+          test_tree.tree().LowerBound([key](const BenchmarkElement& element) {
+            return element.key >= key;
+          }));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+void BM_FrozenIndexLowerBound(benchmark::State& state) {
+  const size_t n = state.range(0);
+  BenchmarkTree<> test_tree(n, /*key_step=*/2);
+  const FrozenIndex<BenchmarkElement, BenchmarkElementLess> index =
+      Freeze(test_tree.tree());
+  const std::vector<uint64_t> keys = RandomKeys(kLookupsPerIteration, 2 * n);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(
+          index.LowerBound([key](const BenchmarkElement& element) {
+            return element.key >= key;
+          }));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+void BM_Freeze(benchmark::State& state) {
+  const size_t n = state.range(0);
+  BenchmarkTree<> test_tree(n, /*key_step=*/2);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Freeze(test_tree.tree()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// From 1K elements up to 64M (2.5 GB of tree nodes).
+BENCHMARK(BM_RbTreeLowerBound)->RangeMultiplier(8)->Range(1 << 10, 1 << 26);
+BENCHMARK(BM_FrozenIndexLowerBound)
+    ->RangeMultiplier(8)
+    ->Range(1 << 10, 1 << 26);
+BENCHMARK(BM_Freeze)->RangeMultiplier(8)->Range(1 << 10, 1 << 20);
+
+}  // namespace
+
+}  // namespace util
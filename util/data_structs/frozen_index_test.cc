@@ -0,0 +1,122 @@
+#include "util/data_structs/frozen_index.h"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+struct Element : public RbNode {
+  int val;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.val < e2.val;
+  }
+};
+
+using ElementTree = RbTree<Element, ElementLess>;
+using ElementIndex = FrozenIndex<Element, ElementLess>;
+
+const Element* LowerBound(const ElementIndex& index, int val) {
+  return index.LowerBound(
+      [val](const Element& element) { return element.val >= val; });
+}
+
+TEST(FrozenIndexTest, TestEmpty) {
+  ElementTree tree;
+  FrozenIndex<Element, ElementLess> index = Freeze(tree);
+  EXPECT_EQ(index.Size(), 0);
+  EXPECT_EQ(index.LowerBound([](const Element&) {
+    return true;
+  }),
+            nullptr);
+}
+
+TEST(FrozenIndexTest, TestDefault) {
+  FrozenIndex<Element, ElementLess> index;
+  EXPECT_EQ(index.Size(), 0);
+  EXPECT_EQ(index.LowerBound([](const Element&) {
+    return true;
+  }),
+            nullptr);
+}
+
+// Checks every lower bound of an index over `n` elements with values
+// 0, 2, 4, ..., for each `n` in a range covering complete, nearly complete and
+// sparse last levels.
+TEST(FrozenIndexTest, TestAllSizes) {
+  constexpr size_t kMaxElements = 300;
+
+  for (size_t n = 1; n <= kMaxElements; n++) {
+    ElementTree tree;
+    auto elements = std::make_unique<Element[]>(n);
+    for (size_t i = 0; i < n; i++) {
+      elements[i].val = static_cast<int>(2 * ((i * 7) % n));
+    }
+    // The values are only a permutation of 0, 2, ... if 7 is coprime with n.
+    if (n % 7 == 0) {
+      for (size_t i = 0; i < n; i++) {
+        elements[i].val = static_cast<int>(2 * i);
+      }
+    }
+    for (size_t i = 0; i < n; i++) {
+      tree.Insert(&elements[i]);
+    }
+
+    FrozenIndex<Element, ElementLess> index = Freeze(tree);
+    ASSERT_EQ(index.Size(), n);
+
+    for (int val = -1; val <= static_cast<int>(2 * n); val++) {
+      const Element* expected = tree.LowerBound([val](const Element& element) {
+        return element.val >= val;
+      });
+      const Element* actual = index.LowerBound([val](const Element& element) {
+        return element.val >= val;
+      });
+      ASSERT_EQ(actual, expected) << "n = " << n << ", val = " << val;
+    }
+  }
+}
+
+// Copies and moves must not refer to the storage of their source, which is
+// destroyed here before they are used.
+TEST(FrozenIndexTest, TestCopyAndMove) {
+  constexpr int kNumElements = 100;
+
+  ElementTree tree;
+  Element elements[kNumElements];
+  for (int i = 0; i < kNumElements; i++) {
+    elements[i].val = 2 * i;
+    tree.Insert(&elements[i]);
+  }
+
+  auto index = std::make_optional(Freeze(tree));
+  ElementIndex copy = *index;
+  ElementIndex assigned = Freeze(ElementTree());
+  assigned = *index;
+  ElementIndex moved = *index;
+  ElementIndex move_constructed = std::move(moved);
+  EXPECT_EQ(moved.Size(), 0);
+  EXPECT_EQ(LowerBound(moved, 0), nullptr);
+  ElementIndex move_assigned;
+  move_assigned = std::move(move_constructed);
+  EXPECT_EQ(move_constructed.Size(), 0);
+  index.reset();
+
+  for (const ElementIndex* other : { &copy, &assigned, &move_assigned }) {
+    ASSERT_EQ(other->Size(), kNumElements);
+    for (int i = 0; i < kNumElements; i++) {
+      EXPECT_EQ(LowerBound(*other, 2 * i - 1), &elements[i]);
+    }
+    EXPECT_EQ(LowerBound(*other, 2 * kNumElements), nullptr);
+  }
+}
+
+}  // namespace util
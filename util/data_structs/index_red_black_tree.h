@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "util/data_structs/red_black_tree_ops.h"
+#include "util/internal/util.h"
+
+namespace util {
+
+namespace internal {
+
+template <typename T>
+struct IndexRbLinks;
+
+}  // namespace internal
+
+// The hook of an `IndexRbTree` element. Links are 32-bit indices into the
+// tree's node array rather than pointers, with the color packed into the top
+// bit of the parent index, so the hook is 12 bytes instead of 32.
+class IndexRbNode {
+  template <typename T>
+  friend struct internal::IndexRbLinks;
+  template <typename T, typename Cmp>
+  friend class IndexRbTree;
+
+ public:
+  // The index of no node.
+  static constexpr uint32_t kNull = 0x7fff'ffff;
+  // The index of the root sentinel of the tree, whose left child is the root.
+  static constexpr uint32_t kRootSentinel = 0x7fff'fffe;
+  // Indices at or above this are reserved.
+  static constexpr uint32_t kMaxNodes = kRootSentinel;
+
+  IndexRbNode() = default;
+
+  uint32_t Left() const {
+    return children_[0];
+  }
+
+  uint32_t Right() const {
+    return children_[1];
+  }
+
+  // Returns `Right()` if `right`, else `Left()`.
+  uint32_t Child(bool right) const {
+    return children_[right];
+  }
+
+  uint32_t Parent() const {
+    return parent_and_color_ & kParentMask;
+  }
+
+  bool IsRed() const {
+    return (parent_and_color_ & kRedBit) != 0;
+  }
+
+  bool IsBlack() const {
+    return !IsRed();
+  }
+
+ private:
+  static constexpr uint32_t kRedBit = 0x8000'0000;
+  static constexpr uint32_t kParentMask = ~kRedBit;
+
+  void SetParent(uint32_t parent) {
+    parent_and_color_ = (parent_and_color_ & kRedBit) | parent;
+  }
+
+  void SetRed(bool red) {
+    parent_and_color_ =
+        (parent_and_color_ & kParentMask) | (red ? kRedBit : 0);
+  }
+
+  // The left and right children.
+  uint32_t children_[2] = { kNull, kNull };
+  uint32_t parent_and_color_ = kNull | kRedBit;
+};
+
+namespace internal {
+
+// Links the hooks of an array of `T` through their indices, for `RbOps`.
+template <typename T>
+struct IndexRbLinks {
+  using Ref = uint32_t;
+
+  // Only child links are ever read or written on the root sentinel, so the
+  // other accessors skip the check.
+  IndexRbNode* Hook(uint32_t index) const {
+    return index != IndexRbNode::kRootSentinel ? &nodes[index] : root;
+  }
+
+  static uint32_t Null() {
+    return IndexRbNode::kNull;
+  }
+
+  uint32_t Left(uint32_t index) const {
+    return Hook(index)->children_[0];
+  }
+
+  uint32_t Right(uint32_t index) const {
+    return Hook(index)->children_[1];
+  }
+
+  uint32_t Parent(uint32_t index) const {
+    return nodes[index].Parent();
+  }
+
+  bool IsRed(uint32_t index) const {
+    return nodes[index].IsRed();
+  }
+
+  void SetLeft(uint32_t index, uint32_t left) {
+    Hook(index)->children_[0] = left;
+  }
+
+  void SetRight(uint32_t index, uint32_t right) {
+    Hook(index)->children_[1] = right;
+  }
+
+  void SetParent(uint32_t index, uint32_t parent) {
+    nodes[index].SetParent(parent);
+  }
+
+  void SetRed(uint32_t index, bool red) {
+    nodes[index].SetRed(red);
+  }
+
+  T* nodes;
+  // The hook of the root sentinel, which is not in `nodes`.
+  IndexRbNode* root;
+};
+
+}  // namespace internal
+
+// A red-black tree over the elements of a contiguous array of `T`, which
+// derives from `IndexRbNode`. Balancing is shared with `RbTree` through
+// `internal::RbOps`.
+//
+// Nodes are named by their index in the array. Since no links are pointers,
+// the tree and its array can be moved, copied byte-for-byte, or written out and
+// read back as-is; call `Rebase` with the new address of the array afterwards.
+// The array may hold elements that are not in the tree, and must not be larger
+// than `IndexRbNode::kMaxNodes`.
+template <typename T, typename Cmp = std::less<T>>
+class IndexRbTree {
+ public:
+  static constexpr uint32_t kNull = IndexRbNode::kNull;
+
+  explicit IndexRbTree(T* nodes) : nodes_(nodes) {}
+
+  // Points the tree at a new copy of its node array.
+  void Rebase(T* nodes) {
+    nodes_ = nodes;
+  }
+
+  T* Nodes() const {
+    return nodes_;
+  }
+
+  T& At(uint32_t index) const {
+    return nodes_[index];
+  }
+
+  uint32_t IndexOf(const T* item) const {
+    return static_cast<uint32_t>(item - nodes_);
+  }
+
+  // The index of the root node, or `kNull` if the tree is empty.
+  uint32_t Root() const {
+    return root_.Left();
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  // The index of the first node in order, or `kNull` if the tree is empty.
+  uint32_t First() const {
+    const uint32_t root = Root();
+    return root != kNull ? Leftmost(root) : kNull;
+  }
+
+  // The index of the node after `index` in order, or `kNull` if it is the last.
+  uint32_t Next(uint32_t index) const;
+
+  void Insert(uint32_t index);
+
+  void Remove(uint32_t index) {
+    Ops().Remove(index, IndexRbNode::kRootSentinel);
+    size_--;
+  }
+
+  // Returns the index of the lowest-valued element in the tree that
+  // `AtLeast`() is true for, or `kNull` if there is none.
+  template <typename AtLeast>
+  uint32_t LowerBound(AtLeast at_least) const {
+    uint32_t node = Root();
+    uint32_t smallest = kNull;
+    while (node != kNull) {
+      // Index the children rather than branch, since the direction is
+      // unpredictable.
+      const T& item = nodes_[node];
+      const bool go_left = at_least(item);
+      smallest = go_left ? node : smallest;
+      node = item.Child(!go_left);
+    }
+    return smallest;
+  }
+
+ private:
+  internal::RbOps<internal::IndexRbLinks<T>> Ops() {
+    return internal::RbOps<internal::IndexRbLinks<T>>({ nodes_, &root_ });
+  }
+
+  uint32_t Leftmost(uint32_t index) const {
+    for (uint32_t left; (left = nodes_[index].Left()) != kNull; index = left)
+      ;
+    return index;
+  }
+
+  T* nodes_;
+  IndexRbNode root_;
+  size_t size_ = 0;
+};
+
+template <typename T, typename Cmp>
+uint32_t IndexRbTree<T, Cmp>::Next(uint32_t index) const {
+  const uint32_t right = nodes_[index].Right();
+  if (right != kNull) {
+    return Leftmost(right);
+  }
+
+  uint32_t parent;
+  while ((parent = nodes_[index].Parent()) != IndexRbNode::kRootSentinel &&
+         nodes_[parent].Right() == index) {
+    index = parent;
+  }
+  return parent != IndexRbNode::kRootSentinel ? parent : kNull;
+}
+
+template <typename T, typename Cmp>
+void IndexRbTree<T, Cmp>::Insert(uint32_t index) {
+  UTIL_DCHECK_LT(index, IndexRbNode::kMaxNodes);
+  uint32_t parent = Root();
+  if (parent == kNull) {
+    IndexRbNode& node = nodes_[index];
+    node.children_[0] = kNull;
+    node.children_[1] = kNull;
+    node.SetParent(IndexRbNode::kRootSentinel);
+    node.SetRed(false);
+    root_.children_[0] = index;
+    size_++;
+    return;
+  }
+
+  const T& item = nodes_[index];
+  bool right;
+  for (uint32_t node;
+       (node = nodes_[parent].Child(right = !Cmp{}(item, nodes_[parent]))) !=
+       kNull;
+       parent = node)
+    ;
+
+  if (right) {
+    Ops().InsertRight(index, parent, IndexRbNode::kRootSentinel);
+  } else {
+    Ops().InsertLeft(index, parent, IndexRbNode::kRootSentinel);
+  }
+  size_++;
+}
+
+}  // namespace util
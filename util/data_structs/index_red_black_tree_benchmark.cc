@@ -0,0 +1,129 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/index_red_black_tree.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+struct IndexElement : public IndexRbNode {
+  uint64_t key;
+};
+
+struct KeyLess {
+  template <typename E>
+  bool operator()(const E& e1, const E& e2) const {
+    return e1.key < e2.key;
+  }
+};
+
+// The number of operations per benchmark iteration.
+constexpr size_t kOpsPerIteration = 1024;
+
+// A pointer-linked `RbTree` of `n` elements inserted in random order, where
+// `Get(i)` is the element with key `i`.
+class PointerTestTree {
+ public:
+  explicit PointerTestTree(size_t n) : test_tree_(n), by_key_(n) {
+    for (size_t i = 0; i < n; i++) {
+      BenchmarkElement& element = test_tree_.element(i);
+      by_key_[element.key] = &element;
+    }
+  }
+
+  bool Find(uint64_t key) {
+    return test_tree_.tree().LowerBound([key](const BenchmarkElement& element) {
+      return element.key >= key;
+    }) != nullptr;
+  }
+
+  void RemoveInsert(uint64_t key) {
+    test_tree_.tree().Remove(by_key_[key]);
+    test_tree_.tree().Insert(by_key_[key]);
+  }
+
+ private:
+  BenchmarkTree<> test_tree_;
+  std::vector<BenchmarkElement*> by_key_;
+};
+
+// The same as `PointerTestTree`, with an `IndexRbTree`.
+class IndexTestTree {
+ public:
+  explicit IndexTestTree(size_t n)
+      : elements_(new IndexElement[n]), by_key_(n), tree_(elements_.get()) {
+    const std::vector<uint64_t> keys = ShuffledKeys(n);
+    for (size_t i = 0; i < n; i++) {
+      elements_[i].key = keys[i];
+      by_key_[keys[i]] = i;
+      tree_.Insert(i);
+    }
+  }
+
+  bool Find(uint64_t key) {
+    return tree_.LowerBound([key](const IndexElement& element) {
+      return element.key >= key;
+    }) != IndexRbNode::kNull;
+  }
+
+  void RemoveInsert(uint64_t key) {
+    tree_.Remove(by_key_[key]);
+    tree_.Insert(by_key_[key]);
+  }
+
+ private:
+  std::unique_ptr<IndexElement[]> elements_;
+  std::vector<uint32_t> by_key_;
+  IndexRbTree<IndexElement, KeyLess> tree_;
+};
+
+template <typename TestTree>
+void BM_LowerBound(benchmark::State& state) {
+  const size_t n = state.range(0);
+  TestTree tree(n);
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(tree.Find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+template <typename TestTree>
+void BM_RemoveInsert(benchmark::State& state) {
+  const size_t n = state.range(0);
+  TestTree tree(n);
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      tree.RemoveInsert(key);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+BENCHMARK(BM_LowerBound<PointerTestTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_LowerBound<IndexTestTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_RemoveInsert<PointerTestTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_RemoveInsert<IndexTestTree>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24);
+
+}  // namespace
+
+}  // namespace util
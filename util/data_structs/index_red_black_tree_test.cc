@@ -0,0 +1,220 @@
+#include "util/data_structs/index_red_black_tree.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/absl_util.h"
+#include "util/gtest_util.h"
+
+namespace util {
+
+using ::testing::ElementsAreArray;
+using util::IsOk;
+
+struct Element : public IndexRbNode {
+  int val;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.val < e2.val;
+  }
+};
+
+using ElementTree = IndexRbTree<Element, ElementLess>;
+
+class IndexRedBlackTreeTest : public ::testing::Test {
+ protected:
+  static absl::Status Validate(const ElementTree& tree) {
+    if (tree.Root() != ElementTree::kNull &&
+        tree.At(tree.Root()).Parent() != IndexRbNode::kRootSentinel) {
+      return absl::FailedPreconditionError(
+          "Found root with parent other than the sentinel.");
+    }
+    DEFINE_OR_RETURN(size_t, black_depth, ValidateNode(tree, tree.Root()));
+    (void) black_depth;
+    return absl::OkStatus();
+  }
+
+  static std::vector<int> Values(const ElementTree& tree) {
+    std::vector<int> values;
+    for (uint32_t node = tree.First(); node != ElementTree::kNull;
+         node = tree.Next(node)) {
+      values.push_back(tree.At(node).val);
+    }
+    return values;
+  }
+
+ private:
+  // If valid, returns the black depth of the node.
+  static absl::StatusOr<size_t> ValidateNode(const ElementTree& tree,
+                                             uint32_t index) {
+    if (index == ElementTree::kNull) {
+      return 0;
+    }
+
+    const Element& node = tree.At(index);
+    for (const uint32_t child : { node.Left(), node.Right() }) {
+      if (child == ElementTree::kNull) {
+        continue;
+      }
+      if (tree.At(child).Parent() != index) {
+        return absl::FailedPreconditionError(
+            absl::StrFormat("Found child %u of %u with parent incorrect",
+                            child, index));
+      }
+      if (node.IsRed() && tree.At(child).IsRed()) {
+        return absl::FailedPreconditionError(
+            "Found child of red node which is also red.");
+      }
+    }
+    if (node.Left() != ElementTree::kNull &&
+        !ElementLess{}(tree.At(node.Left()), node)) {
+      return absl::FailedPreconditionError("Found left child of node >= node");
+    }
+    if (node.Right() != ElementTree::kNull &&
+        !ElementLess{}(node, tree.At(node.Right()))) {
+      return absl::FailedPreconditionError("Found right child of node < node");
+    }
+
+    DEFINE_OR_RETURN(size_t, left_depth, ValidateNode(tree, node.Left()));
+    DEFINE_OR_RETURN(size_t, right_depth, ValidateNode(tree, node.Right()));
+
+    if (left_depth != right_depth) {
+      return absl::FailedPreconditionError(
+          absl::StrFormat("Found inequal black depth of node: %zu vs %zu",
+                          left_depth, right_depth));
+    }
+
+    return left_depth + (node.IsRed() ? 0 : 1);
+  }
+};
+
+TEST_F(IndexRedBlackTreeTest, TestHookSize) {
+  EXPECT_EQ(sizeof(IndexRbNode), 3 * sizeof(uint32_t));
+}
+
+TEST_F(IndexRedBlackTreeTest, TestEmpty) {
+  Element elements[1];
+  ElementTree tree(elements);
+  EXPECT_EQ(tree.Size(), 0);
+  EXPECT_EQ(tree.Root(), ElementTree::kNull);
+  EXPECT_EQ(tree.First(), ElementTree::kNull);
+  EXPECT_EQ(tree.LowerBound([](const Element&) { return true; }),
+            ElementTree::kNull);
+}
+
+TEST_F(IndexRedBlackTreeTest, TestInsertRemoveMany) {
+  constexpr size_t kNumElements = 1000;
+
+  std::vector<Element> elements(kNumElements);
+  ElementTree tree(elements.data());
+  for (size_t i = 0; i < kNumElements; i++) {
+    const uint32_t idx = (i * 17) % kNumElements;
+    elements[idx].val = idx;
+    tree.Insert(idx);
+    ASSERT_THAT(Validate(tree), IsOk());
+  }
+  ASSERT_EQ(tree.Size(), kNumElements);
+
+  std::vector<int> expected;
+  for (size_t i = 0; i < kNumElements; i++) {
+    expected.push_back(i);
+  }
+  EXPECT_THAT(Values(tree), ElementsAreArray(expected));
+
+  for (size_t i = 0; i < kNumElements; i++) {
+    const uint32_t idx = (i * 13 + 3) % kNumElements;
+    tree.Remove(idx);
+    ASSERT_THAT(Validate(tree), IsOk());
+    ASSERT_EQ(tree.Size(), kNumElements - i - 1);
+    EXPECT_NE(tree.LowerBound([idx](const Element& element) {
+      return element.val >= static_cast<int>(idx);
+    }),
+              idx);
+  }
+  EXPECT_EQ(tree.Root(), ElementTree::kNull);
+}
+
+TEST_F(IndexRedBlackTreeTest, TestReinsert) {
+  constexpr size_t kNumElements = 100;
+
+  std::vector<Element> elements(kNumElements);
+  ElementTree tree(elements.data());
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(i);
+  }
+
+  for (size_t i = 0; i < kNumElements; i++) {
+    const uint32_t idx = (i * 37) % kNumElements;
+    tree.Remove(idx);
+    tree.Insert(idx);
+    ASSERT_THAT(Validate(tree), IsOk());
+    ASSERT_EQ(tree.Size(), kNumElements);
+  }
+}
+
+TEST_F(IndexRedBlackTreeTest, TestLowerBound) {
+  constexpr size_t kNumElements = 100;
+
+  std::vector<Element> elements(kNumElements);
+  ElementTree tree(elements.data());
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = 2 * i;
+    tree.Insert(i);
+  }
+
+  for (int key = 0; key <= 2 * static_cast<int>(kNumElements - 1); key++) {
+    const uint32_t found = tree.LowerBound(
+        [key](const Element& element) { return element.val >= key; });
+    ASSERT_NE(found, ElementTree::kNull);
+    EXPECT_EQ(tree.At(found).val, (key + 1) / 2 * 2);
+  }
+  EXPECT_EQ(tree.LowerBound([](const Element& element) {
+    return element.val > 2 * static_cast<int>(kNumElements - 1);
+  }),
+            ElementTree::kNull);
+}
+
+TEST_F(IndexRedBlackTreeTest, TestRelocate) {
+  constexpr size_t kNumElements = 100;
+
+  std::vector<Element> elements(kNumElements);
+  ElementTree tree(elements.data());
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = (i * 7) % kNumElements;
+    tree.Insert(i);
+  }
+
+  // Copy the nodes and the tree byte-for-byte, and destroy the originals.
+  static_assert(std::is_trivially_copyable_v<Element>);
+  static_assert(std::is_trivially_copyable_v<ElementTree>);
+  auto copy = std::make_unique<Element[]>(kNumElements);
+  std::memcpy(copy.get(), elements.data(), kNumElements * sizeof(Element));
+  ElementTree copied_tree = tree;
+  const std::vector<int> values = Values(tree);
+  elements.assign(kNumElements, Element{});
+
+  copied_tree.Rebase(copy.get());
+  ASSERT_THAT(Validate(copied_tree), IsOk());
+  EXPECT_THAT(Values(copied_tree), ElementsAreArray(values));
+
+  // The copy is fully functional.
+  for (uint32_t i = 0; i < kNumElements; i += 2) {
+    copied_tree.Remove(i);
+  }
+  ASSERT_THAT(Validate(copied_tree), IsOk());
+  EXPECT_EQ(copied_tree.Size(), kNumElements / 2);
+}
+
+}  // namespace util
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "util/internal/util.h"
+
+namespace util {
+
+// The hook for items in a `PairingHeap`. Derive from it to put an item in a
+// heap; an item can be in at most one heap at a time.
+class PairingHeapNode {
+  template <typename T, typename Cmp>
+  friend class PairingHeap;
+
+ public:
+  PairingHeapNode() = default;
+
+  // Nodes cannot be moved/copied.
+  PairingHeapNode(const PairingHeapNode&) = delete;
+  PairingHeapNode(PairingHeapNode&&) = delete;
+
+ private:
+  PairingHeapNode& operator=(const PairingHeapNode&) = default;
+  PairingHeapNode& operator=(PairingHeapNode&&) = default;
+
+  // The leftmost child.
+  PairingHeapNode* child_ = nullptr;
+  // The next sibling to the right.
+  PairingHeapNode* next_ = nullptr;
+  // The previous sibling, or the parent if this is the leftmost child. Null for
+  // the root.
+  PairingHeapNode* prev_ = nullptr;
+};
+
+// An intrusive min-heap of `T`, ordered by `Cmp`. `T` must derive from
+// `PairingHeapNode`. Like `RbTree`, the heap never owns or allocates anything.
+//
+// Each node of the heap is no greater than its children, which are kept in a
+// doubly-linked list. `Insert`, `Meld` and `DecreaseKey` link a single subtree
+// under the root (or the root under it), and are O(1). `Pop` and `Remove`
+// merge the children of the removed node in two passes, and are O(log n)
+// amortized.
+//
+// Items with equal keys are popped in an unspecified order.
+template <typename T, typename Cmp = std::less<T>>
+class PairingHeap {
+ public:
+  PairingHeap() = default;
+
+  // Heaps cannot be moved/copied.
+  PairingHeap(const PairingHeap&) = delete;
+  PairingHeap(PairingHeap&&) = delete;
+  PairingHeap& operator=(const PairingHeap&) = delete;
+  PairingHeap& operator=(PairingHeap&&) = delete;
+
+  bool Empty() const {
+    return root_ == nullptr;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  // Returns the least item, or `nullptr` if the heap is empty.
+  T* Top() const {
+    return static_cast<T*>(root_);
+  }
+
+  void Insert(T* item) {
+    PairingHeapNode* node = item;
+    node->child_ = nullptr;
+    node->next_ = nullptr;
+    node->prev_ = nullptr;
+    root_ = root_ != nullptr ? Link(root_, node) : node;
+    size_++;
+  }
+
+  // Removes and returns the least item, or returns `nullptr` if the heap is
+  // empty.
+  T* Pop() {
+    PairingHeapNode* node = root_;
+    if (node == nullptr) {
+      return nullptr;
+    }
+
+    root_ = MergePairs(node->child_);
+    node->child_ = nullptr;
+    size_--;
+    return static_cast<T*>(node);
+  }
+
+  // Removes `item`, which must be in this heap.
+  void Remove(T* item) {
+    PairingHeapNode* node = item;
+    if (node == root_) {
+      Pop();
+      return;
+    }
+
+    Cut(node);
+    PairingHeapNode* children = MergePairs(node->child_);
+    node->child_ = nullptr;
+    if (children != nullptr) {
+      root_ = Link(root_, children);
+    }
+    size_--;
+  }
+
+  // Restores the heap order after the key of `item`, which must be in this
+  // heap, was decreased. To increase a key, `Remove` the item first, and
+  // `Insert` it again after changing it.
+  void DecreaseKey(T* item) {
+    PairingHeapNode* node = item;
+    if (node == root_) {
+      return;
+    }
+
+    // The subtree of `node` is still heap-ordered, so it can be linked with
+    // the root as a whole.
+    Cut(node);
+    root_ = Link(root_, node);
+  }
+
+  // Moves all items of `other` into this heap.
+  void Meld(PairingHeap& other) {
+    if (other.root_ == nullptr) {
+      return;
+    }
+
+    root_ = root_ != nullptr ? Link(root_, other.root_) : other.root_;
+    size_ += other.size_;
+    other.root_ = nullptr;
+    other.size_ = 0;
+  }
+
+  // Empties the heap, without touching the items in it.
+  void Clear() {
+    root_ = nullptr;
+    size_ = 0;
+  }
+
+ private:
+  static bool Less(const PairingHeapNode* n1, const PairingHeapNode* n2) {
+    return Cmp()(*static_cast<const T*>(n1), *static_cast<const T*>(n2));
+  }
+
+  // Links two subtrees whose roots have no parent or siblings that matter, and
+  // returns the root of the result. Ties keep `n1` on top. The `next_` pointer
+  // of the result is left for the caller to set.
+  static PairingHeapNode* Link(PairingHeapNode* n1, PairingHeapNode* n2) {
+    if (Less(n2, n1)) {
+      std::swap(n1, n2);
+    }
+
+    n2->prev_ = n1;
+    n2->next_ = n1->child_;
+    if (n1->child_ != nullptr) {
+      n1->child_->prev_ = n2;
+    }
+    n1->child_ = n2;
+    n1->prev_ = nullptr;
+    return n1;
+  }
+
+  // Cuts the subtree of `node`, which is not the root, out of its parent's
+  // list of children.
+  static void Cut(PairingHeapNode* node) {
+    UTIL_DCHECK(node->prev_ != nullptr);
+    if (node->prev_->child_ == node) {
+      node->prev_->child_ = node->next_;
+    } else {
+      node->prev_->next_ = node->next_;
+    }
+    if (node->next_ != nullptr) {
+      node->next_->prev_ = node->prev_;
+    }
+    node->next_ = nullptr;
+    node->prev_ = nullptr;
+  }
+
+  // Merges a list of sibling subtrees into one, and returns its root, or
+  // `nullptr` if the list is empty.
+  //
+  // The first pass links the siblings in pairs from left to right, and the
+  // second links the pairs into one tree from right to left. The pairs are
+  // chained in reverse through `next_` between the passes.
+  static PairingHeapNode* MergePairs(PairingHeapNode* first) {
+    if (first == nullptr) {
+      return nullptr;
+    }
+
+    PairingHeapNode* pairs = nullptr;
+    while (first != nullptr) {
+      PairingHeapNode* n1 = first;
+      PairingHeapNode* n2 = n1->next_;
+      PairingHeapNode* pair;
+      if (n2 == nullptr) {
+        pair = n1;
+        first = nullptr;
+      } else {
+        first = n2->next_;
+        pair = Link(n1, n2);
+      }
+      pair->next_ = pairs;
+      pairs = pair;
+    }
+
+    PairingHeapNode* root = pairs;
+    pairs = pairs->next_;
+    while (pairs != nullptr) {
+      PairingHeapNode* next = pairs->next_;
+      root = Link(root, pairs);
+      pairs = next;
+    }
+    root->next_ = nullptr;
+    root->prev_ = nullptr;
+    return root;
+  }
+
+  PairingHeapNode* root_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace util
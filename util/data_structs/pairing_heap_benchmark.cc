@@ -0,0 +1,188 @@
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/pairing_heap.h"
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+namespace {
+
+constexpr size_t kEdgesPerVertex = 8;
+constexpr uint64_t kMaxWeight = 1000;
+
+// The baseline: an `RbTree` used as a heap, which removes and reinserts items
+// to decrease their key, and finds the leftmost item to pop.
+class RbTreeQueue {
+ public:
+  struct Entry : public RbNode {
+    uint64_t key;
+  };
+
+  bool Empty() const {
+    return tree_.Size() == 0;
+  }
+
+  void Insert(Entry* entry) {
+    tree_.Insert(entry);
+  }
+
+  Entry* Pop() {
+    Entry* entry = tree_.LowerBound([](const Entry&) { return true; });
+    tree_.Remove(entry);
+    return entry;
+  }
+
+  void DecreaseKey(Entry* entry, uint64_t key) {
+    tree_.Remove(entry);
+    entry->key = key;
+    tree_.Insert(entry);
+  }
+
+ private:
+  struct KeyLess {
+    bool operator()(const Entry& e1, const Entry& e2) const {
+      return e1.key < e2.key;
+    }
+  };
+
+  RbTree<Entry, KeyLess> tree_;
+};
+
+class PairingHeapQueue {
+ public:
+  struct Entry : public PairingHeapNode {
+    uint64_t key;
+
+    bool operator<(const Entry& other) const {
+      return key < other.key;
+    }
+  };
+
+  bool Empty() const {
+    return heap_.Empty();
+  }
+
+  void Insert(Entry* entry) {
+    heap_.Insert(entry);
+  }
+
+  Entry* Pop() {
+    return heap_.Pop();
+  }
+
+  void DecreaseKey(Entry* entry, uint64_t key) {
+    entry->key = key;
+    heap_.DecreaseKey(entry);
+  }
+
+ private:
+  PairingHeap<Entry> heap_;
+};
+
+// Args: n.
+//
+// Inserts `n` items with random keys, then pops them all.
+template <typename Queue>
+void BM_InsertPop(benchmark::State& state) {
+  using Entry = typename Queue::Entry;
+  const size_t n = state.range(0);
+
+  std::mt19937_64 gen(0);
+  std::vector<Entry> entries(n);
+  for (Entry& entry : entries) {
+    entry.key = gen();
+  }
+
+  for (auto _ : state) {
+    Queue queue;
+    for (Entry& entry : entries) {
+      queue.Insert(&entry);
+    }
+    while (!queue.Empty()) {
+      benchmark::DoNotOptimize(queue.Pop());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Args: n.
+//
+// Runs Dijkstra's algorithm from vertex 0 of a random graph of `n` vertices,
+// each with `kEdgesPerVertex` edges of random weight. Every vertex is queued
+// once, and its distance decreased as shorter paths are found.
+template <typename Queue>
+void BM_Dijkstra(benchmark::State& state) {
+  using Entry = typename Queue::Entry;
+  const size_t n = state.range(0);
+
+  struct Edge {
+    uint32_t to;
+    uint32_t weight;
+  };
+
+  std::mt19937_64 gen(0);
+  std::vector<Edge> edges(n * kEdgesPerVertex);
+  for (Edge& edge : edges) {
+    edge.to = gen() % n;
+    edge.weight = 1 + gen() % kMaxWeight;
+  }
+
+  std::vector<Entry> entries(n);
+  std::vector<bool> queued(n);
+  size_t decreases = 0;
+  for (auto _ : state) {
+    for (size_t v = 0; v < n; v++) {
+      entries[v].key = std::numeric_limits<uint64_t>::max();
+      queued[v] = false;
+    }
+
+    Queue queue;
+    entries[0].key = 0;
+    queued[0] = true;
+    queue.Insert(&entries[0]);
+    while (!queue.Empty()) {
+      Entry* entry = queue.Pop();
+      const size_t v = entry - entries.data();
+      for (size_t e = v * kEdgesPerVertex; e < (v + 1) * kEdgesPerVertex; e++) {
+        Entry& to = entries[edges[e].to];
+        const uint64_t distance = entry->key + edges[e].weight;
+        if (distance >= to.key) {
+          continue;
+        }
+        if (queued[edges[e].to]) {
+          queue.DecreaseKey(&to, distance);
+          decreases++;
+        } else {
+          to.key = distance;
+          queued[edges[e].to] = true;
+          queue.Insert(&to);
+        }
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.counters["decreases"] = benchmark::Counter(
+      static_cast<double>(decreases) / state.iterations());
+}
+
+void QueueArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n" });
+  for (int64_t n : { 1 << 10, 1 << 16, 1 << 20 }) {
+    b->Arg(n);
+  }
+}
+
+BENCHMARK(BM_InsertPop<RbTreeQueue>)->Apply(QueueArgs);
+BENCHMARK(BM_InsertPop<PairingHeapQueue>)->Apply(QueueArgs);
+BENCHMARK(BM_Dijkstra<RbTreeQueue>)->Apply(QueueArgs);
+BENCHMARK(BM_Dijkstra<PairingHeapQueue>)->Apply(QueueArgs);
+
+}  // namespace
+
+}  // namespace util
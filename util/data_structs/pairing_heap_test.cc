@@ -0,0 +1,182 @@
+#include "util/data_structs/pairing_heap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsNull;
+
+struct Item : public PairingHeapNode {
+  explicit Item(int64_t key = 0) : key(key) {}
+
+  int64_t key;
+  bool in_heap = false;
+
+  bool operator<(const Item& other) const {
+    return key < other.key;
+  }
+};
+
+using ItemHeap = PairingHeap<Item>;
+
+std::vector<int64_t> PopAll(ItemHeap& heap) {
+  std::vector<int64_t> keys;
+  while (Item* item = heap.Pop()) {
+    keys.push_back(item->key);
+  }
+  return keys;
+}
+
+TEST(PairingHeapTest, TestEmpty) {
+  ItemHeap heap;
+  EXPECT_TRUE(heap.Empty());
+  EXPECT_EQ(heap.Size(), 0);
+  EXPECT_THAT(heap.Top(), IsNull());
+  EXPECT_THAT(heap.Pop(), IsNull());
+}
+
+TEST(PairingHeapTest, TestPopsInOrder) {
+  std::deque<Item> items;
+  for (int64_t key : { 5, 3, 8, 1, 9, 3, 7 }) {
+    items.emplace_back(key);
+  }
+
+  ItemHeap heap;
+  for (Item& item : items) {
+    heap.Insert(&item);
+  }
+  EXPECT_EQ(heap.Size(), 7);
+  EXPECT_EQ(heap.Top()->key, 1);
+  EXPECT_THAT(PopAll(heap), ElementsAre(1, 3, 3, 5, 7, 8, 9));
+  EXPECT_TRUE(heap.Empty());
+}
+
+TEST(PairingHeapTest, TestDecreaseKey) {
+  std::deque<Item> items;
+  for (int64_t key : { 10, 20, 30, 40 }) {
+    items.emplace_back(key);
+  }
+
+  ItemHeap heap;
+  for (Item& item : items) {
+    heap.Insert(&item);
+  }
+  // Consolidate the heap, so that the items are not all children of the root.
+  Item least(0);
+  heap.Insert(&least);
+  heap.Pop();
+
+  items[3].key = 5;
+  heap.DecreaseKey(&items[3]);
+  EXPECT_EQ(heap.Top(), &items[3]);
+  items[2].key = 15;
+  heap.DecreaseKey(&items[2]);
+  EXPECT_THAT(PopAll(heap), ElementsAre(5, 10, 15, 20));
+}
+
+TEST(PairingHeapTest, TestRemove) {
+  std::deque<Item> items;
+  for (int64_t key = 0; key < 10; key++) {
+    items.emplace_back(key);
+  }
+
+  ItemHeap heap;
+  for (Item& item : items) {
+    heap.Insert(&item);
+  }
+  heap.Remove(&items[0]);
+  heap.Pop();
+  heap.Remove(&items[5]);
+  heap.Remove(&items[9]);
+  EXPECT_EQ(heap.Size(), 6);
+  EXPECT_THAT(PopAll(heap), ElementsAre(2, 3, 4, 6, 7, 8));
+}
+
+TEST(PairingHeapTest, TestMeld) {
+  std::deque<Item> items;
+  for (int64_t key = 0; key < 10; key++) {
+    items.emplace_back(key);
+  }
+
+  ItemHeap evens;
+  ItemHeap odds;
+  for (Item& item : items) {
+    (item.key % 2 == 0 ? evens : odds).Insert(&item);
+  }
+  odds.Meld(evens);
+  EXPECT_TRUE(evens.Empty());
+  EXPECT_EQ(evens.Size(), 0);
+  EXPECT_EQ(odds.Size(), 10);
+  EXPECT_THAT(PopAll(odds), ElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 8, 9));
+}
+
+// Applies random operations to a heap and to a reference multiset of keys, and
+// checks that they agree on the least key.
+TEST(PairingHeapTest, TestRandomAgainstReference) {
+  constexpr size_t kNumItems = 1000;
+  constexpr size_t kNumOps = 100000;
+
+  std::mt19937_64 gen(0);
+  std::vector<Item> items(kNumItems);
+  std::multiset<std::pair<int64_t, Item*>> expected;
+  ItemHeap heap;
+
+  for (size_t op = 0; op < kNumOps; op++) {
+    Item& item = items[gen() % kNumItems];
+    switch (gen() % 4) {
+      case 0:
+        if (!item.in_heap) {
+          item.key = gen() % 10000;
+          item.in_heap = true;
+          heap.Insert(&item);
+          expected.emplace(item.key, &item);
+        }
+        break;
+      case 1:
+        if (item.in_heap) {
+          expected.erase(expected.find({ item.key, &item }));
+          item.key -= gen() % 1000;
+          heap.DecreaseKey(&item);
+          expected.emplace(item.key, &item);
+        }
+        break;
+      case 2:
+        if (item.in_heap) {
+          expected.erase(expected.find({ item.key, &item }));
+          item.in_heap = false;
+          heap.Remove(&item);
+        }
+        break;
+      case 3:
+        if (Item* top = heap.Pop()) {
+          ASSERT_EQ(top->key, expected.begin()->first) << "op " << op;
+          expected.erase(expected.find({ top->key, top }));
+          top->in_heap = false;
+        }
+        break;
+    }
+    ASSERT_EQ(heap.Size(), expected.size());
+    if (!expected.empty()) {
+      ASSERT_EQ(heap.Top()->key, expected.begin()->first) << "op " << op;
+    }
+  }
+
+  std::vector<int64_t> expected_keys;
+  for (const auto& [key, item] : expected) {
+    expected_keys.push_back(key);
+  }
+  EXPECT_THAT(PopAll(heap), ElementsAreArray(expected_keys));
+}
+
+}  // namespace util
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "util/internal/util.h"
+
+namespace util {
+
+// A red-black tree of values of type `T` whose versions share structure.
+//
+// `Snapshot()` (or copying the tree) is O(1): both trees point at the same
+// nodes. Nodes are reference counted, and an update copies only the nodes it
+// has to modify which are shared with another version: the search path, plus
+// the siblings and nephews the fix-up recolors or rotates. An update therefore
+// allocates at most about 3 * height = O(log n) nodes, and the rest of the tree
+// stays shared.
+//
+// The balancing follows `RbTree`, but since a shared node can have many
+// parents, nodes have no parent links; updates keep the search path on a stack
+// of child-link slots instead.
+//
+// A single version is not thread-safe, but different versions may be read and
+// modified on different threads concurrently. `T` must be copy constructible
+// and move assignable.
+template <typename T, typename Cmp = std::less<T>>
+class PersistentRbTree {
+ public:
+  class Node {
+    friend PersistentRbTree;
+
+   public:
+    const Node* Left() const {
+      return child_[0];
+    }
+
+    const Node* Right() const {
+      return child_[1];
+    }
+
+    bool IsRed() const {
+      return red_;
+    }
+
+    bool IsBlack() const {
+      return !red_;
+    }
+
+    const T& value() const {
+      return value_;
+    }
+
+   private:
+    template <typename... Args>
+    explicit Node(Args&&... args) : value_(std::forward<Args>(args)...) {}
+
+    std::atomic<uint32_t> refs_ = 1;
+    bool red_ = true;
+    Node* child_[2] = { nullptr, nullptr };
+    T value_;
+  };
+
+  PersistentRbTree() = default;
+
+  // Shares all nodes with `tree`.
+  PersistentRbTree(const PersistentRbTree& tree)
+      : root_(Ref(tree.root_)), size_(tree.size_) {}
+
+  PersistentRbTree(PersistentRbTree&& tree)
+      : root_(std::exchange(tree.root_, nullptr)),
+        size_(std::exchange(tree.size_, 0)) {}
+
+  PersistentRbTree& operator=(const PersistentRbTree& tree) {
+    Node* const root = Ref(tree.root_);
+    Unref(root_);
+    root_ = root;
+    size_ = tree.size_;
+    return *this;
+  }
+
+  PersistentRbTree& operator=(PersistentRbTree&& tree) {
+    if (this != &tree) {
+      Unref(root_);
+      root_ = std::exchange(tree.root_, nullptr);
+      size_ = std::exchange(tree.size_, 0);
+    }
+    return *this;
+  }
+
+  ~PersistentRbTree() {
+    Unref(root_);
+  }
+
+  // Returns a version of the tree which is unaffected by later updates to this
+  // one, and vice versa.
+  PersistentRbTree Snapshot() const {
+    return *this;
+  }
+
+  const Node* Root() const {
+    return root_;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  void Insert(T value);
+
+  // Removes a value equivalent to `value`, returning whether there was one.
+  bool Remove(const T& value);
+
+  // Returns the lowest value in the tree that `AtLeast`() is true for, or null
+  // if there is none.
+  template <typename AtLeast>
+  const T* LowerBound(AtLeast at_least) const {
+    const Node* node = root_;
+    const Node* smallest = nullptr;
+    while (node != nullptr) {
+      if (at_least(node->value_)) {
+        smallest = node;
+        node = node->child_[0];
+      } else {
+        node = node->child_[1];
+      }
+    }
+    return smallest != nullptr ? &smallest->value_ : nullptr;
+  }
+
+  // Returns a value equivalent to `value`, or null if there is none.
+  const T* Find(const T& value) const {
+    const T* found = LowerBound(
+        [&value](const T& other) { return !Cmp{}(other, value); });
+    return found != nullptr && !Cmp{}(value, *found) ? found : nullptr;
+  }
+
+  // Calls `fn` on every value in order.
+  template <typename Fn>
+  void ForEach(Fn fn) const;
+
+ private:
+  // Bounds the height of any tree which fits in memory.
+  static constexpr size_t kMaxDepth = 128;
+
+  static Node* Ref(Node* node) {
+    if (node != nullptr) {
+      node->refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return node;
+  }
+
+  static void Unref(Node* node) {
+    if (node != nullptr &&
+        node->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Unref(node->child_[0]);
+      Unref(node->child_[1]);
+      delete node;
+    }
+  }
+
+  static bool IsBlackPtr(const Node* node) {
+    return node == nullptr || node->IsBlack();
+  }
+
+  // Returns the node in `slot`, first replacing it with a copy if it is shared
+  // with another version.
+  static Node* MakeMutable(Node** slot);
+
+  // Rotates the node in `slot` towards `dir` (0 = left, 1 = right), replacing
+  // it with its child from the other side. Both must be mutable.
+  static void Rotate(Node** slot, int dir) {
+    Node* node = *slot;
+    Node* child = node->child_[!dir];
+    node->child_[!dir] = child->child_[dir];
+    child->child_[dir] = node;
+    *slot = child;
+  }
+
+  // Fixes a red node at `slots[depth - 1]` which may have a red parent. All
+  // nodes in `slots` must be mutable.
+  void InsertFix(Node** slots[], size_t depth);
+
+  // Fixes the subtree in `slots[depth - 1]` (which may be null), which has a
+  // black height 1 less than it should. All nodes in `slots` before it must be
+  // mutable.
+  void DeleteFix(Node** slots[], size_t depth);
+
+  Node* root_ = nullptr;
+  size_t size_ = 0;
+};
+
+template <typename T, typename Cmp>
+typename PersistentRbTree<T, Cmp>::Node* PersistentRbTree<T, Cmp>::MakeMutable(
+    Node** slot) {
+  Node* node = *slot;
+  if (node->refs_.load(std::memory_order_acquire) == 1) {
+    return node;
+  }
+
+  Node* copy = new Node(node->value_);
+  copy->red_ = node->red_;
+  copy->child_[0] = Ref(node->child_[0]);
+  copy->child_[1] = Ref(node->child_[1]);
+  Unref(node);
+  *slot = copy;
+  return copy;
+}
+
+template <typename T, typename Cmp>
+void PersistentRbTree<T, Cmp>::Insert(T value) {
+  Node** slots[kMaxDepth];
+  size_t depth = 0;
+  Node** slot = &root_;
+  while (*slot != nullptr) {
+    Node* node = MakeMutable(slot);
+    slots[depth++] = slot;
+    slot = &node->child_[!Cmp{}(value, node->value_)];
+  }
+  UTIL_DCHECK_LT(depth, kMaxDepth);
+  *slot = new Node(std::move(value));
+  slots[depth++] = slot;
+  size_++;
+  InsertFix(slots, depth);
+}
+
+template <typename T, typename Cmp>
+void PersistentRbTree<T, Cmp>::InsertFix(Node** slots[], size_t depth) {
+  for (size_t i = depth - 1; i >= 2; i -= 2) {
+    Node* n = *slots[i];
+    Node* p = *slots[i - 1];
+    if (p->IsBlack()) {
+      break;
+    }
+
+    // `p` is red, so it is not the root.
+    Node* gp = *slots[i - 2];
+    const int p_dir = gp->child_[1] == p;
+    Node* a = gp->child_[!p_dir];
+    if (a != nullptr && a->IsRed()) {
+      a = MakeMutable(&gp->child_[!p_dir]);
+      p->red_ = false;
+      a->red_ = false;
+      gp->red_ = true;
+      continue;
+    }
+
+    if ((p->child_[1] == n) != p_dir) {
+      // Rotate `n` above `p`, so that it is on the same side of its parent as
+      // its parent is of `gp`.
+      Rotate(slots[i - 1], p_dir);
+      p = *slots[i - 1];
+    }
+    p->red_ = false;
+    gp->red_ = true;
+    Rotate(slots[i - 2], !p_dir);
+    break;
+  }
+
+  root_->red_ = false;
+}
+
+template <typename T, typename Cmp>
+bool PersistentRbTree<T, Cmp>::Remove(const T& value) {
+  // Look the value up first, so that nothing is copied if it is not there.
+  if (Find(value) == nullptr) {
+    return false;
+  }
+
+  Node** slots[kMaxDepth];
+  size_t depth = 0;
+  Node** slot = &root_;
+  Node* target;
+  while (true) {
+    Node* node = MakeMutable(slot);
+    slots[depth++] = slot;
+    if (Cmp{}(value, node->value_)) {
+      slot = &node->child_[0];
+    } else if (Cmp{}(node->value_, value)) {
+      slot = &node->child_[1];
+    } else {
+      target = node;
+      break;
+    }
+  }
+
+  // If the target has two children, take the value of its successor, and
+  // remove the successor instead.
+  if (target->child_[0] != nullptr && target->child_[1] != nullptr) {
+    slot = &target->child_[1];
+    while (true) {
+      Node* node = MakeMutable(slot);
+      slots[depth++] = slot;
+      if (node->child_[0] == nullptr) {
+        break;
+      }
+      slot = &node->child_[0];
+    }
+    target->value_ = std::move((*slots[depth - 1])->value_);
+  }
+  UTIL_DCHECK_LE(depth, kMaxDepth);
+
+  // Replace the node with its (only) child.
+  Node* removed = *slots[depth - 1];
+  const bool deleted_black = removed->IsBlack();
+  Node* child = removed->child_[removed->child_[0] == nullptr];
+  *slots[depth - 1] = child;
+  removed->child_[0] = nullptr;
+  removed->child_[1] = nullptr;
+  Unref(removed);
+  size_--;
+
+  if (deleted_black) {
+    DeleteFix(slots, depth);
+  }
+  return true;
+}
+
+template <typename T, typename Cmp>
+void PersistentRbTree<T, Cmp>::DeleteFix(Node** slots[], size_t depth) {
+  size_t i = depth - 1;
+  while (i > 0) {
+    if (*slots[i] != nullptr && (*slots[i])->IsRed()) {
+      // If we landed on a red node, we can color it black and that will fix
+      // the black defecit.
+      MakeMutable(slots[i])->red_ = false;
+      return;
+    }
+
+    Node* p = *slots[i - 1];
+    const int dir = slots[i] == &p->child_[1];
+    Node* s = MakeMutable(&p->child_[!dir]);
+    if (s->IsRed()) {
+      s->red_ = false;
+      p->red_ = true;
+      Rotate(slots[i - 1], dir);
+      // `s` is now the parent of `p`, so splice it into the path.
+      UTIL_DCHECK_LT(depth, kMaxDepth);
+      for (size_t j = depth; j > i; j--) {
+        slots[j] = slots[j - 1];
+      }
+      slots[i] = &s->child_[dir];
+      depth++;
+      i++;
+      s = MakeMutable(&p->child_[!dir]);
+    }
+
+    if (IsBlackPtr(s->child_[dir]) && IsBlackPtr(s->child_[!dir])) {
+      s->red_ = true;
+      i--;
+      continue;
+    }
+
+    if (IsBlackPtr(s->child_[!dir])) {
+      // Rotate the red near nephew above `s`.
+      MakeMutable(&s->child_[dir])->red_ = false;
+      s->red_ = true;
+      Rotate(&p->child_[!dir], !dir);
+      s = p->child_[!dir];
+    }
+    s->red_ = p->red_;
+    p->red_ = false;
+    MakeMutable(&s->child_[!dir])->red_ = false;
+    Rotate(slots[i - 1], dir);
+    return;
+  }
+
+  if (root_ != nullptr && root_->IsRed()) {
+    MakeMutable(&root_)->red_ = false;
+  }
+}
+
+template <typename T, typename Cmp>
+template <typename Fn>
+void PersistentRbTree<T, Cmp>::ForEach(Fn fn) const {
+  const Node* stack[kMaxDepth];
+  size_t depth = 0;
+  const Node* node = root_;
+  while (node != nullptr || depth != 0) {
+    for (; node != nullptr; node = node->child_[0]) {
+      stack[depth++] = node;
+    }
+    node = stack[--depth];
+    fn(node->value_);
+    node = node->child_[1];
+  }
+}
+
+}  // namespace util
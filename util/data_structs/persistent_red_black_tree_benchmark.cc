@@ -0,0 +1,131 @@
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/persistent_red_black_tree.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+// The number of updates per benchmark iteration.
+constexpr size_t kOpsPerIteration = 64;
+
+PersistentRbTree<uint64_t> MakePersistentTree(size_t n) {
+  PersistentRbTree<uint64_t> tree;
+  for (uint64_t key : ShuffledKeys(n)) {
+    tree.Insert(key);
+  }
+  return tree;
+}
+
+// Takes a snapshot before every update, and keeps it alive until the next
+// one, so that every update has to copy its path.
+void BM_SnapshotUpdatePersistent(benchmark::State& state) {
+  const size_t n = state.range(0);
+  PersistentRbTree<uint64_t> tree = MakePersistentTree(n);
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      PersistentRbTree<uint64_t> snapshot = tree.Snapshot();
+      tree.Remove(key);
+      tree.Insert(key);
+      benchmark::DoNotOptimize(snapshot.Root());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+// The same, snapshotting a `std::set` by copying it.
+void BM_SnapshotUpdateStdSet(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::vector<uint64_t> shuffled = ShuffledKeys(n);
+  std::set<uint64_t> set(shuffled.begin(), shuffled.end());
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      std::set<uint64_t> snapshot = set;
+      set.erase(key);
+      set.insert(key);
+      benchmark::DoNotOptimize(snapshot.size());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+// Updates with no snapshots alive, where nodes are modified in place.
+void BM_UpdatePersistent(benchmark::State& state) {
+  const size_t n = state.range(0);
+  PersistentRbTree<uint64_t> tree = MakePersistentTree(n);
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      tree.Remove(key);
+      tree.Insert(key);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+void BM_UpdateStdSet(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::vector<uint64_t> shuffled = ShuffledKeys(n);
+  std::set<uint64_t> set(shuffled.begin(), shuffled.end());
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      set.erase(key);
+      set.insert(key);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+// A long scan over a snapshot while the tree is updated underneath it.
+void BM_ScanSnapshotUnderUpdates(benchmark::State& state) {
+  const size_t n = state.range(0);
+  PersistentRbTree<uint64_t> tree = MakePersistentTree(n);
+  const std::vector<uint64_t> keys = RandomKeys(kOpsPerIteration, n - 1);
+
+  for (auto _ : state) {
+    const PersistentRbTree<uint64_t> snapshot = tree.Snapshot();
+    uint64_t sum = 0;
+    size_t next_key = 0;
+    snapshot.ForEach([&](uint64_t value) {
+      sum += value;
+      // Update the live tree every 64 values scanned.
+      if (value % 64 == 0) {
+        const uint64_t key = keys[next_key++ % keys.size()];
+        tree.Remove(key);
+        tree.Insert(key);
+      }
+    });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_SnapshotUpdatePersistent)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 20);
+// Copying a set of 1M elements per update takes too long to measure.
+BENCHMARK(BM_SnapshotUpdateStdSet)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 16);
+BENCHMARK(BM_UpdatePersistent)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_UpdateStdSet)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_ScanSnapshotUnderUpdates)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 20);
+
+}  // namespace
+
+}  // namespace util
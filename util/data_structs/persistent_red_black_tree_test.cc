@@ -0,0 +1,182 @@
+#include "util/data_structs/persistent_red_black_tree.h"
+
+#include <cstddef>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/absl_util.h"
+#include "util/gtest_util.h"
+
+namespace util {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::IsNull;
+using ::testing::Pointee;
+using util::IsOk;
+
+using IntTree = PersistentRbTree<int>;
+
+class PersistentRedBlackTreeTest : public ::testing::Test {
+ protected:
+  static absl::Status Validate(const IntTree& tree) {
+    if (tree.Root() != nullptr && tree.Root()->IsRed()) {
+      return absl::FailedPreconditionError("Found red root.");
+    }
+    DEFINE_OR_RETURN(size_t, black_depth, ValidateNode(tree.Root()));
+    (void) black_depth;
+    return absl::OkStatus();
+  }
+
+  static std::vector<int> Values(const IntTree& tree) {
+    std::vector<int> values;
+    tree.ForEach([&values](int value) { values.push_back(value); });
+    return values;
+  }
+
+ private:
+  // If valid, returns the black depth of the node.
+  static absl::StatusOr<size_t> ValidateNode(const IntTree::Node* node) {
+    if (node == nullptr) {
+      return 0;
+    }
+
+    for (const IntTree::Node* child : { node->Left(), node->Right() }) {
+      if (child != nullptr && node->IsRed() && child->IsRed()) {
+        return absl::FailedPreconditionError(
+            "Found child of red node which is also red.");
+      }
+    }
+    if (node->Left() != nullptr && node->Left()->value() > node->value()) {
+      return absl::FailedPreconditionError("Found left child of node > node");
+    }
+    if (node->Right() != nullptr && node->Right()->value() < node->value()) {
+      return absl::FailedPreconditionError("Found right child of node < node");
+    }
+
+    DEFINE_OR_RETURN(size_t, left_depth, ValidateNode(node->Left()));
+    DEFINE_OR_RETURN(size_t, right_depth, ValidateNode(node->Right()));
+
+    if (left_depth != right_depth) {
+      return absl::FailedPreconditionError(
+          absl::StrFormat("Found inequal black depth of node: %zu vs %zu",
+                          left_depth, right_depth));
+    }
+
+    return left_depth + (node->IsRed() ? 0 : 1);
+  }
+};
+
+TEST_F(PersistentRedBlackTreeTest, TestEmpty) {
+  IntTree tree;
+  EXPECT_EQ(tree.Size(), 0);
+  EXPECT_THAT(tree.Find(0), IsNull());
+  EXPECT_FALSE(tree.Remove(0));
+  EXPECT_THAT(Values(tree), IsEmpty());
+}
+
+TEST_F(PersistentRedBlackTreeTest, TestInsertRemoveMany) {
+  constexpr int kNumElements = 1000;
+
+  IntTree tree;
+  for (int i = 0; i < kNumElements; i++) {
+    tree.Insert((i * 17) % kNumElements);
+    ASSERT_THAT(Validate(tree), IsOk());
+  }
+  ASSERT_EQ(tree.Size(), kNumElements);
+
+  std::vector<int> expected;
+  for (int i = 0; i < kNumElements; i++) {
+    expected.push_back(i);
+  }
+  EXPECT_THAT(Values(tree), ElementsAreArray(expected));
+
+  for (int i = 0; i < kNumElements; i++) {
+    const int value = (i * 13 + 3) % kNumElements;
+    ASSERT_TRUE(tree.Remove(value));
+    ASSERT_THAT(Validate(tree), IsOk());
+    ASSERT_EQ(tree.Size(), kNumElements - i - 1);
+    EXPECT_THAT(tree.Find(value), IsNull());
+  }
+  EXPECT_EQ(tree.Root(), nullptr);
+}
+
+TEST_F(PersistentRedBlackTreeTest, TestLowerBound) {
+  IntTree tree;
+  for (int i = 0; i < 100; i++) {
+    tree.Insert(2 * i);
+  }
+  for (int value = 0; value <= 198; value++) {
+    EXPECT_THAT(tree.LowerBound([value](int other) { return other >= value; }),
+                Pointee((value + 1) / 2 * 2));
+  }
+  EXPECT_THAT(tree.LowerBound([](int other) { return other > 198; }),
+              IsNull());
+}
+
+TEST_F(PersistentRedBlackTreeTest, TestSnapshotsAreIndependent) {
+  IntTree tree;
+  for (int i = 0; i < 10; i++) {
+    tree.Insert(i);
+  }
+
+  IntTree snapshot = tree.Snapshot();
+  EXPECT_EQ(snapshot.Root(), tree.Root());
+
+  tree.Insert(10);
+  ASSERT_TRUE(tree.Remove(0));
+  ASSERT_TRUE(snapshot.Remove(9));
+  snapshot.Insert(-1);
+
+  EXPECT_THAT(Validate(tree), IsOk());
+  EXPECT_THAT(Validate(snapshot), IsOk());
+  EXPECT_THAT(Values(tree), ElementsAre(1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+  EXPECT_THAT(Values(snapshot), ElementsAre(-1, 0, 1, 2, 3, 4, 5, 6, 7, 8));
+}
+
+// Applies random updates to a tree, taking a snapshot before each one, and
+// checks that every snapshot still holds the values it was taken with.
+TEST_F(PersistentRedBlackTreeTest, TestRandomVersions) {
+  constexpr size_t kNumUpdates = 2000;
+  constexpr int kMaxValue = 300;
+
+  std::mt19937 gen(0);
+  IntTree tree;
+  std::multiset<int> expected;
+  std::vector<IntTree> snapshots;
+  std::vector<std::vector<int>> snapshot_values;
+  for (size_t i = 0; i < kNumUpdates; i++) {
+    snapshots.push_back(tree.Snapshot());
+    snapshot_values.emplace_back(expected.begin(), expected.end());
+
+    const int value = gen() % kMaxValue;
+    if (gen() % 2 == 0) {
+      tree.Insert(value);
+      expected.insert(value);
+    } else {
+      const auto it = expected.find(value);
+      ASSERT_EQ(tree.Remove(value), it != expected.end());
+      if (it != expected.end()) {
+        expected.erase(it);
+      }
+    }
+    ASSERT_THAT(Validate(tree), IsOk());
+    ASSERT_EQ(tree.Size(), expected.size());
+  }
+
+  EXPECT_THAT(Values(tree), ElementsAreArray(expected));
+  for (size_t i = 0; i < snapshots.size(); i++) {
+    ASSERT_THAT(Validate(snapshots[i]), IsOk());
+    ASSERT_THAT(Values(snapshots[i]), ElementsAreArray(snapshot_values[i]));
+  }
+}
+
+}  // namespace util
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/slab_arena.h"
+
+namespace util {
+
+template <typename K, typename V>
+struct RbMapEntry : public RbNode {
+  template <typename KeyArg, typename... Args>
+  explicit RbMapEntry(KeyArg&& key, Args&&... args)
+      : key(std::forward<KeyArg>(key)), value(std::forward<Args>(args)...) {}
+
+  const K key;
+  V value;
+};
+
+template <typename K>
+struct RbSetEntry : public RbNode {
+  template <typename... Args>
+  explicit RbSetEntry(Args&&... args) : key(std::forward<Args>(args)...) {}
+
+  const K key;
+};
+
+namespace internal {
+
+// The shared implementation of `RbMap` and `RbSet`: an `RbTree` of unique
+// `Entry`s ordered by `Entry::key`, which owns its entries and allocates them
+// from a `SlabArena`.
+template <typename Entry, typename K, typename Cmp>
+class RbArenaTree {
+  struct EntryLess {
+    bool operator()(const Entry& e1, const Entry& e2) const {
+      return Cmp{}(e1.key, e2.key);
+    }
+  };
+
+  template <bool kConst>
+  class IteratorImpl {
+    friend RbArenaTree;
+
+   public:
+    using value_type = Entry;
+    using reference = std::conditional_t<kConst, const Entry&, Entry&>;
+    using pointer = std::conditional_t<kConst, const Entry*, Entry*>;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    IteratorImpl() = default;
+
+    reference operator*() const {
+      return *operator->();
+    }
+
+    pointer operator->() const {
+      return static_cast<pointer>(const_cast<RbNode*>(node_));
+    }
+
+    bool operator==(const IteratorImpl& it) const {
+      return node_ == it.node_;
+    }
+
+    IteratorImpl& operator++() {
+      node_ = node_->Next();
+      return *this;
+    }
+
+    IteratorImpl operator++(int) {
+      IteratorImpl it = *this;
+      ++(*this);
+      return it;
+    }
+
+   private:
+    explicit IteratorImpl(const RbNode* node) : node_(node) {}
+
+    // The root sentinel of the tree for `end()`, which `RbNode::Next()`
+    // returns after the last node.
+    const RbNode* node_ = nullptr;
+  };
+
+ public:
+  using iterator = IteratorImpl</*kConst=*/false>;
+  using const_iterator = IteratorImpl</*kConst=*/true>;
+
+  RbArenaTree() = default;
+
+  ~RbArenaTree() {
+    // The arena frees all of the entries' memory at once, so only visit them
+    // if they need to be destroyed. They are destroyed in post-order, so that
+    // the walk only follows the links of entries which are still alive.
+    if constexpr (!std::is_trivially_destructible_v<Entry>) {
+      const RbTree<Entry, EntryLess>& tree = tree_;
+      const RbNode* node =
+          tree.Root() != nullptr ? FirstInPostOrder(tree.Root()) : nullptr;
+      while (node != nullptr) {
+        const RbNode* parent = node->Parent();
+        const bool left = parent->Left() == node;
+        const_cast<Entry*>(static_cast<const Entry*>(node))->~Entry();
+        if (parent == tree.RootSentinel()) {
+          break;
+        }
+        node = left && parent->Right() != nullptr
+                   ? FirstInPostOrder(parent->Right())
+                   : parent;
+      }
+    }
+  }
+
+  size_t Size() const {
+    return tree_.Size();
+  }
+
+  bool Empty() const {
+    return tree_.Size() == 0;
+  }
+
+  iterator begin() {
+    return iterator(Leftmost());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(Leftmost());
+  }
+
+  iterator end() {
+    return iterator(tree_.RootSentinel());
+  }
+
+  const_iterator end() const {
+    return const_iterator(tree_.RootSentinel());
+  }
+
+  // Returns the entry with the lowest key not less than `key`, or null if
+  // there is none.
+  Entry* LowerBound(const K& key) {
+    return tree_.LowerBound([&key](const Entry& entry) {
+      return !Cmp{}(entry.key, key);
+    });
+  }
+
+  const Entry* LowerBound(const K& key) const {
+    return const_cast<RbArenaTree*>(this)->LowerBound(key);
+  }
+
+  // Returns the entry for `key`, or null if there is none.
+  Entry* Find(const K& key) {
+    Entry* entry = LowerBound(key);
+    return entry != nullptr && !Cmp{}(key, entry->key) ? entry : nullptr;
+  }
+
+  const Entry* Find(const K& key) const {
+    return const_cast<RbArenaTree*>(this)->Find(key);
+  }
+
+  bool Contains(const K& key) const {
+    return Find(key) != nullptr;
+  }
+
+  // Removes and destroys `entry`, which must be in this container.
+  void Erase(Entry* entry) {
+    tree_.Remove(entry);
+    entry->~Entry();
+    arena_.Free(entry);
+  }
+
+  // Removes the entry for `key`, returning whether there was one.
+  bool Erase(const K& key) {
+    Entry* entry = Find(key);
+    if (entry == nullptr) {
+      return false;
+    }
+    Erase(entry);
+    return true;
+  }
+
+ protected:
+  // Constructs an entry from `entry_args` if there is no entry for `key`.
+  // Returns the entry for `key`, and whether it was inserted.
+  template <typename... Args>
+  std::pair<Entry*, bool> EmplaceIfAbsent(const K& key, Args&&... entry_args) {
+    const InsertPosition position = Locate(key);
+    if (Matches(position, key)) {
+      return { position.lower_bound, false };
+    }
+    Entry* entry =
+        new (arena_.Allocate()) Entry(std::forward<Args>(entry_args)...);
+    tree_.InsertAt(entry, position);
+    return { entry, true };
+  }
+
+  // Constructs an entry from `entry_args`, and inserts it if there is no entry
+  // with an equal key. Returns the entry for the key, and whether it was
+  // inserted.
+  template <typename... Args>
+  std::pair<Entry*, bool> EmplaceEntry(Args&&... entry_args) {
+    Entry* entry =
+        new (arena_.Allocate()) Entry(std::forward<Args>(entry_args)...);
+    const InsertPosition position = Locate(entry->key);
+    if (Matches(position, entry->key)) {
+      entry->~Entry();
+      arena_.Free(entry);
+      return { position.lower_bound, false };
+    }
+    tree_.InsertAt(entry, position);
+    return { entry, true };
+  }
+
+ private:
+  using InsertPosition = typename RbTree<Entry, EntryLess>::InsertPosition;
+
+  // Finds the lower bound of `key`, and where to insert it if it is absent.
+  InsertPosition Locate(const K& key) {
+    return tree_.LowerBoundPosition([&key](const Entry& entry) {
+      return !Cmp{}(entry.key, key);
+    });
+  }
+
+  // Whether `position`, from `Locate(key)`, holds an entry for `key`.
+  static bool Matches(const InsertPosition& position, const K& key) {
+    return position.lower_bound != nullptr &&
+           !Cmp{}(key, position.lower_bound->key);
+  }
+
+  // Returns the first node of the subtree under `node` in post-order.
+  static const RbNode* FirstInPostOrder(const RbNode* node) {
+    while (true) {
+      if (node->Left() != nullptr) {
+        node = node->Left();
+      } else if (node->Right() != nullptr) {
+        node = node->Right();
+      } else {
+        return node;
+      }
+    }
+  }
+
+  const RbNode* Leftmost() const {
+    return tree_.Root() != nullptr ? tree_.Root()->LeftmostChild()
+                                   : tree_.RootSentinel();
+  }
+
+  // Declared before `tree_`, since the entries in `tree_` live in the arena.
+  SlabArena<sizeof(Entry), alignof(Entry)> arena_;
+  RbTree<Entry, EntryLess> tree_;
+};
+
+}  // namespace internal
+
+// An ordered map from unique keys to values, built on `RbTree`.
+//
+// Unlike `RbTree`, keys and values need no hook, and the map owns its entries.
+// Entries are allocated from a per-map `SlabArena` rather than individually,
+// and stay at the same address until erased. Values are constructed in place,
+// so they may be move-only or immovable.
+//
+// Like `RbTree`, the map is not thread-safe, and cannot be copied or moved.
+template <typename K, typename V, typename Cmp = std::less<K>>
+class RbMap : public internal::RbArenaTree<RbMapEntry<K, V>, K, Cmp> {
+  using Base = internal::RbArenaTree<RbMapEntry<K, V>, K, Cmp>;
+
+ public:
+  using Entry = RbMapEntry<K, V>;
+
+  // Constructs a value from `args` for `key` if the map does not already
+  // contain `key`. Returns the entry for `key`, and whether it was inserted.
+  template <typename... Args>
+  std::pair<Entry*, bool> Emplace(const K& key, Args&&... args) {
+    return Base::EmplaceIfAbsent(key, key, std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  std::pair<Entry*, bool> Emplace(K&& key, Args&&... args) {
+    return Base::EmplaceIfAbsent(key, std::move(key),
+                                 std::forward<Args>(args)...);
+  }
+};
+
+// An ordered set of unique keys, built on `RbTree`. See `RbMap`.
+template <typename K, typename Cmp = std::less<K>>
+class RbSet : public internal::RbArenaTree<RbSetEntry<K>, K, Cmp> {
+  using Base = internal::RbArenaTree<RbSetEntry<K>, K, Cmp>;
+
+ public:
+  using Entry = RbSetEntry<K>;
+
+  // Inserts `key` if the set does not already contain it. Returns the entry
+  // for `key`, and whether it was inserted.
+  std::pair<Entry*, bool> Insert(const K& key) {
+    return Base::EmplaceIfAbsent(key, key);
+  }
+
+  std::pair<Entry*, bool> Insert(K&& key) {
+    return Base::EmplaceIfAbsent(key, std::move(key));
+  }
+
+  // Constructs a key from `args`, and inserts it if the set does not already
+  // contain it.
+  template <typename... Args>
+  std::pair<Entry*, bool> Emplace(Args&&... args) {
+    return Base::EmplaceEntry(std::forward<Args>(args)...);
+  }
+};
+
+}  // namespace util
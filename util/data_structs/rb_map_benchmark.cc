@@ -0,0 +1,94 @@
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/rb_map.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+// The number of erase/insert pairs per benchmark iteration.
+constexpr size_t kOpsPerIteration = 1024;
+
+struct Value {
+  uint64_t data[4];
+};
+
+template <typename Map>
+void Emplace(Map& map, uint64_t key) {
+  if constexpr (requires { map.Emplace(key); }) {
+    map.Emplace(key);
+  } else {
+    map.emplace(key, Value());
+  }
+}
+
+template <typename Map>
+void Erase(Map& map, uint64_t key) {
+  if constexpr (requires { map.Erase(key); }) {
+    map.Erase(key);
+  } else {
+    map.erase(key);
+  }
+}
+
+// Erases a random key and inserts another, keeping the map size roughly
+// constant at `n` so that every insert allocates a node and every erase frees
+// one.
+template <typename Map>
+void BM_Churn(benchmark::State& state) {
+  const size_t n = state.range(0);
+  Map map;
+  for (uint64_t key : RandomKeys(n, 2 * n - 1, /*seed=*/1)) {
+    Emplace(map, key);
+  }
+  const std::vector<uint64_t> erase_keys =
+      RandomKeys(kOpsPerIteration, 2 * n - 1, /*seed=*/2);
+  const std::vector<uint64_t> insert_keys =
+      RandomKeys(kOpsPerIteration, 2 * n - 1, /*seed=*/3);
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < kOpsPerIteration; i++) {
+      Erase(map, erase_keys[i]);
+      Emplace(map, insert_keys[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+// Builds and destroys a map of `n` elements.
+template <typename Map>
+void BM_BuildDestroy(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::vector<uint64_t> keys = RandomKeys(n, 2 * n - 1, /*seed=*/1);
+
+  for (auto _ : state) {
+    Map map;
+    for (uint64_t key : keys) {
+      Emplace(map, key);
+    }
+    benchmark::DoNotOptimize(&map);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+using UtilMap = RbMap<uint64_t, Value>;
+using StdMap = std::map<uint64_t, Value>;
+
+BENCHMARK(BM_Churn<UtilMap>)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_Churn<StdMap>)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_BuildDestroy<UtilMap>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+BENCHMARK(BM_BuildDestroy<StdMap>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 20);
+
+}  // namespace
+
+}  // namespace util
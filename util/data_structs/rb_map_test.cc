@@ -0,0 +1,234 @@
+#include "util/data_structs/rb_map.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::Pair;
+
+template <typename Map>
+std::vector<std::pair<int, int>> Entries(const Map& map) {
+  std::vector<std::pair<int, int>> entries;
+  for (const auto& entry : map) {
+    entries.emplace_back(entry.key, entry.value);
+  }
+  return entries;
+}
+
+TEST(RbMapTest, TestEmpty) {
+  RbMap<int, int> map;
+  EXPECT_TRUE(map.Empty());
+  EXPECT_EQ(map.Size(), 0);
+  EXPECT_EQ(map.Find(1), nullptr);
+  EXPECT_EQ(map.LowerBound(1), nullptr);
+  EXPECT_FALSE(map.Erase(1));
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(RbMapTest, TestEmplace) {
+  RbMap<int, int> map;
+  auto [entry, inserted] = map.Emplace(2, 20);
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(entry->key, 2);
+  EXPECT_EQ(entry->value, 20);
+
+  auto [existing, inserted_again] = map.Emplace(2, 30);
+  EXPECT_FALSE(inserted_again);
+  EXPECT_EQ(existing, entry);
+  EXPECT_EQ(existing->value, 20);
+
+  map.Emplace(1, 10);
+  map.Emplace(3, 30);
+  EXPECT_EQ(map.Size(), 3);
+  EXPECT_THAT(Entries(map), ElementsAre(Pair(1, 10), Pair(2, 20), Pair(3, 30)));
+
+  EXPECT_EQ(map.Find(2), entry);
+  EXPECT_EQ(map.LowerBound(0)->key, 1);
+  EXPECT_EQ(map.LowerBound(3)->key, 3);
+  EXPECT_EQ(map.LowerBound(4), nullptr);
+  EXPECT_TRUE(map.Contains(3));
+  EXPECT_FALSE(map.Contains(4));
+}
+
+TEST(RbMapTest, TestErase) {
+  RbMap<int, int> map;
+  for (int i = 0; i < 10; i++) {
+    map.Emplace(i, i * i);
+  }
+
+  EXPECT_TRUE(map.Erase(3));
+  EXPECT_FALSE(map.Erase(3));
+  map.Erase(map.Find(5));
+  EXPECT_EQ(map.Size(), 8);
+  EXPECT_EQ(map.Find(3), nullptr);
+  EXPECT_EQ(map.LowerBound(5)->key, 6);
+
+  // Erased entries are reused.
+  auto [entry, inserted] = map.Emplace(3, 0);
+  EXPECT_TRUE(inserted);
+  EXPECT_EQ(map.Size(), 9);
+}
+
+TEST(RbMapTest, TestMoveOnlyValue) {
+  RbMap<std::string, std::unique_ptr<int>> map;
+  map.Emplace("a", std::make_unique<int>(1));
+  map.Emplace(std::string("b"), new int(2));
+
+  ASSERT_NE(map.Find("a"), nullptr);
+  EXPECT_EQ(*map.Find("a")->value, 1);
+  ASSERT_NE(map.Find("b"), nullptr);
+  EXPECT_EQ(*map.Find("b")->value, 2);
+
+  // The value is not constructed if the key is already present.
+  auto value = std::make_unique<int>(3);
+  map.Emplace("a", std::move(value));
+  EXPECT_EQ(*map.Find("a")->value, 1);
+}
+
+TEST(RbMapTest, TestDestroysValues) {
+  auto counter = std::make_shared<int>(0);
+  {
+    RbMap<int, std::shared_ptr<int>> map;
+    for (int i = 0; i < 100; i++) {
+      map.Emplace(i, counter);
+    }
+    EXPECT_EQ(counter.use_count(), 101);
+    map.Erase(50);
+    EXPECT_EQ(counter.use_count(), 100);
+  }
+  EXPECT_EQ(counter.use_count(), 1);
+}
+
+// Records the order in which values are destroyed.
+struct DestructionRecorder {
+  DestructionRecorder(int key, std::vector<int>* destroyed)
+      : key(key), destroyed(destroyed) {}
+
+  ~DestructionRecorder() {
+    destroyed->push_back(key);
+  }
+
+  int key;
+  std::vector<int>* destroyed;
+};
+
+// The map destroys each entry after its children, so that it never follows
+// the links of an entry which was already destroyed.
+TEST(RbMapTest, TestDestroysChildrenFirst) {
+  using Map = RbMap<int, DestructionRecorder>;
+  constexpr int kNumEntries = 100;
+  std::vector<int> destroyed;
+  std::vector<std::pair<int, int>> children;
+  {
+    Map map;
+    for (int i = 0; i < kNumEntries; i++) {
+      map.Emplace(i, i, &destroyed);
+    }
+    for (int i = 0; i < kNumEntries; i++) {
+      const Map::Entry* entry = map.Find(i);
+      for (const RbNode* child : { entry->Left(), entry->Right() }) {
+        if (child != nullptr) {
+          children.emplace_back(static_cast<const Map::Entry*>(child)->key, i);
+        }
+      }
+    }
+  }
+
+  ASSERT_EQ(destroyed.size(), kNumEntries);
+  std::vector<int> position(kNumEntries);
+  for (size_t i = 0; i < destroyed.size(); i++) {
+    position[destroyed[i]] = i;
+  }
+  EXPECT_EQ(children.size(), kNumEntries - 1);
+  for (const auto& [child, parent] : children) {
+    EXPECT_LT(position[child], position[parent])
+        << child << " is a child of " << parent;
+  }
+}
+
+// Counts every comparison, to measure the work done by the map.
+struct CountingLess {
+  bool operator()(int k1, int k2) const {
+    comparisons++;
+    return k1 < k2;
+  }
+
+  static inline size_t comparisons = 0;
+};
+
+// Emplacing looks the key up and inserts it in the same descent, so it takes
+// one more comparison than a lookup, to check for an equal key.
+TEST(RbMapTest, TestEmplaceDescendsOnce) {
+  RbMap<int, int, CountingLess> map;
+  for (int i = 0; i < 1000; i++) {
+    map.Emplace(2 * ((i * 7) % 1000), i);
+  }
+
+  for (int key : { -1, 0, 777, 1000, 1001, 1998, 1999 }) {
+    CountingLess::comparisons = 0;
+    map.LowerBound(key);
+    const size_t lookup_comparisons = CountingLess::comparisons;
+
+    CountingLess::comparisons = 0;
+    const bool inserted = map.Emplace(key, 0).second;
+    EXPECT_EQ(inserted, key % 2 != 0) << key;
+    EXPECT_EQ(CountingLess::comparisons,
+              lookup_comparisons + (key <= 1998 ? 1 : 0))
+        << key;
+  }
+  EXPECT_EQ(map.Size(), 1004);
+}
+
+TEST(RbMapTest, TestMatchesStdMap) {
+  constexpr size_t kNumOperations = 20000;
+
+  RbMap<int, int> map;
+  std::map<int, int> expected;
+  uint64_t state = 1;
+  for (size_t op = 0; op < kNumOperations; op++) {
+    state = state * 6364136223846793005 + 1442695040888963407;
+    const int key = static_cast<int>((state >> 33) % 1000);
+    if ((state >> 20) % 3 == 0) {
+      ASSERT_EQ(map.Erase(key), expected.erase(key) == 1);
+    } else {
+      auto [entry, inserted] = map.Emplace(key, static_cast<int>(op));
+      auto [it, expected_inserted] = expected.emplace(key, op);
+      ASSERT_EQ(inserted, expected_inserted);
+      ASSERT_EQ(entry->value, it->second);
+    }
+    ASSERT_EQ(map.Size(), expected.size());
+  }
+  EXPECT_THAT(Entries(map), ElementsAreArray(expected));
+}
+
+TEST(RbSetTest, TestInsertEmplace) {
+  RbSet<std::string> set;
+  EXPECT_TRUE(set.Insert("b").second);
+  EXPECT_TRUE(set.Emplace(3, 'a').second);
+  EXPECT_FALSE(set.Insert("b").second);
+  EXPECT_FALSE(set.Emplace("aaa").second);
+  EXPECT_EQ(set.Size(), 2);
+
+  std::vector<std::string> keys;
+  for (const auto& entry : set) {
+    keys.push_back(entry.key);
+  }
+  EXPECT_THAT(keys, ElementsAre("aaa", "b"));
+
+  EXPECT_TRUE(set.Erase("aaa"));
+  EXPECT_FALSE(set.Contains("aaa"));
+  EXPECT_TRUE(set.Contains("b"));
+}
+
+}  // namespace util
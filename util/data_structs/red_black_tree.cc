@@ -1,244 +1,188 @@
 #include "util/data_structs/red_black_tree.h"
 
-#include "util/internal/util.h"
+#include <cstddef>
+#include <numeric>
 
-namespace util {
+#include "util/data_structs/red_black_tree_ops.h"
 
-namespace {
+namespace util {
 
-bool IsRedPtr(const RbNode* node) {
-  return node != nullptr && node->IsRed();
-}
+namespace internal {
 
-bool IsBlackPtr(const RbNode* node) {
-  return node == nullptr || node->IsBlack();
-}
+constinit thread_local RbTreeCounters rb_tree_counters;
 
-}  // namespace
+// Links `RbNode`s through their pointer fields, for `RbOps`.
+struct RbNodeLinks {
+  using Ref = RbNode*;
 
-void RbNode::RotateLeft(RbNode* right) {
-  UTIL_ASSERT(right == right_);
-  this->SetRight(right->Left());
-  right->SetParentOf(this);
-  this->parent_ = right;
-  right->left_ = this;
-}
+  static RbNode* Null() {
+    return nullptr;
+  }
 
-void RbNode::RotateRight(RbNode* left) {
-  UTIL_ASSERT(left == left_);
-  this->SetLeft(left->Right());
-  left->SetParentOf(this);
-  this->parent_ = left;
-  left->right_ = this;
-}
+  static RbNode* Left(RbNode* node) {
+    return node->left_;
+  }
 
-void RbNode::RotateLeftRight(RbNode* parent, RbNode* right) {
-  UTIL_ASSERT(parent == parent_);
-  UTIL_ASSERT(parent->left_ == this);
-  UTIL_ASSERT(right == right_);
-  this->SetRight(right->Left());
-  parent->SetLeft(right->Right());
-  right->SetParentOf(parent);
-  right->SetLeft(this);
-  right->SetRight(parent);
-}
+  static RbNode* Right(RbNode* node) {
+    return node->right_;
+  }
 
-void RbNode::RotateRightLeft(RbNode* parent, RbNode* left) {
-  UTIL_ASSERT(parent == parent_);
-  UTIL_ASSERT(parent->right_ == this);
-  UTIL_ASSERT(left == left_);
-  this->SetLeft(left->Right());
-  parent->SetRight(left->Left());
-  left->SetParentOf(parent);
-  left->SetRight(this);
-  left->SetLeft(parent);
-}
+  static RbNode* Parent(RbNode* node) {
+    return node->parent_;
+  }
 
-void RbNode::InsertLeft(RbNode* node, const RbNode* root) {
-  UTIL_ASSERT(node->left_ == nullptr);
-  node->left_ = this;
-  this->parent_ = node;
-  this->MakeRed();
-  InsertFix(this, root);
-}
+  static bool IsRed(RbNode* node) {
+    return node->red_;
+  }
 
-void RbNode::InsertRight(RbNode* node, const RbNode* root) {
-  UTIL_ASSERT(node->right_ == nullptr);
-  node->right_ = this;
-  this->parent_ = node;
-  this->MakeRed();
-  InsertFix(this, root);
-}
+  static void SetLeft(RbNode* node, RbNode* left) {
+    node->left_ = left;
+  }
 
-void RbNode::Remove(const RbNode* root) const {
-  // The node which will be succeeding the location being removed from the tree.
-  // This is where we start fixing from.
-  RbNode* successor;
-  // The parent of `successor`.
-  RbNode* parent;
-  bool deleted_black;
-  if (left_ == nullptr) {
-    successor = right_;
-    parent = parent_;
-    deleted_black = this->IsBlack();
-    DetachParent(right_);
-  } else if (right_ == nullptr) {
-    successor = left_;
-    parent = parent_;
-    deleted_black = this->IsBlack();
-    DetachParent(left_);
-  } else {
-    RbNode* scapegoat = left_->RightmostChild();
-    successor = scapegoat->left_;
-    parent = scapegoat->parent_ != this ? scapegoat->parent_ : scapegoat;
-    deleted_black = scapegoat->IsBlack();
-
-    // successor does not have a right child. Detach it from its parent and
-    // replace it with its left (only) child.
-    scapegoat->DetachParent(successor);
-
-    // Replace this node with the successor.
-    scapegoat->SetLeft(left_);
-    scapegoat->SetRight(right_);
-    scapegoat->SetParentOf(this);
-    scapegoat->red_ = red_;
-  }
-
-  if (deleted_black) {
-    DeleteFix(successor, parent, root);
+  static void SetRight(RbNode* node, RbNode* right) {
+    node->right_ = right;
   }
-}
 
-void RbNode::SetLeft(RbNode* node) {
-  left_ = node;
-  if (node != nullptr) {
-    node->parent_ = this;
+  static void SetParent(RbNode* node, RbNode* parent) {
+    node->parent_ = parent;
   }
-}
 
-void RbNode::SetRight(RbNode* node) {
-  right_ = node;
-  if (node != nullptr) {
-    node->parent_ = this;
+  static void SetRed(RbNode* node, bool red) {
+    node->red_ = red;
   }
-}
 
-void RbNode::SetParentOf(const RbNode* node) {
-  parent_ = node->parent_;
-  if (parent_ != nullptr) {
-    if (parent_->left_ == node) {
-      parent_->left_ = this;
-    } else {
-      parent_->right_ = this;
+#if UTIL_RB_TREE_COUNTERS
+  static void Count(RbOpsEvent event) {
+    switch (event) {
+      case RbOpsEvent::kRotateLeft:
+        rb_tree_counters.rotations_left++;
+        break;
+      case RbOpsEvent::kRotateRight:
+        rb_tree_counters.rotations_right++;
+        break;
+      case RbOpsEvent::kRotateLeftRight:
+        rb_tree_counters.rotations_left_right++;
+        break;
+      case RbOpsEvent::kRotateRightLeft:
+        rb_tree_counters.rotations_right_left++;
+        break;
+      case RbOpsEvent::kInsertFixIteration:
+        rb_tree_counters.insert_fix_iterations++;
+        break;
+      case RbOpsEvent::kDeleteFixIteration:
+        rb_tree_counters.delete_fix_iterations++;
+        break;
     }
   }
-}
+#endif
+};
 
-void RbNode::DetachParent(RbNode* new_child) const {
-  if (new_child != nullptr) {
-    new_child->parent_ = parent_;
+RbTreeStats ComputeRbTreeStats(const RbNode* root) {
+  RbTreeStats stats;
+  if (root == nullptr) {
+    return stats;
   }
-  if (parent_ != nullptr) {
-    if (parent_->left_ == this) {
-      parent_->left_ = new_child;
+
+  // Every path has the same number of black nodes, so follow the leftmost.
+  for (const RbNode* node = root; node != nullptr; node = node->Left()) {
+    stats.black_height += node->IsBlack();
+  }
+
+  // Walk the tree through parent links, so that this does not allocate for a
+  // stack, and note which way each node was entered from.
+  const RbNode* const end = root->Parent();
+  const RbNode* node = root;
+  const RbNode* prev = end;
+  size_t depth = 0;
+  while (node != end) {
+    const RbNode* next;
+    if (prev == node->Parent()) {
+      if (depth == stats.depth_histogram.size()) {
+        stats.depth_histogram.push_back(0);
+      }
+      stats.depth_histogram[depth]++;
+      next = node->Left() != nullptr    ? node->Left()
+             : node->Right() != nullptr ? node->Right()
+                                        : node->Parent();
+    } else if (prev == node->Left() && node->Right() != nullptr) {
+      next = node->Right();
     } else {
-      parent_->right_ = new_child;
+      next = node->Parent();
     }
+
+    if (next == node->Parent()) {
+      depth--;
+    } else {
+      depth++;
+    }
+    prev = node;
+    node = next;
   }
+
+  stats.height = stats.depth_histogram.size();
+  stats.size = std::accumulate(stats.depth_histogram.begin(),
+                               stats.depth_histogram.end(), size_t{ 0 });
+  return stats;
 }
 
-void RbNode::InsertFix(RbNode* n, const RbNode* root) {
-  RbNode* p;
-  while ((p = n->parent_) != root && p->IsRed()) {
-#define FIX_CHILD(dir, opp)         \
-  RbNode* a = gp->opp();            \
-  if (a != nullptr && a->IsRed()) { \
-    p->MakeBlack();                 \
-    a->MakeBlack();                 \
-    gp->MakeRed();                  \
-    n = gp;                         \
-  } else if (n == p->dir()) {       \
-    p->MakeBlack();                 \
-    gp->MakeRed();                  \
-    gp->Rotate##opp(p);             \
-    n = p;                          \
-    p = n->Parent();                \
-    break;                          \
-  } else {                          \
-    n->MakeBlack();                 \
-    gp->MakeRed();                  \
-    p->Rotate##dir##opp(gp, n);     \
-    p = n->parent_;                 \
-    break;                          \
-  }
-
-    RbNode* gp = p->parent_;
-    if (p == gp->Left()) {
-      FIX_CHILD(Left, Right);
-    } else /* p == gp->Right() */ {
-      FIX_CHILD(Right, Left);
-    }
+}  // namespace internal
 
-#undef FIX_CHILD
-  }
+namespace {
+
+using RbNodeOps = internal::RbOps<internal::RbNodeLinks>;
 
-  if (p == root) {
-    n->MakeBlack();
+}  // namespace
+
+RbTreeCounters GetRbTreeCounters() {
+  return internal::rb_tree_counters;
+}
+
+void ResetRbTreeCounters() {
+  internal::rb_tree_counters = {};
+}
+
+double RbTreeStats::MeanDepth() const {
+  if (size == 0) {
+    return 0;
+  }
+  size_t total = 0;
+  for (size_t depth = 0; depth < depth_histogram.size(); depth++) {
+    total += (depth + 1) * depth_histogram[depth];
   }
+  return static_cast<double>(total) / size;
 }
 
-void RbNode::DeleteFix(RbNode* n, RbNode* p, const RbNode* root) {
-  while (true) {
-#define FIX_CHILD(dir, opp)                           \
-  RbNode* s = p->opp();                               \
-  UTIL_ASSERT(s != nullptr);                          \
-  if (s->IsRed()) {                                   \
-    p->MakeRed();                                     \
-    s->MakeBlack();                                   \
-    p->Rotate##dir(s);                                \
-    s = p->opp();                                     \
-    UTIL_ASSERT(s != nullptr);                        \
-  }                                                   \
-  if (IsBlackPtr(s->dir()) && IsBlackPtr(s->opp())) { \
-    s->MakeRed();                                     \
-    n = p;                                            \
-    p = n->Parent();                                  \
-  } else if (IsRedPtr(s->opp())) {                    \
-    s->red_ = p->red_;                                \
-    p->MakeBlack();                                   \
-    s->opp()->MakeBlack();                            \
-    p->Rotate##dir(s);                                \
-    n = s;                                            \
-    p = n->Parent();                                  \
-    break;                                            \
-  } else /* IsRedPtr(s->dir()) */ {                   \
-    RbNode* sd = s->dir();                            \
-    sd->red_ = p->red_;                               \
-    p->MakeBlack();                                   \
-    s->Rotate##opp##dir(p, sd);                       \
-    n = sd;                                           \
-    p = n->Parent();                                  \
-    break;                                            \
-  }
-
-    if (p == root || IsRedPtr(n)) {
-      // If we landed on a red node, we can color it black and that will fix
-      // the black defecit. If we happened to land on the root, then we need
-      // to color it black anyway, so this coincidentally covers both cases.
-      if (n != nullptr && n->IsRed()) {
-        n->MakeBlack();
-      }
+void RbNode::InsertLeft(RbNode* node, const RbNode* root) {
+  RbNodeOps({}).InsertLeft(this, node, const_cast<RbNode*>(root));
+}
 
-      break;
-    }
+void RbNode::InsertRight(RbNode* node, const RbNode* root) {
+  RbNodeOps({}).InsertRight(this, node, const_cast<RbNode*>(root));
+}
 
-    if (n == p->Left()) {
-      FIX_CHILD(Left, Right);
-    } else /* n == p->Right() */ {
-      FIX_CHILD(Right, Left);
-    }
+void RbNode::Remove(const RbNode* root) const {
+  RbNodeOps({}).Remove(const_cast<RbNode*>(this), const_cast<RbNode*>(root));
+}
+
+RbNode* RbNode::DetachRange(RbNode* last, const RbNode* root) {
+  return RbNodeOps({}).DetachRange(this, last, const_cast<RbNode*>(root));
+}
+
+void RbNode::Appender::Append(RbNode* node) {
+  if (first_ == nullptr) {
+    first_ = node;
+    return;
+  }
+
+  UTIL_DCHECK_LT(size_, size_t{ 1 } << (kMaxBlackHeight - 1));
+  RbNodeOps({}).BuildAppend(node, trees_, roots_, size_);
+  size_++;
+}
 
-#undef FIX_CHILD
+void RbNode::Appender::Finish(const RbNode* root) {
+  if (first_ != nullptr) {
+    RbNodeOps({}).BuildJoin(const_cast<RbNode*>(root), first_, trees_, roots_,
+                            size_);
   }
 }
 
@@ -1,13 +1,101 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include "util/internal/util.h"
+
+// Operation counters are kept in debug builds, and can be turned on in
+// optimized builds with -DUTIL_RB_TREE_COUNTERS=1. When off, they cost nothing.
+#ifndef UTIL_RB_TREE_COUNTERS
+#ifdef UTIL_NDEBUG
+#define UTIL_RB_TREE_COUNTERS 0
+#else
+#define UTIL_RB_TREE_COUNTERS 1
+#endif
+#endif
 
 namespace util {
 
+class RbNode;
+
+inline constexpr bool kRbTreeCountersEnabled = UTIL_RB_TREE_COUNTERS;
+
+// Counts of the work done by `RbTree` operations on the calling thread, over
+// all trees.
+struct RbTreeCounters {
+  // Single rotations.
+  uint64_t rotations_left = 0;
+  uint64_t rotations_right = 0;
+  // Double rotations, of a child and then its parent.
+  uint64_t rotations_left_right = 0;
+  uint64_t rotations_right_left = 0;
+
+  // Iterations of the rebalancing loops after an insertion and a removal.
+  uint64_t insert_fix_iterations = 0;
+  uint64_t delete_fix_iterations = 0;
+
+  uint64_t inserts = 0;
+  uint64_t insert_comparisons = 0;
+  // Includes each key of `LowerBoundBatch`.
+  uint64_t lower_bounds = 0;
+  uint64_t lower_bound_comparisons = 0;
+
+  uint64_t Rotations() const {
+    return rotations_left + rotations_right + rotations_left_right +
+           rotations_right_left;
+  }
+};
+
+// Returns the counters of the calling thread, which are all zero if counters
+// are not enabled.
+RbTreeCounters GetRbTreeCounters();
+
+void ResetRbTreeCounters();
+
+// The shape of a tree, as computed by `RbTree::Stats`.
+struct RbTreeStats {
+  size_t size = 0;
+  // The number of nodes on the longest path from the root to a leaf.
+  size_t height = 0;
+  // The number of black nodes on any path from the root to a leaf.
+  size_t black_height = 0;
+  // `depth_histogram[d]` is the number of nodes at depth d, with the root at
+  // depth 0.
+  std::vector<size_t> depth_histogram;
+
+  // The mean number of nodes visited by a successful lookup.
+  double MeanDepth() const;
+};
+
+namespace internal {
+
+struct AtomicRbNodeLinks;
+struct RbNodeLinks;
+
+extern constinit thread_local RbTreeCounters rb_tree_counters;
+
+inline void CountRbTree(uint64_t RbTreeCounters::*counter, uint64_t n = 1) {
+  if constexpr (kRbTreeCountersEnabled) {
+    rb_tree_counters.*counter += n;
+  }
+}
+
+RbTreeStats ComputeRbTreeStats(const RbNode* root);
+
+}  // namespace internal
+
 class RbNode {
   template <typename T, typename Cmp>
   friend class RbTree;
+  friend struct internal::AtomicRbNodeLinks;
+  friend struct internal::RbNodeLinks;
 
  public:
   RbNode() = default;
@@ -58,28 +146,6 @@ class RbNode {
   RbNode& operator=(const RbNode&) = default;
   RbNode& operator=(RbNode&&) = default;
 
-  // Rotate left about `this`. Pass the right child of `this` if already loaded
-  // into a variable.
-  void RotateLeft(RbNode* right);
-
-  // Rotate right about `this`. Pass the left child of `this` if already loaded
-  // into a variable.
-  void RotateRight(RbNode* left);
-
-  // Equivalent to:
-  // this->RotateLeft(right);
-  // parent->RotateRight(right);
-  //
-  // `this` is the left child of parent, and right is the right child of `this`.
-  void RotateLeftRight(RbNode* parent, RbNode* right);
-
-  // Equivalent to:
-  // this->RotateRight(left);
-  // parent->RotateLeft(left);
-  //
-  // `this` is the right child of parent, and left is the left child of `this`.
-  void RotateRightLeft(RbNode* parent, RbNode* left);
-
   // Inserts this node to the left of `node`, fixing the tree as necessary.
   void InsertLeft(RbNode* node, const RbNode* root);
 
@@ -89,6 +155,31 @@ class RbNode {
   // Removes this node, fixing the tree as necessary.
   void Remove(const RbNode* root) const;
 
+  // Unlinks this node and the nodes after it up to, but excluding, `last` (or
+  // to the end of the tree if `last` is null), and returns them as an
+  // unbalanced tree rooted at this node.
+  RbNode* DetachRange(RbNode* last, const RbNode* root);
+
+  // Builds a balanced tree from nodes appended in order, and appends it to the
+  // end of an existing tree.
+  class Appender {
+   public:
+    void Append(RbNode* node);
+
+    // Appends the nodes to the end of the tree under `root`.
+    void Finish(const RbNode* root);
+
+   private:
+    // Bounds the black height of the tree built.
+    static constexpr size_t kMaxBlackHeight = 64;
+
+    // The first node is held out to join the built tree to the existing one.
+    RbNode* first_ = nullptr;
+    RbNode* trees_[kMaxBlackHeight];
+    RbNode* roots_[kMaxBlackHeight];
+    size_t size_ = 0;
+  };
+
   RbNode* Left() {
     return left_;
   }
@@ -101,32 +192,17 @@ class RbNode {
     return parent_;
   }
 
-  void MakeRed() {
-    red_ = true;
-  }
-
-  void MakeBlack() {
-    red_ = false;
+  void SetLeft(RbNode* node) {
+    left_ = node;
+    if (node != nullptr) {
+      node->parent_ = this;
+    }
   }
 
-  void SetLeft(RbNode* node);
-
-  void SetRight(RbNode* node);
-
-  void SetParentOf(const RbNode* node);
-
-  // Detaches this RbNode from its parent, replacing it with `new_child`. Either
-  // `parent_` or `new_child` may be null. This does not modify `this`.
-  void DetachParent(RbNode* new_child) const;
-
   RbNode* LeftmostChild() {
     return left_ != nullptr ? left_->LeftmostChild() : this;
   }
 
-  RbNode* RightmostChild() {
-    return right_ != nullptr ? right_->RightmostChild() : this;
-  }
-
   void Reset() {
     left_ = nullptr;
     right_ = nullptr;
@@ -134,13 +210,6 @@ class RbNode {
     red_ = false;
   }
 
-  static void InsertFix(RbNode* node, const RbNode* root);
-
-  // Fixes a node `node` which has a black height of 1 less than it should. The
-  // subtree rooted at `node` should still be a valid red-black tree (except
-  // `node` may be red).
-  static void DeleteFix(RbNode* node, RbNode* parent, const RbNode* root);
-
   RbNode* left_ = nullptr;
   RbNode* right_ = nullptr;
   RbNode* parent_ = nullptr;
@@ -172,6 +241,7 @@ class RbTree {
   }
 
   void Insert(T* item) {
+    internal::CountRbTree(&RbTreeCounters::inserts);
     if (Root() == nullptr) {
       auto* node = static_cast<RbNode*>(item);
       node->Reset();
@@ -181,13 +251,13 @@ class RbTree {
     }
 
     RbNode* parent = Root();
-    for (RbNode* node; (node = Cmp{}(*item, *static_cast<T*>(parent))
-                                   ? parent->left_
-                                   : parent->right_) != nullptr;
+    for (RbNode* node; (node = InsertLess(item, parent) ? parent->left_
+                                                        : parent->right_) !=
+                       nullptr;
          parent = node)
       ;
 
-    if (Cmp{}(*item, *static_cast<T*>(parent))) {
+    if (InsertLess(item, parent)) {
       item->RbNode::InsertLeft(parent, RootSentinel());
     } else {
       item->RbNode::InsertRight(parent, RootSentinel());
@@ -200,13 +270,129 @@ class RbTree {
     size_--;
   }
 
+  // Appends elements to the end of the tree without comparing them, in O(1)
+  // amortized time each. Elements must be appended in order, and after all
+  // elements already in the tree. They are linked into the tree, balanced, by
+  // `Finish`, and the tree must not be used until then.
+  class Appender {
+   public:
+    explicit Appender(RbTree& tree) : tree_(tree) {}
+
+    Appender(const Appender&) = delete;
+    Appender& operator=(const Appender&) = delete;
+
+    void Append(T* item) {
+      appender_.Append(item);
+      size_++;
+    }
+
+    void Finish() {
+      appender_.Finish(tree_.RootSentinel());
+      tree_.size_ += size_;
+    }
+
+   private:
+    RbTree& tree_;
+    RbNode::Appender appender_;
+    size_t size_ = 0;
+  };
+
+  // Removes the elements from `first` up to, but excluding, `last` (or to the
+  // end of the tree if `last` is null), calling `dispose` on each in order
+  // once it is unlinked. Returns the number of elements removed.
+  //
+  // The range is split out of the tree and the rest joined back together, so
+  // this takes O(log n + k) to remove k elements, rather than a rebalance per
+  // element.
+  template <typename Disposer>
+  size_t EraseRange(T* first, T* last, Disposer dispose) {
+    if (first == last) {
+      return 0;
+    }
+
+    size_t removed = 0;
+    UnlinkInOrder(first->RbNode::DetachRange(last, RootSentinel()),
+                  [&](RbNode* node) {
+                    dispose(static_cast<T*>(node));
+                    removed++;
+                  });
+    size_ -= removed;
+    return removed;
+  }
+
+  // Removes every element that `pred` is true for, calling `dispose` on each
+  // once it is unlinked. `pred` is called once on every element, in order.
+  // Returns the number of elements removed.
+  //
+  // Elements are removed a batch at a time until more than 1/`kRebuildFraction`
+  // of the tree has been removed. From then on, the rest of the tree is
+  // unlinked, and rebuilt from the remaining elements in O(n) instead.
+  template <typename Pred, typename Disposer>
+  size_t RemoveIf(Pred pred, Disposer dispose) {
+    const size_t rebuild_threshold = size_ / kRebuildFraction;
+    size_t removed = 0;
+    RbNode* batch[kRemoveBatchSize];
+    size_t batch_size = 0;
+    auto remove_batch = [&] {
+      for (size_t i = 0; i < batch_size; i++) {
+        Remove(static_cast<T*>(batch[i]));
+        dispose(static_cast<T*>(batch[i]));
+      }
+      removed += batch_size;
+      batch_size = 0;
+    };
+
+    RbNode* stack[kMaxHeight];
+    size_t depth = 0;
+    RbNode* node = Root();
+    while (true) {
+      for (; node != nullptr; node = node->left_) {
+        __builtin_prefetch(node->right_);
+        stack[depth++] = node;
+      }
+      if (depth == 0) {
+        break;
+      }
+
+      node = stack[--depth];
+      if (pred(*static_cast<T*>(node))) {
+        batch[batch_size++] = node;
+      }
+      node = node->right_;
+      if (batch_size < kRemoveBatchSize) {
+        continue;
+      }
+
+      RbNode* next = node != nullptr ? node->LeftmostChild()
+                     : depth != 0    ? stack[depth - 1]
+                                     : nullptr;
+      remove_batch();
+      if (next == nullptr) {
+        break;
+      }
+      if (removed > rebuild_threshold) {
+        return removed + RemoveIfAndRebuild(next, pred, dispose);
+      }
+
+      // Removing the batch may have rotated the nodes on the stack, so resume
+      // the scan from the path to `next`.
+      depth = PathFrom(next, stack);
+      node = nullptr;
+    }
+
+    remove_batch();
+    return removed;
+  }
+
   // Returns the lowest-valued element in the tree that `AtLeast`() is true
   // for.
   template <typename AtLeast>
   T* LowerBound(AtLeast at_least) {
+    internal::CountRbTree(&RbTreeCounters::lower_bounds);
     RbNode* node = Root();
     RbNode* smallest = nullptr;
     while (node != nullptr) {
+      internal::CountRbTree(&RbTreeCounters::lower_bound_comparisons);
       if (at_least(*static_cast<T*>(node))) {
         smallest = node;
         node = node->left_;
@@ -218,11 +404,246 @@ class RbTree {
     return smallest != nullptr ? static_cast<T*>(smallest) : nullptr;
   }
 
+  // Where a lookup ended: the lowest-valued element `AtLeast`() was true for,
+  // as returned by `LowerBound`, and the empty child link below `parent` that
+  // the descent reached, where an element sorting just before `lower_bound`
+  // belongs.
+  struct InsertPosition {
+    T* lower_bound;
+    RbNode* parent;
+    bool right;
+  };
+
+  // As `LowerBound`, but also returns where to insert an element with
+  // `InsertAt`, so that a lookup and an insertion if it fails, such as of a
+  // unique key, take a single descent of the tree.
+  template <typename AtLeast>
+  InsertPosition LowerBoundPosition(AtLeast at_least) {
+    internal::CountRbTree(&RbTreeCounters::lower_bounds);
+    InsertPosition position = { .lower_bound = nullptr,
+                                .parent = nullptr,
+                                .right = false };
+    for (RbNode* node = Root(); node != nullptr;
+         node = position.right ? node->right_ : node->left_) {
+      internal::CountRbTree(&RbTreeCounters::lower_bound_comparisons);
+      position.parent = node;
+      position.right = !at_least(*static_cast<T*>(node));
+      if (!position.right) {
+        position.lower_bound = static_cast<T*>(node);
+      }
+    }
+    return position;
+  }
+
+  // Inserts `item` at `position`, from `LowerBoundPosition` on this tree with
+  // no modifications since. `item` must sort after every element before
+  // `position.lower_bound` and not after it.
+  void InsertAt(T* item, const InsertPosition& position) {
+    internal::CountRbTree(&RbTreeCounters::inserts);
+    if (position.parent == nullptr) {
+      auto* node = static_cast<RbNode*>(item);
+      node->Reset();
+      root_.SetLeft(node);
+    } else if (position.right) {
+      item->RbNode::InsertRight(position.parent, RootSentinel());
+    } else {
+      item->RbNode::InsertLeft(position.parent, RootSentinel());
+    }
+    size_++;
+  }
+
+  // An in-order run of elements, from `first` up to, but excluding, `last`, or
+  // to the end of the tree if `last` is null.
+  struct Range {
+    T* first;
+    T* last;
+  };
+
+  // Splits the tree into consecutive, non-empty ranges, by cutting it at the
+  // nodes in its top ceil(log2(n)) levels. Those levels are full in trees much
+  // larger than `n`, which then give between `n` and `2n` ranges. The ranges
+  // hold subtrees of the same black height, which can still differ several-fold
+  // in size, so callers dividing work between threads should ask for a few
+  // ranges per thread. This takes O(n + log(Size())).
+  std::vector<Range> Partition(size_t n) {
+    std::vector<Range> ranges;
+    if (Root() == nullptr) {
+      return ranges;
+    }
+
+    std::vector<T*> cuts;
+    CollectCuts(Root(), n <= 1 ? 0 : std::bit_width(n - 1), cuts);
+
+    T* first = static_cast<T*>(Root()->LeftmostChild());
+    for (T* cut : cuts) {
+      if (cut != first) {
+        ranges.push_back({ first, cut });
+        first = cut;
+      }
+    }
+    ranges.push_back({ first, nullptr });
+    return ranges;
+  }
+
+  // Computes the shape of the tree, in O(n) without allocating beyond the
+  // histogram.
+  RbTreeStats Stats() const {
+    return internal::ComputeRbTreeStats(Root());
+  }
+
+  // The number of lookups `LowerBoundBatch` keeps in flight at once.
+  static constexpr size_t kLowerBoundBatchWidth = 8;
+
+  // Equivalent to calling `LowerBound` once per key:
+  //   out[i] = LowerBound([&](const T& item) { return at_least(item, keys[i]); })
+  //
+  // Lookups are advanced in lockstep, up to `kLowerBoundBatchWidth` at a time,
+  // and the next node of each lookup is prefetched before stepping the others,
+  // so the cache misses of independent lookups overlap instead of serializing.
+  template <std::ranges::random_access_range Keys, typename AtLeast>
+  void LowerBoundBatch(const Keys& keys, std::span<T*> out, AtLeast at_least) {
+    const size_t num_keys = std::ranges::size(keys);
+    UTIL_DCHECK_EQ(out.size(), num_keys);
+    internal::CountRbTree(&RbTreeCounters::lower_bounds, num_keys);
+    if (Root() == nullptr) {
+      std::fill(out.begin(), out.end(), nullptr);
+      return;
+    }
+
+    struct Probe {
+      RbNode* node;
+      RbNode* smallest;
+      size_t idx;
+    };
+
+    Probe probes[kLowerBoundBatchWidth];
+    size_t num_probes = 0;
+    size_t next_key = 0;
+    for (; num_probes < kLowerBoundBatchWidth && next_key < num_keys;
+         num_probes++, next_key++) {
+      probes[num_probes] = { Root(), nullptr, next_key };
+    }
+
+    while (num_probes != 0) {
+      for (size_t i = 0; i < num_probes;) {
+        Probe& probe = probes[i];
+        internal::CountRbTree(&RbTreeCounters::lower_bound_comparisons);
+        if (at_least(*static_cast<T*>(probe.node), keys[probe.idx])) {
+          probe.smallest = probe.node;
+          probe.node = probe.node->left_;
+        } else {
+          probe.node = probe.node->right_;
+        }
+
+        if (probe.node != nullptr) {
+          __builtin_prefetch(probe.node);
+          i++;
+          continue;
+        }
+
+        out[probe.idx] = static_cast<T*>(probe.smallest);
+        if (next_key < num_keys) {
+          probe = { Root(), nullptr, next_key++ };
+          i++;
+        } else {
+          // Fill this slot with the last probe, which has not been stepped
+          // yet if it comes after `i`.
+          probe = probes[--num_probes];
+        }
+      }
+    }
+  }
+
  private:
+  // `RemoveIf` rebuilds the tree once it has removed more than this fraction
+  // of it.
+  static constexpr size_t kRebuildFraction = 8;
+
+  // The number of elements `RemoveIf` finds before removing them.
+  static constexpr size_t kRemoveBatchSize = 64;
+
+  // Bounds the height of any red-black tree which fits in memory.
+  static constexpr size_t kMaxHeight = 2 * 64;
+
   RbNode* Root() {
     return root_.Left();
   }
 
+  static bool InsertLess(T* item, RbNode* node) {
+    internal::CountRbTree(&RbTreeCounters::insert_comparisons);
+    return Cmp{}(*item, *static_cast<T*>(node));
+  }
+
+  // Calls `visit` on the nodes of the tree rooted at `node` in order, after
+  // reading their links, so `visit` may reuse each node it is passed. The tree
+  // must be no taller than a red-black tree, plus one.
+  template <typename Visit>
+  static void UnlinkInOrder(RbNode* node, Visit visit) {
+    RbNode* stack[kMaxHeight + 1];
+    size_t depth = 0;
+    while (true) {
+      for (; node != nullptr; node = node->left_) {
+        // The right child is not needed until the left subtree has been
+        // visited, so fetch it in the meantime.
+        __builtin_prefetch(node->right_);
+        stack[depth++] = node;
+      }
+      if (depth == 0) {
+        break;
+      }
+
+      node = stack[--depth];
+      RbNode* right = node->right_;
+      visit(node);
+      node = right;
+    }
+  }
+
+  // Appends the nodes in the top `levels` levels under `node` to `cuts`, in
+  // order.
+  static void CollectCuts(RbNode* node, size_t levels, std::vector<T*>& cuts) {
+    if (node == nullptr || levels == 0) {
+      return;
+    }
+    CollectCuts(node->left_, levels - 1, cuts);
+    cuts.push_back(static_cast<T*>(node));
+    CollectCuts(node->right_, levels - 1, cuts);
+  }
+
+  // Fills `stack` with the nodes an in-order scan has yet to visit on the path
+  // from the root to `node`, ending in `node`, and returns their number.
+  size_t PathFrom(RbNode* node, RbNode* stack[]) {
+    size_t depth = 0;
+    stack[depth++] = node;
+    for (RbNode* parent; (parent = node->parent_) != &root_; node = parent) {
+      if (parent->left_ == node) {
+        stack[depth++] = parent;
+      }
+    }
+    std::reverse(stack, stack + depth);
+    return depth;
+  }
+
+  // Removes the elements from `from` onwards that `pred` is true for, by
+  // unlinking them all and rebuilding them from the remaining elements.
+  template <typename Pred, typename Disposer>
+  size_t RemoveIfAndRebuild(RbNode* from, Pred& pred, Disposer& dispose) {
+    RbNode::Appender appender;
+    size_t removed = 0;
+    UnlinkInOrder(from->DetachRange(nullptr, RootSentinel()),
+                  [&](RbNode* node) {
+                    if (pred(*static_cast<T*>(node))) {
+                      dispose(static_cast<T*>(node));
+                      removed++;
+                    } else {
+                      appender.Append(node);
+                    }
+                  });
+    appender.Finish(RootSentinel());
+    size_ -= removed;
+    return removed;
+  }
+
   RbNode root_;
   size_t size_ = 0;
 };
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "absl/container/btree_set.h"
+#include "benchmark/benchmark.h"
+
+#include "util/benchmark_util.h"
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+using Element = BenchmarkElement;
+using ElementTree = BenchmarkRbTree;
+using TestTree = BenchmarkTree<>;
+
+// The number of lookups issued per benchmark iteration.
+constexpr size_t kLookupsPerIteration = 1024;
+
+bool AtLeast(const Element& element, uint64_t key) {
+  return element.key >= key;
+}
+
+void BM_LowerBound(benchmark::State& state) {
+  const size_t n = state.range(0);
+  TestTree test_tree(n, /*key_step=*/2);
+  const std::vector<uint64_t> keys = RandomKeys(kLookupsPerIteration, 2 * n);
+
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(
+          test_tree.tree().LowerBound([key](const Element& element) {
+            return AtLeast(element, key);
+          }));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+void BM_LowerBoundBatch(benchmark::State& state) {
+  const size_t n = state.range(0);
+  TestTree test_tree(n, /*key_step=*/2);
+  const std::vector<uint64_t> keys = RandomKeys(kLookupsPerIteration, 2 * n);
+  std::vector<Element*> out(kLookupsPerIteration);
+
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    test_tree.tree().LowerBoundBatch(keys, out, AtLeast);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+Element* LowerBound(ElementTree& tree, uint64_t key) {
+  return tree.LowerBound(
+      [key](const Element& element) { return AtLeast(element, key); });
+}
+
+// Args: n, the percentage of elements removed.
+//
+// Removes the elements with the lowest keys, as when expiring the oldest
+// entries of a tree keyed by time, with `EraseRange`. The elements are
+// reinserted between iterations.
+void BM_ExpireEraseRange(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const uint64_t end_key = 2 * (n * state.range(1) / 100);
+  TestTree test_tree(n, /*key_step=*/2);
+  ElementTree& tree = test_tree.tree();
+  std::vector<Element*> removed;
+  removed.reserve(n);
+
+  for (auto _ : state) {
+    Element* first = LowerBound(tree, 0);
+    Element* last = LowerBound(tree, end_key);
+    tree.EraseRange(first, last, [&removed](Element* element) {
+      removed.push_back(element);
+    });
+
+    state.PauseTiming();
+    for (Element* element : removed) {
+      tree.Insert(element);
+    }
+    removed.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * end_key / 2);
+}
+
+// The same, calling `Remove` on each element.
+void BM_ExpireRemove(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const uint64_t end_key = 2 * (n * state.range(1) / 100);
+  TestTree test_tree(n, /*key_step=*/2);
+  ElementTree& tree = test_tree.tree();
+  std::vector<Element*> removed;
+  removed.reserve(n);
+
+  for (auto _ : state) {
+    for (Element* element; (element = LowerBound(tree, 0)) != nullptr &&
+                           element->key < end_key;) {
+      tree.Remove(element);
+      removed.push_back(element);
+    }
+
+    state.PauseTiming();
+    for (Element* element : removed) {
+      tree.Insert(element);
+    }
+    removed.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * end_key / 2);
+}
+
+// Args: n, the percentage of elements removed.
+//
+// Removes elements scattered throughout the tree with `RemoveIf`.
+void BM_RemoveIf(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const uint64_t percent = state.range(1);
+  TestTree test_tree(n, /*key_step=*/2);
+  ElementTree& tree = test_tree.tree();
+  std::vector<Element*> removed;
+  removed.reserve(n);
+
+  for (auto _ : state) {
+    tree.RemoveIf(
+        [percent](const Element& element) {
+          return element.key / 2 % 100 < percent;
+        },
+        [&removed](Element* element) { removed.push_back(element); });
+
+    state.PauseTiming();
+    for (Element* element : removed) {
+      tree.Insert(element);
+    }
+    removed.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// The same, iterating over the tree and calling `Remove` on each element.
+void BM_RemoveIfByRemove(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const uint64_t percent = state.range(1);
+  TestTree test_tree(n, /*key_step=*/2);
+  ElementTree& tree = test_tree.tree();
+  std::vector<Element*> removed;
+  removed.reserve(n);
+
+  for (auto _ : state) {
+    const ElementTree& const_tree = tree;
+    for (const RbNode* node = const_tree.Root()->LeftmostChild();
+         node != const_tree.RootSentinel();) {
+      auto* element = const_cast<Element*>(static_cast<const Element*>(node));
+      node = node->Next();
+      if (element->key / 2 % 100 < percent) {
+        tree.Remove(element);
+        removed.push_back(element);
+      }
+    }
+
+    state.PauseTiming();
+    for (Element* element : removed) {
+      tree.Insert(element);
+    }
+    removed.clear();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Sets of keys behind a common interface, to compare `RbTree` with the
+// standard library's node-based tree and absl's B-tree.
+class RbTreeSet {
+ public:
+  explicit RbTreeSet(size_t capacity) : elements_(new Element[capacity]) {}
+
+  void Insert(uint64_t key) {
+    Element* element;
+    if (free_.empty()) {
+      element = &elements_[used_++];
+    } else {
+      element = free_.back();
+      free_.pop_back();
+    }
+    element->key = key;
+    tree_.Insert(element);
+  }
+
+  // Erases the element with the lowest key at least `key`, which must exist.
+  void EraseLowerBound(uint64_t key) {
+    Element* element = util::LowerBound(tree_, key);
+    tree_.Remove(element);
+    free_.push_back(element);
+  }
+
+  const Element* LowerBound(uint64_t key) {
+    return util::LowerBound(tree_, key);
+  }
+
+  uint64_t Sum() const {
+    uint64_t sum = 0;
+    for (const RbNode* node = tree_.Root()->LeftmostChild();
+         node != tree_.RootSentinel(); node = node->Next()) {
+      sum += static_cast<const Element*>(node)->key;
+    }
+    return sum;
+  }
+
+ private:
+  std::unique_ptr<Element[]> elements_;
+  size_t used_ = 0;
+  std::vector<Element*> free_;
+  ElementTree tree_;
+};
+
+template <typename Set>
+class StdSetAdapter {
+ public:
+  explicit StdSetAdapter(size_t /*capacity*/) {}
+
+  void Insert(uint64_t key) {
+    set_.insert(key);
+  }
+
+  void EraseLowerBound(uint64_t key) {
+    set_.erase(set_.lower_bound(key));
+  }
+
+  const uint64_t* LowerBound(uint64_t key) {
+    auto it = set_.lower_bound(key);
+    return it != set_.end() ? &*it : nullptr;
+  }
+
+  uint64_t Sum() const {
+    uint64_t sum = 0;
+    for (uint64_t key : set_) {
+      sum += key;
+    }
+    return sum;
+  }
+
+ private:
+  Set set_;
+};
+
+using StdSet = StdSetAdapter<std::set<uint64_t>>;
+using AbslBtreeSet = StdSetAdapter<absl::btree_set<uint64_t>>;
+
+// The keys 0, 2, 4, ... 2(n - 1) in a random order.
+std::vector<uint64_t> ShuffledEvenKeys(size_t n) {
+  std::vector<uint64_t> keys = ShuffledKeys(n);
+  for (uint64_t& key : keys) {
+    key *= 2;
+  }
+  return keys;
+}
+
+template <typename Set>
+std::unique_ptr<Set> BuildSet(const std::vector<uint64_t>& keys) {
+  auto set = std::make_unique<Set>(keys.size());
+  for (uint64_t key : keys) {
+    set->Insert(key);
+  }
+  return set;
+}
+
+// Args: n.
+//
+// Builds a set of `n` keys inserted in a random order.
+template <typename Set>
+void BM_SetInsert(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::vector<uint64_t> keys = ShuffledEvenKeys(n);
+
+  for (auto _ : state) {
+    std::unique_ptr<Set> set = BuildSet<Set>(keys);
+    benchmark::DoNotOptimize(set.get());
+    state.PauseTiming();
+    set = nullptr;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Args: n.
+//
+// Erases a random key from a set of `n` keys and inserts it back.
+template <typename Set>
+void BM_SetEraseInsert(benchmark::State& state) {
+  const size_t n = state.range(0);
+  std::unique_ptr<Set> set = BuildSet<Set>(ShuffledEvenKeys(n));
+  std::vector<uint64_t> keys = RandomKeys(kLookupsPerIteration, 2 * n);
+  for (uint64_t& key : keys) {
+    key = std::min(key & ~uint64_t{ 1 }, 2 * (n - 1));
+  }
+
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      set->EraseLowerBound(key);
+      set->Insert(key);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+// Args: n.
+template <typename Set>
+void BM_SetLowerBound(benchmark::State& state) {
+  const size_t n = state.range(0);
+  std::unique_ptr<Set> set = BuildSet<Set>(ShuffledEvenKeys(n));
+  const std::vector<uint64_t> keys = RandomKeys(kLookupsPerIteration, 2 * n);
+
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    for (uint64_t key : keys) {
+      benchmark::DoNotOptimize(set->LowerBound(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+// Args: n.
+//
+// Visits every key in order.
+template <typename Set>
+void BM_SetIterate(benchmark::State& state) {
+  const size_t n = state.range(0);
+  std::unique_ptr<Set> set = BuildSet<Set>(ShuffledEvenKeys(n));
+
+  BenchmarkPerfCounters perf(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set->Sum());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+void BulkRemoveArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n", "percent" });
+  for (int64_t n : { 1 << 16, 1 << 20, 10'000'000 }) {
+    for (int64_t percent : { 1, 10, 50 }) {
+      b->Args({ n, percent });
+    }
+  }
+  b->Unit(benchmark::kMillisecond);
+}
+
+// Up to 2^24 elements (640 MB of nodes), well beyond the size of the LLC.
+BENCHMARK(BM_LowerBound)->RangeMultiplier(16)->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_LowerBoundBatch)->RangeMultiplier(16)->Range(1 << 8, 1 << 24);
+BENCHMARK(BM_ExpireEraseRange)->Apply(BulkRemoveArgs);
+BENCHMARK(BM_ExpireRemove)->Apply(BulkRemoveArgs);
+BENCHMARK(BM_RemoveIf)->Apply(BulkRemoveArgs);
+BENCHMARK(BM_RemoveIfByRemove)->Apply(BulkRemoveArgs);
+
+// From L1-resident to DRAM-bound: 2^22 `std::set` nodes take 128 MB.
+#define SET_BENCHMARK(name)                                              \
+  BENCHMARK(name<RbTreeSet>)->RangeMultiplier(16)->Range(1 << 6, 1 << 22); \
+  BENCHMARK(name<StdSet>)->RangeMultiplier(16)->Range(1 << 6, 1 << 22);    \
+  BENCHMARK(name<AbslBtreeSet>)->RangeMultiplier(16)->Range(1 << 6, 1 << 22)
+
+SET_BENCHMARK(BM_SetInsert);
+SET_BENCHMARK(BM_SetEraseInsert);
+SET_BENCHMARK(BM_SetLowerBound);
+SET_BENCHMARK(BM_SetIterate);
+
+#undef SET_BENCHMARK
+
+}  // namespace
+
+}  // namespace util
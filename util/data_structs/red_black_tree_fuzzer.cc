@@ -0,0 +1,412 @@
+// Checks `RbTree` against `std::multiset` over traces of operations decoded
+// from the input, and the red-black invariants of the tree after each.
+// Values are single bytes, so that traces are dense with duplicates.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <ostream>
+#include <set>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+
+#include "util/absl_util.h"
+#include "util/data_structs/red_black_tree.h"
+#include "util/fuzz_util.h"
+
+namespace util {
+
+namespace {
+
+struct Element : public RbNode {
+  explicit Element(int val) : val(val) {}
+
+  int val;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.val < e2.val;
+  }
+};
+
+using ElementTree = RbTree<Element, ElementLess>;
+
+struct Op {
+  enum Kind : uint8_t {
+    kInsert,
+    kRemove,
+    kAppend,
+    kLowerBound,
+    kLowerBoundBatch,
+    kEraseRange,
+    kRemoveIf,
+    kPartition,
+    kNumKinds,
+  };
+
+  Kind kind;
+  // The operands: the value to insert, remove or look up, the bounds of the
+  // range to erase, the modulus and remainder of the values to remove, or the
+  // number of ranges to partition into.
+  int a = 0;
+  int b = 0;
+  // The keys to look up, or the increments between values to append.
+  std::vector<int> values;
+};
+
+std::ostream& operator<<(std::ostream& os, const std::vector<int>& values) {
+  os << "{";
+  for (size_t i = 0; i < values.size(); i++) {
+    os << (i == 0 ? "" : ", ") << values[i];
+  }
+  return os << "}";
+}
+
+std::ostream& operator<<(std::ostream& os, const Op& op) {
+  switch (op.kind) {
+    case Op::kInsert:
+      return os << "Insert(" << op.a << ")";
+    case Op::kRemove:
+      return os << "Remove(LowerBound(" << op.a << "))";
+    case Op::kAppend:
+      return os << "Append(increments " << op.values << ")";
+    case Op::kLowerBound:
+      return os << "LowerBound(" << op.a << ")";
+    case Op::kLowerBoundBatch:
+      return os << "LowerBoundBatch(" << op.values << ")";
+    case Op::kEraseRange:
+      return os << "EraseRange(LowerBound(" << op.a << "), LowerBound(" << op.b
+                << "))";
+    case Op::kRemoveIf:
+      return os << "RemoveIf(val % " << op.a << " == " << op.b << ")";
+    case Op::kPartition:
+      return os << "Partition(" << op.a << ")";
+    case Op::kNumKinds:
+      break;
+  }
+  return os << "?";
+}
+
+Op DecodeOp(FuzzInput& input) {
+  Op op = { .kind = static_cast<Op::Kind>(input.Below(Op::kNumKinds)) };
+  switch (op.kind) {
+    case Op::kInsert:
+    case Op::kRemove:
+    case Op::kLowerBound:
+      op.a = input.Byte();
+      break;
+    case Op::kAppend:
+      op.values.resize(input.Below(16) + 1);
+      for (int& increment : op.values) {
+        increment = static_cast<int>(input.Below(4));
+      }
+      break;
+    case Op::kLowerBoundBatch:
+      op.values.resize(
+          input.Below(2 * ElementTree::kLowerBoundBatchWidth + 1));
+      for (int& key : op.values) {
+        key = input.Byte();
+      }
+      break;
+    case Op::kEraseRange:
+      op.a = input.Byte();
+      op.b = input.Byte();
+      if (op.b < op.a) {
+        std::swap(op.a, op.b);
+      }
+      break;
+    case Op::kRemoveIf:
+      op.a = static_cast<int>(input.Below(8)) + 1;
+      op.b = static_cast<int>(input.Below(op.a));
+      break;
+    case Op::kPartition:
+      op.a = static_cast<int>(input.Below(16)) + 1;
+      break;
+    case Op::kNumKinds:
+      break;
+  }
+  return op;
+}
+
+class TreeHarness {
+ public:
+  absl::Status Run(const Op& op) {
+    switch (op.kind) {
+      case Op::kInsert:
+        tree_.Insert(&elements_.emplace_back(op.a));
+        expected_.insert(op.a);
+        return absl::OkStatus();
+      case Op::kRemove: {
+        Element* element = LowerBound(op.a);
+        const auto it = expected_.lower_bound(op.a);
+        RETURN_IF_ERROR(CheckFound(op.a, element, it));
+        if (element != nullptr) {
+          tree_.Remove(element);
+          expected_.erase(it);
+        }
+        return absl::OkStatus();
+      }
+      case Op::kAppend: {
+        ElementTree::Appender appender(tree_);
+        int val = expected_.empty() ? 0 : *expected_.rbegin();
+        for (int increment : op.values) {
+          val += increment;
+          appender.Append(&elements_.emplace_back(val));
+          expected_.insert(expected_.end(), val);
+        }
+        appender.Finish();
+        return absl::OkStatus();
+      }
+      case Op::kLowerBound:
+        return CheckFound(op.a, LowerBound(op.a), expected_.lower_bound(op.a));
+      case Op::kLowerBoundBatch: {
+        std::vector<Element*> out(op.values.size());
+        tree_.LowerBoundBatch(op.values, out,
+                              [](const Element& element, int key) {
+                                return element.val >= key;
+                              });
+        for (size_t i = 0; i < op.values.size(); i++) {
+          RETURN_IF_ERROR(CheckFound(op.values[i], out[i],
+                                     expected_.lower_bound(op.values[i])));
+        }
+        return absl::OkStatus();
+      }
+      case Op::kEraseRange:
+        return EraseRange(op.a, op.b);
+      case Op::kRemoveIf:
+        return RemoveIf(op.a, op.b);
+      case Op::kPartition:
+        return Partition(static_cast<size_t>(op.a));
+      case Op::kNumKinds:
+        break;
+    }
+    return absl::OkStatus();
+  }
+
+  // Checks the invariants of the tree, and that it holds the expected values
+  // in order.
+  absl::Status Validate() const {
+    if (tree_.Size() != expected_.size()) {
+      return absl::InternalError(absl::StrCat(
+          "Size() is ", tree_.Size(), ", expected ", expected_.size()));
+    }
+    if (tree_.Root() == nullptr) {
+      return expected_.empty()
+                 ? absl::OkStatus()
+                 : absl::InternalError("Found no root in non-empty tree");
+    }
+    if (tree_.Root()->Parent() != tree_.RootSentinel()) {
+      return absl::InternalError("Found root with parent not the sentinel");
+    }
+    RETURN_IF_ERROR(ValidateNode(tree_.Root()).status());
+
+    const std::vector<int> values = Values(tree_.Root()->LeftmostChild());
+    if (!std::equal(values.begin(), values.end(), expected_.begin(),
+                    expected_.end())) {
+      return absl::InternalError("Found values differing in order");
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // If valid, returns the black height of the subtree under `node`.
+  static absl::StatusOr<size_t> ValidateNode(const RbNode* node) {
+    if (node == nullptr) {
+      return 0;
+    }
+    for (const RbNode* child : { node->Left(), node->Right() }) {
+      if (child == nullptr) {
+        continue;
+      }
+      if (child->Parent() != node) {
+        return absl::InternalError(absl::StrCat(
+            "Found child of ", Val(node), " with parent incorrect"));
+      }
+      if (node->IsRed() && child->IsRed()) {
+        return absl::InternalError(
+            absl::StrCat("Found red child of red node ", Val(node)));
+      }
+    }
+
+    DEFINE_OR_RETURN(size_t, left_height, ValidateNode(node->Left()));
+    DEFINE_OR_RETURN(size_t, right_height, ValidateNode(node->Right()));
+    if (left_height != right_height) {
+      return absl::InternalError(
+          absl::StrCat("Found unequal black heights under ", Val(node), ": ",
+                       left_height, " vs ", right_height));
+    }
+    return left_height + (node->IsRed() ? 0 : 1);
+  }
+
+  static int Val(const RbNode* node) {
+    return static_cast<const Element*>(node)->val;
+  }
+
+  // The values from `first` up to, but excluding, `last`, or to the end of the
+  // tree if `last` is null. Stops after more values than the tree holds, in
+  // case the links form a cycle.
+  std::vector<int> Values(const RbNode* first,
+                          const RbNode* last = nullptr) const {
+    if (last == nullptr) {
+      last = tree_.RootSentinel();
+    }
+    std::vector<int> values;
+    for (const RbNode* node = first;
+         node != last && values.size() <= tree_.Size(); node = node->Next()) {
+      values.push_back(Val(node));
+    }
+    return values;
+  }
+
+  Element* LowerBound(int key) {
+    return tree_.LowerBound([key](const Element& element) {
+      return element.val >= key;
+    });
+  }
+
+  // Checks a lower bound of `key` in the tree against the expected one.
+  absl::Status CheckFound(int key, const Element* found,
+                          std::multiset<int>::const_iterator expected) const {
+    const bool matches = expected == expected_.end()
+                             ? found == nullptr
+                             : found != nullptr && found->val == *expected;
+    if (matches) {
+      return absl::OkStatus();
+    }
+    return absl::InternalError(absl::StrCat(
+        "LowerBound(", key, ") is ",
+        found == nullptr ? "none" : absl::StrCat(found->val), ", expected ",
+        expected == expected_.end() ? "none" : absl::StrCat(*expected)));
+  }
+
+  absl::Status EraseRange(int lo, int hi) {
+    const auto expected_first = expected_.lower_bound(lo);
+    const auto expected_last = expected_.lower_bound(hi);
+    const std::vector<int> expected_erased(expected_first, expected_last);
+
+    std::vector<int> erased;
+    const size_t removed = tree_.EraseRange(
+        LowerBound(lo), LowerBound(hi),
+        [&](Element* element) { erased.push_back(element->val); });
+    expected_.erase(expected_first, expected_last);
+    if (removed != erased.size() || erased != expected_erased) {
+      return absl::InternalError(
+          absl::StrCat("EraseRange removed ", removed, " values, disposed ",
+                       erased.size(), ", expected ", expected_erased.size()));
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status RemoveIf(int modulus, int remainder) {
+    const std::vector<int> expected_visited(expected_.begin(), expected_.end());
+    std::vector<int> expected_removed;
+    for (int val : expected_visited) {
+      if (val % modulus == remainder) {
+        expected_removed.push_back(val);
+      }
+    }
+
+    std::vector<int> visited;
+    std::vector<int> removed;
+    const size_t num_removed = tree_.RemoveIf(
+        [&](const Element& element) {
+          visited.push_back(element.val);
+          return element.val % modulus == remainder;
+        },
+        [&](Element* element) { removed.push_back(element->val); });
+    std::erase_if(expected_,
+                  [&](int val) { return val % modulus == remainder; });
+
+    if (visited != expected_visited) {
+      return absl::InternalError(
+          "RemoveIf did not call its predicate once per value in order");
+    }
+    // The disposal order is unspecified.
+    std::sort(removed.begin(), removed.end());
+    if (num_removed != removed.size() || removed != expected_removed) {
+      return absl::InternalError(absl::StrCat(
+          "RemoveIf removed ", num_removed, " values, disposed ",
+          removed.size(), ", expected ", expected_removed.size()));
+    }
+    return absl::OkStatus();
+  }
+
+  // Checks that the ranges are non-empty, and together cover the tree in
+  // order.
+  absl::Status Partition(size_t n) {
+    const std::vector<ElementTree::Range> ranges = tree_.Partition(n);
+    const RbNode* root = std::as_const(tree_).Root();
+    if (root == nullptr) {
+      return ranges.empty() ? absl::OkStatus()
+                            : absl::InternalError(
+                                  "Partition of an empty tree is non-empty");
+    }
+    if (ranges.empty() || ranges.size() > 2 * n) {
+      return absl::InternalError(absl::StrCat(
+          "Partition(", n, ") gave ", ranges.size(), " ranges"));
+    }
+    if (ranges.front().first != root->LeftmostChild() ||
+        ranges.back().last != nullptr) {
+      return absl::InternalError("Partition does not cover the tree");
+    }
+
+    std::vector<int> values;
+    for (size_t i = 0; i < ranges.size(); i++) {
+      if (i != 0 && ranges[i].first != ranges[i - 1].last) {
+        return absl::InternalError("Partition ranges are not consecutive");
+      }
+      const std::vector<int> range = Values(ranges[i].first, ranges[i].last);
+      if (range.empty()) {
+        return absl::InternalError("Partition range is empty");
+      }
+      values.insert(values.end(), range.begin(), range.end());
+    }
+    if (!std::equal(values.begin(), values.end(), expected_.begin(),
+                    expected_.end())) {
+      return absl::InternalError("Partition ranges differ from the tree");
+    }
+    return absl::OkStatus();
+  }
+
+  // Owns every element ever inserted, and outlives the tree.
+  std::deque<Element> elements_;
+  ElementTree tree_;
+  std::multiset<int> expected_;
+};
+
+absl::Status RunTrace(std::span<const Op> ops) {
+  TreeHarness harness;
+  for (size_t i = 0; i < ops.size(); i++) {
+    absl::Status status = harness.Run(ops[i]);
+    if (status.ok()) {
+      status = harness.Validate();
+    }
+    if (!status.ok()) {
+      return absl::InternalError(
+          absl::StrCat("op ", i, ": ", status.message()));
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+}  // namespace util
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  util::FuzzInput input(data, size);
+  std::vector<util::Op> ops;
+  while (!input.empty()) {
+    ops.push_back(util::DecodeOp(input));
+  }
+  util::CheckTrace<util::Op>(ops, util::RunTrace);
+  return 0;
+}
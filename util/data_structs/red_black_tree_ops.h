@@ -0,0 +1,656 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "util/internal/util.h"
+
+namespace util {
+
+namespace internal {
+
+// The rebalancing steps counted by `Links::Count`.
+enum class RbOpsEvent {
+  kRotateLeft,
+  kRotateRight,
+  kRotateLeftRight,
+  kRotateRightLeft,
+  kInsertFixIteration,
+  kDeleteFixIteration,
+};
+
+// The red-black tree balancing algorithms, written against a link-access
+// policy so that they can run on any node representation.
+//
+// `Links` must provide:
+//   using Ref = ...;              // A cheap-to-copy handle to a node.
+//   Ref Null() const;             // The handle for no node.
+//   Ref Left(Ref node) const;
+//   Ref Right(Ref node) const;
+//   Ref Parent(Ref node) const;
+//   bool IsRed(Ref node) const;
+//   void SetLeft(Ref node, Ref left);
+//   void SetRight(Ref node, Ref right);
+//   void SetParent(Ref node, Ref parent);
+//   void SetRed(Ref node, bool red);
+//
+// `Links` may also provide `void Update(Ref node)`, which recomputes an
+// augmented value of `node` from its own data and its children, such as the
+// largest key in its subtree. `InsertLeft`, `InsertRight` and `Remove` keep
+// it up to date on every node, and `Propagate` restores it after the data of a
+// node changes. The other algorithms do not maintain it.
+//
+// `Links` may also provide `void Count(RbOpsEvent event)`, which is called on
+// every rotation and rebalancing step, for instrumentation.
+//
+// Trees are rooted at the left child of a root sentinel node, which is passed
+// as `root` to the algorithms and whose parent is null.
+template <typename Links>
+class RbOps {
+ public:
+  using Ref = typename Links::Ref;
+
+  explicit RbOps(Links links) : links_(std::move(links)) {}
+
+  // Inserts `n` as the left child of `node`, fixing the tree as necessary.
+  void InsertLeft(Ref n, Ref node, Ref root);
+
+  // Inserts `n` as the right child of `node`, fixing the tree as necessary.
+  void InsertRight(Ref n, Ref node, Ref root);
+
+  // Removes `n`, fixing the tree as necessary.
+  void Remove(Ref n, Ref root);
+
+  // Calls `Update` on `n` and each of its ancestors below `root`, bottom-up.
+  void Propagate(Ref n, Ref root) {
+    if constexpr (kAugmented) {
+      for (; n != root; n = Parent(n)) {
+        links_.Update(n);
+      }
+    }
+  }
+
+  // Unlinks the nodes from `first` up to, but excluding, `last` (or to the end
+  // of the tree if `last` is null), and returns them as a tree rooted at
+  // `first`. The returned tree is ordered but not balanced, and its root has a
+  // null parent.
+  //
+  // The tree is split around `first` and `last`, and the outer parts are
+  // joined back together, which takes O(log n) however many nodes are unlinked.
+  Ref DetachRange(Ref first, Ref last, Ref root);
+
+  // Appends `n` to a tree being built from nodes in order, of which `size`
+  // have been appended so far. Like a binary counter, for each bit h set in
+  // `size`, `trees[h]` holds a perfect black tree of black height h, which is
+  // followed in order by the node `roots[h]`. Higher levels come first.
+  //
+  // This takes O(1) amortized time, and only touches nodes appended before.
+  void BuildAppend(Ref n, Ref trees[], Ref roots[], size_t size);
+
+  // Appends `pivot` and then the nodes of a tree built by `BuildAppend` to the
+  // end of the tree under `root`, in O(log n).
+  void BuildJoin(Ref root, Ref pivot, const Ref trees[], const Ref roots[],
+                 size_t size);
+
+ private:
+  // A tree which is not linked to a root sentinel, so its root has a null
+  // parent. The root is always black.
+  struct Subtree {
+    Ref root;
+    size_t black_height;
+  };
+
+  static constexpr bool kAugmented =
+      requires(Links links, Ref n) { links.Update(n); };
+
+  static constexpr bool kCounted =
+      requires(Links links) { links.Count(RbOpsEvent::kRotateLeft); };
+
+  void Update(Ref n) {
+    if constexpr (kAugmented) {
+      links_.Update(n);
+    }
+  }
+
+  void Count(RbOpsEvent event) {
+    if constexpr (kCounted) {
+      links_.Count(event);
+    }
+  }
+
+  Ref Null() const {
+    return links_.Null();
+  }
+
+  Ref Left(Ref n) const {
+    return links_.Left(n);
+  }
+
+  Ref Right(Ref n) const {
+    return links_.Right(n);
+  }
+
+  Ref Parent(Ref n) const {
+    return links_.Parent(n);
+  }
+
+  bool IsRed(Ref n) const {
+    return links_.IsRed(n);
+  }
+
+  bool IsBlack(Ref n) const {
+    return !links_.IsRed(n);
+  }
+
+  bool IsRedRef(Ref n) const {
+    return n != Null() && IsRed(n);
+  }
+
+  bool IsBlackRef(Ref n) const {
+    return n == Null() || IsBlack(n);
+  }
+
+  void MakeRed(Ref n) {
+    links_.SetRed(n, true);
+  }
+
+  void MakeBlack(Ref n) {
+    links_.SetRed(n, false);
+  }
+
+  Ref RightmostChild(Ref n) const {
+    for (Ref right; (right = Right(n)) != Null(); n = right)
+      ;
+    return n;
+  }
+
+  Ref Child(Ref n, bool right) const {
+    return right ? Right(n) : Left(n);
+  }
+
+  // The number of black nodes on a path from `n` (inclusive) to a leaf.
+  size_t BlackHeight(Ref n) const {
+    size_t height = 0;
+    for (; n != Null(); n = Left(n)) {
+      height += IsBlack(n);
+    }
+    return height;
+  }
+
+  // Rotate left about `n`. `right` is the right child of `n`.
+  void RotateLeft(Ref n, Ref right);
+
+  // Rotate right about `n`. `left` is the left child of `n`.
+  void RotateRight(Ref n, Ref left);
+
+  // Equivalent to:
+  // RotateLeft(n, right);
+  // RotateRight(parent, right);
+  //
+  // `n` is the left child of parent, and right is the right child of `n`.
+  void RotateLeftRight(Ref n, Ref parent, Ref right);
+
+  // Equivalent to:
+  // RotateRight(n, left);
+  // RotateLeft(parent, left);
+  //
+  // `n` is the right child of parent, and left is the left child of `n`.
+  void RotateRightLeft(Ref n, Ref parent, Ref left);
+
+  void SetLeftChild(Ref n, Ref child);
+
+  void SetRightChild(Ref n, Ref child);
+
+  void SetChild(Ref n, bool right, Ref child) {
+    if (right) {
+      SetRightChild(n, child);
+    } else {
+      SetLeftChild(n, child);
+    }
+  }
+
+  // Replaces `node` with `n` in the parent of `node`.
+  void SetParentOf(Ref n, Ref node);
+
+  // Detaches `n` from its parent, replacing it with `new_child`. Either the
+  // parent of `n` or `new_child` may be null. This does not modify `n`.
+  void DetachParent(Ref n, Ref new_child);
+
+  // Returns true if this colored the root black from red, which increases the
+  // black height of the tree.
+  bool InsertFix(Ref n, Ref root);
+
+  // Fixes a node `n` which has a black height of 1 less than it should. The
+  // subtree rooted at `n` should still be a valid red-black tree (except `n`
+  // may be red).
+  void DeleteFix(Ref n, Ref p, Ref root);
+
+  // Detaches `n`, which has a black height of `black_height`, from its parent,
+  // making it the root of its own subtree.
+  Subtree MakeSubtree(Ref n, size_t black_height);
+
+  // Returns the tree of the nodes in `left`, then `k`, then the nodes in
+  // `right`. This takes O(1 + |difference in black height|).
+  Subtree Join(Subtree left, Ref k, Subtree right);
+
+  // Splits the tree containing `x` into the nodes before `x` and the nodes
+  // after it, leaving `x` unlinked. `top` is the parent of the root of the
+  // tree.
+  std::pair<Subtree, Subtree> Split(Ref x, Ref top);
+
+  Links links_;
+};
+
+template <typename Links>
+void RbOps<Links>::RotateLeft(Ref n, Ref right) {
+  Count(RbOpsEvent::kRotateLeft);
+  UTIL_DCHECK(right == Right(n));
+  SetRightChild(n, Left(right));
+  SetParentOf(right, n);
+  links_.SetParent(n, right);
+  links_.SetLeft(right, n);
+  Update(n);
+  Update(right);
+}
+
+template <typename Links>
+void RbOps<Links>::RotateRight(Ref n, Ref left) {
+  Count(RbOpsEvent::kRotateRight);
+  UTIL_DCHECK(left == Left(n));
+  SetLeftChild(n, Right(left));
+  SetParentOf(left, n);
+  links_.SetParent(n, left);
+  links_.SetRight(left, n);
+  Update(n);
+  Update(left);
+}
+
+template <typename Links>
+void RbOps<Links>::RotateLeftRight(Ref n, Ref parent, Ref right) {
+  Count(RbOpsEvent::kRotateLeftRight);
+  UTIL_DCHECK(parent == Parent(n));
+  UTIL_DCHECK(Left(parent) == n);
+  UTIL_DCHECK(right == Right(n));
+  SetRightChild(n, Left(right));
+  SetLeftChild(parent, Right(right));
+  SetParentOf(right, parent);
+  SetLeftChild(right, n);
+  SetRightChild(right, parent);
+  Update(n);
+  Update(parent);
+  Update(right);
+}
+
+template <typename Links>
+void RbOps<Links>::RotateRightLeft(Ref n, Ref parent, Ref left) {
+  Count(RbOpsEvent::kRotateRightLeft);
+  UTIL_DCHECK(parent == Parent(n));
+  UTIL_DCHECK(Right(parent) == n);
+  UTIL_DCHECK(left == Left(n));
+  SetLeftChild(n, Right(left));
+  SetRightChild(parent, Left(left));
+  SetParentOf(left, parent);
+  SetRightChild(left, n);
+  SetLeftChild(left, parent);
+  Update(n);
+  Update(parent);
+  Update(left);
+}
+
+template <typename Links>
+void RbOps<Links>::InsertLeft(Ref n, Ref node, Ref root) {
+  UTIL_DCHECK(Left(node) == Null());
+  // Clear any links left over from a previous insertion of this node before
+  // linking it into the tree.
+  links_.SetLeft(n, Null());
+  links_.SetRight(n, Null());
+  links_.SetParent(n, node);
+  MakeRed(n);
+  links_.SetLeft(node, n);
+  // The ancestors of `n` are updated first, so that rotations only need to
+  // update the nodes they move.
+  Propagate(n, root);
+  InsertFix(n, root);
+}
+
+template <typename Links>
+void RbOps<Links>::InsertRight(Ref n, Ref node, Ref root) {
+  UTIL_DCHECK(Right(node) == Null());
+  // Clear any links left over from a previous insertion of this node before
+  // linking it into the tree.
+  links_.SetLeft(n, Null());
+  links_.SetRight(n, Null());
+  links_.SetParent(n, node);
+  MakeRed(n);
+  links_.SetRight(node, n);
+  Propagate(n, root);
+  InsertFix(n, root);
+}
+
+template <typename Links>
+void RbOps<Links>::Remove(Ref n, Ref root) {
+  // The node which will be succeeding the location being removed from the tree.
+  // This is where we start fixing from.
+  Ref successor;
+  // The parent of `successor`.
+  Ref parent;
+  bool deleted_black;
+  const Ref left = Left(n);
+  const Ref right = Right(n);
+  if (left == Null()) {
+    successor = right;
+    parent = Parent(n);
+    deleted_black = IsBlack(n);
+    DetachParent(n, right);
+  } else if (right == Null()) {
+    successor = left;
+    parent = Parent(n);
+    deleted_black = IsBlack(n);
+    DetachParent(n, left);
+  } else {
+    Ref scapegoat = RightmostChild(left);
+    successor = Left(scapegoat);
+    parent = Parent(scapegoat) != n ? Parent(scapegoat) : scapegoat;
+    deleted_black = IsBlack(scapegoat);
+
+    // successor does not have a right child. Detach it from its parent and
+    // replace it with its left (only) child.
+    DetachParent(scapegoat, successor);
+
+    // Replace this node with the successor. The left child of `n` may have
+    // changed if it was `scapegoat`.
+    SetLeftChild(scapegoat, Left(n));
+    SetRightChild(scapegoat, right);
+    SetParentOf(scapegoat, n);
+    links_.SetRed(scapegoat, IsRed(n));
+  }
+
+  if (deleted_black) {
+    DeleteFix(successor, parent, root);
+  }
+
+  // Rotations may have updated nodes from stale children, but those nodes all
+  // stayed ancestors of `successor`'s position, as did `parent`.
+  Propagate(parent, root);
+}
+
+template <typename Links>
+typename RbOps<Links>::Ref RbOps<Links>::DetachRange(Ref first, Ref last,
+                                                     Ref root) {
+  UTIL_DCHECK(first != last);
+  auto [before, after] = Split(first, root);
+  Subtree rest = before;
+  Ref detached = after.root;
+  if (last != Null()) {
+    auto [between, after_last] = Split(last, Null());
+    rest = Join(before, last, after_last);
+    detached = between.root;
+  }
+
+  links_.SetLeft(first, Null());
+  SetRightChild(first, detached);
+  links_.SetParent(first, Null());
+  SetLeftChild(root, rest.root);
+  return first;
+}
+
+template <typename Links>
+void RbOps<Links>::BuildAppend(Ref n, Ref trees[], Ref roots[], size_t size) {
+  // Carry `n` up through the occupied levels, merging each level's tree and
+  // root with the tree built so far.
+  Ref tree = Null();
+  size_t height = 0;
+  for (; (size >> height & 1) != 0; height++) {
+    const Ref root = roots[height];
+    SetLeftChild(root, trees[height]);
+    SetRightChild(root, tree);
+    MakeBlack(root);
+    tree = root;
+  }
+  trees[height] = tree;
+  roots[height] = n;
+}
+
+template <typename Links>
+void RbOps<Links>::BuildJoin(Ref root, Ref pivot, const Ref trees[],
+                             const Ref roots[], size_t size) {
+  Subtree built = { Null(), 0 };
+  for (size_t height = 0; (size >> height) != 0; height++) {
+    if ((size >> height & 1) != 0) {
+      if (trees[height] != Null()) {
+        links_.SetParent(trees[height], Null());
+      }
+      built = Join({ trees[height], height }, roots[height], built);
+    }
+  }
+
+  const Ref tree = Left(root);
+  const Subtree before = MakeSubtree(tree, BlackHeight(tree));
+  SetLeftChild(root, Join(before, pivot, built).root);
+}
+
+template <typename Links>
+auto RbOps<Links>::MakeSubtree(Ref n, size_t black_height) -> Subtree {
+  if (n == Null()) {
+    return { Null(), 0 };
+  }
+
+  links_.SetParent(n, Null());
+  if (IsRed(n)) {
+    MakeBlack(n);
+    black_height++;
+  }
+  return { n, black_height };
+}
+
+template <typename Links>
+auto RbOps<Links>::Join(Subtree left, Ref k, Subtree right) -> Subtree {
+  if (left.black_height == right.black_height) {
+    SetLeftChild(k, left.root);
+    SetRightChild(k, right.root);
+    links_.SetParent(k, Null());
+    MakeBlack(k);
+    return { k, left.black_height + 1 };
+  }
+
+  // Walk down the inner edge of the taller tree to the first black node with
+  // the same black height as the shorter tree, and replace it with `k`, red,
+  // with that node and the shorter tree as its children.
+  const bool left_taller = left.black_height > right.black_height;
+  const Subtree& tall = left_taller ? left : right;
+  const Subtree& small = left_taller ? right : left;
+  Ref parent = Null();
+  Ref node = tall.root;
+  size_t height = tall.black_height;
+  while (height > small.black_height || IsRedRef(node)) {
+    height -= IsBlack(node);
+    parent = node;
+    node = Child(node, left_taller);
+  }
+
+  SetChild(k, !left_taller, node);
+  SetChild(k, left_taller, small.root);
+  MakeRed(k);
+  SetChild(parent, left_taller, k);
+  const bool grew = InsertFix(k, Null());
+
+  // The fix may have rotated a new node to the top of the tree.
+  Ref top = k;
+  for (Ref p; (p = Parent(top)) != Null(); top = p)
+    ;
+  return { top, tall.black_height + grew };
+}
+
+template <typename Links>
+auto RbOps<Links>::Split(Ref x, Ref top) -> std::pair<Subtree, Subtree> {
+  size_t height = BlackHeight(x);
+  Subtree left = MakeSubtree(Left(x), height - IsBlack(x));
+  Subtree right = MakeSubtree(Right(x), height - IsBlack(x));
+
+  // Walk up from `x`, joining each ancestor and its other subtree onto the
+  // side `x` is not on. `height` is the original black height of `n`, which is
+  // also the black height of its sibling.
+  Ref n = x;
+  for (Ref p = Parent(n); p != top;) {
+    const Ref next = Parent(p);
+    const size_t parent_height = height + IsBlack(p);
+    if (Right(p) == n) {
+      left = Join(MakeSubtree(Left(p), height), p, left);
+    } else {
+      right = Join(right, p, MakeSubtree(Right(p), height));
+    }
+    n = p;
+    p = next;
+    height = parent_height;
+  }
+  return { left, right };
+}
+
+template <typename Links>
+void RbOps<Links>::SetLeftChild(Ref n, Ref child) {
+  links_.SetLeft(n, child);
+  if (child != Null()) {
+    links_.SetParent(child, n);
+  }
+}
+
+template <typename Links>
+void RbOps<Links>::SetRightChild(Ref n, Ref child) {
+  links_.SetRight(n, child);
+  if (child != Null()) {
+    links_.SetParent(child, n);
+  }
+}
+
+template <typename Links>
+void RbOps<Links>::SetParentOf(Ref n, Ref node) {
+  const Ref parent = Parent(node);
+  links_.SetParent(n, parent);
+  if (parent != Null()) {
+    if (Left(parent) == node) {
+      links_.SetLeft(parent, n);
+    } else {
+      links_.SetRight(parent, n);
+    }
+  }
+}
+
+template <typename Links>
+void RbOps<Links>::DetachParent(Ref n, Ref new_child) {
+  const Ref parent = Parent(n);
+  if (new_child != Null()) {
+    links_.SetParent(new_child, parent);
+  }
+  if (parent != Null()) {
+    if (Left(parent) == n) {
+      links_.SetLeft(parent, new_child);
+    } else {
+      links_.SetRight(parent, new_child);
+    }
+  }
+}
+
+template <typename Links>
+bool RbOps<Links>::InsertFix(Ref n, Ref root) {
+  Ref p;
+  while ((p = Parent(n)) != root && IsRed(p)) {
+    Count(RbOpsEvent::kInsertFixIteration);
+#define FIX_CHILD(dir, opp)       \
+  Ref a = opp(gp);                \
+  if (IsRedRef(a)) {              \
+    MakeBlack(p);                 \
+    MakeBlack(a);                 \
+    MakeRed(gp);                  \
+    n = gp;                       \
+  } else if (n == dir(p)) {       \
+    MakeBlack(p);                 \
+    MakeRed(gp);                  \
+    Rotate##opp(gp, p);           \
+    n = p;                        \
+    p = Parent(n);                \
+    break;                        \
+  } else {                        \
+    MakeBlack(n);                 \
+    MakeRed(gp);                  \
+    Rotate##dir##opp(p, gp, n);   \
+    p = Parent(n);                \
+    break;                        \
+  }
+
+    Ref gp = Parent(p);
+    if (p == Left(gp)) {
+      FIX_CHILD(Left, Right);
+    } else /* p == Right(gp) */ {
+      FIX_CHILD(Right, Left);
+    }
+
+#undef FIX_CHILD
+  }
+
+  if (p == root && IsRed(n)) {
+    MakeBlack(n);
+    return true;
+  }
+  return false;
+}
+
+template <typename Links>
+void RbOps<Links>::DeleteFix(Ref n, Ref p, Ref root) {
+  while (true) {
+#define FIX_CHILD(dir, opp)                         \
+  Ref s = opp(p);                                   \
+  UTIL_DCHECK(s != Null());                         \
+  if (IsRed(s)) {                                   \
+    MakeRed(p);                                     \
+    MakeBlack(s);                                   \
+    Rotate##dir(p, s);                              \
+    s = opp(p);                                     \
+    UTIL_DCHECK(s != Null());                       \
+  }                                                 \
+  if (IsBlackRef(dir(s)) && IsBlackRef(opp(s))) {   \
+    MakeRed(s);                                     \
+    n = p;                                          \
+    p = Parent(n);                                  \
+  } else if (IsRedRef(opp(s))) {                    \
+    links_.SetRed(s, IsRed(p));                     \
+    MakeBlack(p);                                   \
+    MakeBlack(opp(s));                              \
+    Rotate##dir(p, s);                              \
+    n = s;                                          \
+    p = Parent(n);                                  \
+    break;                                          \
+  } else /* IsRedRef(dir(s)) */ {                   \
+    Ref sd = dir(s);                                \
+    links_.SetRed(sd, IsRed(p));                    \
+    MakeBlack(p);                                   \
+    Rotate##opp##dir(s, p, sd);                     \
+    n = sd;                                         \
+    p = Parent(n);                                  \
+    break;                                          \
+  }
+
+    if (p == root || IsRedRef(n)) {
+      // If we landed on a red node, we can color it black and that will fix
+      // the black defecit. If we happened to land on the root, then we need
+      // to color it black anyway, so this coincidentally covers both cases.
+      if (IsRedRef(n)) {
+        MakeBlack(n);
+      }
+
+      break;
+    }
+
+    Count(RbOpsEvent::kDeleteFixIteration);
+    if (n == Left(p)) {
+      FIX_CHILD(Left, Right);
+    } else /* n == Right(p) */ {
+      FIX_CHILD(Right, Left);
+    }
+
+#undef FIX_CHILD
+  }
+}
+
+}  // namespace internal
+
+}  // namespace util
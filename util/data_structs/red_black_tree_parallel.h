@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/internal/util.h"
+
+namespace util {
+
+namespace internal {
+
+// The number of ranges a tree is split into per thread, so that threads which
+// finish their ranges early can take over more of the work.
+inline constexpr size_t kRbTreeRangesPerThread = 8;
+
+// Calls `visit(i)` for each `i` in `[0, n)`, on up to `num_threads` threads,
+// one of which is the calling thread. Each thread takes the next `i` when it
+// finishes the last.
+template <typename Visit>
+void ParallelFor(size_t num_threads, size_t n, Visit visit) {
+  UTIL_DCHECK(num_threads > 0);
+  std::atomic<size_t> next = 0;
+  auto work = [&next, n, &visit]() {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+      visit(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t num_workers = std::min(num_threads, n);
+  for (size_t t = 1; t < num_workers; t++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+// Calls `fn(T&)` on each element of `range`, in order.
+template <typename T, typename Cmp, typename Fn>
+void ForEachInRange(const RbTree<T, Cmp>& tree,
+                    const typename RbTree<T, Cmp>::Range& range, Fn& fn) {
+  const RbNode* end = range.last != nullptr ? range.last : tree.RootSentinel();
+  for (const RbNode* node = range.first; node != end; node = node->Next()) {
+    fn(*const_cast<T*>(static_cast<const T*>(node)));
+  }
+}
+
+// The result of folding one range, on a cache line of its own so that threads
+// storing the results of neighboring ranges do not share one. This also keeps
+// results which are `bool` from being packed into shared words, which
+// `std::vector<bool>` would do.
+template <typename R>
+struct alignas(64) RbTreeRangeResult {
+  R value;
+};
+
+}  // namespace internal
+
+// Calls `fn(T&)` on every element of `tree`, on `num_threads` threads, one of
+// which is the calling thread. The tree is split with `RbTree::Partition` into
+// a few ranges per thread, which the threads take in turn. `fn` is called
+// concurrently and in no particular order, and must not modify the tree.
+template <typename T, typename Cmp, typename Fn>
+void ParallelForEach(RbTree<T, Cmp>& tree, size_t num_threads, Fn fn) {
+  const std::vector<typename RbTree<T, Cmp>::Range> ranges =
+      tree.Partition(num_threads * internal::kRbTreeRangesPerThread);
+  internal::ParallelFor(num_threads, ranges.size(), [&](size_t i) {
+    internal::ForEachInRange(tree, ranges[i], fn);
+  });
+}
+
+// Folds the elements of `tree` in order, on `num_threads` threads, as with
+// `ParallelForEach`. Each range of the tree is folded from `identity` with
+// `reduce(R, T&) -> R` by the thread that takes it, and the results of the
+// ranges are then folded in order with `combine(R, R) -> R`. So `combine`
+// must be associative, with `identity` as its identity, but need not be
+// commutative.
+template <typename T, typename Cmp, typename R, typename Reduce,
+          typename Combine>
+R ParallelReduce(RbTree<T, Cmp>& tree, size_t num_threads, R identity,
+                 Reduce reduce, Combine combine) {
+  const std::vector<typename RbTree<T, Cmp>::Range> ranges =
+      tree.Partition(num_threads * internal::kRbTreeRangesPerThread);
+  std::vector<internal::RbTreeRangeResult<R>> results(ranges.size(),
+                                                      { identity });
+  internal::ParallelFor(num_threads, ranges.size(), [&](size_t i) {
+    R result = identity;
+    auto fold = [&result, &reduce](T& item) {
+      result = reduce(std::move(result), item);
+    };
+    internal::ForEachInRange(tree, ranges[i], fold);
+    results[i].value = std::move(result);
+  });
+
+  R result = std::move(identity);
+  for (internal::RbTreeRangeResult<R>& range_result : results) {
+    result = combine(std::move(result), std::move(range_result.value));
+  }
+  return result;
+}
+
+}  // namespace util
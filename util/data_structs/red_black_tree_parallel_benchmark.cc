@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/red_black_tree_parallel.h"
+#include "util/data_structs/tree_benchmark_util.h"
+
+namespace util {
+
+namespace {
+
+using Element = BenchmarkElement;
+using ElementTree = BenchmarkRbTree;
+using TestTree = BenchmarkTree<>;
+
+// Trees are shared between benchmarks, since large ones take a long time to
+// build.
+ElementTree& SharedTree(size_t n) {
+  static auto* trees = new std::map<size_t, std::unique_ptr<TestTree>>();
+  std::unique_ptr<TestTree>& tree = (*trees)[n];
+  if (tree == nullptr) {
+    tree = std::make_unique<TestTree>(n, /*key_step=*/1,
+                                      BenchmarkInsertOrder::kByKey);
+  }
+  return tree->tree();
+}
+
+// Args: n.
+//
+// The baseline: sums the keys of the tree on one thread with `Next()`.
+void BM_SerialSum(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const ElementTree& tree = SharedTree(n);
+
+  for (auto _ : state) {
+    uint64_t sum = 0;
+    for (const RbNode* node = tree.Root()->LeftmostChild();
+         node != tree.RootSentinel(); node = node->Next()) {
+      sum += static_cast<const Element*>(node)->key;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Args: n, threads.
+void BM_ParallelSum(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const size_t num_threads = state.range(1);
+  ElementTree& tree = SharedTree(n);
+
+  for (auto _ : state) {
+    const uint64_t sum = ParallelReduce(
+        tree, num_threads, uint64_t{ 0 },
+        [](uint64_t sum, const Element& element) { return sum + element.key; },
+        [](uint64_t sum1, uint64_t sum2) { return sum1 + sum2; });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+constexpr int64_t kTreeSizes[] = { 1 << 20, 50'000'000 };
+
+void SerialArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n" });
+  for (int64_t n : kTreeSizes) {
+    b->Arg(n);
+  }
+}
+
+void ParallelArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n", "threads" });
+  for (int64_t n : kTreeSizes) {
+    for (int64_t threads : { 1, 2, 4, 8, 16, 32 }) {
+      b->Args({ n, threads });
+    }
+  }
+}
+
+BENCHMARK(BM_SerialSum)->Apply(SerialArgs)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParallelSum)
+    ->Apply(ParallelArgs)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+
+}  // namespace util
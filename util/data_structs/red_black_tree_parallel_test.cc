@@ -0,0 +1,116 @@
+#include "util/data_structs/red_black_tree_parallel.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+struct Element : public RbNode {
+  int val;
+  std::atomic<int> visits = 0;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.val < e2.val;
+  }
+};
+
+using ElementTree = RbTree<Element, ElementLess>;
+
+class RedBlackTreeParallelTest : public ::testing::TestWithParam<size_t> {
+ protected:
+  static constexpr int kNumElements = 10000;
+
+  RedBlackTreeParallelTest() : elements_(kNumElements) {
+    for (int i = 0; i < kNumElements; i++) {
+      const int idx = (i * 17) % kNumElements;
+      elements_[idx].val = idx;
+      tree_.Insert(&elements_[idx]);
+    }
+  }
+
+  std::vector<Element> elements_;
+  ElementTree tree_;
+};
+
+TEST_P(RedBlackTreeParallelTest, TestForEachVisitsAllOnce) {
+  ParallelForEach(tree_, GetParam(), [](Element& element) {
+    element.visits.fetch_add(1, std::memory_order_relaxed);
+  });
+  for (const Element& element : elements_) {
+    EXPECT_EQ(element.visits.load(), 1) << element.val;
+  }
+}
+
+TEST_P(RedBlackTreeParallelTest, TestReduceSum) {
+  const int64_t sum = ParallelReduce(
+      tree_, GetParam(), int64_t{ 0 },
+      [](int64_t sum, const Element& element) { return sum + element.val; },
+      [](int64_t sum1, int64_t sum2) { return sum1 + sum2; });
+  EXPECT_EQ(sum, int64_t{ kNumElements } * (kNumElements - 1) / 2);
+}
+
+// Concatenation is associative but not commutative, so this checks that the
+// ranges are combined in order.
+TEST_P(RedBlackTreeParallelTest, TestReduceInOrder) {
+  const std::vector<int> vals = ParallelReduce(
+      tree_, GetParam(), std::vector<int>(),
+      [](std::vector<int> vals, const Element& element) {
+        vals.push_back(element.val);
+        return vals;
+      },
+      [](std::vector<int> vals1, const std::vector<int>& vals2) {
+        vals1.insert(vals1.end(), vals2.begin(), vals2.end());
+        return vals1;
+      });
+
+  std::vector<int> expected;
+  for (int i = 0; i < kNumElements; i++) {
+    expected.push_back(i);
+  }
+  EXPECT_EQ(vals, expected);
+}
+
+// Results are stored per range from different threads, and must not share
+// storage, as `std::vector<bool>` packs them.
+TEST_P(RedBlackTreeParallelTest, TestReduceBool) {
+  auto any_equal = [this](int val) {
+    return ParallelReduce(
+        tree_, GetParam(), false,
+        [val](bool any, const Element& element) {
+          return any || element.val == val;
+        },
+        [](bool any1, bool any2) { return any1 || any2; });
+  };
+  EXPECT_TRUE(any_equal(0));
+  EXPECT_TRUE(any_equal(kNumElements / 2));
+  EXPECT_TRUE(any_equal(kNumElements - 1));
+  EXPECT_FALSE(any_equal(kNumElements));
+
+  EXPECT_TRUE(ParallelReduce(
+      tree_, GetParam(), true,
+      [](bool all, const Element& element) { return all && element.val >= 0; },
+      [](bool all1, bool all2) { return all1 && all2; }));
+}
+
+TEST_P(RedBlackTreeParallelTest, TestEmpty) {
+  ElementTree tree;
+  ParallelForEach(tree, GetParam(), [](Element&) { FAIL(); });
+  EXPECT_EQ(ParallelReduce(
+                tree, GetParam(), 7, [](int, const Element&) { return 0; },
+                [](int, int) { return 0; }),
+            7);
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, RedBlackTreeParallelTest,
+                         ::testing::Values(1, 2, 4, 7));
+
+}  // namespace util
@@ -0,0 +1,202 @@
+#include "util/data_structs/red_black_tree_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "absl/crc/crc32c.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace util {
+
+namespace {
+
+constexpr char kMagic[] = { 'R', 'B', 'T', 'S', 'N', 'A', 'P', '1' };
+
+constexpr size_t kHeaderBytes = sizeof(kMagic) + sizeof(uint64_t);
+constexpr size_t kBlockHeaderBytes = 3 * sizeof(uint32_t);
+
+// Streamed blocks are read in chunks of at most this many bytes, so that a
+// corrupt block size does not allocate more than the stream holds.
+constexpr size_t kMaxReadChunkBytes = 1 << 20;
+
+void PutFixed32(uint32_t value, char* out) {
+  for (size_t i = 0; i < sizeof(value); i++) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+void PutFixed64(uint64_t value, char* out) {
+  for (size_t i = 0; i < sizeof(value); i++) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint32_t GetFixed32(const char* in) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < sizeof(value); i++) {
+    value |= uint32_t{ static_cast<uint8_t>(in[i]) } << (8 * i);
+  }
+  return value;
+}
+
+uint64_t GetFixed64(const char* in) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(value); i++) {
+    value |= uint64_t{ static_cast<uint8_t>(in[i]) } << (8 * i);
+  }
+  return value;
+}
+
+uint32_t Crc32c(std::string_view data) {
+  return static_cast<uint32_t>(absl::ComputeCrc32c(data));
+}
+
+}  // namespace
+
+void PutVarint64(uint64_t value, std::string& out) {
+  for (; value >= 0x80; value >>= 7) {
+    out.push_back(static_cast<char>(value | 0x80));
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+std::optional<uint64_t> GetVarint64(std::string_view& in) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < in.size() && i < 10; i++) {
+    const uint64_t byte = static_cast<uint8_t>(in[i]);
+    // The 10th byte holds only the top bit.
+    if (i == 9 && byte > 1) {
+      return std::nullopt;
+    }
+    value |= (byte & 0x7f) << (7 * i);
+    if (byte < 0x80) {
+      in.remove_prefix(i + 1);
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
+namespace internal {
+
+absl::Status SnapshotWriter::WriteHeader(uint64_t num_items) {
+  char header[kHeaderBytes];
+  std::memcpy(header, kMagic, sizeof(kMagic));
+  PutFixed64(num_items, header + sizeof(kMagic));
+  if (!out_.write(header, sizeof(header))) {
+    return absl::UnknownError("Failed to write snapshot header");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SnapshotWriter::WriteBlock(std::string_view payload,
+                                        uint32_t num_items) {
+  UTIL_DCHECK_LE(payload.size(), std::numeric_limits<uint32_t>::max());
+  char header[kBlockHeaderBytes];
+  PutFixed32(payload.size(), header);
+  PutFixed32(num_items, header + sizeof(uint32_t));
+  PutFixed32(Crc32c(payload), header + 2 * sizeof(uint32_t));
+  if (!out_.write(header, sizeof(header)) ||
+      !out_.write(payload.data(), payload.size())) {
+    return absl::UnknownError("Failed to write snapshot block");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<uint64_t> SnapshotReader::ReadHeader() {
+  DEFINE_OR_RETURN(std::string_view, header, Read(kHeaderBytes));
+  if (std::memcmp(header.data(), kMagic, sizeof(kMagic)) != 0) {
+    return absl::InvalidArgumentError("Not an RbTree snapshot");
+  }
+  return GetFixed64(header.data() + sizeof(kMagic));
+}
+
+absl::Status SnapshotReader::ReadBlock(std::string_view& payload,
+                                       uint32_t& num_items) {
+  DEFINE_OR_RETURN(std::string_view, header, Read(kBlockHeaderBytes));
+  const uint32_t size = GetFixed32(header.data());
+  num_items = GetFixed32(header.data() + sizeof(uint32_t));
+  const uint32_t crc = GetFixed32(header.data() + 2 * sizeof(uint32_t));
+
+  ASSIGN_OR_RETURN(payload, Read(size));
+  if (Crc32c(payload) != crc) {
+    return absl::DataLossError("Snapshot block checksum mismatch");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string_view> SnapshotReader::Read(size_t size) {
+  if (in_ == nullptr) {
+    if (data_.size() < size) {
+      return absl::DataLossError("Truncated snapshot");
+    }
+    const std::string_view read = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return read;
+  }
+
+  buffer_.clear();
+  while (buffer_.size() < size) {
+    const size_t chunk = std::min(size - buffer_.size(), kMaxReadChunkBytes);
+    const size_t offset = buffer_.size();
+    buffer_.resize(offset + chunk);
+    if (!in_->read(buffer_.data() + offset, chunk)) {
+      return absl::DataLossError("Truncated snapshot");
+    }
+  }
+  return std::string_view(buffer_);
+}
+
+absl::StatusOr<MappedFile> MappedFile::Open(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return absl::ErrnoToStatus(errno, "Failed to open " + path);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int error = errno;
+    close(fd);
+    return absl::ErrnoToStatus(error, "Failed to stat " + path);
+  }
+  const size_t size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    return MappedFile(nullptr, 0);
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  const int error = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    return absl::ErrnoToStatus(error, "Failed to map " + path);
+  }
+  // Snapshots are read front to back, once.
+  madvise(data, size, MADV_SEQUENTIAL);
+  return MappedFile(data, size);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+}  // namespace internal
+
+}  // namespace util
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+#include "util/absl_util.h"
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+// Snapshots hold the elements of an `RbTree` in order, encoded by a
+// user-provided codec, so that the tree can be rebuilt in linear time without
+// comparing elements.
+//
+// A snapshot is a header of the magic "RBTSNAP1" and the number of elements as
+// a little-endian uint64, then blocks of about `kRbTreeSnapshotBlockBytes` of
+// encoded elements. Each block starts with its payload size, its number of
+// elements and the CRC32C of its payload, as little-endian uint32s.
+//
+// A codec for `T` must provide:
+//   // Called before the first element of each block, so that codecs may
+//   // encode elements relative to the ones before them in the block.
+//   void Reset();
+//   // Appends the encoding of `item` to `out`.
+//   void Encode(const T& item, std::string& out);
+//   // Decodes an element from the front of `in`, consuming its encoding, and
+//   // returns it, newly allocated.
+//   absl::StatusOr<T*> Decode(std::string_view& in);
+
+// The payload size after which a block is cut.
+inline constexpr size_t kRbTreeSnapshotBlockBytes = 64 << 10;
+
+// Appends `value` to `out` in 1-10 bytes, 7 bits at a time, low bits first.
+void PutVarint64(uint64_t value, std::string& out);
+
+// Decodes a varint from the front of `in`, consuming it, or returns
+// `std::nullopt` if `in` does not start with one.
+std::optional<uint64_t> GetVarint64(std::string_view& in);
+
+// Encodes the integral keys of the elements of a block, which come in
+// increasing order, as varints of the differences between consecutive keys.
+// For use in codecs.
+template <typename K>
+class DeltaVarintCoder {
+ public:
+  void Reset() {
+    prev_ = 0;
+  }
+
+  void Encode(K key, std::string& out) {
+    PutVarint64(static_cast<uint64_t>(key) - prev_, out);
+    prev_ = static_cast<uint64_t>(key);
+  }
+
+  absl::StatusOr<K> Decode(std::string_view& in) {
+    const std::optional<uint64_t> delta = GetVarint64(in);
+    if (!delta.has_value()) {
+      return absl::DataLossError("Truncated key delta in snapshot");
+    }
+    prev_ += *delta;
+    return static_cast<K>(prev_);
+  }
+
+ private:
+  uint64_t prev_ = 0;
+};
+
+namespace internal {
+
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(std::ostream& out) : out_(out) {}
+
+  absl::Status WriteHeader(uint64_t num_items);
+
+  absl::Status WriteBlock(std::string_view payload, uint32_t num_items);
+
+ private:
+  std::ostream& out_;
+};
+
+// Reads a snapshot either from memory, returning blocks as views into it, or
+// from a stream, through a buffer which is reused between blocks.
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(std::string_view data) : data_(data) {}
+
+  explicit SnapshotReader(std::istream& in) : in_(&in) {}
+
+  // Returns the number of elements in the snapshot.
+  absl::StatusOr<uint64_t> ReadHeader();
+
+  // Reads the next block, and checks its checksum. `payload` is valid until
+  // the next call.
+  absl::Status ReadBlock(std::string_view& payload, uint32_t& num_items);
+
+ private:
+  absl::StatusOr<std::string_view> Read(size_t size);
+
+  std::string_view data_;
+  std::istream* in_ = nullptr;
+  std::string buffer_;
+};
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  static absl::StatusOr<MappedFile> Open(const std::string& path);
+
+  MappedFile(MappedFile&& other) noexcept
+      : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  ~MappedFile();
+
+  std::string_view data() const {
+    return { static_cast<const char*>(data_), size_ };
+  }
+
+ private:
+  MappedFile(void* data, size_t size) : data_(data), size_(size) {}
+
+  void* data_;
+  size_t size_;
+};
+
+template <typename T, typename Cmp, typename Codec>
+absl::Status ReadSnapshot(SnapshotReader& reader, Codec& codec,
+                          RbTree<T, Cmp>& tree) {
+  UTIL_DCHECK(tree.Size() == 0);
+  DEFINE_OR_RETURN(uint64_t, num_items, reader.ReadHeader());
+
+  // Elements are linked into the tree as they are decoded, so that the tree
+  // holds all elements decoded so far even if reading fails.
+  typename RbTree<T, Cmp>::Appender appender(tree);
+  absl::Status status = absl::OkStatus();
+  uint64_t read = 0;
+  while (status.ok() && read < num_items) {
+    std::string_view payload;
+    uint32_t block_items;
+    status = reader.ReadBlock(payload, block_items);
+    if (!status.ok()) {
+      break;
+    }
+    if (block_items == 0 || block_items > num_items - read) {
+      status = absl::DataLossError("Bad element count in snapshot block");
+      break;
+    }
+
+    codec.Reset();
+    for (uint32_t i = 0; i < block_items; i++) {
+      absl::StatusOr<T*> item = codec.Decode(payload);
+      if (!item.ok()) {
+        status = item.status();
+        break;
+      }
+      appender.Append(*item);
+      read++;
+    }
+    if (status.ok() && !payload.empty()) {
+      status = absl::DataLossError("Trailing data in snapshot block");
+    }
+  }
+  appender.Finish();
+  return status;
+}
+
+}  // namespace internal
+
+// Writes the elements of `tree` to `out` as a snapshot.
+template <typename T, typename Cmp, typename Codec>
+absl::Status WriteRbTreeSnapshot(const RbTree<T, Cmp>& tree, Codec& codec,
+                                 std::ostream& out) {
+  internal::SnapshotWriter writer(out);
+  RETURN_IF_ERROR(writer.WriteHeader(tree.Size()));
+  if (tree.Root() == nullptr) {
+    return absl::OkStatus();
+  }
+
+  std::string block;
+  uint32_t block_items = 0;
+  codec.Reset();
+  for (const RbNode* node = tree.Root()->LeftmostChild();
+       node != tree.RootSentinel(); node = node->Next()) {
+    codec.Encode(*static_cast<const T*>(node), block);
+    block_items++;
+    if (block.size() >= kRbTreeSnapshotBlockBytes ||
+        block_items == std::numeric_limits<uint32_t>::max()) {
+      RETURN_IF_ERROR(writer.WriteBlock(block, block_items));
+      block.clear();
+      block_items = 0;
+      codec.Reset();
+    }
+  }
+  if (block_items != 0) {
+    RETURN_IF_ERROR(writer.WriteBlock(block, block_items));
+  }
+  return absl::OkStatus();
+}
+
+// Reads a snapshot from `data` into `tree`, which must be empty. Elements are
+// allocated by `codec`, and owned by the caller as usual. If reading fails,
+// the tree holds the elements decoded before the error.
+template <typename T, typename Cmp, typename Codec>
+absl::Status ReadRbTreeSnapshot(std::string_view data, Codec& codec,
+                                RbTree<T, Cmp>& tree) {
+  internal::SnapshotReader reader(data);
+  return internal::ReadSnapshot(reader, codec, tree);
+}
+
+// Like the above, but streams the snapshot from `in`, one block at a time.
+template <typename T, typename Cmp, typename Codec>
+absl::Status ReadRbTreeSnapshot(std::istream& in, Codec& codec,
+                                RbTree<T, Cmp>& tree) {
+  internal::SnapshotReader reader(in);
+  return internal::ReadSnapshot(reader, codec, tree);
+}
+
+// Like the above, but maps the file at `path` into memory and reads from it.
+template <typename T, typename Cmp, typename Codec>
+absl::Status ReadRbTreeSnapshotFile(const std::string& path, Codec& codec,
+                                    RbTree<T, Cmp>& tree) {
+  DEFINE_OR_RETURN(internal::MappedFile, file,
+                   internal::MappedFile::Open(path));
+  return ReadRbTreeSnapshot(file.data(), codec, tree);
+}
+
+}  // namespace util
@@ -0,0 +1,220 @@
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/red_black_tree_snapshot.h"
+
+namespace util {
+
+namespace {
+
+struct Element : public RbNode {
+  uint64_t key;
+  uint64_t value;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.key < e2.key;
+  }
+};
+
+using ElementTree = RbTree<Element, ElementLess>;
+
+// Hands out elements from a preallocated pool, so that loading does not
+// measure the allocator.
+class ElementPool {
+ public:
+  explicit ElementPool(size_t n) : elements_(new Element[n]) {}
+
+  Element* Next() {
+    return &elements_[next_++];
+  }
+
+  void Clear() {
+    next_ = 0;
+  }
+
+ private:
+  std::unique_ptr<Element[]> elements_;
+  size_t next_ = 0;
+};
+
+class ElementCodec {
+ public:
+  explicit ElementCodec(ElementPool* pool = nullptr) : pool_(pool) {}
+
+  void Reset() {
+    keys_.Reset();
+  }
+
+  void Encode(const Element& element, std::string& out) {
+    keys_.Encode(element.key, out);
+    PutVarint64(element.value, out);
+  }
+
+  absl::StatusOr<Element*> Decode(std::string_view& in) {
+    absl::StatusOr<uint64_t> key = keys_.Decode(in);
+    const std::optional<uint64_t> value = GetVarint64(in);
+    if (!key.ok() || !value.has_value()) {
+      return absl::DataLossError("Truncated element");
+    }
+    Element* element = pool_->Next();
+    element->key = *key;
+    element->value = *value;
+    return element;
+  }
+
+ private:
+  ElementPool* pool_;
+  DeltaVarintCoder<uint64_t> keys_;
+};
+
+// The dumps of a tree of `n` elements with random keys and values, as text
+// lines of "key value" and as a snapshot.
+struct Dumps {
+  explicit Dumps(size_t n) {
+    ElementPool pool(n);
+    ElementTree tree;
+    std::mt19937_64 gen(0);
+    for (size_t i = 0; i < n; i++) {
+      Element* element = pool.Next();
+      // Keys are about 32 apart, as in a dense id space.
+      element->key = gen() % (n * 32);
+      element->value = gen() % 1000000;
+      tree.Insert(element);
+    }
+
+    const ElementTree& const_tree = tree;
+    std::ostringstream text_out;
+    for (const RbNode* node = const_tree.Root()->LeftmostChild();
+         node != const_tree.RootSentinel(); node = node->Next()) {
+      const Element& element = *static_cast<const Element*>(node);
+      text_out << element.key << ' ' << element.value << '\n';
+    }
+    text = text_out.str();
+
+    std::ostringstream snapshot_out;
+    ElementCodec codec;
+    if (!WriteRbTreeSnapshot(tree, codec, snapshot_out).ok()) {
+      std::abort();
+    }
+    snapshot = snapshot_out.str();
+  }
+
+  std::string text;
+  std::string snapshot;
+};
+
+const Dumps& SharedDumps(size_t n) {
+  static size_t dumps_n = 0;
+  static std::unique_ptr<Dumps> dumps;
+  if (dumps_n != n) {
+    dumps = nullptr;
+    dumps = std::make_unique<Dumps>(n);
+    dumps_n = n;
+  }
+  return *dumps;
+}
+
+// Args: n.
+//
+// The baseline: parses a text dump, and inserts each element.
+void BM_LoadText(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::string& text = SharedDumps(n).text;
+  ElementPool pool(n);
+
+  for (auto _ : state) {
+    pool.Clear();
+    ElementTree tree;
+    const char* pos = text.data();
+    const char* end = text.data() + text.size();
+    while (pos != end) {
+      Element* element = pool.Next();
+      pos = std::from_chars(pos, end, element->key).ptr + 1;
+      pos = std::from_chars(pos, end, element->value).ptr + 1;
+      tree.Insert(element);
+    }
+    benchmark::DoNotOptimize(tree.Size());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.counters["bytes/elem"] = static_cast<double>(text.size()) / n;
+}
+
+// Args: n.
+//
+// Reads a snapshot from memory, as from a mapped file.
+void BM_LoadSnapshot(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::string& snapshot = SharedDumps(n).snapshot;
+  ElementPool pool(n);
+  ElementCodec codec(&pool);
+
+  for (auto _ : state) {
+    pool.Clear();
+    ElementTree tree;
+    if (!ReadRbTreeSnapshot(snapshot, codec, tree).ok()) {
+      state.SkipWithError("Failed to read snapshot");
+      break;
+    }
+    benchmark::DoNotOptimize(tree.Size());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.counters["bytes/elem"] = static_cast<double>(snapshot.size()) / n;
+}
+
+// Args: n.
+//
+// Streams a snapshot from a file.
+void BM_LoadSnapshotStream(benchmark::State& state) {
+  const size_t n = state.range(0);
+  const std::string path = "/tmp/red_black_tree_snapshot_benchmark";
+  std::ofstream(path, std::ios::binary) << SharedDumps(n).snapshot;
+  ElementPool pool(n);
+  ElementCodec codec(&pool);
+
+  for (auto _ : state) {
+    pool.Clear();
+    ElementTree tree;
+    std::ifstream in(path, std::ios::binary);
+    if (!ReadRbTreeSnapshot(in, codec, tree).ok()) {
+      state.SkipWithError("Failed to read snapshot");
+      break;
+    }
+    benchmark::DoNotOptimize(tree.Size());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  std::remove(path.c_str());
+}
+
+void LoadArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n" });
+  for (int64_t n : { 1 << 20, 10'000'000 }) {
+    b->Arg(n);
+  }
+}
+
+BENCHMARK(BM_LoadText)->Apply(LoadArgs)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadSnapshot)->Apply(LoadArgs)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadSnapshotStream)
+    ->Apply(LoadArgs)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace util
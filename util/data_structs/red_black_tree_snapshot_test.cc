@@ -0,0 +1,264 @@
+#include "util/data_structs/red_black_tree_snapshot.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/gtest_util.h"
+
+namespace util {
+
+using ::testing::ElementsAreArray;
+using ::testing::Optional;
+using util::IsOk;
+
+struct Element : public RbNode {
+  int64_t key;
+  std::string value;
+};
+
+struct ElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    return e1.key < e2.key;
+  }
+};
+
+using ElementTree = RbTree<Element, ElementLess>;
+
+// Encodes keys as deltas and values with a length prefix, and allocates
+// decoded elements in a deque.
+class ElementCodec {
+ public:
+  void Reset() {
+    keys_.Reset();
+  }
+
+  void Encode(const Element& element, std::string& out) {
+    keys_.Encode(element.key, out);
+    PutVarint64(element.value.size(), out);
+    out.append(element.value);
+  }
+
+  absl::StatusOr<Element*> Decode(std::string_view& in) {
+    DEFINE_OR_RETURN(int64_t, key, keys_.Decode(in));
+    const std::optional<uint64_t> size = GetVarint64(in);
+    if (!size.has_value() || *size > in.size()) {
+      return absl::DataLossError("Truncated value");
+    }
+
+    Element& element = elements_.emplace_back();
+    element.key = key;
+    element.value = in.substr(0, *size);
+    in.remove_prefix(*size);
+    return &element;
+  }
+
+ private:
+  DeltaVarintCoder<int64_t> keys_;
+  std::deque<Element> elements_;
+};
+
+std::vector<std::pair<int64_t, std::string>> Contents(const ElementTree& tree) {
+  std::vector<std::pair<int64_t, std::string>> contents;
+  if (tree.Root() == nullptr) {
+    return contents;
+  }
+  for (const RbNode* node = tree.Root()->LeftmostChild();
+       node != tree.RootSentinel(); node = node->Next()) {
+    const Element& element = *static_cast<const Element*>(node);
+    contents.emplace_back(element.key, element.value);
+  }
+  return contents;
+}
+
+// The black height of the tree under `node`, or -1 if it is not balanced.
+int BlackHeight(const RbNode* node) {
+  if (node == nullptr) {
+    return 0;
+  }
+  const int left = BlackHeight(node->Left());
+  const int right = BlackHeight(node->Right());
+  if (left < 0 || left != right ||
+      (node->IsRed() && ((node->Left() != nullptr && node->Left()->IsRed()) ||
+                         (node->Right() != nullptr &&
+                          node->Right()->IsRed())))) {
+    return -1;
+  }
+  return left + node->IsBlack();
+}
+
+int BlackHeight(const ElementTree& tree) {
+  return BlackHeight(tree.Root());
+}
+
+void FillTree(size_t n, std::deque<Element>& elements, ElementTree& tree) {
+  for (size_t i = 0; i < n; i++) {
+    Element& element = elements.emplace_back();
+    // Keys are negative and positive, with gaps of varying size.
+    element.key = static_cast<int64_t>(i * i) - static_cast<int64_t>(n);
+    element.value = std::string(i % 7, 'a' + i % 26);
+    tree.Insert(&element);
+  }
+}
+
+class RedBlackTreeSnapshotTest : public ::testing::Test {
+ protected:
+  void Fill(size_t n) {
+    FillTree(n, elements_, tree_);
+  }
+
+  std::string Write() {
+    std::ostringstream out;
+    ElementCodec codec;
+    EXPECT_THAT(WriteRbTreeSnapshot(tree_, codec, out), IsOk());
+    return out.str();
+  }
+
+  std::deque<Element> elements_;
+  ElementTree tree_;
+};
+
+TEST_F(RedBlackTreeSnapshotTest, TestRoundTrip) {
+  for (size_t n : { 0, 1, 2, 1000, 100000 }) {
+    std::deque<Element> elements;
+    ElementTree tree;
+    FillTree(n, elements, tree);
+    std::ostringstream out;
+    ElementCodec write_codec;
+    ASSERT_THAT(WriteRbTreeSnapshot(tree, write_codec, out), IsOk());
+    const std::string snapshot = out.str();
+
+    ElementCodec codec;
+    ElementTree from_memory;
+    ASSERT_THAT(ReadRbTreeSnapshot(snapshot, codec, from_memory), IsOk());
+    EXPECT_EQ(from_memory.Size(), n);
+    EXPECT_THAT(Contents(from_memory), ElementsAreArray(Contents(tree)));
+    EXPECT_GE(BlackHeight(from_memory), 0) << n;
+
+    std::istringstream in(snapshot);
+    ElementTree from_stream;
+    ASSERT_THAT(ReadRbTreeSnapshot(in, codec, from_stream), IsOk());
+    EXPECT_EQ(from_stream.Size(), n);
+    EXPECT_THAT(Contents(from_stream), ElementsAreArray(Contents(tree)));
+  }
+}
+
+TEST_F(RedBlackTreeSnapshotTest, TestReadFile) {
+  Fill(10000);
+  const std::string path = ::testing::TempDir() + "/snapshot";
+  std::ofstream(path, std::ios::binary) << Write();
+
+  ElementCodec codec;
+  ElementTree tree;
+  ASSERT_THAT(ReadRbTreeSnapshotFile(path, codec, tree), IsOk());
+  EXPECT_THAT(Contents(tree), ElementsAreArray(Contents(tree_)));
+
+  ElementTree missing;
+  EXPECT_EQ(ReadRbTreeSnapshotFile(path + ".missing", codec, missing).code(),
+            absl::StatusCode::kNotFound);
+}
+
+// The loaded tree can be modified as usual.
+TEST_F(RedBlackTreeSnapshotTest, TestInsertAfterRead) {
+  Fill(1000);
+  const std::string snapshot = Write();
+
+  ElementCodec codec;
+  ElementTree tree;
+  ASSERT_THAT(ReadRbTreeSnapshot(snapshot, codec, tree), IsOk());
+  std::deque<Element> more(1000);
+  for (size_t i = 0; i < more.size(); i++) {
+    more[i].key = 3 * i;
+    tree.Insert(&more[i]);
+  }
+  EXPECT_EQ(tree.Size(), 2000);
+  EXPECT_GE(BlackHeight(tree), 0);
+
+  std::vector<std::pair<int64_t, std::string>> contents = Contents(tree);
+  EXPECT_TRUE(std::is_sorted(
+      contents.begin(), contents.end(),
+      [](const auto& c1, const auto& c2) { return c1.first < c2.first; }));
+}
+
+TEST_F(RedBlackTreeSnapshotTest, TestCorruption) {
+  Fill(50000);
+  const std::string snapshot = Write();
+  ElementCodec codec;
+
+  {
+    ElementTree tree;
+    EXPECT_EQ(ReadRbTreeSnapshot("not an RbTree snapshot", codec, tree).code(),
+              absl::StatusCode::kInvalidArgument);
+  }
+
+  // Flipping any one byte after the header is caught by the block checksums,
+  // or the element count, and the elements of the blocks before are kept.
+  for (size_t i = 8; i < snapshot.size(); i += snapshot.size() / 97) {
+    std::string corrupt = snapshot;
+    corrupt[i] ^= 0x10;
+    ElementTree tree;
+    EXPECT_FALSE(ReadRbTreeSnapshot(corrupt, codec, tree).ok()) << i;
+    EXPECT_GE(BlackHeight(tree), 0);
+    const std::vector<std::pair<int64_t, std::string>> contents =
+        Contents(tree);
+    const std::vector<std::pair<int64_t, std::string>> expected =
+        Contents(tree_);
+    ASSERT_LE(contents.size(), expected.size());
+    EXPECT_TRUE(std::equal(contents.begin(), contents.end(), expected.begin()));
+  }
+
+  // Truncation is caught from memory and from a stream.
+  for (size_t size : { size_t{ 0 }, size_t{ 12 }, snapshot.size() - 1 }) {
+    ElementTree from_memory;
+    EXPECT_EQ(ReadRbTreeSnapshot(std::string_view(snapshot).substr(0, size),
+                                 codec, from_memory)
+                  .code(),
+              absl::StatusCode::kDataLoss)
+        << size;
+    std::istringstream in(snapshot.substr(0, size));
+    ElementTree from_stream;
+    EXPECT_EQ(ReadRbTreeSnapshot(in, codec, from_stream).code(),
+              absl::StatusCode::kDataLoss)
+        << size;
+  }
+}
+
+TEST(VarintTest, TestRoundTrip) {
+  const std::vector<uint64_t> values = {
+    0, 1, 127, 128, 300, uint64_t{ 1 } << 35,
+    std::numeric_limits<uint64_t>::max(),
+  };
+  std::string encoded;
+  for (uint64_t value : values) {
+    PutVarint64(value, encoded);
+  }
+  EXPECT_EQ(encoded.size(), 1 + 1 + 1 + 2 + 2 + 6 + 10);
+
+  std::string_view in = encoded;
+  for (uint64_t value : values) {
+    EXPECT_THAT(GetVarint64(in), Optional(value));
+  }
+  EXPECT_TRUE(in.empty());
+  EXPECT_EQ(GetVarint64(in), std::nullopt);
+
+  std::string_view truncated = "\x80\x80";
+  EXPECT_EQ(GetVarint64(truncated), std::nullopt);
+  std::string_view overlong = "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02";
+  EXPECT_EQ(GetVarint64(overlong), std::nullopt);
+}
+
+}  // namespace util
@@ -1,14 +1,20 @@
 #include "util/data_structs/red_black_tree.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <iomanip>
+#include <memory>
 #include <ostream>
 #include <sstream>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "gtest/gtest.h"
 
 #include "util/absl_util.h"
+#include "util/allocation_tracker.h"
+#include "util/complexity.h"
 #include "util/gtest_util.h"
 
 namespace util {
@@ -18,6 +24,11 @@ using ::testing::Not;
 using ::testing::Pointee;
 using util::IsOk;
 
+// `--config=opt` defines UTIL_NDEBUG, which compiles the counters out.
+#ifdef UTIL_NDEBUG
+static_assert(!kRbTreeCountersEnabled);
+#endif
+
 class RedBlackTreeTest : public ::testing::Test {
  protected:
   template <typename T, typename Cmp>
@@ -118,6 +129,16 @@ struct ElementLess {
 
 using ElementTree = RbTree<Element, ElementLess>;
 
+// Counts every comparison, to measure the work done by the tree.
+struct CountingElementLess {
+  bool operator()(const Element& e1, const Element& e2) const {
+    comparisons++;
+    return e1.val < e2.val;
+  }
+
+  static inline uint64_t comparisons = 0;
+};
+
 TEST_F(RedBlackTreeTest, TestEmpty) {
   ElementTree tree;
   EXPECT_EQ(tree.LowerBound([](const Element&) {
@@ -219,4 +240,414 @@ TEST_F(RedBlackTreeTest, TestDeleteMany) {
   }
 }
 
+TEST_F(RedBlackTreeTest, TestReinsert) {
+  constexpr size_t kNumElements = 100;
+
+  ElementTree tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(&elements[i]);
+  }
+
+  for (size_t i = 0; i < kNumElements; i++) {
+    const size_t idx = (i * 37) % kNumElements;
+    tree.Remove(&elements[idx]);
+    tree.Insert(&elements[idx]);
+    ASSERT_THAT(Validate(tree), IsOk()) << Print(tree);
+    ASSERT_EQ(tree.Size(), kNumElements);
+  }
+}
+
+TEST_F(RedBlackTreeTest, TestLowerBoundPositionInsertAt) {
+  constexpr int kNumElements = 100;
+
+  ElementTree tree;
+  Element elements[2 * kNumElements + 1];
+  for (int val = 0; val <= 2 * kNumElements; val++) {
+    elements[val].val = val;
+  }
+
+  // Inserts the even values, in a scattered order, and then the odd ones,
+  // each at the position of its lower bound.
+  for (int i = 0; i <= 2 * kNumElements; i++) {
+    const int val = i <= kNumElements ? 2 * ((i * 37) % (kNumElements + 1))
+                                      : 2 * (i - kNumElements) - 1;
+    const auto position = tree.LowerBoundPosition(
+        [val](const Element& element) { return element.val >= val; });
+    EXPECT_EQ(position.lower_bound,
+              tree.LowerBound(
+                  [val](const Element& element) { return element.val >= val; }));
+    tree.InsertAt(&elements[val], position);
+    ASSERT_THAT(Validate(tree), IsOk()) << Print(tree);
+  }
+
+  ASSERT_EQ(tree.Size(), 2 * kNumElements + 1);
+  for (int val = 0; val <= 2 * kNumElements; val++) {
+    EXPECT_EQ(tree.LowerBound([val](const Element& element) {
+      return element.val >= val;
+    }),
+              &elements[val]);
+  }
+}
+
+TEST_F(RedBlackTreeTest, TestEraseRange) {
+  constexpr int kNumElements = 200;
+
+  // Erase every range [first, last) of a few shapes of tree, including ranges
+  // running to the end of the tree.
+  for (int first = 0; first < kNumElements; first += 7) {
+    for (int last = first; last <= kNumElements; last += 11) {
+      ElementTree tree;
+      Element elements[kNumElements];
+      for (int i = 0; i < kNumElements; i++) {
+        const int idx = (i * 17) % kNumElements;
+        elements[idx].val = idx;
+        tree.Insert(&elements[idx]);
+      }
+
+      std::vector<int> disposed;
+      const size_t removed = tree.EraseRange(
+          &elements[first], last < kNumElements ? &elements[last] : nullptr,
+          [&disposed](Element* element) { disposed.push_back(element->val); });
+      ASSERT_THAT(Validate(tree), IsOk()) << first << ".." << last;
+      ASSERT_EQ(removed, last - first);
+      ASSERT_EQ(tree.Size(), kNumElements - removed);
+
+      std::vector<int> expected_disposed;
+      for (int i = first; i < last; i++) {
+        expected_disposed.push_back(i);
+      }
+      EXPECT_EQ(disposed, expected_disposed);
+
+      for (int i = 0; i < kNumElements; i++) {
+        Element* found = tree.LowerBound(
+            [i](const Element& element) { return element.val >= i; });
+        const int expected = i >= first && i < last ? last : i;
+        if (expected == kNumElements) {
+          EXPECT_EQ(found, nullptr);
+        } else {
+          EXPECT_EQ(found, &elements[expected]);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(RedBlackTreeTest, TestEraseRangeThenReinsert) {
+  constexpr int kNumElements = 1000;
+
+  ElementTree tree;
+  Element elements[kNumElements];
+  for (int i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(&elements[i]);
+  }
+
+  std::vector<Element*> disposed;
+  auto dispose = [&disposed](Element* element) { disposed.push_back(element); };
+  for (int i = 0; i + 100 <= kNumElements; i += 100) {
+    tree.EraseRange(&elements[i], &elements[i + 50], dispose);
+    ASSERT_THAT(Validate(tree), IsOk());
+  }
+  ASSERT_EQ(tree.Size(), kNumElements / 2);
+
+  for (Element* element : disposed) {
+    tree.Insert(element);
+    ASSERT_THAT(Validate(tree), IsOk());
+  }
+  ASSERT_EQ(tree.Size(), kNumElements);
+}
+
+TEST_F(RedBlackTreeTest, TestRemoveIf) {
+  constexpr int kNumElements = 1000;
+
+  // Remove every 1 in `period` elements, which takes the per-element path for
+  // large periods and rebuilds the tree for small ones.
+  for (int period : { 1, 2, 3, 7, 64, 1001 }) {
+    ElementTree tree;
+    Element elements[kNumElements];
+    for (int i = 0; i < kNumElements; i++) {
+      const int idx = (i * 17) % kNumElements;
+      elements[idx].val = idx;
+      tree.Insert(&elements[idx]);
+    }
+
+    std::vector<int> visited;
+    std::vector<int> disposed;
+    const size_t removed = tree.RemoveIf(
+        [&visited, period](const Element& element) {
+          visited.push_back(element.val);
+          return element.val % period == 0;
+        },
+        [&disposed](Element* element) { disposed.push_back(element->val); });
+    ASSERT_THAT(Validate(tree), IsOk()) << period;
+
+    std::vector<int> expected_visited;
+    std::vector<int> expected_disposed;
+    for (int i = 0; i < kNumElements; i++) {
+      expected_visited.push_back(i);
+      if (i % period == 0) {
+        expected_disposed.push_back(i);
+      }
+    }
+    EXPECT_EQ(visited, expected_visited);
+    EXPECT_EQ(disposed, expected_disposed);
+    EXPECT_EQ(removed, expected_disposed.size());
+    EXPECT_EQ(tree.Size(), kNumElements - removed);
+
+    for (int i = 0; i < kNumElements; i++) {
+      Element* found = tree.LowerBound(
+          [i](const Element& element) { return element.val >= i; });
+      if (i % period != 0) {
+        EXPECT_EQ(found, &elements[i]);
+      } else {
+        EXPECT_NE(found, &elements[i]);
+      }
+    }
+  }
+}
+
+TEST_F(RedBlackTreeTest, TestPartition) {
+  constexpr int kMaxElements = 1000;
+
+  Element elements[kMaxElements];
+  for (int size : { 0, 1, 2, 10, kMaxElements }) {
+    ElementTree tree;
+    for (int i = 0; i < size; i++) {
+      const int idx = (i * 17) % size;
+      elements[idx].val = idx;
+      tree.Insert(&elements[idx]);
+    }
+
+    for (size_t n : { 1, 2, 3, 8, 64 }) {
+      const std::vector<ElementTree::Range> ranges = tree.Partition(n);
+      // The ranges cover the tree in order, and none are empty.
+      std::vector<int> visited;
+      for (const ElementTree::Range& range : ranges) {
+        const RbNode* end =
+            range.last != nullptr ? range.last : tree.RootSentinel();
+        ASSERT_NE(range.first, end) << size << " " << n;
+        for (const RbNode* node = range.first; node != end;
+             node = node->Next()) {
+          visited.push_back(static_cast<const Element*>(node)->val);
+        }
+      }
+      std::vector<int> expected;
+      for (int i = 0; i < size; i++) {
+        expected.push_back(i);
+      }
+      EXPECT_EQ(visited, expected) << size << " " << n;
+
+      if (size == 0) {
+        EXPECT_TRUE(ranges.empty());
+      } else {
+        EXPECT_EQ(ranges.back().last, nullptr);
+        EXPECT_LE(ranges.size(), 2 * n);
+      }
+      if (size == kMaxElements) {
+        EXPECT_GE(ranges.size(), n);
+      }
+    }
+  }
+}
+
+TEST_F(RedBlackTreeTest, TestLowerBoundBatch) {
+  constexpr size_t kNumElements = 1000;
+  constexpr size_t kNumKeys = 2 * kNumElements + 1;
+
+  ElementTree tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = 2 * ((i * 13) % kNumElements);
+    tree.Insert(&elements[i]);
+  }
+
+  std::vector<int> keys;
+  for (size_t i = 0; i < kNumKeys; i++) {
+    keys.push_back(static_cast<int>((i * 7) % kNumKeys) - 1);
+  }
+
+  auto at_least = [](const Element& element, int key) {
+    return element.val >= key;
+  };
+  std::vector<Element*> out(kNumKeys);
+  tree.LowerBoundBatch(keys, out, at_least);
+
+  for (size_t i = 0; i < kNumKeys; i++) {
+    EXPECT_EQ(out[i], tree.LowerBound([&](const Element& element) {
+      return at_least(element, keys[i]);
+    })) << "key " << keys[i];
+  }
+}
+
+TEST_F(RedBlackTreeTest, TestLowerBoundBatchEmpty) {
+  ElementTree tree;
+  std::vector<int> keys = { 1, 2, 3 };
+  std::vector<Element*> out(keys.size(), reinterpret_cast<Element*>(0x1));
+  tree.LowerBoundBatch(keys, out, [](const Element&, int) {
+    return true;
+  });
+  EXPECT_THAT(out, ::testing::Each(nullptr));
+}
+
+TEST_F(RedBlackTreeTest, TestStats) {
+  ElementTree tree;
+  EXPECT_EQ(tree.Stats().size, 0);
+  EXPECT_EQ(tree.Stats().height, 0);
+  EXPECT_EQ(tree.Stats().MeanDepth(), 0);
+
+  // Keys inserted in order give the most right-leaning tree possible.
+  constexpr size_t kNumElements = 1 << 12;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(&elements[i]);
+  }
+
+  const RbTreeStats stats = tree.Stats();
+  EXPECT_EQ(stats.size, kNumElements);
+  EXPECT_EQ(stats.height, stats.depth_histogram.size());
+  EXPECT_EQ(stats.depth_histogram[0], 1);
+  EXPECT_EQ(stats.depth_histogram[1], 2);
+  EXPECT_GE(stats.height, 13);
+  EXPECT_LE(stats.height, 2 * 12);
+  EXPECT_GE(stats.height, stats.black_height);
+  EXPECT_LE(stats.height, 2 * stats.black_height);
+  EXPECT_GT(stats.MeanDepth(), 11);
+  EXPECT_LT(stats.MeanDepth(), stats.height);
+
+  size_t black_height = 0;
+  const ElementTree& const_tree = tree;
+  for (const RbNode* node = const_tree.Root(); node != nullptr;
+       node = node->Right()) {
+    black_height += node->IsBlack();
+  }
+  EXPECT_EQ(stats.black_height, black_height);
+}
+
+TEST_F(RedBlackTreeTest, TestCounters) {
+  if (!kRbTreeCountersEnabled) {
+    GTEST_SKIP() << "RbTree counters are disabled";
+  }
+
+  ElementTree tree;
+  constexpr size_t kNumElements = 1000;
+  Element elements[kNumElements];
+  ResetRbTreeCounters();
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = i;
+    tree.Insert(&elements[i]);
+  }
+
+  RbTreeCounters counters = GetRbTreeCounters();
+  EXPECT_EQ(counters.inserts, kNumElements);
+  // Every insert compares against each node on its path, plus once more.
+  EXPECT_GT(counters.insert_comparisons, kNumElements * 9);
+  EXPECT_LT(counters.insert_comparisons, kNumElements * 2 * 11);
+  // Ascending inserts always lean right, so only rotate left.
+  EXPECT_GT(counters.rotations_left, 0);
+  EXPECT_EQ(counters.rotations_right, 0);
+  EXPECT_EQ(counters.rotations_left_right + counters.rotations_right_left, 0);
+  EXPECT_GE(counters.insert_fix_iterations, counters.Rotations());
+  EXPECT_EQ(counters.lower_bounds, 0);
+
+  ResetRbTreeCounters();
+  EXPECT_EQ(tree.LowerBound([](const Element& element) {
+    return element.val >= 500;
+  }),
+            &elements[500]);
+  counters = GetRbTreeCounters();
+  EXPECT_EQ(counters.lower_bounds, 1);
+  // A lookup compares against every node on one path from the root to a leaf.
+  const RbTreeStats stats = tree.Stats();
+  EXPECT_GE(counters.lower_bound_comparisons, stats.black_height);
+  EXPECT_LE(counters.lower_bound_comparisons, stats.height);
+
+  ResetRbTreeCounters();
+  for (size_t i = 0; i < kNumElements; i += 2) {
+    tree.Remove(&elements[i]);
+  }
+  counters = GetRbTreeCounters();
+  EXPECT_GT(counters.delete_fix_iterations, 0);
+  EXPECT_EQ(counters.inserts, 0);
+  EXPECT_THAT(Validate(tree), IsOk());
+}
+
+TEST_F(RedBlackTreeTest, TestNoAllocations) {
+  constexpr size_t kNumElements = 1000;
+  ElementTree tree;
+  Element elements[kNumElements];
+  for (size_t i = 0; i < kNumElements; i++) {
+    elements[i].val = static_cast<int>((i * 13) % kNumElements);
+    EXPECT_NO_ALLOCATIONS(tree.Insert(&elements[i]));
+  }
+
+  auto at_least = [](const Element& element, int key) {
+    return element.val >= key;
+  };
+  EXPECT_NO_ALLOCATIONS(tree.LowerBound([&](const Element& element) {
+    return at_least(element, 500);
+  }));
+  const std::vector<int> keys = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5 };
+  std::vector<Element*> out(keys.size());
+  EXPECT_NO_ALLOCATIONS(tree.LowerBoundBatch(keys, out, at_least));
+
+  for (size_t i = 0; i < kNumElements; i += 4) {
+    EXPECT_NO_ALLOCATIONS(tree.Remove(&elements[i]));
+  }
+  EXPECT_NO_ALLOCATIONS(tree.RemoveIf(
+      [](const Element& element) { return element.val % 3 == 0; },
+      [](Element*) {}));
+  EXPECT_NO_ALLOCATIONS(tree.EraseRange(
+      tree.LowerBound([&](const Element& element) {
+        return at_least(element, 100);
+      }),
+      tree.LowerBound([&](const Element& element) {
+        return at_least(element, 200);
+      }),
+      [](Element*) {}));
+  EXPECT_THAT(Validate(tree), IsOk());
+}
+
+TEST_F(RedBlackTreeTest, TestComplexity) {
+  const std::vector<size_t> sizes = { 1 << 6,  1 << 8,  1 << 10,
+                                      1 << 12, 1 << 14, 1 << 16 };
+  // Keys in a scrambled order, which is a permutation of [0, n) for the
+  // power-of-two sizes.
+  auto key = [](size_t i, size_t n) {
+    return static_cast<int>((i * 2654435761) % n);
+  };
+
+  // Comparisons per insert.
+  EXPECT_TRUE(HasComplexity(Complexity::kLogarithmic, sizes, [&](size_t n) {
+    RbTree<Element, CountingElementLess> tree;
+    auto elements = std::make_unique<Element[]>(n);
+    CountingElementLess::comparisons = 0;
+    for (size_t i = 0; i < n; i++) {
+      elements[i].val = key(i, n);
+      tree.Insert(&elements[i]);
+    }
+    return static_cast<double>(CountingElementLess::comparisons) / n;
+  }));
+
+  // Comparisons per lookup.
+  EXPECT_TRUE(HasComplexity(Complexity::kLogarithmic, sizes, [&](size_t n) {
+    ElementTree tree;
+    auto elements = std::make_unique<Element[]>(n);
+    for (size_t i = 0; i < n; i++) {
+      elements[i].val = key(i, n);
+      tree.Insert(&elements[i]);
+    }
+    uint64_t comparisons = 0;
+    for (size_t i = 0; i < n; i++) {
+      tree.LowerBound([&](const Element& element) {
+        comparisons++;
+        return element.val >= static_cast<int>(i);
+      });
+    }
+    return static_cast<double>(comparisons) / n;
+  }));
+}
+
 }  // namespace util
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace util {
+
+// Allocates objects of a single size class out of large blocks.
+//
+// Freed objects are kept on an intrusive free list and reused before any new
+// memory is carved out. Blocks are only returned to the system when the arena
+// is destroyed, all at once, without visiting the objects in them. Destroying
+// the objects themselves is left to the owner.
+//
+// Blocks start at `kMinBlockObjects` objects and double in size up to
+// `kMaxBlockBytes`, so small arenas stay small and large ones make few calls
+// into the system allocator.
+template <size_t kObjectBytes, size_t kAlignment = alignof(std::max_align_t)>
+class SlabArena {
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  static_assert((kAlignment & (kAlignment - 1)) == 0,
+                "kAlignment must be a power of two");
+
+  static constexpr size_t kSlotAlignment =
+      std::max(kAlignment, alignof(FreeSlot));
+  static constexpr size_t kSlotBytes =
+      (std::max(kObjectBytes, sizeof(FreeSlot)) + kSlotAlignment - 1) /
+      kSlotAlignment * kSlotAlignment;
+
+  static constexpr size_t kMinBlockObjects = 16;
+  static constexpr size_t kMaxBlockBytes = 1 << 20;
+
+ public:
+  SlabArena() = default;
+
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+  ~SlabArena() {
+    for (void* block : blocks_) {
+      ::operator delete(block, std::align_val_t(kSlotAlignment));
+    }
+  }
+
+  // Returns uninitialized memory for one object.
+  void* Allocate() {
+    if (free_list_ != nullptr) {
+      FreeSlot* slot = free_list_;
+      free_list_ = slot->next;
+      return slot;
+    }
+    if (next_ == end_) {
+      NewBlock();
+    }
+    void* object = next_;
+    next_ += kSlotBytes;
+    return object;
+  }
+
+  // Returns memory from `Allocate` to the arena. The object in it must already
+  // have been destroyed.
+  void Free(void* object) {
+    FreeSlot* slot = static_cast<FreeSlot*>(object);
+    slot->next = free_list_;
+    free_list_ = slot;
+  }
+
+  // The total size of all blocks allocated by the arena.
+  size_t BytesReserved() const {
+    return bytes_reserved_;
+  }
+
+ private:
+  void NewBlock() {
+    const size_t block_bytes = std::max(
+        kSlotBytes,
+        std::min(kMaxBlockBytes, std::max(kMinBlockObjects * kSlotBytes,
+                                          2 * last_block_bytes_)) /
+            kSlotBytes * kSlotBytes);
+    void* block =
+        ::operator new(block_bytes, std::align_val_t(kSlotAlignment));
+    blocks_.push_back(block);
+    bytes_reserved_ += block_bytes;
+    last_block_bytes_ = block_bytes;
+    next_ = static_cast<std::byte*>(block);
+    end_ = next_ + block_bytes;
+  }
+
+  FreeSlot* free_list_ = nullptr;
+  // The unallocated part of the most recent block.
+  std::byte* next_ = nullptr;
+  std::byte* end_ = nullptr;
+  std::vector<void*> blocks_;
+  size_t last_block_bytes_ = 0;
+  size_t bytes_reserved_ = 0;
+};
+
+}  // namespace util
@@ -0,0 +1,59 @@
+#include "util/data_structs/slab_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace util {
+
+TEST(SlabArenaTest, TestAllocateDistinct) {
+  constexpr size_t kNumObjects = 1000;
+
+  SlabArena<24> arena;
+  std::set<void*> objects;
+  for (size_t i = 0; i < kNumObjects; i++) {
+    void* object = arena.Allocate();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(object) % alignof(std::max_align_t),
+              0);
+    // Objects may not overlap.
+    auto it = objects.lower_bound(object);
+    if (it != objects.end()) {
+      EXPECT_GE(static_cast<char*>(*it) - static_cast<char*>(object), 24);
+    }
+    if (it != objects.begin()) {
+      EXPECT_GE(static_cast<char*>(object) - static_cast<char*>(*--it), 24);
+    }
+    objects.insert(object);
+  }
+  EXPECT_GE(arena.BytesReserved(), kNumObjects * 24);
+}
+
+TEST(SlabArenaTest, TestAlignment) {
+  SlabArena<8, 64> arena;
+  for (size_t i = 0; i < 100; i++) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(arena.Allocate()) % 64, 0);
+  }
+}
+
+TEST(SlabArenaTest, TestReuse) {
+  SlabArena<16> arena;
+  std::vector<void*> objects;
+  for (size_t i = 0; i < 100; i++) {
+    objects.push_back(arena.Allocate());
+  }
+  const size_t bytes_reserved = arena.BytesReserved();
+
+  for (void* object : objects) {
+    arena.Free(object);
+  }
+  // Freed objects are reused in LIFO order without growing the arena.
+  for (size_t i = objects.size(); i > 0; i--) {
+    EXPECT_EQ(arena.Allocate(), objects[i - 1]);
+  }
+  EXPECT_EQ(arena.BytesReserved(), bytes_reserved);
+}
+
+}  // namespace util
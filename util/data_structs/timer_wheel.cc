@@ -0,0 +1,191 @@
+#include "util/data_structs/timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/internal/util.h"
+
+namespace util {
+
+void TimerWheel::Schedule(Timer* timer, uint64_t deadline) {
+  Cancel(timer);
+  timer->deadline_ = deadline;
+  Place(timer);
+  size_++;
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  switch (timer->location_) {
+    case Timer::kIdle:
+      return;
+    case Timer::kWheel: {
+      Unlink(timer);
+      Level& level = levels_[timer->level_];
+      const internal::TimerLink& slot = level.slots[timer->slot_];
+      if (slot.next == &slot) {
+        level.occupied &= ~(uint64_t{ 1 } << timer->slot_);
+      }
+      break;
+    }
+    case Timer::kOverflow:
+      RemoveOverflow(timer);
+      break;
+    case Timer::kOverdue:
+      overdue_.Remove(timer);
+      break;
+    case Timer::kDue:
+      Unlink(timer);
+      break;
+  }
+  timer->location_ = Timer::kIdle;
+  size_--;
+}
+
+uint64_t TimerWheel::NextEvent() const {
+  return overdue_.Size() != 0 || due_.next != &due_ ? now_ : NextWheelEvent();
+}
+
+void TimerWheel::Splice(internal::TimerLink* from, internal::TimerLink* to) {
+  if (from->next == from) {
+    return;
+  }
+
+  from->next->prev = to->prev;
+  from->prev->next = to;
+  to->prev->next = from->next;
+  to->prev = from->prev;
+  from->next = from;
+  from->prev = from;
+}
+
+void TimerWheel::Place(Timer* timer) {
+  const uint64_t deadline = timer->deadline_;
+  if (deadline < now_) {
+    overdue_.Insert(timer);
+    timer->location_ = Timer::kOverdue;
+    return;
+  }
+  if (deadline == now_) {
+    Append(&due_, timer);
+    timer->location_ = Timer::kDue;
+    return;
+  }
+
+  const uint64_t diff = deadline ^ now_;
+  if (diff >= kWheelTicks) {
+    InsertOverflow(timer);
+    return;
+  }
+
+  const size_t level = (63 - std::countl_zero(diff)) / kLevelBits;
+  const size_t slot = (deadline >> (level * kLevelBits)) & (kSlotsPerLevel - 1);
+  Append(&levels_[level].slots[slot], timer);
+  levels_[level].occupied |= uint64_t{ 1 } << slot;
+  timer->location_ = Timer::kWheel;
+  timer->level_ = level;
+  timer->slot_ = slot;
+}
+
+void TimerWheel::InsertOverflow(Timer* timer) {
+  overflow_.Insert(timer);
+  // Equal deadlines are inserted after existing ones.
+  if (overflow_first_ == nullptr ||
+      timer->deadline_ < overflow_first_->deadline_) {
+    overflow_first_ = timer;
+  }
+  timer->location_ = Timer::kOverflow;
+}
+
+void TimerWheel::RemoveOverflow(Timer* timer) {
+  if (timer == overflow_first_) {
+    const RbNode* next = timer->Next();
+    overflow_first_ = next != overflow_.RootSentinel()
+                          ? static_cast<const Timer*>(next)
+                          : nullptr;
+  }
+  overflow_.Remove(timer);
+}
+
+uint64_t TimerWheel::NextWheelEvent() const {
+  uint64_t next = std::numeric_limits<uint64_t>::max();
+  for (size_t level = 0; level < kNumLevels; level++) {
+    // Every timer on a level is in a later slot than the current tick, within
+    // the same span of the level above.
+    const size_t shift = level * kLevelBits;
+    const size_t current = (now_ >> shift) & (kSlotsPerLevel - 1);
+    const uint64_t later =
+        levels_[level].occupied & ~((uint64_t{ 2 } << current) - 1);
+    if (later != 0) {
+      const uint64_t span_start =
+          now_ & ~((uint64_t{ 1 } << (shift + kLevelBits)) - 1);
+      const uint64_t slot = std::countr_zero(later);
+      next = std::min(next, span_start + (slot << shift));
+    }
+  }
+
+  if (overflow_first_ != nullptr) {
+    next = std::min(next, overflow_first_->deadline_ & ~(kWheelTicks - 1));
+  }
+  return next;
+}
+
+void TimerWheel::CollectDue(uint64_t now) {
+  UTIL_DCHECK_GE(now, now_);
+  // Overdue timers are due before any other, as their deadlines are before
+  // the current tick.
+  overdue_.EraseRange(overdue_.LowerBound([](const Timer&) { return true; }),
+                      nullptr, [this](Timer* timer) {
+                        Append(&firing_, timer);
+                        timer->location_ = Timer::kDue;
+                      });
+  while (true) {
+    Splice(&due_, &firing_);
+    const uint64_t tick = NextWheelEvent();
+    if (tick > now) {
+      break;
+    }
+    now_ = tick;
+    ReachTick(tick);
+  }
+  now_ = now;
+}
+
+void TimerWheel::ReachTick(uint64_t tick) {
+  for (size_t l = 0; l < kNumLevels; l++) {
+    const size_t shift = l * kLevelBits;
+    if ((tick & ((uint64_t{ 1 } << shift) - 1)) != 0) {
+      // `tick` is not at the start of a slot on this level, or any above.
+      break;
+    }
+
+    Level& level = levels_[l];
+    const size_t slot = (tick >> shift) & (kSlotsPerLevel - 1);
+    if ((level.occupied >> slot & 1) == 0) {
+      continue;
+    }
+
+    // Timers on level 0 are all due, and go to `due_`. Timers above are placed
+    // on lower levels, or in `due_` if they are due exactly now.
+    level.occupied &= ~(uint64_t{ 1 } << slot);
+    internal::TimerLink timers;
+    Splice(&level.slots[slot], &timers);
+    while (timers.next != &timers) {
+      Timer* timer = static_cast<Timer*>(timers.next);
+      Unlink(timer);
+      Place(timer);
+    }
+  }
+
+  while (overflow_first_ != nullptr &&
+         (overflow_first_->deadline_ ^ tick) < kWheelTicks) {
+    Timer* timer = const_cast<Timer*>(overflow_first_);
+    RemoveOverflow(timer);
+    Place(timer);
+  }
+}
+
+}  // namespace util
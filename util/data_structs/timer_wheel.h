@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/internal/util.h"
+
+namespace util {
+
+class TimerWheel;
+
+namespace internal {
+
+// A link in a circular doubly-linked list of timers.
+struct TimerLink {
+  TimerLink* prev = this;
+  TimerLink* next = this;
+};
+
+}  // namespace internal
+
+// A timer which can be scheduled in a `TimerWheel`. Timers are intrusive:
+// derive from `Timer` to attach state to it. A timer must not be destroyed
+// while it is scheduled.
+class Timer : public RbNode, private internal::TimerLink {
+  friend TimerWheel;
+
+ public:
+  Timer() = default;
+
+  ~Timer() {
+    UTIL_DCHECK(!IsScheduled());
+  }
+
+  // The tick the timer was last scheduled to expire at.
+  uint64_t deadline() const {
+    return deadline_;
+  }
+
+  bool IsScheduled() const {
+    return location_ != kIdle;
+  }
+
+ private:
+  enum Location : uint8_t {
+    kIdle,
+    // In slot `slot_` of level `level_` of the wheel.
+    kWheel,
+    // In the overflow tree.
+    kOverflow,
+    // In the overdue tree, scheduled for a tick which had already passed.
+    kOverdue,
+    // Due, waiting to be passed to the callback of `Advance`.
+    kDue,
+  };
+
+  uint64_t deadline_ = 0;
+  Location location_ = kIdle;
+  uint8_t level_ = 0;
+  uint8_t slot_ = 0;
+};
+
+namespace internal {
+
+struct TimerDeadlineLess {
+  bool operator()(const Timer& t1, const Timer& t2) const {
+    return t1.deadline() < t2.deadline();
+  }
+};
+
+}  // namespace internal
+
+// Schedules timers to expire at a given tick, an arbitrary unit of time.
+//
+// Timers due within `kWheelTicks` of now are kept in a hierarchical timing
+// wheel of `kNumLevels` levels of 64 slots, where a slot on level l spans
+// 64^l ticks. Scheduling and cancelling these is O(1). When the current tick
+// reaches a slot above level 0, its timers are cascaded down to lower levels,
+// so each timer is moved at most `kNumLevels - 1` times. Timers due further
+// out are kept in an `RbTree` ordered by deadline, and moved into the wheel as
+// it comes within range of them. So are timers scheduled for ticks which have
+// passed, which can arrive in any order, until the next `Advance` expires them.
+//
+// This is not thread-safe.
+class TimerWheel {
+ public:
+  static constexpr size_t kLevelBits = 6;
+  static constexpr size_t kSlotsPerLevel = size_t{ 1 } << kLevelBits;
+  static constexpr size_t kNumLevels = 4;
+
+  // The range of deadlines (relative to now) the wheel holds, as timers are
+  // placed by the highest 6-bit group of ticks their deadline differs from now
+  // in.
+  static constexpr uint64_t kWheelTicks = uint64_t{ 1 }
+                                          << (kLevelBits * kNumLevels);
+
+  explicit TimerWheel(uint64_t now = 0) : now_(now) {}
+
+  // Slots and timers point back into the wheel.
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+  TimerWheel& operator=(TimerWheel&&) = delete;
+
+  // The current tick.
+  uint64_t Now() const {
+    return now_;
+  }
+
+  // The number of scheduled timers.
+  size_t Size() const {
+    return size_;
+  }
+
+  // Schedules `timer` to expire at `deadline`, first cancelling it if it is
+  // already scheduled. A timer scheduled for `Now()` or earlier expires on the
+  // next call to `Advance`.
+  void Schedule(Timer* timer, uint64_t deadline);
+
+  // Unschedules `timer`, if it is scheduled.
+  void Cancel(Timer* timer);
+
+  // Returns the earliest tick at which `Advance` may expire a timer, or
+  // UINT64_MAX if there are no timers. Since timers in the upper levels of the
+  // wheel and the overflow tree are only sorted coarsely, this may be earlier
+  // than the earliest deadline.
+  uint64_t NextEvent() const;
+
+  // Advances the current tick to `now`, and calls `fn(Timer*)` on every timer
+  // due by then, in order of deadline, and of scheduling among equal
+  // deadlines. This includes timers scheduled for ticks which had already
+  // passed. Each timer is unscheduled before it is passed to `fn`, which may
+  // schedule or cancel any timer; timers it schedules for `Now()` or earlier
+  // expire on the next call. Returns the number of timers expired.
+  template <typename Fn>
+  size_t Advance(uint64_t now, Fn fn) {
+    CollectDue(now);
+    size_t expired = 0;
+    while (firing_.next != &firing_) {
+      Timer* timer = static_cast<Timer*>(firing_.next);
+      Unlink(timer);
+      timer->location_ = Timer::kIdle;
+      size_--;
+      fn(timer);
+      expired++;
+    }
+    return expired;
+  }
+
+ private:
+  struct Level {
+    // Bit s is set if slot s is not empty.
+    uint64_t occupied = 0;
+    internal::TimerLink slots[kSlotsPerLevel];
+  };
+
+  static void Append(internal::TimerLink* list, internal::TimerLink* link) {
+    link->prev = list->prev;
+    link->next = list;
+    list->prev->next = link;
+    list->prev = link;
+  }
+
+  static void Unlink(internal::TimerLink* link) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+  }
+
+  // Moves all timers in `from` to the end of `to`.
+  static void Splice(internal::TimerLink* from, internal::TimerLink* to);
+
+  // Places a timer which is not scheduled according to its deadline.
+  void Place(Timer* timer);
+
+  void InsertOverflow(Timer* timer);
+
+  void RemoveOverflow(Timer* timer);
+
+  // The next tick at which a slot of the wheel is reached, or the earliest
+  // overflow timer comes within range of the wheel.
+  uint64_t NextWheelEvent() const;
+
+  // Advances the current tick to `now`, moving all timers due by then to
+  // `firing_`, in order of deadline.
+  void CollectDue(uint64_t now);
+
+  // Expires or cascades the timers in the slots which start at `tick`, the
+  // current tick, and moves overflow timers which are now in range of the
+  // wheel.
+  void ReachTick(uint64_t tick);
+
+  uint64_t now_;
+  size_t size_ = 0;
+  Level levels_[kNumLevels];
+
+  RbTree<Timer, internal::TimerDeadlineLess> overflow_;
+  // The timer in `overflow_` with the earliest deadline.
+  const Timer* overflow_first_ = nullptr;
+
+  // Timers scheduled for a tick before the current one, which may be in any
+  // order, so they are kept sorted by deadline.
+  RbTree<Timer, internal::TimerDeadlineLess> overdue_;
+  // Timers due at the current tick.
+  internal::TimerLink due_;
+  // Timers being passed to the callback of `Advance`.
+  internal::TimerLink firing_;
+};
+
+}  // namespace util
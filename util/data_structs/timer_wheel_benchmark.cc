@@ -0,0 +1,152 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "util/data_structs/red_black_tree.h"
+#include "util/data_structs/timer_wheel.h"
+
+namespace util {
+
+namespace {
+
+// With 1ms ticks, near timeouts are 30-60 seconds, and far timeouts about 18
+// hours, beyond the range of the wheel.
+constexpr uint64_t kNearTimeout = 30000;
+constexpr uint64_t kFarTimeout = uint64_t{ 1 } << 26;
+
+// The number of timers rescheduled per tick, besides the ones that expire.
+constexpr size_t kReschedulesPerTick = 64;
+
+// The baseline: an `RbTree` ordered by deadline, which removes and reinserts
+// rescheduled timers, and finds the leftmost timer on every tick.
+class RbTreeTimers {
+ public:
+  struct Entry : public RbNode {
+    uint64_t deadline;
+    bool scheduled = false;
+  };
+
+  void Schedule(Entry* entry, uint64_t deadline) {
+    if (entry->scheduled) {
+      tree_.Remove(entry);
+    }
+    entry->deadline = deadline;
+    entry->scheduled = true;
+    tree_.Insert(entry);
+  }
+
+  void Cancel(Entry* entry) {
+    if (entry->scheduled) {
+      tree_.Remove(entry);
+      entry->scheduled = false;
+    }
+  }
+
+  template <typename Fn>
+  void Advance(uint64_t now, Fn fn) {
+    for (Entry* entry;
+         (entry = tree_.LowerBound([](const Entry&) { return true; })) !=
+             nullptr &&
+         entry->deadline <= now;) {
+      tree_.Remove(entry);
+      entry->scheduled = false;
+      fn(entry);
+    }
+  }
+
+ private:
+  struct DeadlineLess {
+    bool operator()(const Entry& e1, const Entry& e2) const {
+      return e1.deadline < e2.deadline;
+    }
+  };
+
+  RbTree<Entry, DeadlineLess> tree_;
+};
+
+class WheelTimers {
+ public:
+  struct Entry : public Timer {};
+
+  void Schedule(Entry* entry, uint64_t deadline) {
+    wheel_.Schedule(entry, deadline);
+  }
+
+  void Cancel(Entry* entry) {
+    wheel_.Cancel(entry);
+  }
+
+  template <typename Fn>
+  void Advance(uint64_t now, Fn fn) {
+    wheel_.Advance(now, [&fn](Timer* timer) {
+      fn(static_cast<Entry*>(timer));
+    });
+  }
+
+ private:
+  TimerWheel wheel_;
+};
+
+// Args: n, the percentage of timers with far deadlines.
+//
+// Models idle timeouts of `n` connections with 1ms ticks. Every tick, the
+// timers which expire are rescheduled (as keepalives), and
+// `kReschedulesPerTick` random connections see activity and push their
+// timeouts back.
+template <typename Timers>
+void BM_Reschedule(benchmark::State& state) {
+  using Entry = typename Timers::Entry;
+  const size_t n = state.range(0);
+  const uint64_t far_percent = state.range(1);
+
+  std::mt19937_64 gen(0);
+  uint64_t now = 0;
+  auto timeout = [&gen, &now, far_percent]() {
+    return gen() % 100 < far_percent ? now + kFarTimeout + gen() % kNearTimeout
+                                     : now + kNearTimeout + gen() % kNearTimeout;
+  };
+
+  std::vector<Entry> entries(n);
+  Timers timers;
+  for (Entry& entry : entries) {
+    // Spread out the first deadlines, so that timers expire at a steady rate.
+    timers.Schedule(&entry, timeout() - kNearTimeout);
+  }
+
+  size_t ops = 0;
+  for (auto _ : state) {
+    now++;
+    timers.Advance(now, [&](Entry* entry) {
+      timers.Schedule(entry, timeout());
+      ops++;
+    });
+    for (size_t i = 0; i < kReschedulesPerTick; i++) {
+      timers.Schedule(&entries[gen() % n], timeout());
+    }
+    ops += kReschedulesPerTick;
+  }
+  state.SetItemsProcessed(ops);
+
+  for (Entry& entry : entries) {
+    timers.Cancel(&entry);
+  }
+}
+
+void RescheduleArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "n", "far%" });
+  for (int64_t n : { 1 << 10, 1 << 16, 1 << 20 }) {
+    for (int64_t far_percent : { 0, 10 }) {
+      b->Args({ n, far_percent });
+    }
+  }
+}
+
+BENCHMARK(BM_Reschedule<RbTreeTimers>)->Apply(RescheduleArgs);
+BENCHMARK(BM_Reschedule<WheelTimers>)->Apply(RescheduleArgs);
+
+}  // namespace
+
+}  // namespace util
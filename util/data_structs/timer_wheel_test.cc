@@ -0,0 +1,250 @@
+#include "util/data_structs/timer_wheel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace util {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAreArray;
+
+struct TestTimer : public Timer {
+  int id = 0;
+};
+
+std::vector<int> AdvanceIds(TimerWheel& wheel, uint64_t now) {
+  std::vector<int> ids;
+  wheel.Advance(now, [&ids](Timer* timer) {
+    ids.push_back(static_cast<TestTimer*>(timer)->id);
+  });
+  return ids;
+}
+
+TEST(TimerWheelTest, TestEmpty) {
+  TimerWheel wheel(10);
+  EXPECT_EQ(wheel.Now(), 10);
+  EXPECT_EQ(wheel.Size(), 0);
+  EXPECT_EQ(wheel.NextEvent(), std::numeric_limits<uint64_t>::max());
+  EXPECT_THAT(AdvanceIds(wheel, 1000), IsEmpty());
+  EXPECT_EQ(wheel.Now(), 1000);
+}
+
+// Timers on every level of the wheel, and in the overflow tree, expire on
+// their deadline and not before.
+TEST(TimerWheelTest, TestExpiresAtDeadline) {
+  const std::vector<uint64_t> delays = {
+    1,        63,      64,      65,        4095,
+    4096,     4097,    262143,  262144,    TimerWheel::kWheelTicks - 1,
+    TimerWheel::kWheelTicks,    TimerWheel::kWheelTicks + 1,
+    uint64_t{ 1 } << 40,
+  };
+  constexpr uint64_t kStart = 12345;
+
+  TimerWheel wheel(kStart);
+  std::vector<TestTimer> timers(delays.size());
+  for (size_t i = 0; i < delays.size(); i++) {
+    timers[i].id = i;
+    wheel.Schedule(&timers[i], kStart + delays[i]);
+  }
+  EXPECT_EQ(wheel.Size(), delays.size());
+
+  for (size_t i = 0; i < delays.size(); i++) {
+    EXPECT_THAT(AdvanceIds(wheel, kStart + delays[i] - 1), IsEmpty());
+    EXPECT_THAT(AdvanceIds(wheel, kStart + delays[i]),
+                ElementsAre(static_cast<int>(i)));
+    EXPECT_FALSE(timers[i].IsScheduled());
+  }
+  EXPECT_EQ(wheel.Size(), 0);
+}
+
+TEST(TimerWheelTest, TestExpiresInDeadlineOrder) {
+  TimerWheel wheel;
+  std::vector<TestTimer> timers(5);
+  const uint64_t deadlines[] = { 5000, 70, 70, 3, 1 << 30 };
+  for (size_t i = 0; i < timers.size(); i++) {
+    timers[i].id = i;
+    wheel.Schedule(&timers[i], deadlines[i]);
+  }
+
+  EXPECT_THAT(AdvanceIds(wheel, uint64_t{ 1 } << 31),
+              ElementsAre(3, 1, 2, 0, 4));
+}
+
+TEST(TimerWheelTest, TestCancel) {
+  TimerWheel wheel;
+  TestTimer near;
+  TestTimer far;
+  near.id = 1;
+  far.id = 2;
+  wheel.Schedule(&near, 10);
+  wheel.Schedule(&far, uint64_t{ 1 } << 32);
+  wheel.Cancel(&near);
+  wheel.Cancel(&far);
+  wheel.Cancel(&far);
+  EXPECT_EQ(wheel.Size(), 0);
+  EXPECT_EQ(wheel.NextEvent(), std::numeric_limits<uint64_t>::max());
+  EXPECT_THAT(AdvanceIds(wheel, uint64_t{ 1 } << 33), IsEmpty());
+}
+
+TEST(TimerWheelTest, TestScheduleInPast) {
+  TimerWheel wheel(100);
+  TestTimer timer;
+  timer.id = 1;
+  wheel.Schedule(&timer, 50);
+  EXPECT_EQ(wheel.NextEvent(), 100);
+  EXPECT_THAT(AdvanceIds(wheel, 100), ElementsAre(1));
+}
+
+// Timers scheduled for ticks which have passed expire in order of deadline,
+// not of scheduling, and before timers due later.
+TEST(TimerWheelTest, TestScheduleInPastExpiresInDeadlineOrder) {
+  TimerWheel wheel(1000);
+  std::vector<TestTimer> timers(6);
+  const uint64_t deadlines[] = { 1001, 500, 999, 1000, 0, 500 };
+  for (size_t i = 0; i < timers.size(); i++) {
+    timers[i].id = i;
+    wheel.Schedule(&timers[i], deadlines[i]);
+  }
+  wheel.Cancel(&timers[2]);
+
+  EXPECT_EQ(wheel.NextEvent(), 1000);
+  EXPECT_THAT(AdvanceIds(wheel, 1001), ElementsAre(4, 1, 5, 3, 0));
+  EXPECT_EQ(wheel.Size(), 0);
+}
+
+// Cancelling or rescheduling a timer due in the same `Advance` keeps it from
+// expiring, wherever it was scheduled.
+TEST(TimerWheelTest, TestCancelDueFromCallback) {
+  TimerWheel wheel(100);
+  TestTimer first;
+  TestTimer overdue;
+  TestTimer due;
+  first.id = 1;
+  overdue.id = 2;
+  due.id = 3;
+  wheel.Schedule(&first, 10);
+  wheel.Schedule(&overdue, 20);
+  wheel.Schedule(&due, 100);
+
+  std::vector<int> ids;
+  wheel.Advance(100, [&](Timer* timer) {
+    ids.push_back(static_cast<TestTimer*>(timer)->id);
+    if (timer == &first) {
+      wheel.Cancel(&overdue);
+      wheel.Schedule(&due, 200);
+    }
+  });
+  EXPECT_THAT(ids, ElementsAre(1));
+  EXPECT_THAT(AdvanceIds(wheel, 200), ElementsAre(3));
+}
+
+TEST(TimerWheelTest, TestRescheduleFromCallback) {
+  constexpr uint64_t kPeriod = 1000;
+
+  TimerWheel wheel;
+  TestTimer periodic;
+  TestTimer cancelled;
+  wheel.Schedule(&periodic, kPeriod);
+  wheel.Schedule(&cancelled, kPeriod);
+
+  size_t fired = 0;
+  for (uint64_t now = 0; now <= 100 * kPeriod; now += 8) {
+    wheel.Advance(now, [&](Timer* timer) {
+      EXPECT_EQ(timer, &periodic);
+      fired++;
+      wheel.Schedule(timer, timer->deadline() + kPeriod);
+      // Cancel a timer which is due at the same time.
+      wheel.Cancel(&cancelled);
+    });
+  }
+  EXPECT_EQ(fired, 100);
+  wheel.Cancel(&periodic);
+}
+
+// Applies random operations to a wheel and to a reference map of deadlines,
+// and checks that they expire the same timers.
+TEST(TimerWheelTest, TestRandomAgainstReference) {
+  constexpr size_t kNumTimers = 500;
+  constexpr size_t kNumOps = 50000;
+
+  std::mt19937_64 gen(0);
+  // Delays are spread over all levels of the wheel, and beyond.
+  auto random_delay = [&gen]() -> uint64_t {
+    const uint64_t bits = gen() % 34;
+    return gen() & ((uint64_t{ 1 } << bits) - 1);
+  };
+
+  TimerWheel wheel(gen() % 1000000);
+  std::vector<TestTimer> timers(kNumTimers);
+  std::multimap<uint64_t, int> expected;
+  std::vector<std::multimap<uint64_t, int>::iterator> entries(kNumTimers);
+  for (size_t i = 0; i < kNumTimers; i++) {
+    timers[i].id = i;
+    entries[i] = expected.end();
+  }
+
+  for (size_t op = 0; op < kNumOps; op++) {
+    const size_t i = gen() % kNumTimers;
+    switch (gen() % 4) {
+      case 0:
+      case 1: {
+        // Some timers are scheduled for ticks which have passed.
+        const uint64_t deadline =
+            gen() % 8 == 0 ? wheel.Now() - std::min(wheel.Now(), random_delay())
+                           : wheel.Now() + random_delay();
+        wheel.Schedule(&timers[i], deadline);
+        if (entries[i] != expected.end()) {
+          expected.erase(entries[i]);
+        }
+        entries[i] = expected.emplace(deadline, i);
+        break;
+      }
+      case 2:
+        wheel.Cancel(&timers[i]);
+        if (entries[i] != expected.end()) {
+          expected.erase(entries[i]);
+          entries[i] = expected.end();
+        }
+        break;
+      case 3: {
+        if (!expected.empty()) {
+          ASSERT_LE(wheel.NextEvent(),
+                    std::max(expected.begin()->first, wheel.Now()));
+        }
+        const uint64_t now = wheel.Now() + random_delay() / 4;
+        std::vector<int> due;
+        while (!expected.empty() && expected.begin()->first <= now) {
+          due.push_back(expected.begin()->second);
+          entries[expected.begin()->second] = expected.end();
+          expected.erase(expected.begin());
+        }
+
+        uint64_t last_deadline = 0;
+        std::vector<int> fired;
+        wheel.Advance(now, [&](Timer* timer) {
+          EXPECT_GE(timer->deadline(), last_deadline);
+          last_deadline = timer->deadline();
+          fired.push_back(static_cast<TestTimer*>(timer)->id);
+        });
+        ASSERT_THAT(fired, UnorderedElementsAreArray(due)) << "op " << op;
+        break;
+      }
+    }
+    ASSERT_EQ(wheel.Size(), expected.size());
+  }
+
+  for (TestTimer& timer : timers) {
+    wheel.Cancel(&timer);
+  }
+}
+
+}  // namespace util
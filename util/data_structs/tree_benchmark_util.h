@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "util/data_structs/red_black_tree.h"
+
+namespace util {
+
+// An element of the intrusive trees of benchmarks, ordered by `key`.
+struct BenchmarkElement : public RbNode {
+  uint64_t key;
+};
+
+struct BenchmarkElementLess {
+  bool operator()(const BenchmarkElement& e1,
+                  const BenchmarkElement& e2) const {
+    return e1.key < e2.key;
+  }
+};
+
+using BenchmarkRbTree = RbTree<BenchmarkElement, BenchmarkElementLess>;
+
+// Returns the keys 0, 1, ..., n - 1 in a random order, the same for each `n`.
+inline std::vector<uint64_t> ShuffledKeys(size_t n) {
+  std::vector<uint64_t> keys(n);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(n));
+  return keys;
+}
+
+// Returns `num_keys` keys drawn uniformly from [0, max_key], the same for each
+// `seed`.
+inline std::vector<uint64_t> RandomKeys(size_t num_keys, uint64_t max_key,
+                                        uint64_t seed = 0) {
+  std::mt19937_64 gen(seed);
+  std::uniform_int_distribution<uint64_t> dist(0, max_key);
+  std::vector<uint64_t> keys(num_keys);
+  for (uint64_t& key : keys) {
+    key = dist(gen);
+  }
+  return keys;
+}
+
+// The order in which a `BenchmarkTree` inserts its elements.
+enum class BenchmarkInsertOrder {
+  kRandom,
+  // Much faster than a random order for large trees.
+  kByKey,
+};
+
+// An intrusive tree (`RbTree`, `BTree`, ...) of `n` elements with keys 0,
+// `key_step`, 2 * `key_step`, ... The keys are assigned to elements in a
+// random order, so in-order neighbors are not adjacent in memory.
+template <typename Tree = BenchmarkRbTree>
+class BenchmarkTree {
+ public:
+  explicit BenchmarkTree(
+      size_t n, uint64_t key_step = 1,
+      BenchmarkInsertOrder order = BenchmarkInsertOrder::kRandom)
+      : elements_(new BenchmarkElement[n]) {
+    const std::vector<uint64_t> shuffled = ShuffledKeys(n);
+    for (size_t i = 0; i < n; i++) {
+      if (order == BenchmarkInsertOrder::kRandom) {
+        elements_[i].key = key_step * shuffled[i];
+        tree_.Insert(&elements_[i]);
+      } else {
+        BenchmarkElement& element = elements_[shuffled[i]];
+        element.key = key_step * i;
+        tree_.Insert(&element);
+      }
+    }
+  }
+
+  Tree& tree() {
+    return tree_;
+  }
+
+  BenchmarkElement& element(size_t i) {
+    return elements_[i];
+  }
+
+ private:
+  std::unique_ptr<BenchmarkElement[]> elements_;
+  Tree tree_;
+};
+
+}  // namespace util
@@ -0,0 +1,329 @@
+#include "util/frame_buffer.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
+#include "util/csi.h"
+#include "util/print_colors.h"
+
+namespace util {
+
+namespace {
+
+constexpr FrameBuffer::Cell kBlank;
+
+// The length of CSI_EL, which is worth a move when erasing more cells.
+constexpr size_t kEraseLength = sizeof(CSI_EL(CSI_CURSOR_BEFORE)) - 1;
+
+size_t Digits(size_t n) {
+  size_t digits = 1;
+  for (; n >= 10; n /= 10) {
+    digits++;
+  }
+  return digits;
+}
+
+// The length of a control sequence with the single argument `n`.
+size_t CsiLength(size_t n) {
+  return 3 + Digits(n);
+}
+
+void AppendUtf8(std::string& out, char32_t c) {
+  if (c < 0x80) {
+    out.push_back(static_cast<char>(c));
+  } else if (c < 0x800) {
+    out.push_back(static_cast<char>(0xc0 | (c >> 6)));
+    out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+  } else if (c < 0x10000) {
+    out.push_back(static_cast<char>(0xe0 | (c >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+  } else {
+    out.push_back(static_cast<char>(0xf0 | (c >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+  }
+}
+
+// Decodes the code point at `pos` of `text`, and advances `pos` past it.
+// Malformed sequences decode to U+FFFD, one byte at a time.
+char32_t DecodeUtf8(std::string_view text, size_t& pos) {
+  constexpr char32_t kReplacement = 0xfffd;
+  const auto byte = [&](size_t i) { return static_cast<uint8_t>(text[i]); };
+  const uint8_t lead = byte(pos++);
+  if (lead < 0x80) {
+    return lead;
+  }
+  size_t length;
+  char32_t c;
+  if ((lead & 0xe0) == 0xc0) {
+    length = 1;
+    c = lead & 0x1f;
+  } else if ((lead & 0xf0) == 0xe0) {
+    length = 2;
+    c = lead & 0x0f;
+  } else if ((lead & 0xf8) == 0xf0) {
+    length = 3;
+    c = lead & 0x07;
+  } else {
+    return kReplacement;
+  }
+  if (text.size() - pos < length) {
+    return kReplacement;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if ((byte(pos + i) & 0xc0) != 0x80) {
+      return kReplacement;
+    }
+    c = (c << 6) | (byte(pos + i) & 0x3f);
+  }
+  pos += length;
+  return c;
+}
+
+}  // namespace
+
+FrameBuffer::FrameBuffer(size_t rows, size_t cols)
+    : rows_(rows),
+      cols_(cols),
+      front_(rows * cols),
+      back_(rows * cols) {}
+
+void FrameBuffer::Resize(size_t rows, size_t cols) {
+  rows_ = rows;
+  cols_ = cols;
+  front_.assign(rows * cols, kBlank);
+  back_.assign(rows * cols, kBlank);
+  Invalidate();
+}
+
+void FrameBuffer::Clear(Style style) {
+  std::fill(back_.begin(), back_.end(), Cell{ .style = style });
+}
+
+size_t FrameBuffer::Print(size_t row, size_t col, std::string_view text,
+                          Style style) {
+  size_t pos = 0;
+  for (; col < cols_ && pos < text.size(); col++) {
+    at(row, col) = Cell{ .glyph = DecodeUtf8(text, pos), .style = style };
+  }
+  return col;
+}
+
+std::string FrameBuffer::ToString() const {
+  std::string out;
+  for (size_t row = 0; row < rows_; row++) {
+    size_t end = cols_;
+    while (end > 0 && at(row, end - 1).glyph == U' ') {
+      end--;
+    }
+    for (size_t col = 0; col < end; col++) {
+      AppendUtf8(out, at(row, col).glyph);
+    }
+    out.push_back('\n');
+  }
+  return out;
+}
+
+void FrameBuffer::Invalidate() {
+  invalid_ = true;
+}
+
+void FrameBuffer::EnterAlternateDisplay() {
+  pending_.append(CSI_ALTERNATE_DISPLAY CSI_HIDE);
+  Invalidate();
+}
+
+std::string_view FrameBuffer::LeaveAlternateDisplay() {
+  out_.assign(pending_);
+  pending_.clear();
+  out_.append(P_RESET CSI_SHOW CSI_MAIN_DISPLAY);
+  pen_ = {};
+  Invalidate();
+  return out_;
+}
+
+std::string_view FrameBuffer::Render() {
+  out_.assign(pending_);
+  pending_.clear();
+  if (invalid_) {
+    out_.append(P_RESET CSI_CHP(1, 1) CSI_ED(CSI_CURSOR_ALL));
+    pen_ = {};
+    cursor_ = { .row = 0, .col = 0, .known = true };
+    std::fill(front_.begin(), front_.end(), kBlank);
+    invalid_ = false;
+  }
+  for (size_t row = 0; row < rows_; row++) {
+    RenderRow(row);
+  }
+  return out_;
+}
+
+absl::Status FrameBuffer::RenderTo(int fd) {
+  std::string_view out = Render();
+  while (!out.empty()) {
+    const ssize_t written = write(fd, out.data(), out.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return absl::ErrnoToStatus(errno, "Failed to write the frame");
+    }
+    out.remove_prefix(written);
+  }
+  return absl::OkStatus();
+}
+
+void FrameBuffer::RenderRow(size_t row) {
+  Cell* front = &front_[row * cols_];
+  const Cell* back = &back_[row * cols_];
+  // Most rows of most frames are unchanged.
+  if (std::equal(back, back + cols_, front)) {
+    return;
+  }
+
+  // From `blank` on, the row is blank, and may be erased rather than written
+  // if enough of it changed.
+  size_t blank = cols_;
+  while (blank > 0 && back[blank - 1] == kBlank) {
+    blank--;
+  }
+  const size_t erased =
+      std::count_if(front + blank, front + cols_,
+                    [](const Cell& cell) { return cell != kBlank; });
+  const bool erase = erased > kEraseLength;
+
+  const size_t end = erase ? blank : cols_;
+  for (size_t col = 0; col < end; col++) {
+    if (front[col] == back[col]) {
+      continue;
+    }
+    MoveTo(row, col);
+    Put(back[col]);
+    front[col] = back[col];
+  }
+  if (erase) {
+    MoveTo(row, blank);
+    SetStyle({});
+    // From the cursor to the end of the line.
+    out_.append(CSI_EL(CSI_CURSOR_BEFORE));
+    std::fill(front + blank, front + cols_, kBlank);
+  }
+}
+
+void FrameBuffer::MoveTo(size_t row, size_t col) {
+  if (cursor_.known && cursor_.row == row && cursor_.col == col) {
+    return;
+  }
+
+  // The cheapest sequence which works from anywhere.
+  size_t best = 4 + Digits(row + 1) + Digits(col + 1);
+  enum { kPosition, kRewrite, kForward, kColumn, kReturn, kNewLine } move =
+      kPosition;
+  const auto consider = [&](size_t length, decltype(move) candidate) {
+    if (length < best) {
+      best = length;
+      move = candidate;
+    }
+  };
+  if (cursor_.known && cursor_.row == row) {
+    if (cursor_.col < col) {
+      // Over a short gap of unchanged cells, writing them again is shorter
+      // than moving, if they need no attribute changes.
+      const Cell* gap = &back_[row * cols_ + cursor_.col];
+      const size_t gap_length = col - cursor_.col;
+      if (std::all_of(gap, gap + gap_length, [&](const Cell& cell) {
+            return cell.glyph < 0x80 && cell.style == pen_;
+          })) {
+        consider(gap_length, kRewrite);
+      }
+      consider(CsiLength(gap_length), kForward);
+    }
+    consider(CsiLength(col + 1), kColumn);
+    consider(col == 0 ? 1 : 1 + CsiLength(col), kReturn);
+  } else if (cursor_.known && cursor_.row + 1 == row) {
+    consider(col == 0 ? 2 : 2 + CsiLength(col), kNewLine);
+  }
+
+  switch (move) {
+    case kPosition:
+      absl::StrAppendFormat(&out_, CSI_VAR_CHP, row + 1, col + 1);
+      break;
+    case kRewrite:
+      for (size_t c = cursor_.col; c < col; c++) {
+        Put(back_[row * cols_ + c]);
+      }
+      break;
+    case kForward:
+      absl::StrAppendFormat(&out_, CSI_VAR_CUR, col - cursor_.col);
+      break;
+    case kColumn:
+      absl::StrAppendFormat(&out_, CSI_VAR_CHA, col + 1);
+      break;
+    case kReturn:
+      out_.push_back('\r');
+      if (col != 0) {
+        absl::StrAppendFormat(&out_, CSI_VAR_CUR, col);
+      }
+      break;
+    case kNewLine:
+      out_.append("\r\n");
+      if (col != 0) {
+        absl::StrAppendFormat(&out_, CSI_VAR_CUR, col);
+      }
+      break;
+  }
+  cursor_ = { .row = row, .col = col, .known = true };
+}
+
+void FrameBuffer::SetStyle(const Style& style) {
+  if (style == pen_) {
+    return;
+  }
+  // Bold is only turned off by a reset of all attributes.
+  if (pen_.bold && !style.bold) {
+    out_.append(P_RESET);
+    pen_ = {};
+  }
+  if (style.bold && !pen_.bold) {
+    out_.append(BOLD);
+  }
+  if (style.fg != pen_.fg) {
+    if (style.fg == FrameStyle::kDefaultColor) {
+      out_.append(P_256_DEFAULT);
+    } else {
+      absl::StrAppendFormat(&out_, P_256_VAR_COLOR, style.fg);
+    }
+  }
+  if (style.bg != pen_.bg) {
+    if (style.bg == FrameStyle::kDefaultColor) {
+      out_.append(P_256_BG_DEFAULT);
+    } else {
+      absl::StrAppendFormat(&out_, P_256_BG_VAR_COLOR, style.bg);
+    }
+  }
+  pen_ = style;
+}
+
+void FrameBuffer::Put(const Cell& cell) {
+  SetStyle(cell.style);
+  // Control characters would move the cursor.
+  const bool control =
+      cell.glyph < 0x20 || (cell.glyph >= 0x7f && cell.glyph < 0xa0);
+  AppendUtf8(out_, control ? U'?' : cell.glyph);
+  // After the last column, terminals differ in where the cursor is.
+  if (++cursor_.col == cols_) {
+    cursor_.known = false;
+  }
+}
+
+}  // namespace util
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace util {
+
+// The attributes of a cell of a `FrameBuffer`. Colors are indices into the
+// 256-color palette, as with `P_256_COLOR` (0-15 are the basic and light
+// colors), or `kDefaultColor`.
+struct FrameStyle {
+  // The terminal's default color.
+  static constexpr uint16_t kDefaultColor = 256;
+
+  uint16_t fg = kDefaultColor;
+  uint16_t bg = kDefaultColor;
+  bool bold = false;
+
+  bool operator==(const FrameStyle&) const = default;
+};
+
+struct FrameCell {
+  char32_t glyph = U' ';
+  FrameStyle style;
+
+  bool operator==(const FrameCell&) const = default;
+};
+
+// A double-buffered terminal screen. Frames are drawn into the back buffer,
+// and `Render` emits only the escape sequences and text which turn the last
+// rendered frame into it: the fewest cursor moves, attribute changes and erases
+// it can find, in a single buffer.
+//
+// Glyphs are assumed to be one column wide.
+//
+// Example:
+//   FrameBuffer screen(rows, cols);
+//   screen.EnterAlternateDisplay();
+//   while (running) {
+//     screen.Clear();
+//     screen.Print(0, 0, absl::StrCat("qps: ", qps), { .fg = 10 });
+//     RETURN_IF_ERROR(screen.RenderTo(STDOUT_FILENO));
+//   }
+//   std::string_view leave = screen.LeaveAlternateDisplay();
+//   write(STDOUT_FILENO, leave.data(), leave.size());
+class FrameBuffer {
+ public:
+  using Cell = FrameCell;
+  using Style = FrameStyle;
+
+  FrameBuffer(size_t rows, size_t cols);
+
+  size_t rows() const {
+    return rows_;
+  }
+
+  size_t cols() const {
+    return cols_;
+  }
+
+  // Resizes the screen, clearing it. The next frame is drawn in full.
+  void Resize(size_t rows, size_t cols);
+
+  // Fills the back buffer with blanks of `style`.
+  void Clear(Style style = {});
+
+  // The cell at (`row`, `col`) of the back buffer.
+  Cell& at(size_t row, size_t col) {
+    return back_[row * cols_ + col];
+  }
+
+  const Cell& at(size_t row, size_t col) const {
+    return back_[row * cols_ + col];
+  }
+
+  // Draws UTF-8 `text` from (`row`, `col`), clipped to the row. Returns the
+  // column after the last glyph drawn.
+  size_t Print(size_t row, size_t col, std::string_view text, Style style = {});
+
+  // Returns the glyphs of the back buffer, without attributes, as a line per
+  // row without trailing spaces.
+  std::string ToString() const;
+
+  // Draws the next frame in full, e.g. after something else wrote to the
+  // terminal.
+  void Invalidate();
+
+  // Switches to the alternate display, with the cursor hidden, from the next
+  // frame.
+  void EnterAlternateDisplay();
+
+  // Returns the sequence which restores the main display and the cursor, to
+  // write after the last frame. Frames rendered after it are drawn in full.
+  std::string_view LeaveAlternateDisplay();
+
+  // Returns the output which updates the terminal from the last rendered frame
+  // to the back buffer, which becomes the last rendered frame. The back buffer
+  // keeps its contents. The output is valid until the next call.
+  std::string_view Render();
+
+  // Renders the frame, and writes it to `fd` in a single write (unless the
+  // write is partial).
+  absl::Status RenderTo(int fd);
+
+ private:
+  // Where the terminal's cursor is, if known.
+  struct Cursor {
+    size_t row = 0;
+    size_t col = 0;
+    bool known = false;
+  };
+
+  void RenderRow(size_t row);
+
+  // Moves the cursor to (`row`, `col`), with the shortest sequence.
+  void MoveTo(size_t row, size_t col);
+
+  void SetStyle(const Style& style);
+
+  void Put(const Cell& cell);
+
+  size_t rows_;
+  size_t cols_;
+  // The last rendered frame, as the terminal shows it.
+  std::vector<Cell> front_;
+  // The frame being drawn.
+  std::vector<Cell> back_;
+
+  // Whether the terminal must be cleared, and the front buffer with it, before
+  // the next frame.
+  bool invalid_ = true;
+  Cursor cursor_;
+  // The terminal's current attributes.
+  Style pen_;
+
+  // Output queued for the next frame.
+  std::string pending_;
+  std::string out_;
+};
+
+}  // namespace util
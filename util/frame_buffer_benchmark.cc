@@ -0,0 +1,85 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "absl/strings/str_format.h"
+#include "benchmark/benchmark.h"
+
+#include "util/frame_buffer.h"
+
+namespace util {
+
+namespace {
+
+constexpr size_t kRows = 40;
+constexpr size_t kCols = 120;
+
+// The number of lines in the log pane of `DrawDashboard`.
+constexpr size_t kLogRows = 24;
+
+// Draws frame `frame` of a dashboard: a title bar, a table of counters of
+// which a few change each frame, and a log pane scrolling a line a frame.
+void DrawDashboard(FrameBuffer& screen, uint64_t frame) {
+  screen.Clear();
+  screen.Print(0, 0, absl::StrFormat(" dashboard %*s", kCols - 11, "uptime"),
+               { .fg = 15, .bg = 4, .bold = true });
+  for (size_t i = 0; i < kRows - kLogRows - 3; i++) {
+    const uint64_t value = i < 4 ? frame * (i + 1) * 7919 : i * 1000;
+    screen.Print(i + 2, 2, absl::StrFormat("counter_%02d", i), { .fg = 6 });
+    screen.Print(i + 2, 24, absl::StrFormat("%12d", value));
+    screen.Print(i + 2, 40, i < 4 ? "changing" : "steady",
+                 { .fg = static_cast<uint16_t>(i < 4 ? 2 : 8) });
+  }
+  for (size_t i = 0; i < kLogRows; i++) {
+    const uint64_t line = frame + i;
+    const std::string text =
+        absl::StrFormat("I%06d worker.cc:%d] request %d served in %dus", line,
+                        100 + line % 300, line * 31, line * 17 % 900);
+    screen.Print(kRows - kLogRows + i, 0, text,
+                 { .fg = static_cast<uint16_t>(line % 16 == 0 ? 1 : 7) });
+  }
+}
+
+// Args: whether each frame is redrawn in full, as before `FrameBuffer`.
+void BM_RenderDashboard(benchmark::State& state) {
+  const bool full = state.range(0) != 0;
+  FrameBuffer screen(kRows, kCols);
+  uint64_t frame = 0;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    DrawDashboard(screen, frame++);
+    if (full) {
+      screen.Invalidate();
+    }
+    const std::string_view out = screen.Render();
+    bytes += out.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.counters["bytes_per_frame"] = benchmark::Counter(
+      static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+// Only a counter changes, without redrawing the rest of the frame.
+void BM_RenderCounter(benchmark::State& state) {
+  FrameBuffer screen(kRows, kCols);
+  DrawDashboard(screen, 0);
+  screen.Render();
+  uint64_t frame = 0;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    screen.Print(2, 24, absl::StrFormat("%12d", frame++));
+    const std::string_view out = screen.Render();
+    bytes += out.size();
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.counters["bytes_per_frame"] = benchmark::Counter(
+      static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_RenderDashboard)->ArgName("full")->Arg(0)->Arg(1);
+BENCHMARK(BM_RenderCounter);
+
+}  // namespace
+
+}  // namespace util
@@ -0,0 +1,310 @@
+#include "util/frame_buffer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/csi.h"
+#include "util/print_colors.h"
+
+namespace util {
+
+using ::testing::HasSubstr;
+using ::testing::StartsWith;
+
+// Interprets the subset of control sequences which `FrameBuffer` emits.
+class FakeTerminal {
+ public:
+  FakeTerminal(size_t rows, size_t cols)
+      : rows_(rows), cols_(cols), cells_(rows * cols) {}
+
+  const FrameCell& at(size_t row, size_t col) const {
+    return cells_[row * cols_ + col];
+  }
+
+  bool alternate() const {
+    return alternate_;
+  }
+
+  void Write(std::string_view out) {
+    size_t pos = 0;
+    while (pos < out.size()) {
+      const char c = out[pos++];
+      if (c == '\033') {
+        ASSERT_LT(pos, out.size());
+        ASSERT_EQ(out[pos++], '[');
+        const size_t end = out.find_first_not_of("0123456789;?", pos);
+        ASSERT_NE(end, std::string_view::npos);
+        Control(out.substr(pos, end - pos), out[end]);
+        pos = end + 1;
+      } else if (c == '\r') {
+        col_ = 0;
+      } else if (c == '\n') {
+        ASSERT_LT(row_ + 1, rows_);
+        row_++;
+      } else {
+        ASSERT_LT(row_, rows_);
+        ASSERT_LT(col_, cols_) << "Wrote past the end of row " << row_;
+        // Decodes UTF-8, which the tests only use well-formed.
+        char32_t glyph = static_cast<uint8_t>(c);
+        if (glyph >= 0x80) {
+          const size_t length = glyph >= 0xf0 ? 3 : glyph >= 0xe0 ? 2 : 1;
+          glyph &= 0x3f >> length;
+          for (size_t i = 0; i < length; i++) {
+            glyph = (glyph << 6) | (static_cast<uint8_t>(out[pos++]) & 0x3f);
+          }
+        }
+        cells_[row_ * cols_ + col_++] = { .glyph = glyph, .style = pen_ };
+      }
+    }
+  }
+
+ private:
+  void Control(std::string_view params, char op) {
+    std::vector<size_t> args;
+    if (!params.empty() && params[0] != '?') {
+      args.push_back(0);
+      for (char c : params) {
+        if (c == ';') {
+          args.push_back(0);
+        } else {
+          args.back() = 10 * args.back() + (c - '0');
+        }
+      }
+    }
+    const auto arg = [&](size_t i, size_t otherwise) {
+      return i < args.size() && args[i] != 0 ? args[i] : otherwise;
+    };
+    switch (op) {
+      case 'H':
+        row_ = arg(0, 1) - 1;
+        col_ = arg(1, 1) - 1;
+        break;
+      case 'G':
+        col_ = arg(0, 1) - 1;
+        break;
+      case 'C':
+        col_ += arg(0, 1);
+        break;
+      case 'J':
+        ASSERT_EQ(arg(0, 0), 2);
+        std::fill(cells_.begin(), cells_.end(),
+                  FrameCell{ .style = { .bg = pen_.bg } });
+        break;
+      case 'K':
+        ASSERT_EQ(arg(0, 0), 0);
+        std::fill(&cells_[row_ * cols_ + col_], &cells_[(row_ + 1) * cols_],
+                  FrameCell{ .style = { .bg = pen_.bg } });
+        break;
+      case 'h':
+      case 'l':
+        if (params == "?1049") {
+          alternate_ = op == 'h';
+        }
+        break;
+      case 'm':
+        Style(args);
+        break;
+      default:
+        FAIL() << "Unexpected sequence " << params << op;
+    }
+  }
+
+  void Style(const std::vector<size_t>& args) {
+    for (size_t i = 0; i < args.size(); i++) {
+      switch (args[i]) {
+        case 0:
+          pen_ = {};
+          break;
+        case 1:
+          pen_.bold = true;
+          break;
+        case 38:
+          pen_.fg = args.at(i + 2);
+          i += 2;
+          break;
+        case 39:
+          pen_.fg = FrameStyle::kDefaultColor;
+          break;
+        case 48:
+          pen_.bg = args.at(i + 2);
+          i += 2;
+          break;
+        case 49:
+          pen_.bg = FrameStyle::kDefaultColor;
+          break;
+        default:
+          FAIL() << "Unexpected attribute " << args[i];
+      }
+    }
+  }
+
+  size_t rows_;
+  size_t cols_;
+  std::vector<FrameCell> cells_;
+  size_t row_ = 0;
+  size_t col_ = 0;
+  FrameStyle pen_;
+  bool alternate_ = false;
+};
+
+// Expects the terminal to show the frame buffer's back buffer.
+void ExpectShows(const FakeTerminal& terminal, const FrameBuffer& screen) {
+  for (size_t row = 0; row < screen.rows(); row++) {
+    for (size_t col = 0; col < screen.cols(); col++) {
+      ASSERT_EQ(terminal.at(row, col), screen.at(row, col))
+          << "At " << row << ", " << col;
+    }
+  }
+}
+
+TEST(FrameBufferTest, TestFirstFrame) {
+  FrameBuffer screen(4, 10);
+  EXPECT_EQ(screen.Render(),
+            P_RESET CSI_CHP(1, 1) CSI_ED(CSI_CURSOR_ALL));
+  // Nothing changed.
+  EXPECT_EQ(screen.Render(), "");
+}
+
+TEST(FrameBufferTest, TestMinimalUpdates) {
+  FrameBuffer screen(4, 10);
+  screen.Print(1, 2, "abc");
+  EXPECT_EQ(screen.Render(),
+            P_RESET CSI_CHP(1, 1) CSI_ED(CSI_CURSOR_ALL) CSI_CHP(2, 3) "abc");
+
+  // Rewriting the unchanged "b" is shorter than moving over it.
+  screen.Print(1, 2, "xby");
+  EXPECT_EQ(screen.Render(), CSI_CHA(3) "xby");
+
+  screen.Print(3, 0, "z");
+  EXPECT_EQ(screen.Render(), CSI_CHP(4, 1) "z");
+
+  screen.Print(3, 8, "w");
+  EXPECT_EQ(screen.Render(), CSI_CUR(7) "w");
+}
+
+TEST(FrameBufferTest, TestStyles) {
+  FrameBuffer screen(1, 10);
+  screen.Render();
+  screen.Print(0, 0, "ab", { .fg = 1, .bold = true });
+  screen.Print(0, 2, "c", { .bg = 200 });
+  EXPECT_EQ(screen.Render(),
+            BOLD P_256_COLOR(1) "ab" P_RESET P_256_BG_COLOR(200) "c");
+  // The pen is kept across frames.
+  screen.Print(0, 3, "d", { .bg = 200 });
+  EXPECT_EQ(screen.Render(), "d");
+}
+
+TEST(FrameBufferTest, TestErase) {
+  FrameBuffer screen(2, 20);
+  screen.Print(0, 0, "a long line of text", { .bg = 4 });
+  screen.Render();
+  screen.Clear();
+  screen.Print(0, 0, "short");
+  EXPECT_EQ(screen.Render(),
+            "\r" P_256_BG_DEFAULT "short" CSI_EL(CSI_CURSOR_BEFORE));
+}
+
+TEST(FrameBufferTest, TestPrint) {
+  FrameBuffer screen(1, 4);
+  EXPECT_EQ(screen.Print(0, 1, "h\xc3\xa9llo"), 4);
+  EXPECT_EQ(screen.at(0, 1).glyph, U'h');
+  EXPECT_EQ(screen.at(0, 2).glyph, U'é');
+  EXPECT_EQ(screen.at(0, 3).glyph, U'l');
+  EXPECT_EQ(screen.Print(0, 0, "\xff"), 1);
+  EXPECT_EQ(screen.at(0, 0).glyph, U'�');
+
+  FakeTerminal terminal(1, 4);
+  terminal.Write(screen.Render());
+  ExpectShows(terminal, screen);
+}
+
+TEST(FrameBufferTest, TestToString) {
+  FrameBuffer screen(3, 6);
+  screen.Print(0, 1, "ab", { .bold = true });
+  screen.Print(2, 0, "\xce\xbb x");
+  EXPECT_EQ(screen.ToString(), " ab\n\n\xce\xbb x\n");
+}
+
+TEST(FrameBufferTest, TestAlternateDisplay) {
+  FrameBuffer screen(2, 4);
+  screen.Print(0, 0, "ab");
+  screen.Render();
+  screen.EnterAlternateDisplay();
+  FakeTerminal terminal(2, 4);
+  const std::string_view out = screen.Render();
+  EXPECT_THAT(out, StartsWith(CSI_ALTERNATE_DISPLAY CSI_HIDE));
+  // The frame is drawn in full on the alternate display.
+  EXPECT_THAT(out, HasSubstr("ab"));
+  terminal.Write(out);
+  EXPECT_TRUE(terminal.alternate());
+  ExpectShows(terminal, screen);
+
+  terminal.Write(screen.LeaveAlternateDisplay());
+  EXPECT_FALSE(terminal.alternate());
+}
+
+TEST(FrameBufferTest, TestResize) {
+  FrameBuffer screen(2, 4);
+  screen.Print(1, 0, "abcd");
+  screen.Render();
+  screen.Resize(3, 5);
+  screen.Print(2, 0, "xyz");
+  FakeTerminal terminal(3, 5);
+  terminal.Write(screen.Render());
+  ExpectShows(terminal, screen);
+}
+
+// Random edits of random frames must leave the terminal showing each frame.
+TEST(FrameBufferTest, TestRandomFrames) {
+  constexpr size_t kRows = 12;
+  constexpr size_t kCols = 30;
+  std::mt19937 gen(42);
+  const auto uniform = [&](size_t n) {
+    return std::uniform_int_distribution<size_t>(0, n - 1)(gen);
+  };
+  const auto style = [&]() {
+    FrameStyle style;
+    if (uniform(2) == 0) {
+      style.fg = uniform(4) == 0 ? FrameStyle::kDefaultColor : uniform(256);
+      style.bg = uniform(4) == 0 ? FrameStyle::kDefaultColor : uniform(256);
+      style.bold = uniform(3) == 0;
+    }
+    return style;
+  };
+  const std::vector<std::string> words = { "a", "bb", "ccc", "\xce\xbb",
+                                           "status", "     " };
+
+  FrameBuffer screen(kRows, kCols);
+  FakeTerminal terminal(kRows, kCols);
+  for (int frame = 0; frame < 500; frame++) {
+    if (uniform(50) == 0) {
+      screen.Clear(style());
+    }
+    if (uniform(100) == 0) {
+      screen.Invalidate();
+    }
+    for (size_t edits = uniform(20); edits > 0; edits--) {
+      screen.Print(uniform(kRows), uniform(kCols), words[uniform(words.size())],
+                   style());
+    }
+    // Blank the end of a row, to exercise erasing.
+    if (uniform(4) == 0) {
+      const size_t row = uniform(kRows);
+      for (size_t col = uniform(kCols); col < kCols; col++) {
+        screen.at(row, col) = FrameCell{};
+      }
+    }
+    terminal.Write(screen.Render());
+    ASSERT_NO_FATAL_FAILURE(ExpectShows(terminal, screen)) << "Frame " << frame;
+  }
+}
+
+}  // namespace util
@@ -0,0 +1,100 @@
+// A main for libFuzzer targets which replays inputs through them without
+// libFuzzer, so that their seed corpora run as tests with any compiler and
+// offline. Runs every file named on the command line and every file in each
+// directory named, then `kNumRandomInputs` pseudo-random inputs from a fixed
+// seed. Fails if an input cannot be read; failures of the target abort it.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <system_error>
+#include <vector>
+
+#include "util/fuzz_util.h"
+
+namespace util {
+
+namespace {
+
+constexpr size_t kNumRandomInputs = 1000;
+constexpr size_t kMaxRandomInputSize = 256;
+
+bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(file),
+              std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+// Appends `path`, or the files in it if it is a directory, in name order.
+bool ListInputs(const std::filesystem::path& path,
+                std::vector<std::filesystem::path>& inputs) {
+  std::error_code error;
+  if (!std::filesystem::is_directory(path, error)) {
+    inputs.push_back(path);
+    return true;
+  }
+
+  std::vector<std::filesystem::path> files;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator(path, error)) {
+    if (entry.is_regular_file()) {
+      files.push_back(entry.path());
+    }
+  }
+  if (error) {
+    std::cerr << "Failed to list " << path << ": " << error.message() << "\n";
+    return false;
+  }
+  std::sort(files.begin(), files.end());
+  inputs.insert(inputs.end(), files.begin(), files.end());
+  return true;
+}
+
+int ReplayMain(int argc, char** argv) {
+  std::vector<std::filesystem::path> inputs;
+  for (int i = 1; i < argc; i++) {
+    if (!ListInputs(argv[i], inputs)) {
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> data;
+  for (const std::filesystem::path& input : inputs) {
+    if (!ReadFile(input, data)) {
+      std::cerr << "Failed to read " << input << "\n";
+      return 1;
+    }
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+  }
+
+  std::mt19937_64 rng(/*seed=*/0);
+  for (size_t i = 0; i < kNumRandomInputs; i++) {
+    data.resize(std::uniform_int_distribution<size_t>(
+        0, kMaxRandomInputSize)(rng));
+    for (uint8_t& byte : data) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+  }
+
+  std::cout << "Replayed " << inputs.size() << " inputs and "
+            << kNumRandomInputs << " random inputs" << std::endl;
+  return 0;
+}
+
+}  // namespace
+
+}  // namespace util
+
+int main(int argc, char** argv) {
+  return util::ReplayMain(argc, argv);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+
+#include "util/internal/util.h"
+
+// The entry point of a libFuzzer target, which each target defines. Targets
+// are built twice: as a fuzzer, linked with `-fsanitize=fuzzer` (clang only),
+// and as a test, linked with `//util:fuzz_replay_main`, which runs the target's
+// seed corpus through it without libFuzzer.
+//
+// To fuzz, growing the seed corpus in place:
+//   bazel run --config=fuzz //util:bit_set_fuzzer -- "$PWD/util/bit_set_fuzzer_corpus"
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace util {
+
+// Reads a fuzzer input as a stream of integers. Reads past the end give zeros,
+// so that every input decodes to something, and each byte libFuzzer mutates
+// changes a single value.
+class FuzzInput {
+ public:
+  FuzzInput(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  uint8_t Byte() {
+    if (size_ == 0) {
+      return 0;
+    }
+    size_--;
+    return *data_++;
+  }
+
+  bool Bool() {
+    return (Byte() & 0x1) != 0;
+  }
+
+  // Returns a value in [0, n), read from as few bytes as hold n - 1.
+  size_t Below(size_t n) {
+    UTIL_DCHECK_GT(n, 0);
+    size_t value = 0;
+    for (size_t max = n - 1; max != 0; max >>= 8) {
+      value = (value << 8) | Byte();
+    }
+    return value % n;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+};
+
+// Shrinks a trace of operations for which `fails` is true to one from which no
+// single operation can be removed with `fails` still true. This is delta
+// debugging: chunks of the trace are removed while it still fails, and the
+// chunks are halved once none can be.
+template <typename Op>
+std::vector<Op> MinimizeTrace(
+    std::vector<Op> ops, absl::FunctionRef<bool(std::span<const Op>)> fails) {
+  size_t chunk = std::max<size_t>(ops.size() / 2, 1);
+  while (true) {
+    bool removed = false;
+    for (size_t start = 0; start < ops.size();) {
+      const size_t end = std::min(start + chunk, ops.size());
+      std::vector<Op> candidate;
+      candidate.reserve(ops.size() - (end - start));
+      candidate.insert(candidate.end(), ops.begin(), ops.begin() + start);
+      candidate.insert(candidate.end(), ops.begin() + end, ops.end());
+      if (fails(candidate)) {
+        ops = std::move(candidate);
+        removed = true;
+      } else {
+        start = end;
+      }
+    }
+    if (!removed) {
+      if (chunk == 1) {
+        return ops;
+      }
+      chunk /= 2;
+    }
+  }
+}
+
+// Runs a trace of operations with `run`, which returns an error where the
+// implementation under test diverges from its reference. On an error, prints
+// the trace minimized (see `MinimizeTrace`), one operation per line with
+// `operator<<`, and aborts, which libFuzzer reports as a crash. Failures which
+// crash `run` itself are left to libFuzzer's `-minimize_crash`, which shrinks
+// the input instead.
+template <typename Op>
+void CheckTrace(const std::vector<Op>& ops,
+                absl::FunctionRef<absl::Status(std::span<const Op>)> run) {
+  const absl::Status status = run(ops);
+  if (status.ok()) {
+    return;
+  }
+
+  const std::vector<Op> minimal =
+      MinimizeTrace<Op>(ops, [&](std::span<const Op> trace) {
+        return !run(trace).ok();
+      });
+  std::cerr << "Trace of " << ops.size() << " operations failed: " << status
+            << "\nMinimized to " << minimal.size() << " operations:\n";
+  for (const Op& op : minimal) {
+    std::cerr << "  " << op << "\n";
+  }
+  std::cerr << "which fail with: " << run(minimal) << std::endl;
+  std::abort();
+}
+
+}  // namespace util
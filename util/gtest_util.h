@@ -5,6 +5,9 @@
 #include "gmock/gmock-matchers.h"
 #include "gtest/gtest.h"
 
+#include "util/perf_counters.h"
+#include "util/result.h"
+
 // Executes an expression that returns an absl::StatusOr<T>, and assigns the
 // contained variable to lhs if the error code is OK. If the Status is non-OK,
 // generates a test failure and returns from the current function, which must
@@ -122,12 +125,19 @@ class IsOkAndHoldsGenerator {
         new IsOkAndHoldsMatcher<absl::StatusOr<T>>(value_matcher_));
   }
 
+  template <typename T, typename E>
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  operator ::testing::Matcher<const Result<T, E> &>() const {
+    return ::testing::MakeMatcher(
+        new IsOkAndHoldsMatcher<Result<T, E>>(value_matcher_));
+  }
+
  private:
   const ValueMatcherT value_matcher_;
 };
 
 // Implements a gMock matcher that checks whether a status container (e.g.
-// absl::Status or absl::StatusOr<T>) has an OK status.
+// absl::Status, absl::StatusOr<T> or util::Result<T, E>) has an OK status.
 class IsOkMatcher {
  public:
   IsOkMatcher() = default;
@@ -159,8 +169,9 @@ class IsOkMatcher {
 
 }  // namespace internal
 
-// Returns a gMock matcher that expects an absl::StatusOr<T> object to have an
-// OK status and for the contained T object to match |value_matcher|.
+// Returns a gMock matcher that expects an absl::StatusOr<T> or a
+// util::Result<T, E> object to have an OK status and for the contained T object
+// to match |value_matcher|.
 //
 // Example:
 //
@@ -182,10 +193,54 @@ internal::IsOkAndHoldsGenerator<ValueMatcherT> IsOkAndHolds(
 }
 
 // Returns an internal::IsOkMatcherGenerator, which may be typecast to a
-// Matcher<absl::Status> or Matcher<absl::StatusOr<T>>. These gMock matchers
-// test that a given status container has an OK status.
+// Matcher<absl::Status>, Matcher<absl::StatusOr<T>> or
+// Matcher<util::Result<T, E>>. These gMock matchers test that a given status
+// container has an OK status.
 inline ::testing::PolymorphicMatcher<internal::IsOkMatcher> IsOk() {
   return ::testing::MakePolymorphicMatcher(internal::IsOkMatcher());
 }
 
+// Records the hardware counters of the calling thread over its scope as
+// properties of the current test: "cycles", "instructions", "LLC-misses" and
+// "branch-misses", which appear in its XML report (`--gtest_output=xml`).
+// Records nothing where perf events are unavailable.
+//
+// Example:
+//   TEST(RbTreeTest, TestInsertMany) {
+//     ScopedPerfProperties perf;
+//     ...
+//   }
+class ScopedPerfProperties {
+ public:
+  ScopedPerfProperties() {
+    const absl::StatusOr<PerfCounters>& counters =
+        PerfCounters::ForThisThread();
+    if (counters.ok()) {
+      counters_ = &*counters;
+      start_ = counters_->Read();
+    }
+  }
+
+  ScopedPerfProperties(const ScopedPerfProperties&) = delete;
+  ScopedPerfProperties& operator=(const ScopedPerfProperties&) = delete;
+
+  ~ScopedPerfProperties() {
+    if (counters_ == nullptr) {
+      return;
+    }
+    const PerfCounts counts = PerfCounters::Between(start_, counters_->Read());
+    ::testing::Test::RecordProperty("cycles", absl::StrCat(counts.cycles));
+    ::testing::Test::RecordProperty("instructions",
+                                    absl::StrCat(counts.instructions));
+    ::testing::Test::RecordProperty("LLC-misses",
+                                    absl::StrCat(counts.cache_misses));
+    ::testing::Test::RecordProperty("branch-misses",
+                                    absl::StrCat(counts.branch_misses));
+  }
+
+ private:
+  const PerfCounters* counters_ = nullptr;
+  PerfCounters::Sample start_;
+};
+
 }  // namespace util
@@ -1,15 +1,30 @@
 #include "util/gtest_util.h"
 
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 #include "util/absl_util.h"
+#include "util/std_util.h"
 
 namespace util {
 
 using ::testing::Not;
+using ::testing::Optional;
+using ::testing::EndsWith;
+using ::testing::Pointee;
+
+// `--config=opt` defines UTIL_NDEBUG, which turns status traces off.
+#ifdef UTIL_NDEBUG
+static_assert(!kStatusTraceEnabled);
+#endif
 
 TEST(GTestUtilTest, TestReturnIfError) {
   auto test = []() -> absl::Status {
@@ -49,4 +64,139 @@ TEST(GTestUtilTest, TestDefineOrReturn) {
   EXPECT_THAT(test(), IsOkAndHolds(5));
 }
 
+// Counts the copies made of it.
+struct CopyCounter {
+  CopyCounter() = default;
+  CopyCounter(const CopyCounter& other) : copies(other.copies + 1) {}
+  CopyCounter(CopyCounter&&) = default;
+  CopyCounter& operator=(const CopyCounter& other) {
+    copies = other.copies + 1;
+    return *this;
+  }
+  CopyCounter& operator=(CopyCounter&&) = default;
+
+  int copies = 0;
+};
+
+TEST(GTestUtilTest, TestAssignOrReturnMoves) {
+  auto make = [](bool ok) -> absl::StatusOr<CopyCounter> {
+    if (!ok) {
+      return absl::NotFoundError("missing");
+    }
+    return CopyCounter();
+  };
+  auto test = [&](bool ok) -> absl::StatusOr<int> {
+    CopyCounter counter;
+    ASSIGN_OR_RETURN(counter, make(ok));
+    return counter.copies;
+  };
+
+  EXPECT_THAT(test(true), IsOkAndHolds(0));
+  EXPECT_EQ(test(false).status(), absl::NotFoundError("missing"));
+}
+
+TEST(GTestUtilTest, TestMoveOnly) {
+  auto make = []() -> absl::StatusOr<std::unique_ptr<int>> {
+    return std::make_unique<int>(3);
+  };
+  auto assign = [&]() -> absl::StatusOr<std::unique_ptr<int>> {
+    std::unique_ptr<int> ptr;
+    ASSIGN_OR_RETURN(ptr, make());
+    return ptr;
+  };
+  auto define = [&]() -> absl::StatusOr<std::unique_ptr<int>> {
+    DEFINE_OR_RETURN(std::unique_ptr<int>, ptr, make());
+    return std::move(ptr);
+  };
+
+  EXPECT_THAT(assign(), IsOkAndHolds(Pointee(3)));
+  EXPECT_THAT(define(), IsOkAndHolds(Pointee(3)));
+}
+
+TEST(GTestUtilTest, TestOptionalMacros) {
+  auto make = [](bool ok) -> std::optional<std::unique_ptr<int>> {
+    if (!ok) {
+      return std::nullopt;
+    }
+    return std::make_unique<int>(3);
+  };
+  auto test = [&](bool ok) -> std::optional<int> {
+    RETURN_IF_NULL(make(ok));
+    std::unique_ptr<int> assigned;
+    ASSIGN_OR_RETURN_OPT(assigned, make(ok));
+    DEFINE_OR_RETURN_OPT(std::unique_ptr<int>, defined, make(ok));
+    return *assigned + *defined;
+  };
+
+  EXPECT_THAT(test(true), Optional(6));
+  EXPECT_EQ(test(false), std::nullopt);
+}
+
+// The lines of the status macros in the functions below, innermost first.
+int trace_lines[3];
+
+absl::Status TraceInner(const absl::Status& status) {
+  trace_lines[0] = __LINE__ + 1;
+  RETURN_IF_ERROR(status);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int> TraceMiddle(const absl::Status& status) {
+  trace_lines[1] = __LINE__ + 1;
+  RETURN_IF_ERROR(TraceInner(status));
+  return 1;
+}
+
+absl::StatusOr<int> TraceOuter(const absl::Status& status) {
+  trace_lines[2] = __LINE__ + 1;
+  DEFINE_OR_RETURN(int, value, TraceMiddle(status));
+  return value + 1;
+}
+
+absl::StatusOr<int> TraceRecursive(int depth) {
+  if (depth == 0) {
+    return absl::NotFoundError("Bottom");
+  }
+  int value;
+  ASSIGN_OR_RETURN(value, TraceRecursive(depth - 1));
+  return value;
+}
+
+TEST(GTestUtilTest, TestStatusTrace) {
+  if (!kStatusTraceEnabled) {
+    GTEST_SKIP() << "Status traces are disabled.";
+  }
+  absl::Status status = TraceOuter(absl::InternalError("Failed")).status();
+  const StatusTrace& trace = GetStatusTrace(status);
+  ASSERT_EQ(trace.entries().size(), 3);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_THAT(trace.entries()[i].file, EndsWith("gtest_util_test.cc"));
+    EXPECT_EQ(trace.entries()[i].line, trace_lines[i]);
+  }
+  EXPECT_EQ(trace.dropped(), 0);
+  EXPECT_THAT(trace.ToString(),
+              EndsWith(absl::StrCat(":", trace_lines[2])));
+
+  // Only the error last returned has a trace.
+  EXPECT_TRUE(GetStatusTrace(absl::InternalError("Other")).empty());
+  EXPECT_TRUE(GetStatusTrace(absl::OkStatus()).empty());
+
+  // A new error starts a new trace, even if it equals the last one.
+  status = TraceMiddle(absl::InternalError("Again")).status();
+  EXPECT_EQ(GetStatusTrace(status).entries().size(), 2);
+  status = TraceMiddle(absl::InternalError("Again")).status();
+  EXPECT_EQ(GetStatusTrace(status).entries().size(), 2);
+
+  // Copies of an error continue its trace.
+  const absl::Status copy = status;
+  EXPECT_EQ(GetStatusTrace(copy).entries().size(), 2);
+  status = TraceMiddle(copy).status();
+  EXPECT_EQ(GetStatusTrace(status).entries().size(), 4);
+
+  status = TraceRecursive(StatusTrace::kCapacity + 4).status();
+  EXPECT_EQ(GetStatusTrace(status).entries().size(), StatusTrace::kCapacity);
+  EXPECT_EQ(GetStatusTrace(status).dropped(), 4);
+  EXPECT_THAT(GetStatusTrace(status).ToString(), EndsWith("(4 more)"));
+}
+
 }  // namespace util
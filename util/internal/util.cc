@@ -0,0 +1,25 @@
+#include "util/internal/util.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+
+namespace util::internal {
+
+CheckFailure::CheckFailure(const char* file, int line, const char* condition)
+    : stream_(std::cerr) {
+  stream_ << file << ":" << line << ": Check failed: " << condition << " ";
+}
+
+CheckFailure::CheckFailure() : stream_(std::cerr) {}
+
+CheckFailure::~CheckFailure() {
+  stream_ << std::endl;
+  std::abort();
+}
+
+std::ostream& CheckOpStream(const char* file, int line, const char* condition) {
+  return std::cerr << file << ":" << line << ": Check failed: " << condition;
+}
+
+}  // namespace util::internal
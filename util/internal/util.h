@@ -1,21 +1,172 @@
 #pragma once
 
-#include <cstdlib>
-#include <iostream>
+#include <ostream>
+#include <type_traits>
+#include <utility>
 
+// Which checks are compiled in:
+//   0: none.
+//   1: `UTIL_CHECK*`. The default with UTIL_NDEBUG.
+//   2: `UTIL_CHECK*` and `UTIL_DCHECK*`. The default otherwise.
+// Checks which are compiled out still type-check their arguments, but never
+// evaluate them.
+#ifndef UTIL_CHECK_LEVEL
 #ifdef UTIL_NDEBUG
+#define UTIL_CHECK_LEVEL 1
+#else
+#define UTIL_CHECK_LEVEL 2
+#endif
+#endif
+
+namespace util::internal {
+
+// Prints a failed check, then any context streamed into it, and aborts when
+// destroyed. Only the failure paths of the macros below construct it, so a
+// passing check costs a compare and a branch, and the code for reporting
+// failures stays out of line.
+class CheckFailure {
+ public:
+  // Starts the message for a failed `UTIL_CHECK`.
+  [[gnu::cold, gnu::noinline]] CheckFailure(const char* file, int line,
+                                            const char* condition);
+
+  // Continues a message started by `CheckOpFailed`.
+  [[gnu::cold, gnu::noinline]] CheckFailure();
+
+  CheckFailure(const CheckFailure&) = delete;
+  CheckFailure& operator=(const CheckFailure&) = delete;
+
+  [[noreturn]] ~CheckFailure();
+
+  std::ostream& stream() {
+    return stream_;
+  }
+
+ private:
+  std::ostream& stream_;
+};
+
+// Starts the message for a failed `UTIL_CHECK_<op>`, up to its operands.
+[[gnu::cold]] std::ostream& CheckOpStream(const char* file, int line,
+                                          const char* condition);
+
+template <typename T1, typename T2>
+[[gnu::cold, gnu::noinline]] bool CheckOpFailed(const char* file, int line,
+                                                const char* condition,
+                                                const T1& v1, const T2& v2) {
+  CheckOpStream(file, line, condition) << " (" << v1 << " vs. " << v2 << ") ";
+  return true;
+}
+
+// The integer types `std::cmp_equal` and the like accept: all but `bool` and
+// the character types.
+template <typename T>
+concept CheckOpInteger =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+    !std::is_same_v<T, char> && !std::is_same_v<T, wchar_t> &&
+    !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+    !std::is_same_v<T, char32_t>;
+
+// Returns whether the comparison failed, after starting its message. Integers
+// are compared by value with `cmp`, so that a negative value is less than any
+// unsigned one, and mixing signedness does not warn.
+#define UTIL_DEFINE_CHECK_OP(name, op, cmp)                      \
+  template <typename T1, typename T2>                            \
+  bool Check##name(const T1& v1, const T2& v2, const char* file, \
+                   int line, const char* condition) {            \
+    bool passed;                                                 \
+    if constexpr (CheckOpInteger<T1> && CheckOpInteger<T2>) {    \
+      passed = cmp(v1, v2);                                      \
+    } else {                                                     \
+      passed = v1 op v2;                                         \
+    }                                                            \
+    if (passed) [[likely]] {                                     \
+      return false;                                              \
+    }                                                            \
+    return CheckOpFailed(file, line, condition, v1, v2);         \
+  }
 
-#define UTIL_ASSERT(cond)
+UTIL_DEFINE_CHECK_OP(EQ, ==, std::cmp_equal)
+UTIL_DEFINE_CHECK_OP(NE, !=, std::cmp_not_equal)
+UTIL_DEFINE_CHECK_OP(LT, <, std::cmp_less)
+UTIL_DEFINE_CHECK_OP(LE, <=, std::cmp_less_equal)
+UTIL_DEFINE_CHECK_OP(GT, >, std::cmp_greater)
+UTIL_DEFINE_CHECK_OP(GE, >=, std::cmp_greater_equal)
 
+#undef UTIL_DEFINE_CHECK_OP
+
+}  // namespace util::internal
+
+// The loops run at most once, since `CheckFailure` aborts when destroyed. They
+// are used rather than an if statement so that context can be streamed into
+// the failure without capturing a following else.
+#define UTIL_CHECK_IMPL(cond)          \
+  while (__builtin_expect(!(cond), 0)) \
+  ::util::internal::CheckFailure(__FILE__, __LINE__, #cond).stream()
+
+#define UTIL_CHECK_OP_IMPL(name, op, v1, v2)                           \
+  while (::util::internal::Check##name((v1), (v2), __FILE__, __LINE__, \
+                                       #v1 " " #op " " #v2))           \
+  ::util::internal::CheckFailure().stream()
+
+#define UTIL_CHECK_DISABLED(check) \
+  while (false) check
+
+#if UTIL_CHECK_LEVEL >= 1
+#define UTIL_IF_CHECK(check) check
 #else
+#define UTIL_IF_CHECK(check) UTIL_CHECK_DISABLED(check)
+#endif
 
-#define UTIL_ASSERT(cond)                                                   \
-  do {                                                                      \
-    if (!(cond)) {                                                          \
-      std::cerr << __FILE__ ":" << __LINE__ << ": Condition failed: " #cond \
-                << std::endl;                                               \
-      std::abort();                                                         \
-    }                                                                       \
-  } while (0)
+#if UTIL_CHECK_LEVEL >= 2
+#define UTIL_IF_DCHECK(check) check
+#else
+#define UTIL_IF_DCHECK(check) UTIL_CHECK_DISABLED(check)
+#endif
+
+// Aborts with a message if `cond` is false. Context may be streamed into the
+// message, and is only evaluated on failure.
+//
+// Example:
+//   UTIL_CHECK(fd >= 0) << "Failed to open " << path;
+//
+// `UTIL_CHECK_EQ(v1, v2)` (and `_NE`, `_LT`, `_LE`, `_GT`, `_GE`) also print
+// both values, which must be printable with `operator<<`.
+//
+// `UTIL_DCHECK*` are the same, for checks too costly or too deep in hot paths
+// for optimized builds. Their arguments must not have side effects.
+#define UTIL_CHECK(cond)      UTIL_IF_CHECK(UTIL_CHECK_IMPL(cond))
+#define UTIL_CHECK_EQ(v1, v2) UTIL_IF_CHECK(UTIL_CHECK_OP_IMPL(EQ, ==, v1, v2))
+#define UTIL_CHECK_NE(v1, v2) UTIL_IF_CHECK(UTIL_CHECK_OP_IMPL(NE, !=, v1, v2))
+#define UTIL_CHECK_LT(v1, v2) UTIL_IF_CHECK(UTIL_CHECK_OP_IMPL(LT, <, v1, v2))
+#define UTIL_CHECK_LE(v1, v2) UTIL_IF_CHECK(UTIL_CHECK_OP_IMPL(LE, <=, v1, v2))
+#define UTIL_CHECK_GT(v1, v2) UTIL_IF_CHECK(UTIL_CHECK_OP_IMPL(GT, >, v1, v2))
+#define UTIL_CHECK_GE(v1, v2) UTIL_IF_CHECK(UTIL_CHECK_OP_IMPL(GE, >=, v1, v2))
 
+#define UTIL_DCHECK(cond) UTIL_IF_DCHECK(UTIL_CHECK_IMPL(cond))
+#define UTIL_DCHECK_EQ(v1, v2) \
+  UTIL_IF_DCHECK(UTIL_CHECK_OP_IMPL(EQ, ==, v1, v2))
+#define UTIL_DCHECK_NE(v1, v2) \
+  UTIL_IF_DCHECK(UTIL_CHECK_OP_IMPL(NE, !=, v1, v2))
+#define UTIL_DCHECK_LT(v1, v2) \
+  UTIL_IF_DCHECK(UTIL_CHECK_OP_IMPL(LT, <, v1, v2))
+#define UTIL_DCHECK_LE(v1, v2) \
+  UTIL_IF_DCHECK(UTIL_CHECK_OP_IMPL(LE, <=, v1, v2))
+#define UTIL_DCHECK_GT(v1, v2) \
+  UTIL_IF_DCHECK(UTIL_CHECK_OP_IMPL(GT, >, v1, v2))
+#define UTIL_DCHECK_GE(v1, v2) \
+  UTIL_IF_DCHECK(UTIL_CHECK_OP_IMPL(GE, >=, v1, v2))
+
+// Tells the optimizer that `cond` holds, where `UTIL_DCHECK` is compiled out,
+// and checks it otherwise. `cond` must be cheap and without side effects,
+// since it may still be evaluated. Takes no context.
+#if UTIL_CHECK_LEVEL >= 2
+#define UTIL_ASSUME(cond) UTIL_DCHECK(cond)
+#else
+#define UTIL_ASSUME(cond)      \
+  do {                         \
+    if (!(cond)) {             \
+      __builtin_unreachable(); \
+    }                          \
+  } while (0)
 #endif
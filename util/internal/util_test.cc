@@ -0,0 +1,81 @@
+#include "util/internal/util.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+namespace util {
+
+// `--config=opt` defines UTIL_NDEBUG, which compiles the DCHECKs out.
+#ifdef UTIL_NDEBUG
+static_assert(UTIL_CHECK_LEVEL == 1);
+#endif
+
+namespace {
+
+// Returns `value`, counting the calls.
+int Count(int& calls, int value) {
+  calls++;
+  return value;
+}
+
+}  // namespace
+
+TEST(CheckTest, TestPassing) {
+  int calls = 0;
+  UTIL_CHECK(Count(calls, 1) == 1) << Count(calls, 2);
+  UTIL_CHECK_EQ(Count(calls, 1), 1) << Count(calls, 2);
+  UTIL_CHECK_LT(Count(calls, 1), 2);
+  // Each operand is evaluated once, and the context not at all.
+  EXPECT_EQ(calls, UTIL_CHECK_LEVEL >= 1 ? 3 : 0);
+}
+
+TEST(CheckTest, TestDebugChecks) {
+  int calls = 0;
+  UTIL_DCHECK(Count(calls, 1) == 1);
+  UTIL_DCHECK_NE(Count(calls, 1), 2);
+  UTIL_ASSUME(Count(calls, 1) == 1);
+  EXPECT_EQ(calls, UTIL_CHECK_LEVEL >= 2 ? 3 : 1);
+}
+
+// Integers of mixed signedness compare by value, without -Wsign-compare.
+TEST(CheckTest, TestMixedSignedness) {
+  const size_t size = 3;
+  const int negative = -1;
+  UTIL_CHECK_GT(size, 0);
+  UTIL_CHECK_LT(negative, size);
+  UTIL_CHECK_NE(negative, static_cast<unsigned>(-1));
+  UTIL_CHECK_GE(uint8_t{ 200 }, int8_t{ -100 });
+  UTIL_CHECK_EQ('a', 'a');
+  UTIL_CHECK_EQ(true, true);
+}
+
+// The check macros are single statements.
+TEST(CheckTest, TestIfElse) {
+  bool taken = false;
+  if (taken)
+    UTIL_CHECK(false) << "Not reached";
+  else
+    taken = true;
+  EXPECT_TRUE(taken);
+}
+
+#if UTIL_CHECK_LEVEL >= 1
+
+TEST(CheckDeathTest, TestCheck) {
+  EXPECT_DEATH(UTIL_CHECK(1 + 1 == 3) << "math " << 42,
+               "util_test.cc:[0-9]+: Check failed: 1 \\+ 1 == 3 math 42");
+}
+
+TEST(CheckDeathTest, TestCheckOp) {
+  const size_t size = 3;
+  EXPECT_DEATH(UTIL_CHECK_EQ(size, size_t{ 4 }) << "context",
+               "Check failed: size == size_t\\{ 4 \\} \\(3 vs. 4\\) context");
+  EXPECT_DEATH(UTIL_CHECK_GE(size, size_t{ 4 }), "\\(3 vs. 4\\)");
+  EXPECT_DEATH(UTIL_CHECK_LT(size, -1), "\\(3 vs. -1\\)");
+}
+
+#endif
+
+}  // namespace util
@@ -0,0 +1,75 @@
+#include "util/metrics.h"
+
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+namespace {
+
+int64_t MonotonicNanoseconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+double MeasureNanosecondsPerTick() {
+#if defined(__x86_64__)
+  const int64_t start = MonotonicNanoseconds();
+  const uint64_t start_ticks = CycleClock::Now();
+  int64_t end;
+  do {
+    end = MonotonicNanoseconds();
+  } while (end - start < 1'000'000);
+  const uint64_t end_ticks = CycleClock::Now();
+  return static_cast<double>(end - start) / (end_ticks - start_ticks);
+#else
+  return 1;
+#endif
+}
+
+}  // namespace
+
+Histogram::~Histogram() {
+  for (std::atomic<Shard*>& shard : shards_) {
+    delete shard.load(std::memory_order_relaxed);
+  }
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  for (const std::atomic<Shard*>& slot : shards_) {
+    const Shard* shard = slot.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    for (size_t i = 0; i < shard->buckets.size(); i++) {
+      snapshot.buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.sum += shard->sum.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+Histogram::Shard* Histogram::AddShard() {
+  std::atomic<Shard*>& slot = shards_[internal::ThisThreadMetricShard()];
+  Shard* shard = new Shard;
+  Shard* existing = nullptr;
+  // Past `kNumMetricShards` threads, another thread may have added it.
+  if (!slot.compare_exchange_strong(existing, shard,
+                                    std::memory_order_acq_rel)) {
+    delete shard;
+    return existing;
+  }
+  return shard;
+}
+
+double CycleClock::NanosecondsPerTick() {
+  static const double nanoseconds_per_tick = MeasureNanosecondsPerTick();
+  return nanoseconds_per_tick;
+}
+
+}  // namespace util
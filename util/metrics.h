@@ -0,0 +1,274 @@
+#pragma once
+
+#include <time.h>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace util {
+
+namespace internal {
+
+// Metrics spread their updates over this many shards, on separate cache
+// lines, so that threads updating the same metric rarely contend.
+inline constexpr size_t kNumMetricShards = 64;
+
+// Assigns threads to shards round-robin, so that up to `kNumMetricShards`
+// threads never share one.
+inline size_t ThisThreadMetricShard() {
+  static std::atomic<size_t> next_shard = 0;
+  thread_local const size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumMetricShards;
+  return shard;
+}
+
+}  // namespace internal
+
+// A count which only increases, e.g. of requests served. Updates are relaxed
+// atomic adds to the calling thread's shard, so they may be made from any
+// thread without locking or bouncing a cache line between threads. Reads sum
+// the shards.
+class Counter {
+ public:
+  Counter() = default;
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  void Add(uint64_t n = 1) {
+    shards_[internal::ThisThreadMetricShard()].value.fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  uint64_t Value() const {
+    uint64_t value = 0;
+    for (const Shard& shard : shards_) {
+      value += shard.value.load(std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value = 0;
+  };
+
+  Shard shards_[internal::kNumMetricShards];
+};
+
+// A value which may go up and down, e.g. the depth of a queue. Unlike
+// `Counter`, a gauge is a single atomic, since `Set` must replace the value
+// all threads see.
+class Gauge {
+ public:
+  Gauge() = default;
+
+  Gauge(const Gauge&) = delete;
+  Gauge& operator=(const Gauge&) = delete;
+
+  void Set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  void Add(int64_t n) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  int64_t Value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> value_ = 0;
+};
+
+// The counts of a `Histogram` at one time.
+//
+// Buckets are log-linear, as in HdrHistogram: values below
+// 2^(kPrecisionBits + 1) each have their own bucket, and above that each
+// power of two range is split into 2^kPrecisionBits buckets. A value is thus
+// within 1/2^kPrecisionBits (about 6%) of its bucket's bounds.
+struct HistogramSnapshot {
+  static constexpr int kPrecisionBits = 4;
+  static constexpr size_t kNumBuckets = (65 - kPrecisionBits)
+                                        << kPrecisionBits;
+
+  static constexpr size_t BucketIndex(uint64_t value) {
+    const int width = std::bit_width(value);
+    if (width <= kPrecisionBits + 1) {
+      return value;
+    }
+    // The top kPrecisionBits + 1 bits of `value` pick the bucket within its
+    // power of two range.
+    const int shift = width - kPrecisionBits - 1;
+    return (static_cast<size_t>(shift) << kPrecisionBits) + (value >> shift);
+  }
+
+  // The largest value in bucket `i`.
+  static constexpr uint64_t BucketLimit(size_t i) {
+    if (i < (size_t{ 2 } << kPrecisionBits)) {
+      return i;
+    }
+    const size_t shift = (i >> kPrecisionBits) - 1;
+    const uint64_t top = i - (shift << kPrecisionBits);
+    return ((top + 1) << shift) - 1;
+  }
+
+  std::array<uint64_t, kNumBuckets> buckets = {};
+  uint64_t sum = 0;
+
+  uint64_t count() const {
+    uint64_t count = 0;
+    for (uint64_t n : buckets) {
+      count += n;
+    }
+    return count;
+  }
+
+  double Mean() const {
+    const uint64_t n = count();
+    return n == 0 ? 0 : static_cast<double>(sum) / n;
+  }
+
+  // Returns the upper bound of the bucket holding the `p`th percentile
+  // (0-100) of the values, or 0 if there are none.
+  uint64_t Percentile(double p) const {
+    const uint64_t rank = static_cast<uint64_t>(p / 100 * count());
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+      seen += buckets[i];
+      if (seen > rank) {
+        return BucketLimit(i);
+      }
+    }
+    return Max();
+  }
+
+  // Returns the upper bound of the bucket holding the largest value, or 0 if
+  // there are none.
+  uint64_t Max() const {
+    for (size_t i = buckets.size(); i > 0; i--) {
+      if (buckets[i - 1] != 0) {
+        return BucketLimit(i - 1);
+      }
+    }
+    return 0;
+  }
+
+  // Adds the counts of `other`, e.g. of the same metric in another process.
+  HistogramSnapshot& operator+=(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < buckets.size(); i++) {
+      buckets[i] += other.buckets[i];
+    }
+    sum += other.sum;
+    return *this;
+  }
+
+  // Leaves the counts of the values recorded since `earlier`, an earlier
+  // snapshot of the same histogram.
+  HistogramSnapshot& operator-=(const HistogramSnapshot& earlier) {
+    for (size_t i = 0; i < buckets.size(); i++) {
+      buckets[i] -= earlier.buckets[i];
+    }
+    sum -= earlier.sum;
+    return *this;
+  }
+};
+
+// Counts values, e.g. latencies in nanoseconds, in the buckets of
+// `HistogramSnapshot`, from which percentiles can be estimated. Each thread
+// records into its own shard, allocated on its first `Record`, with two
+// relaxed atomic adds.
+class Histogram {
+ public:
+  Histogram() = default;
+
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  ~Histogram();
+
+  void Record(uint64_t value) {
+    Shard* shard = shards_[internal::ThisThreadMetricShard()].load(
+        std::memory_order_acquire);
+    if (shard == nullptr) [[unlikely]] {
+      shard = AddShard();
+    }
+    shard->buckets[HistogramSnapshot::BucketIndex(value)].fetch_add(
+        1, std::memory_order_relaxed);
+    shard->sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  // Sums the shards. The counts are read one at a time, so values recorded
+  // concurrently may be missing from some of them.
+  HistogramSnapshot Snapshot() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::kNumBuckets> buckets =
+        {};
+    std::atomic<uint64_t> sum = 0;
+  };
+
+  // Allocates the calling thread's shard.
+  [[gnu::cold, gnu::noinline]] Shard* AddShard();
+
+  std::array<std::atomic<Shard*>, internal::kNumMetricShards> shards_ = {};
+};
+
+// A monotonic clock for timing short intervals, cheaper to read than
+// `absl::Now`: the TSC on x86-64, and `CLOCK_MONOTONIC` elsewhere.
+class CycleClock {
+ public:
+  static uint64_t Now() {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+#endif
+  }
+
+  // The length of a tick, measured against `CLOCK_MONOTONIC` on the first
+  // call, which takes a millisecond.
+  static double NanosecondsPerTick();
+
+  static uint64_t ToNanoseconds(uint64_t ticks) {
+    return static_cast<uint64_t>(ticks * NanosecondsPerTick());
+  }
+};
+
+// Records the nanoseconds from its construction to its destruction into a
+// histogram.
+//
+// Example:
+//   {
+//     ScopedTimer timer(latency);
+//     HandleRequest();
+//   }
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Histogram& histogram)
+      : histogram_(histogram), start_(CycleClock::Now()) {}
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  ~ScopedTimer() {
+    histogram_.Record(CycleClock::ToNanoseconds(CycleClock::Now() - start_));
+  }
+
+ private:
+  Histogram& histogram_;
+  uint64_t start_;
+};
+
+}  // namespace util
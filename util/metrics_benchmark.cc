@@ -0,0 +1,78 @@
+#include <atomic>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+#include "util/metrics.h"
+
+namespace util {
+
+namespace {
+
+// The baseline: one atomic shared by all threads, whose cache line bounces
+// between their cores.
+void BM_SharedAtomicAdd(benchmark::State& state) {
+  static std::atomic<uint64_t> counter;
+  for (auto _ : state) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_CounterAdd(benchmark::State& state) {
+  static Counter counter;
+  for (auto _ : state) {
+    counter.Add();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_GaugeSet(benchmark::State& state) {
+  static Gauge gauge;
+  int64_t value = 0;
+  for (auto _ : state) {
+    gauge.Set(value++);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Latency-like values, which concentrate in a few buckets.
+void BM_HistogramRecord(benchmark::State& state) {
+  static Histogram histogram;
+  uint64_t value = 1;
+  for (auto _ : state) {
+    histogram.Record(10'000 + (value >> 52));
+    value = value * 6364136223846793005 + 1442695040888963407;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_ScopedTimer(benchmark::State& state) {
+  static Histogram histogram;
+  for (auto _ : state) {
+    ScopedTimer timer(histogram);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_HistogramSnapshot(benchmark::State& state) {
+  Histogram histogram;
+  for (uint64_t value = 0; value < 1000; value++) {
+    histogram.Record(value * value);
+  }
+  for (auto _ : state) {
+    HistogramSnapshot snapshot = histogram.Snapshot();
+    benchmark::DoNotOptimize(snapshot.Percentile(99));
+  }
+}
+
+BENCHMARK(BM_SharedAtomicAdd)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_CounterAdd)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_GaugeSet)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_HistogramRecord)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_ScopedTimer)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_HistogramSnapshot);
+
+}  // namespace
+
+}  // namespace util
@@ -0,0 +1,124 @@
+#include "util/metrics.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace util {
+
+TEST(MetricsTest, TestCounter) {
+  Counter counter;
+  EXPECT_EQ(counter.Value(), 0);
+  counter.Add();
+  counter.Add(41);
+  EXPECT_EQ(counter.Value(), 42);
+}
+
+TEST(MetricsTest, TestGauge) {
+  Gauge gauge;
+  gauge.Set(10);
+  gauge.Add(-15);
+  EXPECT_EQ(gauge.Value(), -5);
+}
+
+// More threads than shards, so that some share them.
+TEST(MetricsTest, TestConcurrentUpdates) {
+  constexpr int kThreads = 80;
+  constexpr int kAdds = 10000;
+  Counter counter;
+  Histogram histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kAdds; j++) {
+        counter.Add();
+        histogram.Record(j);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter.Value(), kThreads * kAdds);
+  EXPECT_EQ(histogram.Snapshot().count(), kThreads * kAdds);
+}
+
+TEST(MetricsTest, TestHistogramBuckets) {
+  using Snapshot = HistogramSnapshot;
+  // Small values are exact.
+  for (uint64_t value = 0; value < 32; value++) {
+    EXPECT_EQ(Snapshot::BucketIndex(value), value);
+    EXPECT_EQ(Snapshot::BucketLimit(value), value);
+  }
+  EXPECT_EQ(Snapshot::BucketIndex(UINT64_MAX), Snapshot::kNumBuckets - 1);
+  EXPECT_EQ(Snapshot::BucketLimit(Snapshot::kNumBuckets - 1), UINT64_MAX);
+  // Every bucket starts after the previous one's limit, and is at most 1/16
+  // of its values wide.
+  for (size_t i = 1; i < Snapshot::kNumBuckets; i++) {
+    const uint64_t low = Snapshot::BucketLimit(i - 1) + 1;
+    const uint64_t high = Snapshot::BucketLimit(i);
+    ASSERT_EQ(Snapshot::BucketIndex(low), i);
+    ASSERT_EQ(Snapshot::BucketIndex(high), i);
+    ASSERT_LE(high - low, low >> Snapshot::kPrecisionBits);
+  }
+}
+
+TEST(MetricsTest, TestHistogram) {
+  Histogram histogram;
+  EXPECT_EQ(histogram.Snapshot().Percentile(50), 0);
+  EXPECT_EQ(histogram.Snapshot().Max(), 0);
+
+  for (uint64_t value = 1; value <= 100; value++) {
+    histogram.Record(value);
+  }
+  const HistogramSnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ(snapshot.count(), 100);
+  EXPECT_EQ(snapshot.sum, 5050);
+  EXPECT_DOUBLE_EQ(snapshot.Mean(), 50.5);
+  // Upper bounds of the buckets holding 51, 91 and 100.
+  EXPECT_EQ(snapshot.Percentile(50), 51);
+  EXPECT_EQ(snapshot.Percentile(90), 91);
+  EXPECT_EQ(snapshot.Percentile(0), 1);
+  EXPECT_EQ(snapshot.Max(), 103);
+
+  histogram.Record(0);
+  histogram.Record(UINT64_MAX);
+  HistogramSnapshot interval = histogram.Snapshot();
+  interval -= snapshot;
+  EXPECT_EQ(interval.count(), 2);
+  EXPECT_EQ(interval.Percentile(0), 0);
+  EXPECT_EQ(interval.Max(), UINT64_MAX);
+}
+
+TEST(MetricsTest, TestHistogramMerge) {
+  Histogram h1;
+  Histogram h2;
+  h1.Record(10);
+  // From another thread, into another shard.
+  std::thread([&] { h1.Record(20); }).join();
+  h2.Record(1000);
+  HistogramSnapshot merged = h1.Snapshot();
+  merged += h2.Snapshot();
+  EXPECT_EQ(merged.count(), 3);
+  EXPECT_EQ(merged.sum, 1030);
+  EXPECT_EQ(merged.Percentile(50), 20);
+  EXPECT_EQ(merged.Max(), 1023);
+}
+
+TEST(MetricsTest, TestScopedTimer) {
+  Histogram latency;
+  {
+    ScopedTimer timer(latency);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  const HistogramSnapshot snapshot = latency.Snapshot();
+  ASSERT_EQ(snapshot.count(), 1);
+  EXPECT_GE(snapshot.sum, 4'500'000);
+  EXPECT_LT(snapshot.sum, 1'000'000'000);
+}
+
+}  // namespace util
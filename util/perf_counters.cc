@@ -0,0 +1,143 @@
+#include "util/perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+#include "util/internal/util.h"
+
+namespace util {
+
+namespace {
+
+// In the order of `PerfCounters::Sample::values`. The first leads the group.
+constexpr uint64_t kEvents[PerfCounters::kNumEvents] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+// What a read of the group leader returns, with `PERF_FORMAT_GROUP`.
+struct GroupReadFormat {
+  uint64_t nr;
+  uint64_t time_enabled;
+  uint64_t time_running;
+  uint64_t values[PerfCounters::kNumEvents];
+};
+
+// Opens a counter of `event` for the calling thread, in the group led by
+// `group_fd`, or leading a new, disabled group if it is -1.
+int OpenEvent(uint64_t event, int group_fd) {
+  perf_event_attr attr = {};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = event;
+  attr.disabled = group_fd == -1;
+  // Counting the kernel needs privileges, and is noise for user-space code.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+}  // namespace
+
+absl::StatusOr<PerfCounters> PerfCounters::Create() {
+  const int group_fd = OpenEvent(kEvents[0], -1);
+  if (group_fd < 0) {
+    return absl::ErrnoToStatus(errno, "Failed to open perf events");
+  }
+  PerfCounters counters(group_fd);
+  for (size_t i = 1; i < kNumEvents; i++) {
+    const int fd = OpenEvent(kEvents[i], group_fd);
+    if (fd < 0) {
+      return absl::ErrnoToStatus(errno, "Failed to open perf events");
+    }
+    counters.member_fds_[i - 1] = fd;
+  }
+  if (ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0) {
+    return absl::ErrnoToStatus(errno, "Failed to enable perf events");
+  }
+  return counters;
+}
+
+const absl::StatusOr<PerfCounters>& PerfCounters::ForThisThread() {
+  thread_local const absl::StatusOr<PerfCounters> counters = Create();
+  return counters;
+}
+
+PerfCounters::PerfCounters(PerfCounters&& other) noexcept
+    : group_fd_(std::exchange(other.group_fd_, -1)),
+      member_fds_(std::exchange(other.member_fds_, { -1, -1, -1 })) {}
+
+PerfCounters& PerfCounters::operator=(PerfCounters&& other) noexcept {
+  if (this != &other) {
+    Close();
+    group_fd_ = std::exchange(other.group_fd_, -1);
+    member_fds_ = std::exchange(other.member_fds_, { -1, -1, -1 });
+  }
+  return *this;
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+void PerfCounters::Close() {
+  for (int fd : member_fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  if (group_fd_ >= 0) {
+    close(group_fd_);
+  }
+}
+
+PerfCounters::Sample PerfCounters::Read() const {
+  GroupReadFormat group;
+  const ssize_t size = read(group_fd_, &group, sizeof(group));
+  UTIL_CHECK_EQ(size, static_cast<ssize_t>(sizeof(group)))
+      << "Failed to read perf events, errno " << errno;
+  Sample sample = {
+    .enabled = group.time_enabled,
+    .running = group.time_running,
+  };
+  for (size_t i = 0; i < kNumEvents; i++) {
+    sample.values[i] = group.values[i];
+  }
+  return sample;
+}
+
+PerfCounts PerfCounters::Between(const Sample& start, const Sample& end) {
+  const uint64_t running = end.running - start.running;
+  if (running == 0) {
+    return {};
+  }
+  const double scale = static_cast<double>(end.enabled - start.enabled) /
+                       static_cast<double>(running);
+  const auto delta = [&](size_t i) {
+    return static_cast<uint64_t>(
+        static_cast<double>(end.values[i] - start.values[i]) * scale);
+  };
+  return {
+    .cycles = delta(0),
+    .instructions = delta(1),
+    .cache_misses = delta(2),
+    .branch_misses = delta(3),
+  };
+}
+
+}  // namespace util
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+
+namespace util {
+
+// Hardware event counts over an interval.
+struct PerfCounts {
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  // Last-level cache misses.
+  uint64_t cache_misses = 0;
+  uint64_t branch_misses = 0;
+
+  // Instructions per cycle.
+  double ipc() const {
+    return cycles == 0 ? 0 : static_cast<double>(instructions) / cycles;
+  }
+
+  PerfCounts& operator+=(const PerfCounts& other) {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+    branch_misses += other.branch_misses;
+    return *this;
+  }
+
+  bool operator==(const PerfCounts&) const = default;
+};
+
+// A group of hardware performance counters for the calling thread, opened with
+// Linux's `perf_event_open`, which count the events of `PerfCounts` in user
+// space. The events are counted together, so their ratios are consistent even
+// when the kernel multiplexes them with other groups, which it compensates for
+// by scaling.
+//
+// Example:
+//   absl::StatusOr<PerfCounters> counters = PerfCounters::Create();
+//   if (counters.ok()) {
+//     const PerfCounters::Sample start = counters->Read();
+//     Work();
+//     const PerfCounts counts = PerfCounters::Between(start, counters->Read());
+//   }
+class PerfCounters {
+ public:
+  static constexpr size_t kNumEvents = 4;
+
+  // Raw counts since the counters were opened.
+  struct Sample {
+    std::array<uint64_t, kNumEvents> values = {};
+    // How long the group was enabled, and actually counting, in nanoseconds.
+    uint64_t enabled = 0;
+    uint64_t running = 0;
+  };
+
+  // Opens and starts the counters. Fails where perf events are unavailable:
+  // under a seccomp filter (as in many containers), with
+  // `/proc/sys/kernel/perf_event_paranoid` above 2, or in a VM without a
+  // virtual PMU.
+  static absl::StatusOr<PerfCounters> Create();
+
+  // The calling thread's counters, opened on its first call, or the error
+  // opening them.
+  static const absl::StatusOr<PerfCounters>& ForThisThread();
+
+  PerfCounters(PerfCounters&& other) noexcept;
+  PerfCounters& operator=(PerfCounters&& other) noexcept;
+
+  ~PerfCounters();
+
+  Sample Read() const;
+
+  // The counts between two samples, scaled up for the time the group was
+  // not counting.
+  static PerfCounts Between(const Sample& start, const Sample& end);
+
+ private:
+  explicit PerfCounters(int group_fd) : group_fd_(group_fd) {}
+
+  void Close();
+
+  // The group leader, which reads the whole group.
+  int group_fd_;
+  std::array<int, kNumEvents - 1> member_fds_ = { -1, -1, -1 };
+};
+
+// Adds the counts over its scope to `counts`, or does nothing if `counters` is
+// null.
+//
+// Example:
+//   PerfCounts counts;
+//   {
+//     PerfScope scope(counters, counts);
+//     Work();
+//   }
+class PerfScope {
+ public:
+  PerfScope(const PerfCounters* counters, PerfCounts& counts)
+      : counters_(counters), counts_(counts) {
+    if (counters_ != nullptr) {
+      start_ = counters_->Read();
+    }
+  }
+
+  PerfScope(const PerfScope&) = delete;
+  PerfScope& operator=(const PerfScope&) = delete;
+
+  ~PerfScope() {
+    if (counters_ != nullptr) {
+      counts_ += PerfCounters::Between(start_, counters_->Read());
+    }
+  }
+
+ private:
+  const PerfCounters* counters_;
+  PerfCounts& counts_;
+  PerfCounters::Sample start_;
+};
+
+}  // namespace util
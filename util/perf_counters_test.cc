@@ -0,0 +1,99 @@
+#include "util/perf_counters.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "gtest/gtest.h"
+
+#include "util/gtest_util.h"
+
+namespace util {
+
+namespace {
+
+// Sums 0..n-1 in a way the compiler cannot fold, in at least n instructions.
+uint64_t Work(uint64_t n) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    sum += i;
+    asm volatile("" : "+r"(sum));
+  }
+  return sum;
+}
+
+}  // namespace
+
+TEST(PerfCountersTest, TestCounts) {
+  PerfCounts counts = { .cycles = 100, .instructions = 250 };
+  EXPECT_DOUBLE_EQ(counts.ipc(), 2.5);
+  counts += { .cycles = 100, .cache_misses = 3 };
+  EXPECT_EQ(counts, (PerfCounts{ .cycles = 200,
+                                 .instructions = 250,
+                                 .cache_misses = 3 }));
+  EXPECT_EQ(PerfCounts{}.ipc(), 0);
+}
+
+// The group counted for half the time it was enabled, so the counts are
+// doubled.
+TEST(PerfCountersTest, TestBetweenScales) {
+  const PerfCounters::Sample start = {
+    .values = { 1000, 2000, 10, 20 },
+    .enabled = 100,
+    .running = 100,
+  };
+  const PerfCounters::Sample end = {
+    .values = { 1500, 3000, 15, 20 },
+    .enabled = 300,
+    .running = 200,
+  };
+  EXPECT_EQ(PerfCounters::Between(start, end),
+            (PerfCounts{ .cycles = 1000,
+                         .instructions = 2000,
+                         .cache_misses = 10,
+                         .branch_misses = 0 }));
+  // Never scheduled.
+  EXPECT_EQ(PerfCounters::Between(start, start), PerfCounts{});
+}
+
+TEST(PerfCountersTest, TestCounting) {
+  absl::StatusOr<PerfCounters> counters = PerfCounters::Create();
+  if (!counters.ok()) {
+    GTEST_SKIP() << counters.status();
+  }
+  PerfCounters moved = *std::move(counters);
+
+  PerfCounts counts;
+  {
+    PerfScope scope(&moved, counts);
+    EXPECT_NE(Work(1'000'000), 0);
+  }
+  EXPECT_GE(counts.instructions, 1'000'000);
+  EXPECT_GT(counts.cycles, 0);
+
+  // Scopes add up.
+  const PerfCounts first = counts;
+  {
+    PerfScope scope(&moved, counts);
+    EXPECT_NE(Work(1'000'000), 0);
+  }
+  EXPECT_GE(counts.instructions, first.instructions + 1'000'000);
+}
+
+TEST(PerfCountersTest, TestForThisThread) {
+  const absl::StatusOr<PerfCounters>& counters = PerfCounters::ForThisThread();
+  EXPECT_EQ(&counters, &PerfCounters::ForThisThread());
+  // Where unavailable, scopes do nothing.
+  PerfCounts counts;
+  {
+    PerfScope scope(nullptr, counts);
+  }
+  EXPECT_EQ(counts, PerfCounts{});
+}
+
+TEST(PerfCountersTest, TestScopedPerfProperties) {
+  ScopedPerfProperties perf;
+  EXPECT_NE(Work(1000), 0);
+}
+
+}  // namespace util
@@ -34,4 +34,5 @@
 #define P_256_DEFAULT   "\u001b[39m"
 
 #define P_256_BG_COLOR(id) "\u001b[48;5;" STR_CONCAT(id) "m"
+#define P_256_BG_VAR_COLOR "\u001b[48;5;%um"
 #define P_256_BG_DEFAULT   "\u001b[49m"
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+#include "util/internal/util.h"
+#include "util/macro_util.h"
+
+namespace util {
+
+// The error of a failed `Result`, which converts to a `Result` of any value
+// type with the same error type.
+//
+// Example:
+//   return util::Error{ ParseError::kBadDigit };
+template <typename E>
+struct Error {
+  E error;
+};
+
+// Aggregate deduction for `Error{ ... }` above is only implemented by clang 17
+// and later.
+template <typename E>
+Error(E) -> Error<E>;
+
+// Either a value of type `T`, or an error of type `E`, typically a small enum
+// of error codes. Unlike `absl::StatusOr`, it never allocates, and it is
+// trivially copyable when `T` and `E` are, so it is returned in registers when
+// small. `T` may be void, for operations which return only success or an
+// error.
+//
+// Convert to and from `absl::StatusOr` at API boundaries with `ToStatusOr` and
+// `ToResult`.
+template <typename T, typename E>
+class [[nodiscard]] Result {
+  using Stored = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+  // Whether the defaulted copy, move and destructor apply. A union is used
+  // rather than `std::variant` so that small results stay in registers across
+  // calls instead of being assembled on the stack.
+  static constexpr bool kTrivial =
+      std::is_trivially_copyable_v<Stored> && std::is_trivially_copyable_v<E>;
+  static constexpr bool kCopyable =
+      std::is_copy_constructible_v<Stored> && std::is_copy_constructible_v<E>;
+
+ public:
+  using value_type = T;
+  using error_type = E;
+
+  // A successful result, if `T` is void.
+  Result()
+    requires std::is_void_v<T>
+      : value_(), ok_(true) {}
+
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  Result(const Stored& value)
+    requires(!std::is_void_v<T>)
+      : value_(value), ok_(true) {}
+
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  Result(Stored&& value)
+    requires(!std::is_void_v<T>)
+      : value_(std::move(value)), ok_(true) {}
+
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  Result(Error<E> error) : error_(std::move(error.error)), ok_(false) {}
+
+  Result(const Result&)
+    requires kTrivial
+  = default;
+  Result(const Result& other)
+    requires(!kTrivial && kCopyable)
+  {
+    Construct(other);
+  }
+
+  Result(Result&&)
+    requires kTrivial
+  = default;
+  Result(Result&& other) noexcept { Construct(std::move(other)); }
+
+  Result& operator=(const Result&)
+    requires kTrivial
+  = default;
+  Result& operator=(const Result& other)
+    requires(!kTrivial && kCopyable)
+  {
+    if (this != &other) {
+      Destroy();
+      Construct(other);
+    }
+    return *this;
+  }
+
+  Result& operator=(Result&&)
+    requires kTrivial
+  = default;
+  Result& operator=(Result&& other) noexcept {
+    if (this != &other) {
+      Destroy();
+      Construct(std::move(other));
+    }
+    return *this;
+  }
+
+  ~Result()
+    requires kTrivial
+  = default;
+  ~Result() {
+    Destroy();
+  }
+
+  bool ok() const {
+    return ok_;
+  }
+
+  // Requires `!ok()`.
+  const E& error() const {
+    UTIL_DCHECK(!ok());
+    return error_;
+  }
+
+  // Requires `ok()`.
+  const Stored& value() const&
+    requires(!std::is_void_v<T>)
+  {
+    UTIL_DCHECK(ok());
+    return value_;
+  }
+
+  Stored& value() &
+    requires(!std::is_void_v<T>)
+  {
+    UTIL_DCHECK(ok());
+    return value_;
+  }
+
+  Stored&& value() &&
+    requires(!std::is_void_v<T>)
+  {
+    UTIL_DCHECK(ok());
+    return std::move(value_);
+  }
+
+  const Stored& operator*() const&
+    requires(!std::is_void_v<T>)
+  {
+    return value();
+  }
+
+  Stored& operator*() &
+    requires(!std::is_void_v<T>)
+  {
+    return value();
+  }
+
+  Stored&& operator*() &&
+    requires(!std::is_void_v<T>)
+  {
+    return std::move(*this).value();
+  }
+
+  const Stored* operator->() const
+    requires(!std::is_void_v<T>)
+  {
+    return &value();
+  }
+
+  Stored* operator->()
+    requires(!std::is_void_v<T>)
+  {
+    return &value();
+  }
+
+  // Returns the value, or `default_value` on error.
+  template <typename U>
+  Stored value_or(U&& default_value) const&
+    requires(!std::is_void_v<T>)
+  {
+    return ok() ? value()
+                : static_cast<Stored>(std::forward<U>(default_value));
+  }
+
+  friend bool operator==(const Result& lhs, const Result& rhs) {
+    if (lhs.ok_ != rhs.ok_) {
+      return false;
+    }
+    if (!lhs.ok_) {
+      return lhs.error_ == rhs.error_;
+    }
+    return lhs.value_ == rhs.value_;
+  }
+
+ private:
+  template <typename Other>
+  void Construct(Other&& other) {
+    ok_ = other.ok_;
+    if (ok_) {
+      std::construct_at(&value_, std::forward<Other>(other).value_);
+    } else {
+      std::construct_at(&error_, std::forward<Other>(other).error_);
+    }
+  }
+
+  void Destroy() {
+    if (ok_) {
+      std::destroy_at(&value_);
+    } else {
+      std::destroy_at(&error_);
+    }
+  }
+
+  union {
+    Stored value_;
+    E error_;
+  };
+  bool ok_;
+};
+
+// Converts error codes to statuses, for `ToStatusOr`. Error types other than
+// `absl::StatusCode` should provide `absl::Status ToStatus(E)` in their own
+// namespace.
+inline absl::Status ToStatus(absl::StatusCode code) {
+  return absl::Status(code, "");
+}
+
+template <typename E>
+absl::Status ToStatus(const Result<void, E>& result) {
+  if (result.ok()) {
+    return absl::OkStatus();
+  }
+  return ToStatus(result.error());
+}
+
+template <typename T, typename E>
+  requires(!std::is_void_v<T>)
+absl::StatusOr<T> ToStatusOr(Result<T, E> result) {
+  if (!result.ok()) {
+    return ToStatus(result.error());
+  }
+  return *std::move(result);
+}
+
+// Converts a status to a result holding only its code. The message is dropped.
+inline Result<void, absl::StatusCode> ToResult(const absl::Status& status) {
+  if (!status.ok()) {
+    return Error{ status.code() };
+  }
+  return {};
+}
+
+template <typename T>
+Result<T, absl::StatusCode> ToResult(absl::StatusOr<T> status_or) {
+  if (!status_or.ok()) {
+    return Error{ status_or.status().code() };
+  }
+  return *std::move(status_or);
+}
+
+}  // namespace util
+
+// Like `RETURN_IF_ERROR`, but for a `util::Result`. Returns its error from a
+// function returning a `util::Result` of any value type with the same error
+// type.
+#define RETURN_IF_ERROR_RESULT(expr)           \
+  do {                                         \
+    auto _result = (expr);                     \
+    if (!_result.ok()) [[unlikely]] {          \
+      return ::util::Error{ _result.error() }; \
+    }                                          \
+  } while (0)
+
+#define ASSIGN_OR_RETURN_RESULT_IMPL(tmp, lhs, ...) \
+  auto tmp = (__VA_ARGS__);                         \
+  if (!(tmp).ok()) [[unlikely]] {                   \
+    return ::util::Error{ (tmp).error() };          \
+  }                                                 \
+  lhs = *std::move(tmp)  // NOLINT(bugprone-macro-parentheses)
+
+// Like `ASSIGN_OR_RETURN`, but for a `util::Result`.
+#define ASSIGN_OR_RETURN_RESULT(lhs, ...)                                     \
+  ASSIGN_OR_RETURN_RESULT_IMPL(UTILS_CONCAT_NAME(_result_value, __COUNTER__), \
+                               lhs, __VA_ARGS__)
+
+#define DEFINE_OR_RETURN_RESULT_IMPL(type, lhs, tmp, ...) \
+  auto tmp = (__VA_ARGS__);                               \
+  if (!(tmp).ok()) [[unlikely]] {                         \
+    return ::util::Error{ (tmp).error() };                \
+  }                                                       \
+  type &lhs = *(tmp)  // NOLINT(bugprone-macro-parentheses)
+
+// Like `DEFINE_OR_RETURN`, but for a `util::Result`.
+#define DEFINE_OR_RETURN_RESULT(type, lhs, ...)                              \
+  DEFINE_OR_RETURN_RESULT_IMPL(                                              \
+      type, lhs, UTILS_CONCAT_NAME(__define_or_return_result_, __COUNTER__), \
+      __VA_ARGS__)
@@ -0,0 +1,122 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+
+#include "util/absl_util.h"
+#include "util/result.h"
+
+namespace util {
+
+namespace {
+
+// The number of calls per benchmark iteration.
+constexpr size_t kCallsPerIteration = 1024;
+
+enum class ParseError : uint8_t {
+  kBadDigit,
+};
+
+// Inputs of which `percent`% fail at the deepest call level.
+std::vector<uint32_t> Inputs(int64_t percent) {
+  std::mt19937 gen(percent);
+  std::uniform_int_distribution<int64_t> dist(0, 99);
+  std::vector<uint32_t> inputs(kCallsPerIteration);
+  for (uint32_t& input : inputs) {
+    input = dist(gen) < percent ? 0 : static_cast<uint32_t>(gen() | 1);
+  }
+  return inputs;
+}
+
+// Five levels of calls, each adding to the value of the one below, as in a
+// recursive-descent parser.
+ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<uint32_t> StatusOrLevel1(uint32_t x) {
+  if (x == 0) {
+    return absl::InvalidArgumentError("Bad digit");
+  }
+  return x;
+}
+
+#define STATUS_OR_LEVEL(n, below)                                    \
+  ABSL_ATTRIBUTE_NOINLINE absl::StatusOr<uint32_t> StatusOrLevel##n( \
+      uint32_t x) {                                                  \
+    DEFINE_OR_RETURN(uint32_t, value, StatusOrLevel##below(x));      \
+    return value + 1;                                                \
+  }
+
+STATUS_OR_LEVEL(2, 1)
+STATUS_OR_LEVEL(3, 2)
+STATUS_OR_LEVEL(4, 3)
+STATUS_OR_LEVEL(5, 4)
+
+#undef STATUS_OR_LEVEL
+
+ABSL_ATTRIBUTE_NOINLINE Result<uint32_t, ParseError> ResultLevel1(uint32_t x) {
+  if (x == 0) {
+    return Error{ ParseError::kBadDigit };
+  }
+  return x;
+}
+
+#define RESULT_LEVEL(n, below)                                         \
+  ABSL_ATTRIBUTE_NOINLINE Result<uint32_t, ParseError> ResultLevel##n( \
+      uint32_t x) {                                                    \
+    DEFINE_OR_RETURN_RESULT(uint32_t, value, ResultLevel##below(x));   \
+    return value + 1;                                                  \
+  }
+
+RESULT_LEVEL(2, 1)
+RESULT_LEVEL(3, 2)
+RESULT_LEVEL(4, 3)
+RESULT_LEVEL(5, 4)
+
+#undef RESULT_LEVEL
+
+// Args: percent of calls which fail.
+void BM_StatusOr(benchmark::State& state) {
+  const std::vector<uint32_t> inputs = Inputs(state.range(0));
+  for (auto _ : state) {
+    size_t errors = 0;
+    for (uint32_t input : inputs) {
+      absl::StatusOr<uint32_t> result = StatusOrLevel5(input);
+      errors += !result.ok();
+      benchmark::DoNotOptimize(result);
+    }
+    benchmark::DoNotOptimize(errors);
+  }
+  state.SetItemsProcessed(state.iterations() * kCallsPerIteration);
+}
+
+// Args: percent of calls which fail.
+void BM_Result(benchmark::State& state) {
+  const std::vector<uint32_t> inputs = Inputs(state.range(0));
+  for (auto _ : state) {
+    size_t errors = 0;
+    for (uint32_t input : inputs) {
+      Result<uint32_t, ParseError> result = ResultLevel5(input);
+      errors += !result.ok();
+      benchmark::DoNotOptimize(result);
+    }
+    benchmark::DoNotOptimize(errors);
+  }
+  state.SetItemsProcessed(state.iterations() * kCallsPerIteration);
+}
+
+void ErrorArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({ "percent" });
+  for (int64_t percent : { 0, 1, 10, 50, 100 }) {
+    b->Arg(percent);
+  }
+}
+
+BENCHMARK(BM_StatusOr)->Apply(ErrorArgs);
+BENCHMARK(BM_Result)->Apply(ErrorArgs);
+
+}  // namespace
+
+}  // namespace util
@@ -0,0 +1,163 @@
+#include "util/result.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "util/gtest_util.h"
+
+namespace util {
+
+using ::testing::Not;
+using ::testing::Pointee;
+
+enum class ParseError : uint8_t {
+  kEmpty,
+  kBadDigit,
+};
+
+absl::Status ToStatus(ParseError error) {
+  switch (error) {
+    case ParseError::kEmpty:
+      return absl::InvalidArgumentError("Empty");
+    case ParseError::kBadDigit:
+      return absl::InvalidArgumentError("Bad digit");
+  }
+  return absl::InternalError("Unknown ParseError");
+}
+
+static_assert(std::is_trivially_copyable_v<Result<int, ParseError>>);
+static_assert(std::is_trivially_copyable_v<Result<void, ParseError>>);
+static_assert(sizeof(Result<int, ParseError>) == 2 * sizeof(int));
+static_assert(!std::is_trivially_copyable_v<Result<std::string, ParseError>>);
+
+Result<int, ParseError> ParseDigit(char c) {
+  if (c < '0' || c > '9') {
+    return Error{ ParseError::kBadDigit };
+  }
+  return c - '0';
+}
+
+Result<int, ParseError> ParseNumber(std::string_view s) {
+  if (s.empty()) {
+    return Error{ ParseError::kEmpty };
+  }
+  int value = 0;
+  for (char c : s) {
+    DEFINE_OR_RETURN_RESULT(int, digit, ParseDigit(c));
+    value = 10 * value + digit;
+  }
+  return value;
+}
+
+Result<void, ParseError> CheckNumber(std::string_view s) {
+  RETURN_IF_ERROR_RESULT(ParseNumber(s));
+  return {};
+}
+
+Result<int, ParseError> SumNumbers(std::string_view s1, std::string_view s2) {
+  int n1;
+  ASSIGN_OR_RETURN_RESULT(n1, ParseNumber(s1));
+  DEFINE_OR_RETURN_RESULT(int, n2, ParseNumber(s2));
+  return n1 + n2;
+}
+
+TEST(ResultTest, TestValue) {
+  Result<int, ParseError> result = 3;
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.value(), 3);
+  EXPECT_EQ(*result, 3);
+  EXPECT_EQ(result.value_or(4), 3);
+  EXPECT_THAT(result, IsOk());
+  EXPECT_THAT(result, IsOkAndHolds(3));
+  EXPECT_EQ(result, (Result<int, ParseError>(3)));
+}
+
+TEST(ResultTest, TestError) {
+  Result<int, ParseError> result = Error{ ParseError::kBadDigit };
+  ASSERT_FALSE(result.ok());
+  EXPECT_EQ(result.error(), ParseError::kBadDigit);
+  EXPECT_EQ(result.value_or(4), 4);
+  EXPECT_THAT(result, Not(IsOk()));
+  EXPECT_THAT(result, Not(IsOkAndHolds(3)));
+  EXPECT_NE(result, (Result<int, ParseError>(Error{ ParseError::kEmpty })));
+}
+
+// The value and error types may be the same.
+TEST(ResultTest, TestSameTypes) {
+  Result<int, int> value = 3;
+  Result<int, int> error = Error{ 3 };
+  EXPECT_THAT(value, IsOkAndHolds(3));
+  EXPECT_FALSE(error.ok());
+  EXPECT_EQ(error.error(), 3);
+  EXPECT_NE(value, error);
+}
+
+TEST(ResultTest, TestCopyAndAssign) {
+  Result<std::string, std::string> value = std::string(64, 'v');
+  Result<std::string, std::string> error = Error{ std::string(64, 'e') };
+  Result<std::string, std::string> copy = value;
+  EXPECT_THAT(copy, IsOkAndHolds(std::string(64, 'v')));
+  copy = error;
+  EXPECT_EQ(copy.error(), std::string(64, 'e'));
+  copy = std::move(value);
+  EXPECT_THAT(copy, IsOkAndHolds(std::string(64, 'v')));
+  Result<std::string, std::string> moved = std::move(error);
+  EXPECT_EQ(moved, (Result<std::string, std::string>(
+                       Error{ std::string(64, 'e') })));
+}
+
+TEST(ResultTest, TestMoveOnly) {
+  Result<std::unique_ptr<int>, ParseError> result = std::make_unique<int>(3);
+  EXPECT_THAT(result, IsOkAndHolds(Pointee(3)));
+  EXPECT_EQ(*result->get(), 3);
+  std::unique_ptr<int> ptr = *std::move(result);
+  EXPECT_THAT(ptr, Pointee(3));
+}
+
+TEST(ResultTest, TestMacros) {
+  EXPECT_THAT(ParseNumber("123"), IsOkAndHolds(123));
+  EXPECT_EQ(ParseNumber("1x3").error(), ParseError::kBadDigit);
+  EXPECT_EQ(ParseNumber("").error(), ParseError::kEmpty);
+
+  EXPECT_THAT(CheckNumber("12"), IsOk());
+  EXPECT_EQ(CheckNumber("a").error(), ParseError::kBadDigit);
+
+  EXPECT_THAT(SumNumbers("12", "30"), IsOkAndHolds(42));
+  EXPECT_EQ(SumNumbers("", "30").error(), ParseError::kEmpty);
+  EXPECT_EQ(SumNumbers("12", "3-").error(), ParseError::kBadDigit);
+}
+
+TEST(ResultTest, TestToStatusOr) {
+  EXPECT_THAT(ToStatusOr(ParseNumber("12")), IsOkAndHolds(12));
+  EXPECT_EQ(ToStatusOr(ParseNumber("1x")).status(),
+            absl::InvalidArgumentError("Bad digit"));
+  EXPECT_THAT(ToStatus(CheckNumber("12")), IsOk());
+  EXPECT_EQ(ToStatus(CheckNumber("")), absl::InvalidArgumentError("Empty"));
+
+  EXPECT_EQ(ToStatusOr(Result<int, absl::StatusCode>(
+                           Error{ absl::StatusCode::kNotFound }))
+                .status()
+                .code(),
+            absl::StatusCode::kNotFound);
+}
+
+TEST(ResultTest, TestToResult) {
+  EXPECT_THAT(ToResult(absl::StatusOr<int>(3)), IsOkAndHolds(3));
+  EXPECT_EQ(ToResult(absl::StatusOr<int>(absl::NotFoundError("missing")))
+                .error(),
+            absl::StatusCode::kNotFound);
+  EXPECT_THAT(ToResult(absl::OkStatus()), IsOk());
+  EXPECT_EQ(ToResult(absl::InternalError("")).error(),
+            absl::StatusCode::kInternal);
+}
+
+}  // namespace util
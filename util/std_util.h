@@ -1,25 +1,41 @@
 #pragma once
 
 #include <optional>
+#include <utility>
 
 #include "util/macro_util.h"
 
-#define RETURN_IF_NULL(expr) \
-  do {                       \
-    auto _opt = (expr);      \
-    if (!_opt.has_value()) { \
-      return std::nullopt;   \
-    }                        \
+#define RETURN_IF_NULL(expr)                \
+  do {                                      \
+    if (!(expr).has_value()) [[unlikely]] { \
+      return std::nullopt;                  \
+    }                                       \
   } while (0)
 
 #define DEFINE_OR_RETURN_OPT_IMPL(type, lhs, tmp, ...) \
   std::optional<type> tmp = (__VA_ARGS__);             \
-  if (!(tmp).has_value()) {                            \
+  if (!(tmp).has_value()) [[unlikely]] {               \
     return std::nullopt;                               \
   }                                                    \
-  type &lhs = (tmp).value()
+  type &lhs = *(tmp)
 
+// Evaluates an expression that returns a std::optional<T>, and defines a new
+// variable with given type and name referring to its value in place. If the
+// optional is empty, returns std::nullopt.
 #define DEFINE_OR_RETURN_OPT(type, lhs, ...)                              \
   DEFINE_OR_RETURN_OPT_IMPL(                                              \
       type, lhs, UTILS_CONCAT_NAME(__define_or_return_opt_, __COUNTER__), \
       __VA_ARGS__)
+
+#define ASSIGN_OR_RETURN_OPT_IMPL(tmp, lhs, ...) \
+  auto tmp = (__VA_ARGS__);                      \
+  if (!(tmp).has_value()) [[unlikely]] {         \
+    return std::nullopt;                         \
+  }                                              \
+  lhs = *std::move(tmp)  // NOLINT(bugprone-macro-parentheses)
+
+// Evaluates an expression that returns a std::optional, moving its value into
+// lhs, or returns std::nullopt if it is empty.
+#define ASSIGN_OR_RETURN_OPT(lhs, ...)                                       \
+  ASSIGN_OR_RETURN_OPT_IMPL(UTILS_CONCAT_NAME(_optional_value, __COUNTER__), \
+                            lhs, __VA_ARGS__)